@@ -0,0 +1,324 @@
+// Heap arena benchmark: GameArena (what heap_hooks.cpp serves the game's
+// HeapAlloc calls from) under a game-like churn of short-lived effects and
+// longer-lived objects, without Windows or the hooks. A straight run times
+// the arena against malloc/free on the same trace and reports how much
+// memory its size classes and free lists hold beyond the live bytes; a
+// rollback run saves the arena every frame, rewinds it a few frames at a
+// time, and checks that every live block comes back intact and that
+// pointers the rewind discarded are refused instead of freed.
+
+#include "game_arena.h"
+#include "input_streams.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using namespace FM2K;
+using State::GameArena;
+
+struct Options {
+    uint32_t frames = 20000;
+    uint32_t capacity_mb = 16;
+    uint32_t rollback_interval = 4;     // Frames between rollbacks in the rollback run
+    uint32_t max_depth = 7;             // Deepest rollback; the snapshot ring holds depth + 1
+    uint32_t seed = 0x4152454E;
+};
+
+using Clock = std::chrono::steady_clock;
+
+double ElapsedNs(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+struct Block {
+    uint8_t* ptr;
+    uint32_t size;
+    uint32_t death;     // Frame it is freed on
+    uint32_t tag;
+};
+
+// Mostly small effect and projectile records living a few frames, some
+// mid-sized ones living seconds, and the odd large buffer
+uint32_t NextSize(uint32_t& rng) {
+    uint32_t roll = Bench::NextRandom(rng) % 100;
+    if (roll < 70) return 16 + Bench::NextRandom(rng) % 240;
+    if (roll < 97) return 256 + Bench::NextRandom(rng) % 3840;
+    return 16384 + Bench::NextRandom(rng) % 49152;
+}
+
+uint32_t NextLifetime(uint32_t& rng) {
+    return Bench::NextRandom(rng) % 10 < 8 ? 1 + Bench::NextRandom(rng) % 30 : 60 + Bench::NextRandom(rng) % 600;
+}
+
+// The tag in the first and last four bytes, so a block clobbered or
+// restored from the wrong snapshot shows up
+void Stamp(const Block& block) {
+    std::memcpy(block.ptr, &block.tag, sizeof(block.tag));
+    std::memcpy(block.ptr + block.size - sizeof(block.tag), &block.tag, sizeof(block.tag));
+}
+
+bool Intact(const Block& block) {
+    uint32_t head, tail;
+    std::memcpy(&head, block.ptr, sizeof(head));
+    std::memcpy(&tail, block.ptr + block.size - sizeof(tail), sizeof(tail));
+    return head == block.tag && tail == block.tag;
+}
+
+struct Churn {
+    std::vector<Block> live;
+    uint32_t rng;
+    uint32_t next_tag = 1;
+
+    explicit Churn(uint32_t seed) : rng(seed ? seed : 1) {}
+
+    // One frame: free what dies now, then allocate 0-7 new blocks. Returns
+    // the ns spent in the allocator calls alone.
+    template<typename Alloc, typename Free>
+    double Step(uint32_t frame, Alloc&& alloc, Free&& free, uint64_t& ops, uint64_t& failures) {
+        double ns = 0;
+        for (size_t i = 0; i < live.size();) {
+            if (live[i].death != frame) {
+                i++;
+                continue;
+            }
+            Clock::time_point start = Clock::now();
+            free(live[i].ptr);
+            ns += ElapsedNs(start);
+            ops++;
+            live[i] = live.back();
+            live.pop_back();
+        }
+        uint32_t count = Bench::NextRandom(rng) % 8;
+        for (uint32_t n = 0; n < count; n++) {
+            Block block = {};
+            block.size = NextSize(rng);
+            block.death = frame + NextLifetime(rng);
+            block.tag = next_tag++;
+            Clock::time_point start = Clock::now();
+            block.ptr = static_cast<uint8_t*>(alloc(block.size));
+            ns += ElapsedNs(start);
+            ops++;
+            if (!block.ptr) {
+                failures++;
+                continue;
+            }
+            Stamp(block);
+            live.push_back(block);
+        }
+        return ns;
+    }
+};
+
+struct StraightResult {
+    double ns;
+    uint64_t ops;
+    uint64_t failures;
+    size_t peak_reserved;           // Highest class-rounded bytes in use
+    GameArena::Stats stats;         // At the end of the run
+};
+
+StraightResult RunArena(const Options& options, GameArena& arena) {
+    StraightResult result = {};
+    Churn churn(options.seed);
+    for (uint32_t frame = 0; frame < options.frames; frame++) {
+        arena.BeginFrame();
+        result.ns += churn.Step(
+            frame, [&](size_t size) { return arena.Allocate(size); }, [&](void* ptr) { arena.Free(ptr); },
+            result.ops, result.failures);
+        result.peak_reserved = std::max(result.peak_reserved, arena.GetStats().bytes_reserved);
+    }
+    result.stats = arena.GetStats();
+    for (const Block& block : churn.live) arena.Free(block.ptr);
+    return result;
+}
+
+StraightResult RunMalloc(const Options& options) {
+    StraightResult result = {};
+    Churn churn(options.seed);
+    for (uint32_t frame = 0; frame < options.frames; frame++) {
+        result.ns += churn.Step(
+            frame, [](size_t size) { return std::malloc(size); }, [](void* ptr) { std::free(ptr); }, result.ops,
+            result.failures);
+    }
+    for (const Block& block : churn.live) std::free(block.ptr);
+    return result;
+}
+
+struct RollbackResult {
+    uint64_t saves;
+    uint64_t save_ns;
+    uint64_t snapshot_bytes;
+    uint64_t rollbacks;
+    uint64_t load_ns;
+    uint64_t corrupt;           // Live blocks not intact after a load
+    uint64_t stale_offered;     // Pointers discarded by a load, freed anyway
+    uint64_t stale_accepted;    // ...that the arena took as live (must be 0)
+    uint64_t failures;
+};
+
+// A pointer the game kept across a load that discarded its block
+void OfferStale(GameArena& arena, uint8_t* ptr, RollbackResult& result) {
+    result.stale_offered++;
+    size_t live_before = arena.GetStats().bytes_live;
+    if (arena.IsLive(ptr)) result.stale_accepted++;
+    arena.Free(ptr);
+    if (arena.GetStats().bytes_live != live_before) result.stale_accepted++;
+}
+
+RollbackResult RunRollback(const Options& options, GameArena& arena) {
+    RollbackResult result = {};
+    arena.Reset();
+
+    const uint32_t slots = options.max_depth + 1;
+    std::vector<std::vector<uint8_t>> snapshots(slots);
+    std::vector<std::vector<Block>> saved_live(slots);
+    std::vector<uint32_t> saved_frame(slots, UINT32_MAX);
+    for (std::vector<uint8_t>& snapshot : snapshots) snapshot.resize(arena.MaxSnapshotSize());
+
+    Churn churn(options.seed);
+    uint64_t ops = 0;
+    uint32_t last_rollback = 0;     // Frames are resimulated up to here before rolling back again
+    std::vector<uint8_t*> held_stale;
+    for (uint32_t frame = 0; frame < options.frames; frame++) {
+        uint32_t slot = frame % slots;
+        Clock::time_point start = Clock::now();
+        size_t size = arena.Save(snapshots[slot].data(), snapshots[slot].size());
+        result.save_ns += static_cast<uint64_t>(ElapsedNs(start));
+        result.snapshot_bytes += size;
+        result.saves++;
+        saved_live[slot] = churn.live;
+        saved_frame[slot] = frame;
+
+        churn.Step(
+            frame, [&](size_t bytes) { return arena.Allocate(bytes); }, [&](void* ptr) { arena.Free(ptr); }, ops,
+            result.failures);
+
+        if (options.rollback_interval == 0 || frame % options.rollback_interval != 0 || frame < options.max_depth ||
+            frame <= last_rollback) {
+            continue;
+        }
+        last_rollback = frame;
+
+        // Back to the start of an earlier frame
+        uint32_t depth = 1 + Bench::NextRandom(churn.rng) % options.max_depth;
+        uint32_t target = frame + 1 - depth;
+        uint32_t target_slot = target % slots;
+        if (saved_frame[target_slot] != target) continue;
+
+        // Last rollback's discarded pointers, offered again once the arena
+        // has carved new blocks over where they pointed
+        for (uint8_t* ptr : held_stale) {
+            bool live = std::any_of(churn.live.begin(), churn.live.end(),
+                                    [&](const Block& block) { return block.ptr == ptr; });
+            if (!live) OfferStale(arena, ptr, result);
+        }
+        held_stale.clear();
+
+        std::vector<Block> discarded = churn.live;
+        start = Clock::now();
+        bool loaded = arena.Load(snapshots[target_slot].data(), snapshots[target_slot].size());
+        result.load_ns += static_cast<uint64_t>(ElapsedNs(start));
+        result.rollbacks++;
+        churn.live = saved_live[target_slot];
+        for (const Block& block : churn.live) {
+            if (!loaded || !arena.IsLive(block.ptr) || !Intact(block)) result.corrupt++;
+        }
+
+        // Pointers only the abandoned timeline knew. One whose address is
+        // live again in the restored one is that block's, not stale.
+        for (const Block& block : discarded) {
+            bool restored = std::any_of(churn.live.begin(), churn.live.end(),
+                                        [&](const Block& live) { return live.ptr == block.ptr; });
+            if (restored) continue;
+            OfferStale(arena, block.ptr, result);
+            held_stale.push_back(block.ptr);
+        }
+
+        // Resume from the restored frame
+        frame = target - 1;
+    }
+    return result;
+}
+
+void PrintUsage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --frames N      Frames per run (default 20000)\n"
+        "  --capacity N    Arena size in MB (default 16)\n"
+        "  --interval N    Frames between rollbacks in the rollback run (default 4, 0 = none)\n"
+        "  --depth N       Deepest rollback (default 7)\n"
+        "  --seed N        Churn seed\n",
+        program);
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        uint32_t* out = nullptr;
+        if (!std::strcmp(arg, "--frames")) out = &options.frames;
+        else if (!std::strcmp(arg, "--capacity")) out = &options.capacity_mb;
+        else if (!std::strcmp(arg, "--interval")) out = &options.rollback_interval;
+        else if (!std::strcmp(arg, "--depth")) out = &options.max_depth;
+        else if (!std::strcmp(arg, "--seed")) out = &options.seed;
+        if (!out || !value) return false;
+        *out = static_cast<uint32_t>(std::strtoul(value, nullptr, 0));
+        i++;
+    }
+    return options.capacity_mb > 0 && options.max_depth > 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    size_t capacity = static_cast<size_t>(options.capacity_mb) * 1024 * 1024;
+    std::vector<uint8_t> storage(capacity + GameArena::ALIGNMENT);
+    uint8_t* memory = storage.data();
+    memory += (GameArena::ALIGNMENT - reinterpret_cast<uintptr_t>(memory) % GameArena::ALIGNMENT) % GameArena::ALIGNMENT;
+    GameArena arena;
+    if (!arena.Init(memory, capacity)) {
+        std::fprintf(stderr, "Arena init failed\n");
+        return 1;
+    }
+
+    StraightResult straight = RunArena(options, arena);
+    StraightResult baseline = RunMalloc(options);
+    RollbackResult rollback = RunRollback(options, arena);
+
+    const GameArena::Stats& stats = straight.stats;
+    std::printf("FM2K arena bench: %u MB arena, %u frames, %zu size classes\n", options.capacity_mb, options.frames,
+                GameArena::CLASS_COUNT);
+    std::printf("Speed:   arena %.1f ns/op, malloc %.1f ns/op over %llu allocs+frees\n",
+                straight.ops ? straight.ns / straight.ops : 0.0, baseline.ops ? baseline.ns / baseline.ops : 0.0,
+                (unsigned long long)straight.ops);
+    std::printf("Memory:  live %zu KB (peak %zu KB), reserved %zu KB (peak %zu KB), high water %zu KB\n",
+                stats.bytes_live / 1024, stats.bytes_peak / 1024, stats.bytes_reserved / 1024,
+                straight.peak_reserved / 1024, stats.high_water / 1024);
+    std::printf("Frag:    classes+headers %.2fx live, high water %.2fx peak reserved, %llu failures\n",
+                stats.bytes_live ? (double)stats.bytes_reserved / stats.bytes_live : 0.0,
+                straight.peak_reserved ? (double)stats.high_water / straight.peak_reserved : 0.0,
+                (unsigned long long)straight.failures);
+    std::printf("Rollback: save %.1f us (%.0f KB avg), %llu loads at %.1f us\n",
+                rollback.saves ? rollback.save_ns / 1000.0 / rollback.saves : 0.0,
+                rollback.saves ? rollback.snapshot_bytes / 1024.0 / rollback.saves : 0.0,
+                (unsigned long long)rollback.rollbacks,
+                rollback.rollbacks ? rollback.load_ns / 1000.0 / rollback.rollbacks : 0.0);
+    bool ok = rollback.corrupt == 0 && rollback.stale_accepted == 0 && straight.failures == 0 &&
+              rollback.failures == 0 && arena.GetStats().stale == rollback.stale_offered;
+    std::printf("Verify:  %llu blocks corrupt after a load, %llu of %llu discarded pointers accepted, %llu failures\n",
+                (unsigned long long)rollback.corrupt, (unsigned long long)rollback.stale_accepted,
+                (unsigned long long)rollback.stale_offered,
+                (unsigned long long)(straight.failures + rollback.failures));
+    return ok ? 0 : 1;
+}
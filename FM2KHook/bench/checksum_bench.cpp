@@ -0,0 +1,194 @@
+// Checksum kernel benchmark: GB/s of each Fletcher32 kernel the CPU supports
+// (FM2K_Checksum.h, run through Fletcher32With) and of Hash64, over buffers
+// from a single object slot up to the whole hook state. Before timing, every
+// kernel is checked against the scalar one on random lengths, misaligned
+// starts and all-0xFF data (the sums' worst case for the mod-65535 folds),
+// and Hash64 against published XXH64 values.
+
+#include "FM2K_Checksum.h"
+#include "input_streams.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using namespace FM2K;
+using Checksum::Kernel;
+
+constexpr Kernel KERNELS[] = { Kernel::Scalar, Kernel::SSE2, Kernel::AVX2 };
+
+// A live object slot, the input history window, a page, the hook state, a
+// large heap arena
+constexpr size_t SIZES[] = { 382, 4096, 8192, 262144, 4 * 1024 * 1024 };
+
+struct Options {
+    uint32_t megabytes = 64;        // Hashed per kernel and size
+    uint32_t cases = 20000;         // Random cross-checks per kernel
+    uint32_t seed = 1;
+};
+
+using Clock = std::chrono::steady_clock;
+
+void FillRandom(std::vector<uint8_t>& bytes, uint32_t& rng) {
+    for (uint8_t& byte : bytes) byte = static_cast<uint8_t>(Bench::NextRandom(rng));
+}
+
+// Every supported kernel against scalar; returns mismatches
+uint64_t CrossCheck(const Options& options, uint32_t& rng) {
+    uint64_t mismatches = 0;
+    std::vector<uint8_t> data(SIZES[4] + 64);
+    FillRandom(data, rng);
+
+    auto check = [&](const uint8_t* p, size_t len) {
+        uint32_t expected = Checksum::Fletcher32With(Kernel::Scalar, p, len);
+        for (Kernel kernel : KERNELS) {
+            if (!Checksum::KernelSupported(kernel) || kernel == Kernel::Scalar) continue;
+            if (Checksum::Fletcher32With(kernel, p, len) == expected) continue;
+            if (mismatches++ < 8) {
+                std::fprintf(stderr, "%s differs from scalar: %zu bytes at offset %zu\n", Checksum::KernelName(kernel),
+                             len, static_cast<size_t>(p - data.data()));
+            }
+        }
+        if (Checksum::Fletcher32(p, len) != expected) mismatches++;
+    };
+
+    // Every short length at every alignment a block kernel can see
+    for (size_t len = 0; len <= 256; len++) {
+        for (size_t offset = 0; offset < 32; offset++) check(data.data() + offset, len);
+    }
+    for (uint32_t n = 0; n < options.cases; n++) {
+        size_t len = Bench::NextRandom(rng) % (n % 16 == 0 ? SIZES[4] : 65536);
+        check(data.data() + Bench::NextRandom(rng) % 64, len);
+    }
+    for (size_t size : SIZES) check(data.data(), size);
+
+    // Largest possible sums: the modular folds have to keep up
+    std::memset(data.data(), 0xFF, data.size());
+    for (size_t size : SIZES) {
+        check(data.data(), size);
+        check(data.data() + 1, size - 1);
+    }
+    return mismatches;
+}
+
+// Published XXH64 values, seed 0
+uint32_t CheckHash64() {
+    struct Vector {
+        const char* text;
+        uint64_t seed;
+        uint64_t hash;
+    };
+    const Vector vectors[] = {
+        { "", 0, 0xEF46DB3751D8E999ull },
+        { "a", 0, 0xD24EC4F1A98C6E5Bull },
+        { "abc", 0, 0x44BC2CF5AD770999ull },
+        { "Nobody inspects the spammish repetition", 0, 0xFBCEA83C8A378BF1ull },
+    };
+    uint32_t failures = 0;
+    for (const Vector& vector : vectors) {
+        uint64_t hash = Checksum::Hash64(vector.text, std::strlen(vector.text), vector.seed);
+        if (hash == vector.hash) continue;
+        failures++;
+        std::fprintf(stderr, "Hash64(\"%s\") = %016llx, expected %016llx\n", vector.text, (unsigned long long)hash,
+                     (unsigned long long)vector.hash);
+    }
+    return failures;
+}
+
+// GB/s hashing `size` bytes repeatedly until `megabytes` have gone through
+template <typename Hash>
+double Throughput(const std::vector<uint8_t>& data, size_t size, uint32_t megabytes, Hash hash) {
+    size_t rounds = static_cast<size_t>(megabytes) * 1024 * 1024 / size;
+    if (rounds == 0) rounds = 1;
+    volatile uint64_t sink = 0;
+
+    Clock::time_point start = Clock::now();
+    for (size_t round = 0; round < rounds; round++) sink = sink + hash(data.data(), size);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    (void)sink;
+    return seconds > 0.0 ? static_cast<double>(rounds * size) / seconds / 1e9 : 0.0;
+}
+
+void PrintUsage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --megabytes N  Bytes hashed per kernel and size, in MB (default 64)\n"
+        "  --cases N      Random-length cross-checks against scalar (default 20000)\n"
+        "  --seed N       Data seed (default 1)\n",
+        program);
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto number = [&](uint32_t& out) {
+            if (!value) return false;
+            out = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+            i++;
+            return true;
+        };
+
+        bool ok = true;
+        if (!std::strcmp(arg, "--megabytes")) ok = number(options.megabytes);
+        else if (!std::strcmp(arg, "--cases")) ok = number(options.cases);
+        else if (!std::strcmp(arg, "--seed")) ok = number(options.seed);
+        else ok = false;
+
+        if (!ok) return false;
+    }
+    return options.megabytes > 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    uint32_t rng = options.seed * 0x9E3779B1u | 1;
+    uint64_t mismatches = CrossCheck(options, rng);
+    uint32_t hash_failures = CheckHash64();
+
+    std::vector<uint8_t> data(SIZES[4]);
+    FillRandom(data, rng);
+
+    std::printf("FM2K checksum bench: %u MB per measurement, active kernel %s\n", options.megabytes,
+                Checksum::KernelName(Checksum::ActiveKernel()));
+    std::printf("%-10s", "GB/s");
+    for (size_t size : SIZES) std::printf(" %10zu", size);
+    std::printf("\n");
+
+    for (Kernel kernel : KERNELS) {
+        if (!Checksum::KernelSupported(kernel)) {
+            std::printf("%-10s unsupported on this CPU\n", Checksum::KernelName(kernel));
+            continue;
+        }
+        std::printf("%-10s", Checksum::KernelName(kernel));
+        for (size_t size : SIZES) {
+            double rate = Throughput(data, size, options.megabytes, [kernel](const uint8_t* p, size_t len) {
+                return static_cast<uint64_t>(Checksum::Fletcher32With(kernel, p, len));
+            });
+            std::printf(" %10.2f", rate);
+        }
+        std::printf("\n");
+    }
+    std::printf("%-10s", "Hash64");
+    for (size_t size : SIZES) {
+        double rate = Throughput(data, size, options.megabytes,
+                                 [](const uint8_t* p, size_t len) { return Checksum::Hash64(p, len); });
+        std::printf(" %10.2f", rate);
+    }
+    std::printf("\n");
+
+    bool ok = mismatches == 0 && hash_failures == 0;
+    std::printf("Verify:  %llu kernel results differ from scalar, %u Hash64 reference mismatches\n",
+                (unsigned long long)mismatches, hash_failures);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,267 @@
+// Delta ring benchmark: DeltaSnapshotRing (XOR deltas between keyframes,
+// delta_ring.h) against the flat FrameRing on the same SyntheticEngine
+// states. Every frame captures the hook's state plan and saves it into both;
+// every few frames a rollback restores an older frame from both, checks the
+// delta ring rebuilt exactly the flat ring's bytes and resimulates from
+// there. Reports bytes stored per frame and us per save and restore for the
+// flat ring and for each keyframe interval.
+
+#include "synthetic_engine.h"
+#include "delta_ring.h"
+#include "frame_ring.h"
+#include "input_streams.h"
+#include "state_schema.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using namespace FM2K;
+
+// Same window as the hook's snapshot ring (dllmain.cpp)
+constexpr uint32_t INPUT_PREDICTION_WINDOW = 8;
+constexpr uint32_t SNAPSHOT_RING_SLOTS = INPUT_PREDICTION_WINDOW + 2;
+
+constexpr uint32_t KEYFRAME_INTERVALS[] = { 2, 4, 8, 16 };
+
+struct Options {
+    uint32_t frames = 6000;
+    uint32_t rollback_interval = 4;
+    uint32_t max_depth = INPUT_PREDICTION_WINDOW;
+    uint32_t objects = 64;
+    Bench::ObjectPattern pattern = Bench::ObjectPattern::Clustered;
+    uint32_t seed = 1;
+};
+
+using Clock = std::chrono::steady_clock;
+
+uint64_t Nanoseconds(Clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+}
+
+struct Timing {
+    uint64_t count = 0;
+    uint64_t ns = 0;
+    uint64_t max_ns = 0;
+
+    void Add(uint64_t sample) {
+        count++;
+        ns += sample;
+        max_ns = std::max(max_ns, sample);
+    }
+    double AverageUs() const { return count ? static_cast<double>(ns) / static_cast<double>(count) / 1000.0 : 0.0; }
+};
+
+struct Result {
+    Timing save;
+    Timing restore;
+    double bytes_per_frame;     // Stored bytes over the frames the window holds
+    size_t bytes_reserved;
+    uint64_t keyframes;
+    uint64_t deltas_applied;
+    uint64_t rollbacks;
+    uint64_t mismatches;        // Restores that differ from the flat ring's copy
+    uint64_t missing;           // Frames in the window the ring could not restore
+};
+
+// Run the engine with forced rollbacks, saving every frame into the flat ring
+// and, when `keyframe_interval` is non-zero, a delta ring beside it
+Result Run(const Options& options, const State::SnapshotPlan& plan, uint32_t keyframe_interval) {
+    Result result = {};
+    size_t state_size = plan.BufferSize();
+
+    Bench::SyntheticEngine engine;
+    Bench::SyntheticEngine::Config config;
+    config.active_objects = options.objects;
+    config.pattern = options.pattern;
+    config.seed = options.seed;
+    engine.Reset(config);
+    auto& memory = engine.Memory();
+
+    State::FrameRing flat;
+    State::DeltaSnapshotRing delta;
+    if (!flat.Init(SNAPSHOT_RING_SLOTS, state_size) ||
+        (keyframe_interval && !delta.Init(state_size, SNAPSHOT_RING_SLOTS, keyframe_interval))) {
+        std::fprintf(stderr, "Failed to set up %zu-byte snapshot rings\n", state_size);
+        result.missing++;
+        return result;
+    }
+    std::vector<uint8_t> state(state_size);
+    std::vector<uint8_t> restored(state_size);
+
+    uint32_t rng = options.seed * 0x9E3779B1u | 1;
+    uint64_t stored_samples = 0;
+    double stored_total = 0.0;
+    // `step` counts frames run, resimulated ones included; `frame` rewinds.
+    // As under GekkoNet, no rollback reaches more than max_depth behind the
+    // furthest frame run.
+    uint32_t frame = 0;
+    uint32_t furthest = 0;
+    for (uint32_t step = 0; step < options.frames; step++, frame++) {
+        plan.Capture(memory, state.data());
+
+        Clock::time_point start = Clock::now();
+        if (keyframe_interval) {
+            delta.Save(frame, state.data());
+        } else {
+            uint32_t slot = 0;
+            uint8_t* buffer = flat.Acquire(frame, &slot);
+            if (buffer) {
+                std::memcpy(buffer, state.data(), state_size);
+                flat.Commit(slot);
+            }
+        }
+        result.save.Add(Nanoseconds(start));
+
+        // The flat ring is the reference either way
+        if (keyframe_interval) {
+            uint32_t slot = 0;
+            uint8_t* buffer = flat.Acquire(frame, &slot);
+            if (buffer) {
+                std::memcpy(buffer, state.data(), state_size);
+                flat.Commit(slot);
+            }
+            stored_total += static_cast<double>(delta.GetStats().bytes_stored);
+            stored_samples++;
+        }
+
+        engine.Step(Bench::NextRandom(rng) & 0x7FF, Bench::NextRandom(rng) & 0x7FF);
+        furthest = std::max(furthest, frame + 1);
+
+        uint32_t reach = options.max_depth - (furthest - (frame + 1));
+        if (options.rollback_interval == 0 || step % options.rollback_interval != options.rollback_interval - 1 ||
+            reach == 0 || frame < reach) {
+            continue;
+        }
+
+        // Back to a saved frame inside the window; its state is loaded and
+        // the loop saves it again, as resimulation does
+        uint32_t depth = 1 + Bench::NextRandom(rng) % reach;
+        uint32_t target = frame + 1 - depth;
+        uint32_t slot = 0;
+        const uint8_t* reference = flat.Find(target, &slot);
+        result.rollbacks++;
+
+        start = Clock::now();
+        bool ok = false;
+        if (keyframe_interval) {
+            ok = delta.Restore(target, restored.data());
+        } else if (reference) {
+            std::memcpy(restored.data(), reference, state_size);
+            ok = true;
+        }
+        result.restore.Add(Nanoseconds(start));
+
+        if (!ok || !reference) {
+            result.missing++;
+            continue;
+        }
+        if (std::memcmp(restored.data(), reference, state_size) != 0) result.mismatches++;
+        plan.Restore(memory, restored.data());
+        flat.InvalidateAfter(target);
+        frame = target - 1;
+    }
+
+    if (keyframe_interval) {
+        auto stats = delta.GetStats();
+        result.bytes_per_frame = stored_samples ? stored_total / stored_samples / SNAPSHOT_RING_SLOTS : 0.0;
+        result.bytes_reserved = stats.bytes_reserved;
+        result.keyframes = stats.keyframes;
+        result.deltas_applied = stats.deltas_applied;
+    } else {
+        result.bytes_per_frame = static_cast<double>(state_size);
+        result.bytes_reserved = flat.SlotCount() * state_size;
+    }
+    return result;
+}
+
+void PrintUsage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --frames N              Frames to run per ring (default 6000)\n"
+        "  --rollback-interval N   Frames between forced rollbacks (default 4, 0 = none)\n"
+        "  --max-depth N           Deepest rollback, 1-%u (default %u)\n"
+        "  --objects N             Live objects in the pool (default 64)\n"
+        "  --pattern P             clustered or scattered (default clustered)\n"
+        "  --seed N                Random seed (default 1)\n",
+        program, SNAPSHOT_RING_SLOTS - 1, INPUT_PREDICTION_WINDOW);
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto number = [&](uint32_t& out) {
+            if (!value) return false;
+            out = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+            i++;
+            return true;
+        };
+
+        bool ok = true;
+        if (!std::strcmp(arg, "--frames")) ok = number(options.frames);
+        else if (!std::strcmp(arg, "--rollback-interval")) ok = number(options.rollback_interval);
+        else if (!std::strcmp(arg, "--max-depth")) ok = number(options.max_depth);
+        else if (!std::strcmp(arg, "--objects")) ok = number(options.objects);
+        else if (!std::strcmp(arg, "--seed")) ok = number(options.seed);
+        else if (!std::strcmp(arg, "--pattern") && value) {
+            if (!std::strcmp(value, "clustered")) options.pattern = Bench::ObjectPattern::Clustered;
+            else if (!std::strcmp(value, "scattered")) options.pattern = Bench::ObjectPattern::Scattered;
+            else ok = false;
+            i++;
+        }
+        else ok = false;
+
+        if (!ok) return false;
+    }
+    return options.frames > 0 && options.max_depth >= 1 && options.max_depth < SNAPSHOT_RING_SLOTS;
+}
+
+void PrintResult(const char* name, const Result& result) {
+    std::printf("%-12s %10.0f %10zu %9.1f %9.1f %9.1f %9.1f %7llu %8llu\n", name, result.bytes_per_frame,
+                result.bytes_reserved, result.save.AverageUs(), result.save.max_ns / 1000.0, result.restore.AverageUs(),
+                result.restore.max_ns / 1000.0, (unsigned long long)result.rollbacks,
+                (unsigned long long)(result.mismatches + result.missing));
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    // The hook's plan: every Whole field and the whole object pool
+    uint32_t captures = State::CaptureBit(State::Capture::Whole) | State::CaptureBit(State::Capture::Pool);
+    auto regions = State::PackFields(State::STATE_SCHEMA, captures);
+    auto runs = State::MergeRuns(regions);
+    State::SnapshotPlan plan(runs.begin(), runs.count);
+
+    std::printf("FM2K delta ring bench: %zu-byte states, %u-frame window, %u objects %s, rollback every %u frames up to %u deep\n",
+                plan.BufferSize(), SNAPSHOT_RING_SLOTS, options.objects,
+                options.pattern == Bench::ObjectPattern::Clustered ? "clustered" : "scattered",
+                options.rollback_interval, options.max_depth);
+    std::printf("%-12s %10s %10s %9s %9s %9s %9s %7s %8s\n", "ring", "B/frame", "reserved", "save us", "max us",
+                "load us", "max us", "loads", "bad");
+
+    Result flat = Run(options, plan, 0);
+    PrintResult("flat", flat);
+    bool ok = flat.mismatches == 0 && flat.missing == 0;
+
+    for (uint32_t interval : KEYFRAME_INTERVALS) {
+        Result result = Run(options, plan, interval);
+        char name[24];
+        std::snprintf(name, sizeof(name), "delta k=%u", interval);
+        PrintResult(name, result);
+        ok = ok && result.mismatches == 0 && result.missing == 0;
+    }
+
+    std::printf("Verify:  %s\n", ok ? "every delta restore matched the flat ring's copy" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,245 @@
+// Frame pacer check: drives FramePacer (frame_pacer.h) through a fake
+// PacerClock, so timing is simulated and every run is deterministic. Each
+// scenario runs the game loop the hook runs (work, then Wait) and reports the
+// pacer's own p50/p99 period error next to the intervals the loop actually
+// saw:
+//   steady  - peer in step; sleeps overshoot like a scheduler tick
+//   ahead   - we start frames ahead of a peer running at the nominal rate,
+//             and the stretched period has to let it catch up
+//   hitch   - one frame's work runs long, but under the resync limit, so
+//             the next deadlines catch up on the schedule
+//   stall   - one frame stalls past the resync limit, so the pacer restarts
+//             from now instead of fast-forwarding the game
+
+#include "frame_pacer.h"
+#include "input_streams.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using namespace FM2K;
+
+struct Options {
+    uint32_t frames = 10000;
+    uint32_t work_us = 3000;            // Game frame work before each Wait
+    uint32_t oversleep_us = 1000;       // Sleeps wake up to this late
+    uint32_t hiccup_permille = 5;       // Sleeps that overshoot past the spin window
+    uint32_t ahead = 3;                 // Frames ahead at the start of "ahead"
+    uint32_t seed = 1;
+};
+
+// Simulated time: every NowNs call moves it by a poll's cost, and a sleep
+// lands late by a random scheduler overshoot
+class FakePacerClock : public PacerClock {
+public:
+    static constexpr uint64_t POLL_NS = 250;
+
+    FakePacerClock(const Options& options, uint32_t seed)
+        : oversleep_ns_(options.oversleep_us * 1000ull), hiccup_permille_(options.hiccup_permille),
+          rng_(seed * 0x9E3779B1u | 1) {}
+
+    uint64_t NowNs() override {
+        now_ns_ += POLL_NS;
+        return now_ns_;
+    }
+
+    void SleepNs(uint64_t ns) override {
+        now_ns_ += ns + Bench::NextRandom(rng_) % (oversleep_ns_ + 1);
+        if (Bench::NextRandom(rng_) % 1000 < hiccup_permille_) now_ns_ += 2 * oversleep_ns_ + 1000000;
+        sleeps_++;
+    }
+
+    void Advance(uint64_t ns) { now_ns_ += ns; }
+    uint64_t Now() const { return now_ns_; }
+    uint32_t Random() { return Bench::NextRandom(rng_); }
+    uint64_t Sleeps() const { return sleeps_; }
+
+private:
+    uint64_t now_ns_ = 1000000000;
+    uint64_t oversleep_ns_;
+    uint32_t hiccup_permille_;
+    uint32_t rng_;
+    uint64_t sleeps_ = 0;
+};
+
+enum class Scenario { Steady, Ahead, Hitch, Stall };
+
+struct Result {
+    const char* name;
+    FramePacer::Stats stats;
+    std::vector<uint32_t> interval_us;      // Wake to wake, as the game saw it
+    int64_t drift_us;                       // Elapsed minus frames x nominal, outside hitches and stalls
+    uint32_t settle_frame;                  // "ahead": first frame within half a frame of the peer
+    double worst_ahead_after;               // "ahead": largest |frames ahead| once settled
+    double max_scale;
+    uint32_t short_after_stall;             // Intervals under half a period right after the stall
+    bool ok;
+};
+
+uint32_t Percentile(std::vector<uint32_t> values, double percent) {
+    if (values.empty()) return 0;
+    size_t index = static_cast<size_t>(percent / 100.0 * static_cast<double>(values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+Result Run(Scenario scenario, const char* name, const Options& options) {
+    FramePacer::Config config;
+    FakePacerClock clock(options, options.seed);
+    FramePacer pacer(clock, config);
+
+    Result result = {};
+    result.name = name;
+    result.settle_frame = UINT32_MAX;
+    result.interval_us.reserve(options.frames);
+
+    const uint64_t frame_ns = config.frame_ns;
+    const uint32_t event_frame = options.frames / 2;
+    const uint64_t hitch_ns = config.resync_ns * 3 / 5;
+    const uint64_t stall_ns = config.resync_ns * 4;
+
+    // The peer runs at exactly the nominal rate from the first wake
+    double start_ahead = scenario == Scenario::Ahead ? options.ahead : 0.0;
+    uint64_t start_ns = 0;
+    uint64_t last_wake = 0;
+    uint64_t skipped_ns = 0;                // Time the game lost to the hitch or stall
+    uint64_t wakes = 0;
+
+    for (uint32_t frame = 0; frame <= options.frames; frame++) {
+        // The game's frame, with one long one halfway through
+        uint64_t work = options.work_us * 1000ull;
+        if (frame == event_frame && scenario == Scenario::Hitch) work += hitch_ns;
+        if (frame == event_frame && scenario == Scenario::Stall) work += stall_ns;
+        clock.Advance(work);
+
+        double ahead = 0.0;
+        if (frame > 0) {
+            double peer = static_cast<double>(clock.Now() - start_ns) / static_cast<double>(frame_ns);
+            ahead = start_ahead + static_cast<double>(wakes) - peer;
+        }
+        if (scenario == Scenario::Ahead && frame > 0) {
+            if (result.settle_frame == UINT32_MAX && std::fabs(ahead) < 0.5) result.settle_frame = frame;
+            if (result.settle_frame != UINT32_MAX) {
+                result.worst_ahead_after = std::max(result.worst_ahead_after, std::fabs(ahead));
+            }
+        }
+
+        pacer.Wait(static_cast<float>(ahead));
+        uint64_t wake = clock.Now();
+        if (frame == 0) {
+            start_ns = wake;
+        } else {
+            uint64_t interval = wake - last_wake;
+            result.interval_us.push_back(static_cast<uint32_t>(interval / 1000));
+            wakes++;
+            if (scenario == Scenario::Stall && frame > event_frame && frame <= event_frame + 10 &&
+                interval < frame_ns / 2) {
+                result.short_after_stall++;
+            }
+            if (scenario == Scenario::Stall && frame == event_frame) skipped_ns = interval - frame_ns;
+        }
+        last_wake = wake;
+        result.max_scale = std::max(result.max_scale, pacer.GetStats().scale);
+    }
+
+    // Absolute deadlines: the loop as a whole keeps the nominal rate, bar
+    // a resync, which restarts the schedule by the time the stall took
+    int64_t elapsed = static_cast<int64_t>(last_wake - start_ns - skipped_ns);
+    int64_t expected = static_cast<int64_t>(wakes * frame_ns);
+    result.drift_us = (elapsed - expected) / 1000;
+    result.stats = pacer.GetStats();
+
+    switch (scenario) {
+    case Scenario::Steady:
+    case Scenario::Hitch:
+        result.ok = result.stats.resyncs == 0 && std::llabs(result.drift_us) < static_cast<int64_t>(frame_ns / 1000);
+        break;
+    case Scenario::Ahead:
+        // Stretching only ever slows us: drift is the time handed to the peer
+        result.ok = result.stats.resyncs == 0 && result.settle_frame < 1000 && result.worst_ahead_after < 1.0 &&
+                    result.max_scale <= config.max_scale + 1e-9 && result.stats.scale < 1.0 + config.kp;
+        break;
+    case Scenario::Stall:
+        result.ok = result.stats.resyncs == 1 && result.short_after_stall == 0 &&
+                    std::llabs(result.drift_us) < static_cast<int64_t>(frame_ns / 1000);
+        break;
+    }
+    return result;
+}
+
+void PrintUsage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --frames N      Frames per scenario (default 10000)\n"
+        "  --work-us N     Game work per frame before the wait (default 3000)\n"
+        "  --oversleep N   Sleep overshoot up to N us (default 1000)\n"
+        "  --hiccups N     Sleeps per thousand that overshoot past the spin window (default 5)\n"
+        "  --ahead N       Frames ahead of the peer at the start of \"ahead\" (default 3)\n"
+        "  --seed N        Random seed (default 1)\n",
+        program);
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto number = [&](uint32_t& out) {
+            if (!value) return false;
+            out = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+            i++;
+            return true;
+        };
+
+        bool ok = true;
+        if (!std::strcmp(arg, "--frames")) ok = number(options.frames);
+        else if (!std::strcmp(arg, "--work-us")) ok = number(options.work_us);
+        else if (!std::strcmp(arg, "--oversleep")) ok = number(options.oversleep_us);
+        else if (!std::strcmp(arg, "--hiccups")) ok = number(options.hiccup_permille);
+        else if (!std::strcmp(arg, "--ahead")) ok = number(options.ahead);
+        else if (!std::strcmp(arg, "--seed")) ok = number(options.seed);
+        else ok = false;
+
+        if (!ok) return false;
+    }
+    // Work has to fit in a frame, or there is nothing to pace
+    return options.frames >= 100 && options.work_us < 8000 && options.hiccup_permille <= 1000 && options.ahead <= 20;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    std::printf("FM2K frame pacer check: %u frames, %u us work, sleeps up to %u us late, %u/1000 hiccups\n",
+                options.frames, options.work_us, options.oversleep_us, options.hiccup_permille);
+    std::printf("%-8s %6s %6s %6s %9s %9s %5s %7s %7s %9s  %s\n", "scenario", "p50us", "p99us", "maxus", "int p50",
+                "int p99", "late", "resyncs", "scale", "drift us", "result");
+
+    const Scenario scenarios[] = { Scenario::Steady, Scenario::Ahead, Scenario::Hitch, Scenario::Stall };
+    const char* names[] = { "steady", "ahead", "hitch", "stall" };
+    bool ok = true;
+    for (size_t n = 0; n < 4; n++) {
+        Result result = Run(scenarios[n], names[n], options);
+        std::printf("%-8s %6u %6u %6u %9u %9u %5llu %7llu %7.4f %9lld  %s\n", result.name, result.stats.error_p50_us,
+                    result.stats.error_p99_us, result.stats.error_max_us, Percentile(result.interval_us, 50),
+                    Percentile(result.interval_us, 99), (unsigned long long)result.stats.late_wakes,
+                    (unsigned long long)result.stats.resyncs, result.stats.scale, (long long)result.drift_us,
+                    result.ok ? "ok" : "FAIL");
+        if (scenarios[n] == Scenario::Ahead) {
+            std::printf("         settled within half a frame at frame %u, at most %.2f frames off after, peak scale %.4f\n",
+                        result.settle_frame, result.worst_ahead_after, result.max_scale);
+        }
+        ok = ok && result.ok;
+    }
+    std::printf("Verify:  %s\n", ok ? "all scenarios paced as expected" : "FAILED");
+    return ok ? 0 : 1;
+}
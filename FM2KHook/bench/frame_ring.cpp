@@ -0,0 +1,116 @@
+#include "frame_ring.h"
+#include <cstring>
+#include <new>
+
+namespace FM2K {
+namespace State {
+
+FrameRing::~FrameRing() {
+    Shutdown();
+}
+
+bool FrameRing::Init(size_t slot_count, size_t slot_size) {
+    Shutdown();
+    if (slot_count == 0 || slot_size == 0) return false;
+
+    stride_ = (slot_size + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+    storage_ = static_cast<uint8_t*>(::operator new(stride_ * slot_count, std::align_val_t(CACHE_LINE_SIZE), std::nothrow));
+    if (!storage_) {
+        stride_ = 0;
+        return false;
+    }
+    std::memset(storage_, 0, stride_ * slot_count);
+
+    slot_size_ = slot_size;
+    tags_.assign(slot_count, SlotTag{ 0, 0 });
+    stats_ = {};
+    stats_.capacity = slot_count;
+    return true;
+}
+
+void FrameRing::Shutdown() {
+    if (storage_) {
+        ::operator delete(storage_, std::align_val_t(CACHE_LINE_SIZE));
+        storage_ = nullptr;
+    }
+    tags_.clear();
+    slot_size_ = 0;
+    stride_ = 0;
+}
+
+void FrameRing::Release(SlotTag& tag) {
+    if (tag.valid) {
+        tag.valid = 0;
+        stats_.occupancy--;
+    }
+}
+
+uint8_t* FrameRing::Acquire(uint32_t frame, uint32_t* slot) {
+    if (tags_.empty()) return nullptr;
+
+    uint32_t index = static_cast<uint32_t>(frame % tags_.size());
+    SlotTag& tag = tags_[index];
+    if (tag.valid && tag.frame != frame) {
+        stats_.overwrites++;
+    }
+    Release(tag);
+    tag.frame = frame;
+
+    if (slot) *slot = index;
+    return SlotData(index);
+}
+
+void FrameRing::Commit(uint32_t slot) {
+    SlotTag& tag = tags_[slot];
+    if (!tag.valid) {
+        tag.valid = 1;
+        stats_.occupancy++;
+    }
+    stats_.saves++;
+}
+
+const uint8_t* FrameRing::Find(uint32_t frame, uint32_t* slot) {
+    if (tags_.empty()) return nullptr;
+
+    uint32_t index = static_cast<uint32_t>(frame % tags_.size());
+    const SlotTag& tag = tags_[index];
+    if (!tag.valid) {
+        stats_.misses++;
+        return nullptr;
+    }
+    if (tag.frame != frame) {
+        stats_.stale_hits++;
+        return nullptr;
+    }
+
+    stats_.loads++;
+    if (slot) *slot = index;
+    return SlotData(index);
+}
+
+bool FrameRing::Contains(uint32_t frame) const {
+    if (tags_.empty()) return false;
+    const SlotTag& tag = tags_[frame % tags_.size()];
+    return tag.valid && tag.frame == frame;
+}
+
+void FrameRing::InvalidateAfter(uint32_t frame) {
+    for (SlotTag& tag : tags_) {
+        if (tag.valid && tag.frame > frame) {
+            Release(tag);
+        }
+    }
+}
+
+void FrameRing::Clear() {
+    for (SlotTag& tag : tags_) {
+        Release(tag);
+    }
+}
+
+FrameRing::Stats FrameRing::GetStats() const {
+    return stats_;
+}
+
+} // namespace State
+} // namespace FM2K
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace FM2K {
+namespace State {
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// Fixed ring of snapshot buffers keyed by frame number. Storage is allocated
+// once in Init with every slot starting on a cache line; frame N always maps
+// to slot N % slot_count and each slot carries the frame it holds, so a
+// lookup is one tag compare and a slot overwritten by a newer frame is
+// reported as stale instead of being handed back as the wrong state.
+// The hook's snapshot ring before it captured into GekkoNet's buffers; kept
+// as the flat baseline fm2k_delta_ring_bench measures the delta ring against.
+class FrameRing {
+public:
+    struct Stats {
+        uint64_t saves;
+        uint64_t loads;
+        uint64_t overwrites;     // Saves that evicted another valid frame
+        uint64_t stale_hits;     // Lookups whose slot held a different frame
+        uint64_t misses;         // Lookups whose slot was empty
+        size_t occupancy;        // Valid slots right now
+        size_t capacity;
+    };
+
+    FrameRing() = default;
+    ~FrameRing();
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+
+    bool Init(size_t slot_count, size_t slot_size);
+    void Shutdown();
+
+    // Claim the slot for `frame` and return its buffer. The slot stays invalid
+    // until Commit, so a failed save never leaves a half-written frame behind.
+    uint8_t* Acquire(uint32_t frame, uint32_t* slot);
+    void Commit(uint32_t slot);
+
+    // Buffer holding `frame`, or nullptr if its slot is empty or stale
+    const uint8_t* Find(uint32_t frame, uint32_t* slot);
+
+    // Whether `frame` is held, without touching the lookup stats
+    bool Contains(uint32_t frame) const;
+
+    // Drop every frame newer than `frame` (they belong to an abandoned timeline)
+    void InvalidateAfter(uint32_t frame);
+    void Clear();
+
+    size_t SlotCount() const { return tags_.size(); }
+    size_t SlotSize() const { return slot_size_; }
+    uint8_t* SlotData(uint32_t slot) const { return storage_ + slot * stride_; }
+    Stats GetStats() const;
+
+private:
+    struct SlotTag {
+        uint32_t frame;
+        uint32_t valid;
+    };
+
+    void Release(SlotTag& tag);
+
+    uint8_t* storage_ = nullptr;
+    size_t slot_size_ = 0;
+    size_t stride_ = 0;
+    std::vector<SlotTag> tags_;
+    Stats stats_ = {};
+};
+
+} // namespace State
+} // namespace FM2K
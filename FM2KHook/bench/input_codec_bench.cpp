@@ -0,0 +1,165 @@
+// Input codec benchmark: wire size and encode/decode cost of the packed,
+// run-length-encoded input window against raw per-frame inputs. Each frame
+// sends one packet carrying the last `window` frames of one player's input,
+// as a rollback session resends unacknowledged inputs.
+//
+// Streams are either generated (play-like patterns) or recorded; see
+// input_streams.h.
+
+#include "input_codec.h"
+#include "input_ledger.h"
+#include "input_streams.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using namespace FM2K;
+using Bench::InputStream;
+
+constexpr uint32_t FRAMES_PER_SECOND = 100;        // FM2K's 10 ms frame
+constexpr size_t FRAME_HEADER_BYTES = 5;           // Frame number + count, as the packed header carries
+constexpr uint32_t LEGACY_INPUT_MASK = 0xFF;       // What the 8-bit GekkoNet input kept
+
+struct Options {
+    uint32_t frames = 360000;   // An hour of play
+    uint32_t window = 8;
+    uint32_t seed = 1;
+    const char* inputs_path = nullptr;
+};
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    uint64_t packed_bytes;
+    uint64_t encode_ns;
+    uint64_t decode_ns;
+    uint64_t legacy_dropped;    // Frames where the 8-bit input lost a button
+    uint64_t mismatches;        // Round-trip failures
+};
+
+Result Run(const InputStream& stream, uint32_t window) {
+    Result result = {};
+    InputCodec codec;
+    size_t frames = stream.inputs.size();
+    std::vector<uint16_t> wire(frames);
+    std::vector<uint8_t> packets(frames * MaxPackedInputSize(window));
+    std::vector<uint16_t> packet_sizes(frames);
+
+    // Encode: map this frame's input and pack the window ending at it
+    Clock::time_point start = Clock::now();
+    for (size_t frame = 0; frame < frames; frame++) {
+        wire[frame] = codec.ToWire(stream.inputs[frame]);
+        size_t first = frame + 1 >= window ? frame + 1 - window : 0;
+        uint8_t* out = &packets[frame * MaxPackedInputSize(window)];
+        packet_sizes[frame] = static_cast<uint16_t>(
+            PackInputFrames(static_cast<uint32_t>(first), &wire[first], frame + 1 - first, out, MaxPackedInputSize(window)));
+    }
+    result.encode_ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+
+    // Decode: unpack each packet and map the newest frame back
+    std::vector<uint16_t> decoded(window);
+    std::vector<uint32_t> game(frames);
+    start = Clock::now();
+    for (size_t frame = 0; frame < frames; frame++) {
+        uint32_t first = 0;
+        size_t count = UnpackInputFrames(&packets[frame * MaxPackedInputSize(window)], packet_sizes[frame], &first,
+                                         decoded.data(), decoded.size());
+        game[frame] = count ? codec.FromWire(decoded[count - 1]) : ~0u;
+    }
+    result.decode_ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+
+    for (size_t frame = 0; frame < frames; frame++) {
+        result.packed_bytes += packet_sizes[frame];
+        uint32_t expected = stream.inputs[frame] & State::FM2K_INPUT_MASK;
+        if (game[frame] != expected) result.mismatches++;
+        if ((expected & LEGACY_INPUT_MASK) != expected) result.legacy_dropped++;
+    }
+    return result;
+}
+
+void PrintUsage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --frames N     Frames per generated stream (default 360000, an hour)\n"
+        "  --window N     Frames resent per packet, 1-%zu (default 8)\n"
+        "  --inputs FILE  Recorded stream: little-endian uint32 p1/p2 pairs per frame\n"
+        "  --seed N       Generator seed (default 1)\n",
+        program, MAX_PACKED_FRAMES);
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto number = [&](uint32_t& out) {
+            if (!value) return false;
+            out = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+            i++;
+            return true;
+        };
+
+        bool ok = true;
+        if (!std::strcmp(arg, "--frames")) ok = number(options.frames);
+        else if (!std::strcmp(arg, "--window")) ok = number(options.window);
+        else if (!std::strcmp(arg, "--seed")) ok = number(options.seed);
+        else if (!std::strcmp(arg, "--inputs") && value) { options.inputs_path = value; i++; }
+        else ok = false;
+
+        if (!ok) return false;
+    }
+    return options.frames > 0 && options.window >= 1 && options.window <= MAX_PACKED_FRAMES;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<InputStream> streams;
+    if (options.inputs_path) {
+        if (!Bench::LoadRecordedInputs(options.inputs_path, streams)) return 1;
+    } else {
+        streams.push_back(Bench::GenerateInputs("idle", options.frames, options.seed, 20, 120, 80));
+        streams.push_back(Bench::GenerateInputs("footsies", options.frames, options.seed, 4, 40, 20));
+        streams.push_back(Bench::GenerateInputs("mashing", options.frames, options.seed, 1, 3, 5));
+    }
+
+    uint32_t window = options.window;
+    std::printf("Window %u frames per packet, %u packets/s; bytes/s per player\n", window, FRAMES_PER_SECOND);
+    std::printf("%-12s %9s %9s %9s %9s %7s %9s %9s %8s\n", "stream", "8-bit", "16-bit", "11-bit", "11+RLE",
+                "ratio", "enc ns/f", "dec ns/f", "8b lost");
+
+    bool ok = true;
+    for (const InputStream& stream : streams) {
+        Result result = Run(stream, window);
+        double frames = static_cast<double>(stream.inputs.size());
+
+        // Raw formats carry the same frame header plus the window as is
+        double legacy = static_cast<double>(FRAME_HEADER_BYTES + window) * FRAMES_PER_SECOND;
+        double raw = static_cast<double>(FRAME_HEADER_BYTES + window * WIRE_INPUT_BYTES) * FRAMES_PER_SECOND;
+        double packed = static_cast<double>((INPUT_PACKET_HEADER_BITS + window * WIRE_INPUT_BITS + 7) / 8) *
+                        FRAMES_PER_SECOND;
+        double rle = static_cast<double>(result.packed_bytes) / frames * FRAMES_PER_SECOND;
+
+        std::printf("%-12s %9.0f %9.0f %9.0f %9.0f %6.2fx %9.1f %9.1f %7.2f%%\n", stream.name.c_str(), legacy, raw,
+                    packed, rle, raw / rle, result.encode_ns / frames, result.decode_ns / frames,
+                    100.0 * static_cast<double>(result.legacy_dropped) / frames);
+        if (result.mismatches) {
+            std::fprintf(stderr, "%s: %llu frames did not round-trip\n", stream.name.c_str(),
+                         static_cast<unsigned long long>(result.mismatches));
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,262 @@
+// Input history benchmark: the windowed capture of the engine's input rings
+// (input_history.h) against copying both 1024-entry rings whole, on
+// SyntheticEngine. For each window it reports bytes copied and stored per
+// save and us per save and load, then runs the engine with rollbacks of up to
+// the window and checks that every windowed load rebuilds both rings exactly
+// as the full copy of that frame does, and that a rollback past the window
+// is refused without touching the rings.
+
+#include "synthetic_engine.h"
+#include "input_history.h"
+#include "input_streams.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using namespace FM2K;
+namespace Mem = State::Memory;
+
+// The prediction window, the snapshot ring, the hook's window (ring plus
+// the longest checkpoint interval) and the largest a snapshot holds
+constexpr uint32_t WINDOWS[] = { 8, 10, 14, State::INPUT_HISTORY_WINDOW_MAX };
+
+constexpr size_t RING_BYTES = Mem::INPUT_HISTORY_ENTRIES * sizeof(uint32_t);
+
+struct Options {
+    uint32_t frames = 20000;
+    uint32_t rounds = 200000;       // Timed saves and loads per approach
+    uint32_t rollback_interval = 3;
+    uint32_t seed = 1;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Both rings and the shared index, copied whole: what a snapshot holds
+// without the window
+struct FullHistory {
+    uint32_t index;
+    uint32_t p1[Mem::INPUT_HISTORY_ENTRIES];
+    uint32_t p2[Mem::INPUT_HISTORY_ENTRIES];
+};
+
+constexpr size_t FULL_BYTES = sizeof(uint32_t) + 2 * RING_BYTES;
+
+bool SaveFull(State::MemoryBackend& memory, FullHistory& out) {
+    return memory.Read(Mem::INPUT_BUFFER_INDEX_ADDR, &out.index, sizeof(out.index)) &&
+           memory.Read(Mem::P1_INPUT_HISTORY_ADDR, out.p1, RING_BYTES) &&
+           memory.Read(Mem::P2_INPUT_HISTORY_ADDR, out.p2, RING_BYTES);
+}
+
+bool LoadFull(State::MemoryBackend& memory, const FullHistory& in) {
+    return memory.Write(Mem::INPUT_BUFFER_INDEX_ADDR, &in.index, sizeof(in.index)) &&
+           memory.Write(Mem::P1_INPUT_HISTORY_ADDR, in.p1, RING_BYTES) &&
+           memory.Write(Mem::P2_INPUT_HISTORY_ADDR, in.p2, RING_BYTES);
+}
+
+bool RingsMatch(State::MemoryBackend& memory, const FullHistory& expected) {
+    static FullHistory live;
+    return SaveFull(memory, live) && std::memcmp(live.p1, expected.p1, RING_BYTES) == 0 &&
+           std::memcmp(live.p2, expected.p2, RING_BYTES) == 0;
+}
+
+void StartEngine(Bench::SyntheticEngine& engine, uint32_t seed, uint32_t& rng) {
+    Bench::SyntheticEngine::Config config;
+    config.seed = seed;
+    engine.Reset(config);
+    rng = seed * 0x9E3779B1u | 1;
+    // Fill the rings so whole copies move real data
+    for (uint32_t frame = 0; frame < Mem::INPUT_HISTORY_ENTRIES; frame++) {
+        engine.Step(Bench::NextRandom(rng) & 0x7FF, Bench::NextRandom(rng) & 0x7FF);
+    }
+}
+
+double Microseconds(Clock::duration elapsed, uint32_t rounds) {
+    return std::chrono::duration<double, std::micro>(elapsed).count() / rounds;
+}
+
+struct Timing {
+    double save_us;
+    double load_us;
+};
+
+Timing TimeWindow(Bench::SyntheticEngine& engine, uint32_t window, uint32_t rounds) {
+    State::InputHistorySnapshot snapshot = {};
+    auto& memory = engine.Memory();
+    volatile uint32_t sink = 0;
+
+    Clock::time_point start = Clock::now();
+    for (uint32_t n = 0; n < rounds; n++) {
+        State::SaveInputHistory(memory, State::INPUT_HISTORY_LAYOUT, window, snapshot);
+        sink = sink + snapshot.p1[n % snapshot.count];
+    }
+    double save = Microseconds(Clock::now() - start, rounds);
+
+    start = Clock::now();
+    for (uint32_t n = 0; n < rounds; n++) State::LoadInputHistory(memory, State::INPUT_HISTORY_LAYOUT, snapshot);
+    double load = Microseconds(Clock::now() - start, rounds);
+    return { save, load };
+}
+
+Timing TimeFull(Bench::SyntheticEngine& engine, uint32_t rounds) {
+    static FullHistory full;
+    auto& memory = engine.Memory();
+    volatile uint32_t sink = 0;
+
+    Clock::time_point start = Clock::now();
+    for (uint32_t n = 0; n < rounds; n++) {
+        SaveFull(memory, full);
+        sink = sink + full.p1[n % Mem::INPUT_HISTORY_ENTRIES];
+    }
+    double save = Microseconds(Clock::now() - start, rounds);
+
+    start = Clock::now();
+    for (uint32_t n = 0; n < rounds; n++) LoadFull(memory, full);
+    double load = Microseconds(Clock::now() - start, rounds);
+    return { save, load };
+}
+
+struct Check {
+    uint64_t rollbacks;
+    uint64_t mismatches;    // Windowed loads that didn't rebuild the rings
+    uint64_t refused;       // Loads past the window correctly refused
+    uint64_t leaked;        // Loads past the window that went through or wrote anyway
+};
+
+// Save both ways every frame, roll back up to `window` frames, compare
+Check Verify(uint32_t window, const Options& options) {
+    Check check = {};
+    Bench::SyntheticEngine engine;
+    uint32_t rng = 0;
+    StartEngine(engine, options.seed + window, rng);
+    auto& memory = engine.Memory();
+
+    // One slot per frame back to the window, plus one for past it
+    uint32_t depth_slots = window + 2;
+    std::vector<State::InputHistorySnapshot> windowed(depth_slots);
+    std::vector<FullHistory> full(depth_slots);
+    FullHistory before = {};
+
+    // `step` counts frames run, resimulated ones included; `frame` rewinds.
+    // As under GekkoNet, a rollback never reaches further back than the
+    // window from the furthest frame ever run, or slots the abandoned
+    // timeline wrote past the window would survive the load.
+    uint32_t frame = 0;
+    uint32_t furthest = 0;
+    for (uint32_t step = 0; step < options.frames; step++, frame++) {
+        uint32_t slot = frame % depth_slots;
+        State::SaveInputHistory(memory, State::INPUT_HISTORY_LAYOUT, window, windowed[slot]);
+        SaveFull(memory, full[slot]);
+        engine.Step(Bench::NextRandom(rng) & 0x7FF, Bench::NextRandom(rng) & 0x7FF);
+        furthest = std::max(furthest, frame + 1);
+
+        if (options.rollback_interval == 0 || step % options.rollback_interval != 0 || frame < depth_slots) continue;
+
+        // Once in a while, one frame past the window: has to be refused untouched
+        if (step % (options.rollback_interval * 16) == 0) {
+            uint32_t past = (frame + 1 - (window + 1)) % depth_slots;
+            SaveFull(memory, before);
+            bool loaded = State::LoadInputHistory(memory, State::INPUT_HISTORY_LAYOUT, windowed[past]);
+            if (!loaded && RingsMatch(memory, before)) {
+                check.refused++;
+            } else {
+                check.leaked++;
+            }
+        }
+
+        // Back `depth` frames: the window goes first, then the index as the state plan restores it
+        uint32_t reach = window - (furthest - (frame + 1));
+        if (reach == 0) continue;
+        uint32_t depth = 1 + Bench::NextRandom(rng) % reach;
+        uint32_t target = (frame + 1 - depth) % depth_slots;
+        check.rollbacks++;
+        if (!State::LoadInputHistory(memory, State::INPUT_HISTORY_LAYOUT, windowed[target]) ||
+            !RingsMatch(memory, full[target])) {
+            check.mismatches++;
+        }
+        memory.Write(Mem::INPUT_BUFFER_INDEX_ADDR, &full[target].index, sizeof(uint32_t));
+        frame -= depth;
+    }
+    return check;
+}
+
+void PrintUsage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --frames N     Frames per window in the rollback check (default 20000)\n"
+        "  --rounds N     Timed saves and loads per approach (default 200000)\n"
+        "  --interval N   Frames between rollbacks in the check (default 3, 0 = none)\n"
+        "  --seed N       Input seed (default 1)\n",
+        program);
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto number = [&](uint32_t& out) {
+            if (!value) return false;
+            out = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+            i++;
+            return true;
+        };
+
+        bool ok = true;
+        if (!std::strcmp(arg, "--frames")) ok = number(options.frames);
+        else if (!std::strcmp(arg, "--rounds")) ok = number(options.rounds);
+        else if (!std::strcmp(arg, "--interval")) ok = number(options.rollback_interval);
+        else if (!std::strcmp(arg, "--seed")) ok = number(options.seed);
+        else ok = false;
+
+        if (!ok) return false;
+    }
+    return options.frames > 0 && options.rounds > 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    Bench::SyntheticEngine engine;
+    uint32_t rng = 0;
+    StartEngine(engine, options.seed, rng);
+
+    std::printf("FM2K input history bench: %zu-entry rings, %u timed rounds, %u-frame rollback check per window\n",
+                Mem::INPUT_HISTORY_ENTRIES, options.rounds, options.frames);
+    std::printf("%-10s %8s %8s %9s %9s %10s %9s %8s\n", "capture", "copied", "stored", "save us", "load us",
+                "rollbacks", "mismatch", "refused");
+
+    Timing full = TimeFull(engine, options.rounds);
+    std::printf("%-10s %8zu %8zu %9.3f %9.3f\n", "full", FULL_BYTES, sizeof(FullHistory), full.save_us, full.load_us);
+
+    bool ok = true;
+    for (uint32_t window : WINDOWS) {
+        Timing timing = TimeWindow(engine, window, options.rounds);
+        Check check = Verify(window, options);
+        size_t copied = sizeof(uint32_t) + 2 * (window + 2) * sizeof(uint32_t);
+        char name[16];
+        std::snprintf(name, sizeof(name), "window %u", window);
+        std::printf("%-10s %8zu %8zu %9.3f %9.3f %10llu %9llu %8llu\n", name, copied,
+                    sizeof(State::InputHistorySnapshot), timing.save_us, timing.load_us,
+                    (unsigned long long)check.rollbacks, (unsigned long long)check.mismatches,
+                    (unsigned long long)check.refused);
+        if (check.mismatches || check.leaked || (options.rollback_interval && !check.refused)) {
+            std::fprintf(stderr, "window %u: %llu mismatched loads, %llu loads past the window not refused\n", window,
+                         (unsigned long long)check.mismatches, (unsigned long long)check.leaked);
+            ok = false;
+        }
+    }
+
+    std::printf("Verify:  %s\n", ok ? "every windowed load rebuilt both rings, loads past the window refused"
+                                    : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+// Input prediction evaluation: replays one player's inputs through each
+// prediction strategy under a fixed network latency and counts the
+// rollbacks its wrong guesses would cost.
+//
+// Latency model (what GekkoNet does with a remote player): at frame t the
+// remote input for frame t - latency is confirmed and observed; if the
+// frame was simulated with a different guess, the session rolls back to it
+// and resimulates `latency` frames with fresh guesses. Every frame past the
+// confirmed one runs on a prediction `ahead` frames out.
+//
+// Streams are either generated (play-like patterns) or recorded; see
+// input_streams.h.
+
+#include "input_codec.h"
+#include "input_predictor.h"
+#include "input_streams.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace {
+
+using namespace FM2K;
+using Bench::InputStream;
+
+constexpr uint32_t FRAMES_PER_SECOND = 100;        // FM2K's 10 ms frame
+constexpr uint32_t MAX_LATENCY = 60;
+
+struct Options {
+    uint32_t frames = 360000;   // An hour of play
+    uint32_t seed = 1;
+    std::vector<uint32_t> latencies = { 2, 4, 8 };
+    const char* inputs_path = nullptr;
+};
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    uint64_t mispredicted;      // Confirmed frames that had run on a wrong guess
+    uint64_t rollbacks;
+    uint64_t resimulated;       // Frames run again by those rollbacks
+    uint64_t predict_ns;        // Observe + Predict time
+    uint64_t predictions;
+};
+
+Result Run(PredictionStrategy strategy, const std::vector<uint16_t>& wire, uint32_t latency) {
+    Result result = {};
+    std::unique_ptr<InputPredictor> predictor = CreateInputPredictor(strategy);
+    size_t frames = wire.size();
+    std::vector<uint16_t> used(frames);     // Input each frame last ran with
+
+    Clock::time_point start = Clock::now();
+    for (size_t frame = 0; frame < frames; frame++) {
+        if (latency == 0) {
+            used[frame] = wire[frame];
+            continue;
+        }
+
+        if (frame >= latency) {
+            size_t confirmed = frame - latency;
+            predictor->Observe(wire[confirmed]);
+            if (used[confirmed] != wire[confirmed]) {
+                // Roll back to the confirmed frame and rerun up to this one
+                result.mispredicted++;
+                result.rollbacks++;
+                result.resimulated += latency;
+                used[confirmed] = wire[confirmed];
+                for (size_t redo = confirmed + 1; redo < frame; redo++) {
+                    used[redo] = predictor->Predict(static_cast<uint32_t>(redo - confirmed));
+                    result.predictions++;
+                }
+            }
+        }
+        used[frame] = predictor->Predict(latency);
+        result.predictions++;
+    }
+    result.predict_ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+
+    // Frames still unconfirmed when the stream ends
+    for (size_t frame = frames > latency ? frames - latency : 0; frame < frames; frame++) {
+        if (used[frame] != wire[frame]) result.mispredicted++;
+    }
+    return result;
+}
+
+void PrintUsage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --frames N     Frames per generated stream (default 360000, an hour)\n"
+        "  --latency N    Frames of remote latency, 0-%u; repeat for several (default 2, 4, 8)\n"
+        "  --inputs FILE  Recorded stream: little-endian uint32 p1/p2 pairs per frame\n"
+        "  --seed N       Generator seed (default 1)\n",
+        program, MAX_LATENCY);
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    bool latencies_given = false;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto number = [&](uint32_t& out) {
+            if (!value) return false;
+            out = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+            i++;
+            return true;
+        };
+
+        bool ok = true;
+        if (!std::strcmp(arg, "--frames")) ok = number(options.frames);
+        else if (!std::strcmp(arg, "--seed")) ok = number(options.seed);
+        else if (!std::strcmp(arg, "--latency")) {
+            uint32_t latency = 0;
+            if (!latencies_given) options.latencies.clear();
+            latencies_given = true;
+            ok = number(latency) && latency <= MAX_LATENCY;
+            options.latencies.push_back(latency);
+        }
+        else if (!std::strcmp(arg, "--inputs") && value) { options.inputs_path = value; i++; }
+        else ok = false;
+
+        if (!ok) return false;
+    }
+    return options.frames > 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<InputStream> streams;
+    if (options.inputs_path) {
+        if (!Bench::LoadRecordedInputs(options.inputs_path, streams)) return 1;
+    } else {
+        streams.push_back(Bench::GenerateInputs("idle", options.frames, options.seed, 20, 120, 80));
+        streams.push_back(Bench::GenerateInputs("footsies", options.frames, options.seed, 4, 40, 20));
+        streams.push_back(Bench::GenerateInputs("mashing", options.frames, options.seed, 1, 3, 5));
+        streams.push_back(Bench::GenerateCombos("combos", options.frames, options.seed));
+    }
+
+    std::printf("%u frames/s; rollbacks and resimulated frames per second of play\n", FRAMES_PER_SECOND);
+    std::printf("%-12s %4s %-12s %9s %11s %11s %9s\n", "stream", "lat", "strategy", "mispred", "rollbacks/s",
+                "resim f/s", "ns/pred");
+
+    InputCodec codec;
+    for (const InputStream& stream : streams) {
+        std::vector<uint16_t> wire(stream.inputs.size());
+        for (size_t frame = 0; frame < wire.size(); frame++) wire[frame] = codec.ToWire(stream.inputs[frame]);
+        double seconds = static_cast<double>(wire.size()) / FRAMES_PER_SECOND;
+
+        for (uint32_t latency : options.latencies) {
+            for (size_t index = 0; index < PREDICTION_STRATEGY_COUNT; index++) {
+                PredictionStrategy strategy = static_cast<PredictionStrategy>(index);
+                Result result = Run(strategy, wire, latency);
+                std::printf("%-12s %4u %-12s %8.2f%% %11.2f %11.2f %9.1f\n", stream.name.c_str(), latency,
+                            PredictionStrategyName(strategy),
+                            100.0 * static_cast<double>(result.mispredicted) / static_cast<double>(wire.size()),
+                            static_cast<double>(result.rollbacks) / seconds,
+                            static_cast<double>(result.resimulated) / seconds,
+                            result.predictions ? static_cast<double>(result.predict_ns) /
+                                                     static_cast<double>(result.predictions)
+                                               : 0.0);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,242 @@
+// Input ring benchmark: the sampler thread and the hook's side of
+// InputSampleRing without devices or a game. A flat-out run checks every
+// sample crosses threads in order and intact and measures throughput; a
+// paced run polls at the sampler's rate, drains once per game frame the way
+// the hook does, and reports the age of the samples it took.
+
+#include "input_ring.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+using namespace FM2K;
+
+struct Options {
+    uint32_t samples = 20000000;    // Flat-out run
+    uint32_t seconds = 3;           // Paced run
+    uint32_t poll_hz = 1000;
+    uint32_t frame_hz = 100;
+};
+
+using Clock = std::chrono::steady_clock;
+const Clock::time_point clock_base = Clock::now();
+
+uint64_t NowNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - clock_base).count());
+}
+
+// Payload derived from the sequence, so a torn or misplaced slot shows up
+InputSample MakeSample(uint32_t sequence, uint64_t timestamp_ns) {
+    InputSample sample;
+    sample.timestamp_ns = timestamp_ns;
+    sample.sequence = sequence;
+    sample.p1 = static_cast<uint16_t>(sequence & 0x7FF);
+    sample.p2 = static_cast<uint16_t>((sequence * 2654435761u >> 21) & 0x7FF);
+    return sample;
+}
+
+bool Intact(const InputSample& sample) {
+    InputSample expected = MakeSample(sample.sequence, 0);
+    return sample.p1 == expected.p1 && sample.p2 == expected.p2;
+}
+
+struct ThroughputResult {
+    uint64_t errors;
+    uint64_t full_spins;
+    double seconds;
+};
+
+// Every push is retried until it fits, so the consumer must see 0..N-1 in order
+ThroughputResult RunThroughput(const Options& options) {
+    static InputSampleRing ring;
+    ThroughputResult result = {};
+    Clock::time_point start = Clock::now();
+
+    std::thread producer([&] {
+        for (uint32_t sequence = 0; sequence < options.samples; sequence++) {
+            InputSample sample = MakeSample(sequence, sequence);
+            while (!ring.Push(sample)) {
+                result.full_spins++;
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    InputSample sample;
+    while (expected < options.samples) {
+        if (!ring.Pop(&sample)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (sample.sequence != expected || !Intact(sample) || sample.timestamp_ns != expected) {
+            if (++result.errors <= 5) {
+                std::fprintf(stderr, "Throughput: expected sample %u, got %u\n", expected, sample.sequence);
+            }
+        }
+        expected = sample.sequence + 1;
+    }
+    producer.join();
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (ring.Size() != 0) result.errors++;
+    return result;
+}
+
+struct PacedResult {
+    uint64_t produced;
+    uint64_t dropped;
+    uint64_t drained;
+    uint64_t frames;
+    uint64_t empty_frames;
+    uint64_t max_drained;
+    uint64_t errors;
+    InputLatencyHistogram::Stats latency;
+};
+
+// Absolute deadlines, like the sampler; sleep_for alone drifts
+void SleepUntil(uint64_t deadline_ns) {
+    uint64_t now = NowNs();
+    if (deadline_ns > now) std::this_thread::sleep_for(std::chrono::nanoseconds(deadline_ns - now));
+}
+
+PacedResult RunPaced(const Options& options) {
+    static InputSampleRing ring;
+    static InputLatencyHistogram latency;
+    PacedResult result = {};
+    std::atomic<bool> running{ true };
+    std::atomic<uint64_t> produced{ 0 }, dropped{ 0 };
+
+    std::thread producer([&] {
+        uint64_t period = 1000000000ull / options.poll_hz;
+        uint64_t next = NowNs();
+        uint32_t sequence = 0;
+        while (running.load(std::memory_order_relaxed)) {
+            if (ring.Push(MakeSample(sequence++, NowNs()))) {
+                produced.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+            next += period;
+            SleepUntil(next);
+        }
+    });
+
+    uint64_t frame_period = 1000000000ull / options.frame_hz;
+    uint64_t frames = static_cast<uint64_t>(options.seconds) * options.frame_hz;
+    uint64_t next = NowNs() + frame_period;
+    bool have_last = false;
+    uint32_t last_sequence = 0;
+    for (uint64_t frame = 0; frame < frames; frame++) {
+        SleepUntil(next);
+        next += frame_period;
+
+        InputSample sample;
+        size_t drained = 0;
+        if (!ring.PopLatest(&sample, &drained)) {
+            result.empty_frames++;
+            continue;
+        }
+        latency.Record(NowNs() - sample.timestamp_ns);
+        result.drained += drained;
+        if (drained > result.max_drained) result.max_drained = drained;
+        if (!Intact(sample) || (have_last && sample.sequence <= last_sequence)) {
+            if (++result.errors <= 5) {
+                std::fprintf(stderr, "Paced: frame %llu took sample %u after %u\n", (unsigned long long)frame,
+                             sample.sequence, last_sequence);
+            }
+        }
+        last_sequence = sample.sequence;
+        have_last = true;
+    }
+    running.store(false);
+    producer.join();
+
+    // What the last frame left behind still counts as delivered
+    InputSample sample;
+    size_t drained = 0;
+    if (ring.PopLatest(&sample, &drained)) result.drained += drained;
+
+    result.produced = produced.load();
+    result.dropped = dropped.load();
+    result.frames = frames;
+    result.latency = latency.GetStats();
+    if (result.drained != result.produced) result.errors++;
+    return result;
+}
+
+// Known latencies in, known percentiles out
+bool CheckHistogram() {
+    InputLatencyHistogram histogram;
+    for (uint64_t us = 1; us <= 1000; us++) histogram.Record(us * 1000);
+    histogram.Record(1000000000);    // One second, into the last bucket
+    InputLatencyHistogram::Stats stats = histogram.GetStats();
+    bool ok = stats.samples == 1001 && stats.p50_us == 501 && stats.p99_us == 991 && stats.max_us == 1000000 &&
+              histogram.Percentile(100.0) == InputLatencyHistogram::HISTOGRAM_US - 1;
+    histogram.Reset();
+    return ok && histogram.GetStats().samples == 0 && histogram.Percentile(50.0) == 0;
+}
+
+void PrintUsage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --samples N     Samples for the flat-out run (default 20000000)\n"
+        "  --seconds N     Length of the paced run (default 3)\n"
+        "  --poll-hz N     Paced producer rate (default 1000)\n"
+        "  --frame-hz N    Paced consumer rate (default 100)\n",
+        program);
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        uint32_t* out = nullptr;
+        if (!std::strcmp(arg, "--samples")) out = &options.samples;
+        else if (!std::strcmp(arg, "--seconds")) out = &options.seconds;
+        else if (!std::strcmp(arg, "--poll-hz")) out = &options.poll_hz;
+        else if (!std::strcmp(arg, "--frame-hz")) out = &options.frame_hz;
+        if (!out || !value) return false;
+        *out = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        i++;
+    }
+    return options.poll_hz > 0 && options.frame_hz > 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    bool histogram_ok = CheckHistogram();
+    ThroughputResult throughput = RunThroughput(options);
+    PacedResult paced = RunPaced(options);
+
+    std::printf("FM2K input ring bench: %zu-slot ring, %zu-byte samples, %u hardware threads\n",
+                INPUT_SAMPLE_RING_SIZE, sizeof(InputSample), std::thread::hardware_concurrency());
+    std::printf("Flat out: %u samples in %.2f s, %.1f M samples/s, %llu full-ring retries, %llu errors\n",
+                options.samples, throughput.seconds,
+                throughput.seconds > 0 ? options.samples / throughput.seconds / 1e6 : 0.0,
+                (unsigned long long)throughput.full_spins, (unsigned long long)throughput.errors);
+    std::printf("Paced:    %u Hz into %u Hz for %u s, %llu produced, %llu dropped, %llu drained (max %llu per frame), "
+                "%llu of %llu frames empty, %llu errors\n",
+                options.poll_hz, options.frame_hz, options.seconds, (unsigned long long)paced.produced,
+                (unsigned long long)paced.dropped, (unsigned long long)paced.drained,
+                (unsigned long long)paced.max_drained, (unsigned long long)paced.empty_frames,
+                (unsigned long long)paced.frames, (unsigned long long)paced.errors);
+    std::printf("Latency:  sample age at frame p50 %u us / p99 %u us / max %u us over %llu frames\n",
+                paced.latency.p50_us, paced.latency.p99_us, paced.latency.max_us,
+                (unsigned long long)paced.latency.samples);
+    std::printf("Verify:   histogram %s, ordering %s\n", histogram_ok ? "ok" : "FAILED",
+                throughput.errors == 0 && paced.errors == 0 ? "ok" : "FAILED");
+    return histogram_ok && throughput.errors == 0 && paced.errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+// Input streams for the input benches: generated play-like patterns, or a
+// recording of little-endian uint32 p1/p2 pairs, one pair per frame, as the
+// engine consumed them (InputLedger entries).
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace FM2K::Bench {
+
+struct InputStream {
+    std::string name;
+    std::vector<uint32_t> inputs;   // One player's game input per frame
+};
+
+inline uint32_t NextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Directions and buttons held for a while and released, the way a player
+// moves and presses; `hold_min`..`hold_max` frames per change
+inline InputStream GenerateInputs(const char* name, uint32_t frames, uint32_t seed, uint32_t hold_min,
+                                  uint32_t hold_max, uint32_t idle_percent) {
+    InputStream stream{ name, {} };
+    stream.inputs.reserve(frames);
+    uint32_t state = seed * 0x9E3779B1u | 1;
+    uint32_t input = 0;
+    uint32_t held = 0;
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        if (held == 0) {
+            uint32_t roll = NextRandom(state);
+            if (roll % 100 < idle_percent) {
+                input = 0;
+            } else {
+                uint32_t direction = (roll >> 8) % 9;           // Neutral or one of 8 directions
+                static constexpr uint32_t DIRECTIONS[9] = { 0x0, 0x1, 0x2, 0x4, 0x8, 0x5, 0x6, 0x9, 0xA };
+                uint32_t buttons = (roll >> 12) % 4 == 0 ? (1u << (4 + (roll >> 16) % 7)) : 0;
+                input = DIRECTIONS[direction] | buttons;
+            }
+            held = hold_min + NextRandom(state) % (hold_max - hold_min + 1);
+        }
+        stream.inputs.push_back(input);
+        held--;
+    }
+    return stream;
+}
+
+// Walking interleaved with a few practised motions (quarter circles, dragon
+// punch, dash), each step held 1-3 frames: the repeated sequences a learned
+// predictor can pick up and a hold-based one cannot
+inline InputStream GenerateCombos(const char* name, uint32_t frames, uint32_t seed) {
+    static constexpr uint32_t LEFT = 0x1, RIGHT = 0x2, DOWN = 0x8, BUTTON1 = 0x10, BUTTON2 = 0x20;
+    static const std::vector<uint32_t> MOTIONS[] = {
+        { DOWN, DOWN | RIGHT, RIGHT, RIGHT | BUTTON1 },                 // Quarter circle forward + 1
+        { DOWN, DOWN | LEFT, LEFT, LEFT | BUTTON2 },                    // Quarter circle back + 2
+        { RIGHT, DOWN, DOWN | RIGHT, DOWN | RIGHT | BUTTON1 },          // Dragon punch
+        { RIGHT, 0, RIGHT },                                            // Dash
+    };
+
+    InputStream stream{ name, {} };
+    stream.inputs.reserve(frames);
+    uint32_t state = seed * 0x9E3779B1u | 1;
+    while (stream.inputs.size() < frames) {
+        uint32_t roll = NextRandom(state);
+        if (roll % 3 == 0) {
+            uint32_t walk = (roll >> 8) % 3 == 0 ? 0 : ((roll >> 8) & 1 ? LEFT : RIGHT);
+            for (uint32_t n = 10 + (roll >> 12) % 30; n > 0; n--) stream.inputs.push_back(walk);
+        } else {
+            for (uint32_t step : MOTIONS[(roll >> 8) % 4]) {
+                for (uint32_t n = 1 + NextRandom(state) % 3; n > 0; n--) stream.inputs.push_back(step);
+            }
+        }
+    }
+    stream.inputs.resize(frames);
+    return stream;
+}
+
+inline bool LoadRecordedInputs(const char* path, std::vector<InputStream>& streams) {
+    FILE* file = std::fopen(path, "rb");
+    if (!file) {
+        std::fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+    InputStream p1{ std::string("recorded p1"), {} };
+    InputStream p2{ std::string("recorded p2"), {} };
+    uint8_t pair[8];
+    while (std::fread(pair, 1, sizeof(pair), file) == sizeof(pair)) {
+        p1.inputs.push_back(pair[0] | pair[1] << 8 | pair[2] << 16 | static_cast<uint32_t>(pair[3]) << 24);
+        p2.inputs.push_back(pair[4] | pair[5] << 8 | pair[6] << 16 | static_cast<uint32_t>(pair[7]) << 24);
+    }
+    std::fclose(file);
+    if (p1.inputs.empty()) {
+        std::fprintf(stderr, "%s holds no frames\n", path);
+        return false;
+    }
+    streams.push_back(std::move(p1));
+    streams.push_back(std::move(p2));
+    return true;
+}
+
+} // namespace FM2K::Bench
@@ -0,0 +1,264 @@
+// Page tracker benchmark: the Linux backend of PageTracker (mprotect plus a
+// SIGSEGV handler) and the TrackedSnapshotRing on top of it, over a
+// page-aligned stand-in for game memory. Each frame writes a few random
+// pages, saves into the ring and, every few frames, rolls back; every load
+// is checked against a full copy taken at that save. Reports bytes copied
+// against a full copy, save/load time and the cost of one write fault.
+//
+// A foreign SIGSEGV (a fault on memory the tracker does not own) is raised
+// throughout the run: it must reach the handler installed before the
+// tracker, and tracking must carry on afterwards.
+
+#include "page_tracker.h"
+#include "input_streams.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <signal.h>
+#include <sys/mman.h>
+#include <vector>
+
+namespace {
+
+using namespace FM2K;
+using State::TRACKED_PAGE_SIZE;
+
+struct Options {
+    uint32_t frames = 5000;
+    uint32_t pages = 256;               // Tracked game memory
+    uint32_t dirty = 8;                 // Pages written per frame
+    uint32_t slots = 10;
+    uint32_t rollback_interval = 4;
+    uint32_t max_depth = 8;
+    uint32_t foreign_interval = 97;     // Frames between foreign faults
+    uint32_t seed = 0x50414745;
+};
+
+constexpr uintptr_t GAME_BASE = 0x400000;
+constexpr size_t SMALL_RUN = 64;        // Untracked runs on the trailing page
+
+using Clock = std::chrono::steady_clock;
+
+double ElapsedUs(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+// The handler someone else installed before the tracker: it owns one
+// PROT_NONE page and opens it up when touched
+uint8_t* foreign_page = nullptr;
+volatile sig_atomic_t foreign_faults = 0;
+
+void ForeignHandler(int sig, siginfo_t* info, void* context) {
+    (void)context;
+    uint8_t* address = static_cast<uint8_t*>(info->si_addr);
+    if (foreign_page && address >= foreign_page && address < foreign_page + TRACKED_PAGE_SIZE) {
+        mprotect(foreign_page, TRACKED_PAGE_SIZE, PROT_READ | PROT_WRITE);
+        foreign_faults = foreign_faults + 1;
+        return;
+    }
+    signal(sig, SIG_DFL);
+}
+
+bool InstallForeignHandler() {
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_sigaction = ForeignHandler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    return sigaction(SIGSEGV, &action, nullptr) == 0;
+}
+
+bool ForeignHandlerInstalled() {
+    struct sigaction current;
+    return sigaction(SIGSEGV, nullptr, &current) == 0 && (current.sa_flags & SA_SIGINFO) &&
+           current.sa_sigaction == ForeignHandler;
+}
+
+// Touch the foreign page with it locked again; true if the old handler saw it
+bool RaiseForeignFault() {
+    mprotect(foreign_page, TRACKED_PAGE_SIZE, PROT_NONE);
+    sig_atomic_t before = foreign_faults;
+    *reinterpret_cast<volatile uint8_t*>(foreign_page) = 1;
+    return foreign_faults == before + 1;
+}
+
+struct Result {
+    uint64_t rollbacks;
+    uint64_t bad_saves;         // Ring buffer differs from the full copy taken alongside
+    uint64_t bad_loads;         // Memory differs from that copy after a load
+    uint64_t foreign_raised;
+    uint64_t foreign_lost;      // Never reached the earlier handler
+    uint64_t tracking_lost;     // Tracker inactive or not faulting after a foreign fault
+    double save_us;
+    double load_us;
+    double fault_ns;
+};
+
+void PrintUsage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --frames N      Frames to run (default 5000)\n"
+        "  --pages N       Tracked pages of game memory (default 256)\n"
+        "  --dirty N       Pages the game writes per frame (default 8)\n"
+        "  --slots N       Snapshot ring slots (default 10)\n"
+        "  --interval N    Frames between rollbacks, 0 = none (default 4)\n"
+        "  --depth N       Deepest rollback, below the slot count (default 8)\n"
+        "  --foreign N     Frames between foreign faults, 0 = none (default 97)\n"
+        "  --seed N        Write pattern seed\n",
+        program);
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        uint32_t* out = nullptr;
+        if (!std::strcmp(arg, "--frames")) out = &options.frames;
+        else if (!std::strcmp(arg, "--pages")) out = &options.pages;
+        else if (!std::strcmp(arg, "--dirty")) out = &options.dirty;
+        else if (!std::strcmp(arg, "--slots")) out = &options.slots;
+        else if (!std::strcmp(arg, "--interval")) out = &options.rollback_interval;
+        else if (!std::strcmp(arg, "--depth")) out = &options.max_depth;
+        else if (!std::strcmp(arg, "--foreign")) out = &options.foreign_interval;
+        else if (!std::strcmp(arg, "--seed")) out = &options.seed;
+        if (!out || !value) return false;
+        *out = static_cast<uint32_t>(std::strtoul(value, nullptr, 0));
+        i++;
+    }
+    return options.pages > 0 && options.max_depth > 0 && options.max_depth < options.slots;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    // Tracked pages, then one page holding the small untracked runs
+    size_t image_size = (static_cast<size_t>(options.pages) + 1) * TRACKED_PAGE_SIZE;
+    uint8_t* image = static_cast<uint8_t*>(
+        mmap(nullptr, image_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    foreign_page = static_cast<uint8_t*>(
+        mmap(nullptr, TRACKED_PAGE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (image == MAP_FAILED || foreign_page == MAP_FAILED || !InstallForeignHandler()) {
+        std::fprintf(stderr, "Failed to map memory or install the foreign handler\n");
+        return 1;
+    }
+
+    size_t tracked_size = static_cast<size_t>(options.pages) * TRACKED_PAGE_SIZE;
+    uintptr_t small_base = GAME_BASE + tracked_size;
+    State::MemoryRegion regions[] = {
+        { GAME_BASE, tracked_size, 0, "tracked" },
+        { small_base + SMALL_RUN, SMALL_RUN, 0, "small a" },
+        { small_base + 3 * SMALL_RUN, SMALL_RUN, 0, "small b" },
+    };
+    State::SnapshotPlan plan = State::SnapshotPlan::Packed(regions, 3);
+    State::LocalMemoryBackend memory(image, GAME_BASE, image_size);
+
+    State::TrackedSnapshotRing ring;
+    if (!ring.Init(plan, memory, options.slots) || !ring.IsTracking()) {
+        std::fprintf(stderr, "Write tracking did not start\n");
+        return 1;
+    }
+
+    std::vector<std::vector<uint8_t>> buffers(options.slots, std::vector<uint8_t>(plan.BufferSize()));
+    std::vector<std::vector<uint8_t>> expected(options.slots, std::vector<uint8_t>(plan.BufferSize()));
+    std::vector<uint32_t> saved_frame(options.slots, UINT32_MAX);
+    std::vector<uint8_t> check(plan.BufferSize());
+
+    Result result = {};
+    uint32_t rng = options.seed ? options.seed : 1;
+    uint32_t last_rollback = 0;
+    for (uint32_t frame = 0; frame < options.frames; frame++) {
+        uint32_t slot = frame % options.slots;
+        Clock::time_point start = Clock::now();
+        ring.Save(slot, buffers[slot].data());
+        result.save_us += ElapsedUs(start);
+        plan.Capture(memory, expected[slot].data());     // Reads never fault
+        saved_frame[slot] = frame;
+        if (buffers[slot] != expected[slot]) result.bad_saves++;
+
+        // The game's frame: a few scattered pages and the small runs
+        for (uint32_t n = 0; n < options.dirty; n++) {
+            uint32_t page = Bench::NextRandom(rng) % options.pages;
+            size_t offset = page * TRACKED_PAGE_SIZE + Bench::NextRandom(rng) % TRACKED_PAGE_SIZE;
+            image[offset] = static_cast<uint8_t>(Bench::NextRandom(rng));
+        }
+        image[tracked_size + SMALL_RUN + Bench::NextRandom(rng) % SMALL_RUN] = static_cast<uint8_t>(frame);
+
+        if (options.foreign_interval && frame % options.foreign_interval == 0) {
+            result.foreign_raised++;
+            if (!RaiseForeignFault()) result.foreign_lost++;
+            if (!ring.IsTracking()) result.tracking_lost++;
+        }
+
+        if (!options.rollback_interval || frame % options.rollback_interval != 0 || frame < options.max_depth ||
+            frame <= last_rollback) {
+            continue;
+        }
+        last_rollback = frame;
+
+        uint32_t depth = 1 + Bench::NextRandom(rng) % options.max_depth;
+        uint32_t target = frame + 1 - depth;
+        uint32_t target_slot = target % options.slots;
+        if (saved_frame[target_slot] != target) continue;
+
+        start = Clock::now();
+        ring.Load(target_slot, buffers[target_slot].data());
+        result.load_us += ElapsedUs(start);
+        result.rollbacks++;
+        plan.Capture(memory, check.data());
+        if (check != expected[target_slot]) result.bad_loads++;
+        frame = target - 1;
+    }
+
+    // One write fault, timed over pages armed by a save
+    ring.Save(0, buffers[0].data());
+    uint64_t faults_before = ring.GetStats().faults;
+    Clock::time_point start = Clock::now();
+    for (uint32_t page = 0; page < options.pages; page++) image[page * TRACKED_PAGE_SIZE] ^= 1;
+    double fault_us = ElapsedUs(start);
+    uint64_t timed_faults = ring.GetStats().faults - faults_before;
+    result.fault_ns = timed_faults ? fault_us * 1000.0 / timed_faults : 0.0;
+
+    // A foreign fault with the tracker armed must leave it tracking
+    ring.Save(0, buffers[0].data());
+    faults_before = ring.GetStats().faults;
+    bool foreign_ok = RaiseForeignFault();
+    image[0] ^= 1;
+    bool still_tracking = ring.IsTracking() && ring.GetStats().faults == faults_before + 1;
+    if (!foreign_ok) result.foreign_lost++;
+    if (!still_tracking) result.tracking_lost++;
+
+    State::TrackedSnapshotRing::Stats stats = ring.GetStats();
+    ring.Shutdown();
+    bool handler_restored = ForeignHandlerInstalled();
+
+    uint64_t ops = stats.saves + stats.loads;
+    std::printf("FM2K page tracker bench: %u tracked pages, %u written per frame, %u slots, mprotect backend\n",
+                options.pages, options.dirty, options.slots);
+    std::printf("Copy:    %.1f KB per save or load vs %.1f KB full (%.1f%%), %llu faults (%.2f per frame)\n",
+                ops ? stats.bytes_copied / 1024.0 / ops : 0.0, ops ? stats.bytes_full / 1024.0 / ops : 0.0,
+                stats.bytes_full ? 100.0 * stats.bytes_copied / stats.bytes_full : 0.0,
+                (unsigned long long)stats.faults, stats.saves ? (double)stats.faults / stats.saves : 0.0);
+    std::printf("Time:    save %.1f us, load %.1f us over %llu rollbacks, %.0f ns per write fault\n",
+                stats.saves ? result.save_us / stats.saves : 0.0,
+                result.rollbacks ? result.load_us / result.rollbacks : 0.0, (unsigned long long)result.rollbacks,
+                result.fault_ns);
+    std::printf("Verify:  %llu bad saves, %llu bad loads, %llu of %llu foreign faults lost, tracking %s, "
+                "previous handler %s\n",
+                (unsigned long long)result.bad_saves, (unsigned long long)result.bad_loads,
+                (unsigned long long)result.foreign_lost, (unsigned long long)result.foreign_raised + 1,
+                result.tracking_lost ? "LOST" : "kept", handler_restored ? "restored" : "NOT restored");
+
+    munmap(foreign_page, TRACKED_PAGE_SIZE);
+    munmap(image, image_size);
+    return result.bad_saves == 0 && result.bad_loads == 0 && result.foreign_lost == 0 && result.tracking_lost == 0 &&
+                   handler_restored
+               ? 0
+               : 1;
+}
@@ -0,0 +1,168 @@
+// Object pool scan benchmark: ns per ScanActiveSlots over the game's pool
+// layout (1023 slots, flags a 382-byte stride apart) for each scan kernel
+// (object_pool.h, run through ScanActiveSlotsWith), at several live counts.
+// Each measurement is taken twice: with the pool hot in cache, as when a
+// save follows the frame that just touched it, and cold, after streaming a
+// buffer larger than the last-level cache. Every kernel's bitmap and count
+// are checked against the slots that were made live.
+
+#include "input_streams.h"
+#include "state_manager.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using namespace FM2K;
+namespace Mem = State::Memory;
+using State::ScanKernel;
+
+constexpr ScanKernel KERNELS[] = { ScanKernel::Scalar, ScanKernel::SSE2 };
+constexpr const char* KERNEL_NAMES[] = { "scalar", "SSE2" };
+
+// An empty pool, a quiet round, a busy one, and every slot live
+constexpr uint32_t LIVE_COUNTS[] = { 0, 16, 64, 256, State::OBJECT_POOL_LAYOUT.slot_count };
+
+constexpr size_t EVICT_BYTES = 64 * 1024 * 1024;
+constexpr size_t BITMAP_WORDS = (State::OBJECT_POOL_LAYOUT.slot_count + 31) / 32;
+
+struct Options {
+    uint32_t hot_rounds = 100000;   // Scans per hot measurement
+    uint32_t cold_rounds = 200;     // Scans per cold measurement, each after an eviction pass
+    uint32_t seed = 1;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Mark `live` distinct random slots active; returns the expected bitmap
+std::vector<uint32_t> FillPool(std::vector<uint8_t>& pool, uint32_t live, uint32_t& rng) {
+    const State::ObjectPoolLayout& layout = State::OBJECT_POOL_LAYOUT;
+    std::vector<uint32_t> expected(BITMAP_WORDS, 0);
+    std::memset(pool.data(), 0, pool.size());
+    for (uint32_t placed = 0; placed < live;) {
+        size_t slot = Bench::NextRandom(rng) % layout.slot_count;
+        if ((expected[slot / 32] >> (slot % 32)) & 1u) continue;
+        expected[slot / 32] |= 1u << (slot % 32);
+        // Any non-zero flag counts, including ones with only the high byte set
+        uint16_t flag = static_cast<uint16_t>(placed % 3 == 0 ? 0x100 : 1 + placed % 7);
+        std::memcpy(pool.data() + slot * layout.slot_size + layout.active_flag_offset, &flag, sizeof(flag));
+        placed++;
+    }
+    return expected;
+}
+
+void Evict(std::vector<uint8_t>& evict) {
+    for (size_t i = 0; i < evict.size(); i += 64) evict[i]++;
+}
+
+// Average ns per scan; evicts before each one when `cold`
+double TimeScan(ScanKernel kernel, const std::vector<uint8_t>& pool, uint32_t rounds, bool cold,
+                std::vector<uint8_t>& evict) {
+    uint32_t bitmap[BITMAP_WORDS];
+    volatile size_t sink = 0;
+    double total_ns = 0.0;
+    Clock::time_point start = Clock::now();
+    for (uint32_t round = 0; round < rounds; round++) {
+        if (cold) {
+            Evict(evict);
+            start = Clock::now();
+        }
+        sink = sink + State::ScanActiveSlotsWith(kernel, pool.data(), State::OBJECT_POOL_LAYOUT, bitmap);
+        if (cold) total_ns += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+    if (!cold) total_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    (void)sink;
+    return rounds ? total_ns / rounds : 0.0;
+}
+
+void PrintUsage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --hot-rounds N   Scans per hot-cache measurement (default 100000)\n"
+        "  --cold-rounds N  Scans per cold-cache measurement (default 200)\n"
+        "  --seed N         Slot placement seed (default 1)\n",
+        program);
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto number = [&](uint32_t& out) {
+            if (!value) return false;
+            out = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+            i++;
+            return true;
+        };
+
+        bool ok = true;
+        if (!std::strcmp(arg, "--hot-rounds")) ok = number(options.hot_rounds);
+        else if (!std::strcmp(arg, "--cold-rounds")) ok = number(options.cold_rounds);
+        else if (!std::strcmp(arg, "--seed")) ok = number(options.seed);
+        else ok = false;
+
+        if (!ok) return false;
+    }
+    return options.hot_rounds > 0 && options.cold_rounds > 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    const State::ObjectPoolLayout& layout = State::OBJECT_POOL_LAYOUT;
+    std::vector<uint8_t> pool(Mem::OBJECT_POOL_SIZE);
+    std::vector<uint8_t> evict(EVICT_BYTES);
+    uint32_t rng = options.seed * 0x9E3779B1u | 1;
+
+    std::printf("FM2K pool scan bench: %zu slots, %zu-byte stride, flag at +%zu\n", layout.slot_count,
+                layout.slot_size, layout.active_flag_offset);
+    std::printf("%-8s %-8s", "ns/scan", "");
+    for (uint32_t live : LIVE_COUNTS) std::printf(" %8u", live);
+    std::printf("\n");
+
+    // Rows are filled per kernel and cache state, columns per live count
+    constexpr size_t KERNEL_COUNT = sizeof(KERNELS) / sizeof(KERNELS[0]);
+    constexpr size_t LIVE_COLUMNS = sizeof(LIVE_COUNTS) / sizeof(LIVE_COUNTS[0]);
+    double ns[2][KERNEL_COUNT][LIVE_COLUMNS] = {};
+    uint64_t mismatches = 0;
+    for (size_t column = 0; column < LIVE_COLUMNS; column++) {
+        std::vector<uint32_t> expected = FillPool(pool, LIVE_COUNTS[column], rng);
+        for (size_t k = 0; k < KERNEL_COUNT; k++) {
+            if (!State::ScanKernelSupported(KERNELS[k])) continue;
+            uint32_t bitmap[BITMAP_WORDS];
+            size_t live = State::ScanActiveSlotsWith(KERNELS[k], pool.data(), layout, bitmap);
+            if (live != LIVE_COUNTS[column] || std::memcmp(bitmap, expected.data(), sizeof(bitmap)) != 0) {
+                if (mismatches++ < 8) {
+                    std::fprintf(stderr, "%s scan of %u live slots found %zu or a different bitmap\n",
+                                 KERNEL_NAMES[k], LIVE_COUNTS[column], live);
+                }
+            }
+            ns[0][k][column] = TimeScan(KERNELS[k], pool, options.hot_rounds, false, evict);
+            ns[1][k][column] = TimeScan(KERNELS[k], pool, options.cold_rounds, true, evict);
+        }
+    }
+
+    for (int cold = 0; cold < 2; cold++) {
+        for (size_t k = 0; k < KERNEL_COUNT; k++) {
+            std::printf("%-8s %-8s", KERNEL_NAMES[k], cold ? "cold" : "hot");
+            if (!State::ScanKernelSupported(KERNELS[k])) {
+                std::printf(" unsupported in this build\n");
+                continue;
+            }
+            for (size_t column = 0; column < LIVE_COLUMNS; column++) std::printf(" %8.0f", ns[cold][k][column]);
+            std::printf("\n");
+        }
+    }
+
+    std::printf("Verify:  %llu scans disagree with the slots made live\n", (unsigned long long)mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,262 @@
+// Replay benchmark: records SyntheticEngine through ReplayRecorder the way
+// the hook records the game, then seeks the finished file: load the nearest
+// keyframe, fast-forward on the recorded inputs, and check the state matches
+// the one the recording run had at that frame. Reports the game thread's
+// recording cost, the file's size and the seek time. Without --out the file
+// goes to the temp directory and is deleted once it has been read back.
+
+#include "synthetic_engine.h"
+#include "input_codec.h"
+#include "input_streams.h"
+#include "replay_format.h"
+#include "replay_recorder.h"
+#include "state_schema.h"
+#include "FM2K_Checksum.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace FM2K;
+
+constexpr uint32_t FRAMES_PER_SECOND = 100;
+
+// Keyframes hold everything a frame depends on, whole input rings included,
+// so a replay opens in a process whose ring index never matched (as the hook)
+constexpr uint32_t KEYFRAME_CAPTURES = State::CaptureBit(State::Capture::Whole) |
+                                       State::CaptureBit(State::Capture::Window) |
+                                       State::CaptureBit(State::Capture::Pool);
+constexpr auto KEYFRAME_REGIONS = State::PackFields(State::STATE_SCHEMA, KEYFRAME_CAPTURES);
+
+struct Options {
+    uint32_t frames = 60000;    // Ten minutes
+    uint32_t keyframe_interval = ReplayRecorder::DEFAULT_KEYFRAME_INTERVAL;
+    uint32_t seeks = 100;
+    const char* path = nullptr;  // Temp file, removed after reading back
+    Bench::SyntheticEngine::Config engine;
+};
+
+using Clock = std::chrono::steady_clock;
+
+uint64_t ElapsedNanoseconds(Clock::time_point start) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+}
+
+// Seek targets, sorted, spread over the run with a few on keyframes
+std::vector<uint32_t> PickTargets(const Options& options) {
+    std::vector<uint32_t> targets;
+    uint32_t state = options.engine.seed * 0x9E3779B1u | 1;
+    for (uint32_t n = 0; n < options.seeks; n++) {
+        uint32_t target = Bench::NextRandom(state) % options.frames;
+        if (n % 8 == 0) target -= target % options.keyframe_interval;
+        targets.push_back(target);
+    }
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+    return targets;
+}
+
+uint64_t StateHash(const State::SnapshotPlan& plan, Bench::SyntheticEngine& engine, std::vector<uint8_t>& scratch) {
+    plan.Capture(engine.Memory(), scratch.data());
+    return Checksum::Hash64(scratch.data(), scratch.size());
+}
+
+void PrintUsage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --frames N              Frames to record (default 60000, ten minutes)\n"
+        "  --keyframe-interval N   Frames between keyframes, a multiple of %u (default %u)\n"
+        "  --seeks N               Random seeks to verify (default 100)\n"
+        "  --objects N             Live objects in the pool (default 64)\n"
+        "  --out FILE              Keep the replay file here (default: temp file, deleted)\n"
+        "  --seed N                Engine and input seed (default 1)\n",
+        program, ReplayRecorder::DEFAULT_BLOCK_FRAMES, ReplayRecorder::DEFAULT_KEYFRAME_INTERVAL);
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto number = [&](uint32_t& out) {
+            if (!value) return false;
+            out = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+            i++;
+            return true;
+        };
+
+        bool ok = true;
+        if (!std::strcmp(arg, "--frames")) ok = number(options.frames);
+        else if (!std::strcmp(arg, "--keyframe-interval")) ok = number(options.keyframe_interval);
+        else if (!std::strcmp(arg, "--seeks")) ok = number(options.seeks);
+        else if (!std::strcmp(arg, "--objects")) ok = number(options.engine.active_objects);
+        else if (!std::strcmp(arg, "--seed")) ok = number(options.engine.seed);
+        else if (!std::strcmp(arg, "--out") && value) { options.path = value; i++; }
+        else ok = false;
+
+        if (!ok) return false;
+    }
+    return options.frames > 0 && options.keyframe_interval > 0 &&
+           options.keyframe_interval % ReplayRecorder::DEFAULT_BLOCK_FRAMES == 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    std::string temp_path;
+    bool keep_file = options.path != nullptr;
+    if (!keep_file) {
+        std::error_code error;
+        std::filesystem::path dir = std::filesystem::temp_directory_path(error);
+        temp_path = (error ? std::filesystem::path("fm2k_replay_bench.fm2r") : dir / "fm2k_replay_bench.fm2r").string();
+        options.path = temp_path.c_str();
+    }
+
+    State::SnapshotPlan plan(KEYFRAME_REGIONS.begin(), KEYFRAME_REGIONS.count);
+    std::vector<uint8_t> scratch(plan.BufferSize());
+    Bench::InputStream p1 = Bench::GenerateInputs("p1", options.frames, options.engine.seed, 4, 40, 20);
+    Bench::InputStream p2 = Bench::GenerateInputs("p2", options.frames, options.engine.seed + 1, 1, 12, 10);
+    std::vector<uint32_t> targets = PickTargets(options);
+    std::vector<uint64_t> expected(targets.size());
+
+    // Record: stage keyframes at frame starts, append each frame as it runs
+    // (no rollbacks here, so every frame is confirmed at once)
+    Bench::SyntheticEngine engine;
+    engine.Reset(options.engine);
+    InputCodec codec;
+    ReplayRecorder recorder;
+    ReplayRecorder::Config config;
+    config.path = options.path;
+    config.state_size = static_cast<uint32_t>(plan.BufferSize());
+    config.keyframe_interval = options.keyframe_interval;
+    if (!recorder.Start(config)) {
+        std::fprintf(stderr, "Cannot record to %s\n", options.path);
+        return 1;
+    }
+
+    std::vector<uint64_t> append_ns(options.frames);
+    uint64_t stage_ns = 0, stage_max_ns = 0;
+    size_t next_target = 0;
+    for (uint32_t frame = 0; frame < options.frames; frame++) {
+        if (recorder.WantsKeyframe(frame)) {
+            Clock::time_point start = Clock::now();
+            if (uint8_t* buffer = recorder.StageKeyframe(frame)) {
+                plan.Capture(engine.Memory(), buffer);
+                recorder.KeyframeStaged(frame);
+            }
+            uint64_t ns = ElapsedNanoseconds(start);
+            stage_ns += ns;
+            stage_max_ns = std::max(stage_max_ns, ns);
+        }
+        while (next_target < targets.size() && targets[next_target] == frame) {
+            expected[next_target++] = StateHash(plan, engine, scratch);
+        }
+
+        engine.Step(p1.inputs[frame], p2.inputs[frame]);
+
+        Clock::time_point start = Clock::now();
+        recorder.AppendFrame(codec.ToWire(p1.inputs[frame]), codec.ToWire(p2.inputs[frame]));
+        append_ns[frame] = ElapsedNanoseconds(start);
+    }
+    recorder.Stop();
+    ReplayRecorder::Stats stats = recorder.GetStats();
+    if (stats.failed) {
+        std::fprintf(stderr, "Recording failed\n");
+        if (!keep_file) std::remove(options.path);
+        return 1;
+    }
+
+    // Read it back whole; a player would map it
+    FILE* file = std::fopen(options.path, "rb");
+    if (!file) {
+        std::fprintf(stderr, "Cannot open %s\n", options.path);
+        return 1;
+    }
+    std::vector<uint8_t> data;
+    uint8_t chunk[65536];
+    size_t got = 0;
+    while ((got = std::fread(chunk, 1, sizeof(chunk), file)) > 0) data.insert(data.end(), chunk, chunk + got);
+    std::fclose(file);
+    if (!keep_file) std::remove(options.path);
+
+    ReplayReader reader;
+    if (!reader.Open(data.data(), data.size()) || reader.EndFrame() != options.frames) {
+        std::fprintf(stderr, "%s does not open as a %u-frame replay\n", options.path, options.frames);
+        return 1;
+    }
+    ReplayReader scanned;
+    bool scan_ok = scanned.Open(data.data(), data.size() - sizeof(ReplayFooter)) &&
+                   scanned.KeyframeCount() == reader.KeyframeCount() && scanned.EndFrame() == reader.EndFrame();
+
+    // Seek: nearest keyframe, then fast-forward with rendering (here: hashing) off
+    InputCodec playback;
+    playback.Init(reader.Header().input_map);
+    std::vector<uint8_t> state(reader.Header().state_size);
+    std::vector<uint16_t> wire_p1(options.keyframe_interval), wire_p2(options.keyframe_interval);
+    uint64_t seek_ns = 0, seek_max_ns = 0, forwarded = 0, mismatches = 0;
+    for (size_t n = 0; n < targets.size(); n++) {
+        engine.Reset(options.engine);
+        Clock::time_point start = Clock::now();
+        uint32_t keyframe = 0;
+        uint32_t count = 0;
+        bool ok = reader.LoadKeyframe(targets[n], &keyframe, state.data()) &&
+                  plan.Restore(engine.Memory(), state.data());
+        if (ok) {
+            count = targets[n] - keyframe;
+            if (count > wire_p1.size()) {
+                wire_p1.resize(count);
+                wire_p2.resize(count);
+            }
+            ok = reader.ReadInputs(keyframe, count, wire_p1.data(), wire_p2.data());
+        }
+        for (uint32_t frame = 0; ok && frame < count; frame++) {
+            engine.Step(playback.FromWire(wire_p1[frame]), playback.FromWire(wire_p2[frame]));
+        }
+        uint64_t ns = ElapsedNanoseconds(start);
+        seek_ns += ns;
+        seek_max_ns = std::max(seek_max_ns, ns);
+        forwarded += count;
+
+        if (!ok || StateHash(plan, engine, scratch) != expected[n]) {
+            if (++mismatches <= 5) std::fprintf(stderr, "Seek to frame %u does not reproduce it\n", targets[n]);
+        }
+    }
+
+    // Percentiles: on a busy or single core the writer's work can land
+    // inside a timed append when it preempts the game thread
+    std::sort(append_ns.begin(), append_ns.end());
+    double minutes = static_cast<double>(options.frames) / FRAMES_PER_SECOND / 60.0;
+    uint64_t input_bytes = stats.bytes_written - stats.keyframe_encoded_bytes;
+    std::printf("FM2K replay bench: %u frames (%.1f min), %u objects, keyframe every %u frames (%u bytes raw)\n",
+                options.frames, minutes, engine.LiveObjects(), options.keyframe_interval, config.state_size);
+    std::printf("File:    %llu bytes, %.0f bytes/min (inputs + index %.0f bytes/min, keyframes %.0f bytes/min)\n",
+                (unsigned long long)stats.bytes_written, stats.bytes_written / minutes, input_bytes / minutes,
+                stats.keyframe_encoded_bytes / minutes);
+    std::printf("Keys:    %llu written, %llu dropped, %.1fx compressed, %zu indexed, footerless scan %s\n",
+                (unsigned long long)stats.keyframes_written, (unsigned long long)stats.keyframes_dropped,
+                stats.keyframe_encoded_bytes ? (double)stats.keyframe_raw_bytes / stats.keyframe_encoded_bytes : 0.0,
+                reader.KeyframeCount(), scan_ok ? "ok" : "FAILED");
+    std::printf("Record:  append %llu ns p50 / %llu ns p99 per frame, keyframe stage %.1f us avg / %.1f us max, "
+                "queue max %u of %zu\n",
+                (unsigned long long)append_ns[append_ns.size() / 2],
+                (unsigned long long)append_ns[append_ns.size() * 99 / 100],
+                stats.keyframes_written ? stage_ns / 1000.0 / stats.keyframes_written : 0.0, stage_max_ns / 1000.0,
+                stats.max_queued, ReplayRecorder::INPUT_JOB_SLOTS + 2);
+    std::printf("Seek:    %zu seeks, %.2f ms avg / %.2f ms max, %.0f frames fast-forwarded avg\n", targets.size(),
+                targets.empty() ? 0.0 : seek_ns / 1e6 / targets.size(), seek_max_ns / 1e6,
+                targets.empty() ? 0.0 : (double)forwarded / targets.size());
+    std::printf("Verify:  %llu of %zu seeks mismatched\n", (unsigned long long)mismatches, targets.size());
+    return mismatches == 0 && scan_ok ? 0 : 1;
+}
@@ -0,0 +1,657 @@
+// Headless rollback benchmark: the hook's snapshot plan, input history
+// window, object pool capture and checksum tree driven against
+// SyntheticEngine instead of the game. Buffers recycled by frame stand in
+// for GekkoNet's state storage, indexed by the hook's StateBufferTable.
+// Every rollback is a forced one, as in a GekkoNet stress session: roll back
+// `depth` frames, resimulate them on the same inputs (overriding what the
+// engine polls, as the hook does), and check that the image hashes the same
+// as the first time.
+
+#include "synthetic_engine.h"
+#include "checksum_tree.h"
+#include "input_codec.h"
+#include "input_ledger.h"
+#include "rollback_timings.h"
+#include "state_buffer_table.h"
+#include "state_schema.h"
+#include "FM2K_Checksum.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#ifdef FM2K_BENCH_GEKKONET
+#include "gekkonet.h"
+#endif
+
+namespace {
+
+using namespace FM2K;
+namespace Mem = State::Memory;
+
+// Same ring sizing as the hook (dllmain.cpp)
+constexpr uint32_t INPUT_PREDICTION_WINDOW = 8;
+constexpr uint32_t SNAPSHOT_RING_MARGIN = 2;
+constexpr uint32_t SNAPSHOT_RING_SLOTS = INPUT_PREDICTION_WINDOW + SNAPSHOT_RING_MARGIN;
+constexpr size_t CHECKSUM_POOL_CHUNK = 4096;
+
+// Straight-run hashes kept for verification; must cover the deepest rollback
+constexpr uint32_t HASH_HISTORY = 32;
+static_assert(INPUT_PREDICTION_WINDOW < HASH_HISTORY, "Hash history must cover every rollback depth");
+
+// Everything a rollback restores, captured alongside each straight-run hash
+// so a desync can be reported field by field
+constexpr uint32_t REPORT_CAPTURES = State::CaptureBit(State::Capture::Whole) |
+                                     State::CaptureBit(State::Capture::Window) |
+                                     State::CaptureBit(State::Capture::Pool);
+constexpr auto REPORT_REGIONS = State::PackFields(State::STATE_SCHEMA, REPORT_CAPTURES);
+constexpr size_t REPORT_DIFFS = 4;
+
+struct Options {
+    uint32_t frames = 6000;
+    uint32_t rollback_interval = 4;     // Frames between forced rollbacks (0 = none)
+    uint32_t max_depth = INPUT_PREDICTION_WINDOW;
+    bool sparse_pool = false;           // Capture live objects only instead of the whole pool
+    bool remote_pool = false;           // Sparse pool through Read/Write only, as RemoteMemoryBackend
+    bool skip_dead = false;             // Restore with DeadSlotPolicy::Skip
+    bool verify = true;
+    bool gekko = false;
+    Checksum::Mode checksum = Checksum::Mode::Fletcher32;
+    Bench::SyntheticEngine::Config engine;
+};
+
+using Clock = std::chrono::steady_clock;
+
+uint64_t ElapsedMicroseconds(Clock::time_point start) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+}
+
+// Inputs held for a few frames at a time, like a player would, and a pure
+// function of the frame so resimulation sees the same ones
+uint32_t InputFor(uint32_t frame, uint32_t player, uint32_t seed) {
+    uint32_t x = (frame / 6) * 0x9E3779B1u ^ (player + 1) * 0x85EBCA6Bu ^ seed;
+    x ^= x >> 15;
+    x *= 0x2C1B3C6Du;
+    x ^= x >> 12;
+    return x & State::FM2K_INPUT_MASK;
+}
+
+// What the hook does after the engine's input poll when a frame must run on
+// confirmed inputs (dllmain.cpp OverridePolledInputs): the registers and the
+// history slot the poll just wrote both take them
+bool OverridePolledInputs(Bench::SyntheticEngine& engine, uint32_t index, uint32_t p1, uint32_t p2) {
+    return engine.Memory().Write(Mem::P1_INPUT_ADDR, &p1, sizeof(p1)) &&
+           engine.Memory().Write(Mem::P2_INPUT_ADDR, &p2, sizeof(p2)) &&
+           State::WriteInputHistorySlot(engine.Memory(), State::INPUT_HISTORY_LAYOUT, index, p1, p2);
+}
+
+// The engine's memory seen only through Read/Write, as the launcher's
+// RemoteMemoryBackend sees the game, counting calls and bytes moved
+class ReadWriteBackend : public State::MemoryBackend {
+public:
+    explicit ReadWriteBackend(State::MemoryBackend& inner) : inner_(inner) {}
+
+    bool Read(uintptr_t address, void* dst, size_t size) override {
+        calls++;
+        bytes += size;
+        return inner_.Read(address, dst, size);
+    }
+    bool Write(uintptr_t address, const void* src, size_t size) override {
+        calls++;
+        bytes += size;
+        return inner_.Write(address, src, size);
+    }
+
+    uint64_t calls = 0;
+    uint64_t bytes = 0;
+
+private:
+    State::MemoryBackend& inner_;
+};
+
+// The hook's save/load path (dllmain.cpp SaveGameStateDirect /
+// LoadGameStateDirect) minus the page tracker and heap arena: every save
+// copies the whole plan and rehashes every leaf.
+//
+// Slot layout: SlotHeader, input history window, plan buffer (Whole fields,
+// plus the whole pool unless sparse), then the sparse pool if enabled.
+class RollbackStack {
+public:
+    struct Stats {
+        uint64_t saves;
+        uint64_t loads;
+        uint64_t save_us;
+        uint64_t load_us;
+        uint64_t pool_bytes;        // Sparse pool bytes captured, summed over saves
+        uint64_t pool_calls;        // Read/Write calls for the pool (remote only)
+        uint64_t pool_moved;        // Bytes those calls moved
+        uint64_t ghost_slots;       // Slots active after a load that were dead in its snapshot
+    };
+
+    bool Init(Bench::SyntheticEngine& engine, const Options& options);
+
+    bool Save(uint32_t frame);
+    bool Load(uint32_t frame);
+
+    size_t SlotSize() const { return slot_size_; }
+    size_t PlanRuns() const { return plan_.Runs().size(); }
+#ifdef FM2K_BENCH_GEKKONET
+    uint32_t Checksum(uint32_t frame);
+#endif
+    const Stats& GetStats() const { return stats_; }
+
+private:
+    struct SlotHeader {
+        uint32_t frame;
+        uint32_t checksum;
+        uint32_t pool_size;
+        uint32_t reserved;
+    };
+
+    uint64_t CountGhostSlots(const uint8_t* pool_snapshot) const;
+
+    static constexpr size_t HISTORY_OFFSET = sizeof(SlotHeader);
+    static constexpr size_t PLAN_OFFSET = HISTORY_OFFSET + sizeof(State::InputHistorySnapshot);
+
+    Bench::SyntheticEngine* engine_ = nullptr;
+    State::LocalMemoryBackend* memory_ = nullptr;
+    std::unique_ptr<ReadWriteBackend> remote_;
+    State::MemoryBackend* pool_memory_ = nullptr;
+    State::DeadSlotPolicy dead_slots_ = State::DeadSlotPolicy::ZeroFill;
+    // GekkoNet-style storage: frame N is saved into buffer N % count
+    std::vector<uint8_t> storage_;
+    std::vector<uint32_t> checksums_;
+    std::vector<uint32_t> lengths_;
+    size_t slot_size_ = 0;
+    size_t stride_ = 0;
+    State::StateBufferTable table_;
+    State::SnapshotPlan plan_;
+    State::ChecksumTree tree_;
+    bool sparse_pool_ = false;
+    size_t pool_offset_ = 0;
+    size_t pool_capacity_ = 0;
+    std::vector<uint8_t> scratch_;
+    Stats stats_ = {};
+};
+
+bool RollbackStack::Init(Bench::SyntheticEngine& engine, const Options& options) {
+    engine_ = &engine;
+    memory_ = &engine.Memory();
+    sparse_pool_ = options.sparse_pool || options.remote_pool || options.skip_dead;
+    pool_memory_ = memory_;
+    if (options.remote_pool) {
+        remote_ = std::make_unique<ReadWriteBackend>(*memory_);
+        pool_memory_ = remote_.get();
+    }
+    dead_slots_ = options.skip_dead ? State::DeadSlotPolicy::Skip : State::DeadSlotPolicy::ZeroFill;
+
+    // Same layout as the hook's state buffers, generated from the schema
+    uint32_t captures = State::CaptureBit(State::Capture::Whole);
+    if (!sparse_pool_) captures |= State::CaptureBit(State::Capture::Pool);
+    auto regions = State::PackFields(State::STATE_SCHEMA, captures, PLAN_OFFSET);
+    auto runs = State::MergeRuns(regions);
+    plan_.Build(runs.begin(), runs.count);
+    pool_offset_ = regions.buffer_size;
+    pool_capacity_ = sparse_pool_ ? State::MaxObjectPoolSnapshotSize(State::OBJECT_POOL_LAYOUT) : 0;
+
+    slot_size_ = pool_offset_ + pool_capacity_;
+    stride_ = (slot_size_ + 63) & ~static_cast<size_t>(63);
+    storage_.assign(SNAPSHOT_RING_SLOTS * stride_, 0);
+    checksums_.assign(SNAPSHOT_RING_SLOTS, 0);
+    lengths_.assign(SNAPSHOT_RING_SLOTS, 0);
+    table_.Init(SNAPSHOT_RING_SLOTS);
+
+    // Checksum leaves as in the hook; a sparse pool is hashed on its own
+    // since its length varies per save
+    std::vector<State::MemoryRegion> leaves;
+    leaves.push_back({ Mem::P1_INPUT_HISTORY_ADDR, sizeof(State::InputHistorySnapshot), HISTORY_OFFSET,
+                       "input history" });
+    for (const auto& region : State::PackFields(State::STATE_SCHEMA, captures, PLAN_OFFSET,
+                                                State::PriorityBit(State::Priority::Critical))) {
+        if (region.address != Mem::OBJECT_POOL_ADDR) {
+            leaves.push_back(region);
+            continue;
+        }
+        for (size_t offset = 0; offset < region.size; offset += CHECKSUM_POOL_CHUNK) {
+            size_t size = std::min(CHECKSUM_POOL_CHUNK, region.size - offset);
+            leaves.push_back({ region.address + offset, size, region.offset + offset, "object pool" });
+        }
+    }
+    tree_.Build(leaves.data(), leaves.size(), options.checksum);
+    return true;
+}
+
+// Slots active in the engine now that the sparse snapshot just loaded had dead
+uint64_t RollbackStack::CountGhostSlots(const uint8_t* pool_snapshot) const {
+    const State::ObjectPoolLayout& layout = State::OBJECT_POOL_LAYOUT;
+    const uint32_t* saved = reinterpret_cast<const uint32_t*>(pool_snapshot + sizeof(State::ObjectPoolHeader));
+    uint32_t now[(Mem::MAX_OBJECTS + 31) / 32];
+    State::ScanActiveSlots(memory_->Translate(layout.address, Mem::OBJECT_POOL_SIZE), layout, now);
+
+    uint64_t ghosts = 0;
+    for (size_t w = 0; w < (layout.slot_count + 31) / 32; w++) {
+        for (uint32_t bits = now[w] & ~saved[w]; bits; bits &= bits - 1) ghosts++;
+    }
+    return ghosts;
+}
+
+bool RollbackStack::Save(uint32_t frame) {
+    Clock::time_point start = Clock::now();
+    uint32_t index = frame % SNAPSHOT_RING_SLOTS;
+    uint32_t slot = 0;
+    if (!table_.Bind(frame, storage_.data() + index * stride_, &checksums_[index], &lengths_[index], &slot)) {
+        return false;
+    }
+    uint8_t* buffer = table_.Get(slot).buffer;
+
+    SlotHeader& header = *reinterpret_cast<SlotHeader*>(buffer);
+    auto& history = *reinterpret_cast<State::InputHistorySnapshot*>(buffer + HISTORY_OFFSET);
+    if (!plan_.Capture(*memory_, buffer) ||
+        !State::SaveInputHistory(*memory_, State::INPUT_HISTORY_LAYOUT, SNAPSHOT_RING_SLOTS, history)) {
+        return false;
+    }
+
+    header.frame = frame;
+    header.pool_size = 0;
+    uint32_t pool_checksum = 0;
+    if (sparse_pool_) {
+        size_t size = State::SaveObjectPool(*pool_memory_, State::OBJECT_POOL_LAYOUT, buffer + pool_offset_,
+                                            pool_capacity_, scratch_);
+        if (size == 0) return false;
+        header.pool_size = static_cast<uint32_t>(size);
+        if (remote_) {
+            stats_.pool_calls = remote_->calls;
+            stats_.pool_moved = remote_->bytes;
+        }
+        pool_checksum = Checksum::StateChecksum(tree_.ChecksumMode(), buffer + pool_offset_, size);
+        stats_.pool_bytes += size;
+    }
+
+    // No write tracking here, so every leaf counts as changed
+    tree_.MarkAllChanged();
+    header.checksum = tree_.Update(buffer) ^ pool_checksum;
+    *table_.Get(slot).checksum = header.checksum;
+    *table_.Get(slot).length = static_cast<uint32_t>(slot_size_);
+    table_.MarkCaptured(slot);
+
+    stats_.saves++;
+    stats_.save_us += ElapsedMicroseconds(start);
+    return true;
+}
+
+bool RollbackStack::Load(uint32_t frame) {
+    Clock::time_point start = Clock::now();
+    uint32_t slot = 0;
+    if (!table_.FindCaptured(frame, &slot)) return false;
+    const uint8_t* buffer = table_.Get(slot).buffer;
+
+    const SlotHeader& header = *reinterpret_cast<const SlotHeader*>(buffer);
+    const auto& history = *reinterpret_cast<const State::InputHistorySnapshot*>(buffer + HISTORY_OFFSET);
+
+    // Input history before the index it is checked against is rewound
+    if (!State::LoadInputHistory(*memory_, State::INPUT_HISTORY_LAYOUT, history) ||
+        !plan_.Restore(*memory_, buffer)) {
+        return false;
+    }
+    if (sparse_pool_) {
+        if (!State::LoadObjectPool(*pool_memory_, State::OBJECT_POOL_LAYOUT, buffer + pool_offset_, header.pool_size,
+                                   dead_slots_)) {
+            return false;
+        }
+        stats_.ghost_slots += CountGhostSlots(buffer + pool_offset_);
+        if (dead_slots_ == State::DeadSlotPolicy::Skip) engine_->ClearDeadSlots();
+        if (remote_) {
+            stats_.pool_calls = remote_->calls;
+            stats_.pool_moved = remote_->bytes;
+        }
+    }
+    table_.InvalidateAfter(frame);
+
+    stats_.loads++;
+    stats_.load_us += ElapsedMicroseconds(start);
+    return true;
+}
+
+#ifdef FM2K_BENCH_GEKKONET
+uint32_t RollbackStack::Checksum(uint32_t frame) {
+    uint32_t slot = 0;
+    if (!table_.FindBound(frame, &slot) || !table_.Get(slot).captured) return 0;
+    return reinterpret_cast<const SlotHeader*>(table_.Get(slot).buffer)->checksum;
+}
+#endif
+
+// Which schema fields a desynced frame got wrong; a hash mismatch with no
+// field listed lies outside the schema (heap, untracked memory)
+void ReportFieldDiffs(const State::SnapshotPlan& plan, Bench::SyntheticEngine& engine, const uint8_t* expected,
+                      uint8_t* actual) {
+    if (!plan.Capture(engine.Memory(), actual)) return;
+
+    State::FieldDiff diffs[REPORT_DIFFS];
+    size_t count = State::DiffFields(State::STATE_SCHEMA, State::STATE_SCHEMA_COUNT, REPORT_CAPTURES, 0, actual,
+                                     expected, diffs, REPORT_DIFFS);
+    for (size_t i = 0; i < std::min(count, REPORT_DIFFS); i++) {
+        char line[160];
+        State::FormatFieldDiff(diffs[i], line, sizeof(line));
+        std::fprintf(stderr, "  %s\n", line);
+    }
+    if (count > REPORT_DIFFS) std::fprintf(stderr, "  ... %zu more fields\n", count - REPORT_DIFFS);
+}
+
+struct RunResult {
+    uint32_t live_frames;
+    uint64_t resim_frames;
+    uint64_t step_us;
+    uint64_t desyncs;
+    uint64_t input_misses;      // Advances whose inputs did not reach the image
+    uint64_t elapsed_us;        // Save + load + step, verification excluded
+};
+
+// Straight run with a forced rollback every rollback_interval frames, depths
+// cycling 1..max_depth
+bool RunForcedRollbacks(const Options& options, Bench::SyntheticEngine& engine, RollbackStack& stack,
+                        State::RollbackTimings& timings, RunResult& result) {
+    uint64_t hashes[HASH_HISTORY] = {};
+    uint32_t next_depth = 1;
+    uint32_t seed = options.engine.seed;
+
+    State::SnapshotPlan report_plan(REPORT_REGIONS.begin(), REPORT_REGIONS.count);
+    std::vector<uint8_t> expected(options.verify ? HASH_HISTORY * REPORT_REGIONS.buffer_size : 0);
+    std::vector<uint8_t> actual(options.verify ? REPORT_REGIONS.buffer_size : 0);
+
+    for (uint32_t frame = 0; frame < options.frames; frame++) {
+        if (!stack.Save(frame)) {
+            std::fprintf(stderr, "Save failed at frame %u\n", frame);
+            return false;
+        }
+
+        Clock::time_point step_start = Clock::now();
+        engine.Step(InputFor(frame, 0, seed), InputFor(frame, 1, seed));
+        result.step_us += ElapsedMicroseconds(step_start);
+        result.live_frames++;
+        if (options.verify) {
+            hashes[frame % HASH_HISTORY] = engine.Hash();
+            report_plan.Capture(engine.Memory(), &expected[(frame % HASH_HISTORY) * REPORT_REGIONS.buffer_size]);
+        }
+
+        if (options.rollback_interval == 0 || (frame + 1) % options.rollback_interval != 0) continue;
+
+        uint32_t depth = std::min(next_depth, frame + 1);
+        next_depth = next_depth % options.max_depth + 1;
+        uint32_t target = frame + 1 - depth;
+
+        Clock::time_point restore_start = Clock::now();
+        if (!stack.Load(target)) {
+            std::fprintf(stderr, "Load of frame %u failed at frame %u\n", target, frame);
+            return false;
+        }
+        uint64_t restore_us = ElapsedMicroseconds(restore_start);
+
+        // Resimulate on the same inputs, saving as the hook does. The engine
+        // still polls the devices, which hold what is pressed now rather than
+        // what each frame ran with, so the confirmed inputs replace the poll's
+        // before the frame's logic runs.
+        Clock::time_point fastforward_start = Clock::now();
+        for (uint32_t resim = target; resim <= frame; resim++) {
+            if (resim != target && !stack.Save(resim)) return false;
+            uint32_t index = engine.PollInputs(InputFor(frame, 0, seed + 1), InputFor(frame, 1, seed + 1));
+            if (!OverridePolledInputs(engine, index, InputFor(resim, 0, seed), InputFor(resim, 1, seed))) return false;
+            engine.Update();
+            result.resim_frames++;
+        }
+        timings.Record(depth, restore_us, ElapsedMicroseconds(fastforward_start));
+
+        if (options.verify && engine.Hash() != hashes[frame % HASH_HISTORY]) {
+            result.desyncs++;
+            if (result.desyncs <= 5) {
+                std::fprintf(stderr, "Desync: frame %u differs after a %u-frame rollback\n", frame, depth);
+                ReportFieldDiffs(report_plan, engine, &expected[(frame % HASH_HISTORY) * REPORT_REGIONS.buffer_size],
+                                 actual.data());
+            }
+        }
+    }
+    return true;
+}
+
+#ifdef FM2K_BENCH_GEKKONET
+// Whether the frame just run read `p1`/`p2`: the registers and the history
+// slot at `index` hold them
+bool InputsReachedImage(Bench::SyntheticEngine& engine, uint32_t index, uint32_t p1, uint32_t p2) {
+    uint32_t registers[2] = {};
+    uint32_t history[2] = {};
+    uintptr_t slot = (index & (Mem::INPUT_HISTORY_ENTRIES - 1)) * sizeof(uint32_t);
+    return engine.Memory().Read(Mem::P1_INPUT_ADDR, registers, sizeof(registers)) &&
+           engine.Memory().Read(Mem::P1_INPUT_HISTORY_ADDR + slot, &history[0], sizeof(uint32_t)) &&
+           engine.Memory().Read(Mem::P2_INPUT_HISTORY_ADDR + slot, &history[1], sizeof(uint32_t)) &&
+           registers[0] == p1 && registers[1] == p2 && history[0] == p1 && history[1] == p2;
+}
+
+// The same stack behind a GekkoNet session with two local players. Local
+// sessions never predict, so this measures the session's save/advance event
+// overhead rather than rollbacks. The engine's poll only sees P1's device, as
+// on a host whose P2 is remote: P2's input exists only in each AdvanceEvent,
+// and every frame checks that it reached the image the hook's way.
+bool RunGekkoSession(const Options& options, Bench::SyntheticEngine& engine, RollbackStack& stack,
+                     RunResult& result) {
+    GekkoSession* session = nullptr;
+    if (!gekko_create(&session)) {
+        std::fprintf(stderr, "gekko_create failed\n");
+        return false;
+    }
+
+    GekkoConfig config;
+    config.num_players = 2;
+    config.max_spectators = 0;
+    config.input_prediction_window = INPUT_PREDICTION_WINDOW;
+    config.spectator_delay = 0;
+    config.input_size = WIRE_INPUT_BYTES;  // Same 11-bit input the hook sends
+    config.state_size = sizeof(uint32_t);
+    config.limited_saving = false;
+    config.post_sync_joining = false;
+    config.desync_detection = false;
+    gekko_start(session, &config);
+
+    int p1 = gekko_add_actor(session, LocalPlayer, nullptr);
+    int p2 = gekko_add_actor(session, LocalPlayer, nullptr);
+    uint32_t seed = options.engine.seed;
+    InputCodec codec;
+
+    bool ok = true;
+    for (uint32_t frame = 0; frame < options.frames && ok; frame++) {
+        unsigned char p1_input[WIRE_INPUT_BYTES];
+        unsigned char p2_input[WIRE_INPUT_BYTES];
+        StoreWireInput(codec.ToWire(InputFor(frame, 0, seed)), p1_input);
+        StoreWireInput(codec.ToWire(InputFor(frame, 1, seed)), p2_input);
+        gekko_add_local_input(session, p1, p1_input);
+        gekko_add_local_input(session, p2, p2_input);
+
+        int count = 0;
+        GekkoGameEvent** events = gekko_update_session(session, &count);
+        for (int i = 0; i < count && ok; i++) {
+            GekkoGameEvent* event = events[i];
+            switch (event->type) {
+                case SaveEvent: {
+                    uint32_t saved = static_cast<uint32_t>(event->data.save.frame);
+                    ok = stack.Save(saved);
+                    *event->data.save.checksum = stack.Checksum(saved);
+                    *event->data.save.state_len = sizeof(uint32_t);
+                    std::memcpy(event->data.save.state, &saved, sizeof(uint32_t));
+                    break;
+                }
+                case LoadEvent:
+                    ok = stack.Load(static_cast<uint32_t>(event->data.load.frame));
+                    break;
+                case AdvanceEvent: {
+                    const unsigned char* inputs = event->data.adv.inputs;
+                    uint32_t advance_p1 = codec.FromWire(LoadWireInput(inputs, 0));
+                    uint32_t advance_p2 = codec.FromWire(LoadWireInput(inputs, 1));
+                    Clock::time_point step_start = Clock::now();
+                    uint32_t index = engine.PollInputs(InputFor(frame, 0, seed), 0);
+                    ok = OverridePolledInputs(engine, index, advance_p1, advance_p2);
+                    engine.Update();
+                    result.step_us += ElapsedMicroseconds(step_start);
+                    result.live_frames++;
+                    if (!InputsReachedImage(engine, index, advance_p1, advance_p2)) result.input_misses++;
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    }
+
+    gekko_destroy(session);
+    return ok;
+}
+#endif
+
+void PrintUsage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --frames N            Live frames to run (default 6000)\n"
+        "  --objects N           Live objects in the pool (default 64)\n"
+        "  --pattern P           clustered | scattered (default clustered)\n"
+        "  --bytes N             Bytes each object rewrites per frame (default 64)\n"
+        "  --churn N             Frames between object respawns, 0 = never (default 30)\n"
+        "  --rollback-every N    Frames between forced rollbacks, 0 = never (default 4)\n"
+        "  --max-depth N         Deepest rollback, 1-%u (default %u)\n"
+        "  --sparse-pool         Capture live objects only\n"
+        "  --remote-pool         Sparse pool through Read/Write only, like the launcher's backend\n"
+        "  --skip-dead           Sparse pool restored with DeadSlotPolicy::Skip\n"
+        "  --no-verify           Skip the resimulation hash check\n"
+        "  --checksum M          fletcher32 | hash64 desync checksum (default fletcher32)\n"
+        "  --seed N              Engine and input seed (default 1)\n"
+#ifdef FM2K_BENCH_GEKKONET
+        "  --gekko               Drive frames through a local GekkoNet session\n"
+#endif
+        , program, INPUT_PREDICTION_WINDOW, INPUT_PREDICTION_WINDOW);
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto number = [&](uint32_t& out) {
+            if (!value) return false;
+            out = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+            i++;
+            return true;
+        };
+
+        bool ok = true;
+        if (!std::strcmp(arg, "--frames")) ok = number(options.frames);
+        else if (!std::strcmp(arg, "--objects")) ok = number(options.engine.active_objects);
+        else if (!std::strcmp(arg, "--bytes")) ok = number(options.engine.bytes_per_object);
+        else if (!std::strcmp(arg, "--churn")) ok = number(options.engine.churn_period);
+        else if (!std::strcmp(arg, "--rollback-every")) ok = number(options.rollback_interval);
+        else if (!std::strcmp(arg, "--max-depth")) ok = number(options.max_depth);
+        else if (!std::strcmp(arg, "--seed")) ok = number(options.engine.seed);
+        else if (!std::strcmp(arg, "--sparse-pool")) options.sparse_pool = true;
+        else if (!std::strcmp(arg, "--remote-pool")) options.remote_pool = true;
+        else if (!std::strcmp(arg, "--skip-dead")) options.skip_dead = true;
+        else if (!std::strcmp(arg, "--no-verify")) options.verify = false;
+#ifdef FM2K_BENCH_GEKKONET
+        else if (!std::strcmp(arg, "--gekko")) options.gekko = true;
+#endif
+        else if (!std::strcmp(arg, "--checksum") && value) {
+            ok = Checksum::ParseMode(value, &options.checksum);
+            i++;
+        } else if (!std::strcmp(arg, "--pattern") && value) {
+            if (!std::strcmp(value, "clustered")) options.engine.pattern = Bench::ObjectPattern::Clustered;
+            else if (!std::strcmp(value, "scattered")) options.engine.pattern = Bench::ObjectPattern::Scattered;
+            else ok = false;
+            i++;
+        } else {
+            ok = false;
+        }
+        if (!ok) return false;
+    }
+    return options.max_depth >= 1 && options.max_depth <= INPUT_PREDICTION_WINDOW;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    Bench::SyntheticEngine engine;
+    engine.Reset(options.engine);
+
+    RollbackStack stack;
+    if (!stack.Init(engine, options)) return 1;
+    bool sparse_pool = options.sparse_pool || options.remote_pool || options.skip_dead;
+
+    std::printf("FM2K rollback bench: %u frames, %u objects (%s, %u bytes/frame), %s pool, "
+                "slot %zu bytes in %zu runs, checksum %s (kernel %s)\n",
+                options.frames, engine.LiveObjects(),
+                options.engine.pattern == Bench::ObjectPattern::Scattered ? "scattered" : "clustered",
+                options.engine.bytes_per_object,
+                !sparse_pool ? "full" : options.remote_pool ? "sparse remote" : "sparse",
+                stack.SlotSize(), stack.PlanRuns(), Checksum::ModeName(options.checksum),
+                Checksum::KernelName(Checksum::ActiveKernel()));
+
+    State::RollbackTimings timings;
+    RunResult result = {};
+    bool ok;
+#ifdef FM2K_BENCH_GEKKONET
+    if (options.gekko) {
+        ok = RunGekkoSession(options, engine, stack, result);
+    } else
+#endif
+    {
+        ok = RunForcedRollbacks(options, engine, stack, timings, result);
+    }
+    if (!ok) return 1;
+
+    const RollbackStack::Stats& stats = stack.GetStats();
+    result.elapsed_us = stats.save_us + stats.load_us + result.step_us;
+    double seconds = result.elapsed_us / 1e6;
+    uint64_t simulated = result.live_frames + result.resim_frames;
+
+    std::printf("Frames:  %u live + %llu resimulated in %.3f s: %.0f live frames/s, %.0f simulated frames/s\n",
+                result.live_frames, (unsigned long long)result.resim_frames, seconds,
+                seconds > 0 ? result.live_frames / seconds : 0.0, seconds > 0 ? simulated / seconds : 0.0);
+    std::printf("Per op:  save %.1f us, load %.1f us, step %.1f us\n",
+                stats.saves ? (double)stats.save_us / stats.saves : 0.0,
+                stats.loads ? (double)stats.load_us / stats.loads : 0.0,
+                simulated ? (double)result.step_us / simulated : 0.0);
+    if (sparse_pool && stats.saves) {
+        std::printf("Pool:    %.0f bytes per sparse save, %llu slots left active by a load (%s restore)\n",
+                    (double)stats.pool_bytes / stats.saves, (unsigned long long)stats.ghost_slots,
+                    options.skip_dead ? "flag-only" : "zero-fill");
+        if (options.remote_pool) {
+            std::printf("Remote:  %.1f Read/Write calls, %.0f bytes moved per save or load (pool is %zu bytes)\n",
+                        (double)stats.pool_calls / (stats.saves + stats.loads),
+                        (double)stats.pool_moved / (stats.saves + stats.loads), Mem::OBJECT_POOL_SIZE);
+        }
+    }
+
+    if (timings.TotalRollbacks() > 0) {
+        std::printf("Rollback cost by depth (restore + fast-forward):\n");
+        for (uint32_t depth = 1; depth <= State::MAX_TIMED_ROLLBACK_DEPTH; depth++) {
+            const auto& entry = timings.Get(depth);
+            if (entry.count == 0) continue;
+            std::printf("  %2u frames: %6llu rollbacks, restore %7.1f us, fast-forward %8.1f us, max %6llu us\n",
+                        depth, (unsigned long long)entry.count,
+                        (double)entry.restore_us / entry.count, (double)entry.fastforward_us / entry.count,
+                        (unsigned long long)entry.max_total_us);
+        }
+    }
+
+    if (options.verify && timings.TotalRollbacks() > 0) {
+        std::printf("Verify:  %llu of %llu rollbacks desynced\n",
+                    (unsigned long long)result.desyncs, (unsigned long long)timings.TotalRollbacks());
+    }
+    if (options.gekko) {
+        std::printf("Verify:  %llu of %u advances lost an input before the frame ran\n",
+                    (unsigned long long)result.input_misses, result.live_frames);
+    }
+    return result.desyncs == 0 && result.input_misses == 0 && stats.ghost_slots == 0 ? 0 : 1;
+}
@@ -0,0 +1,293 @@
+// Rollback budget check: drives the catch-up controller (rollback_budget.h)
+// the way the hook does, on a simulated clock, so every run is deterministic.
+// First a set of fixed cases for FramesThisUpdate, BeginCatchUp and the
+// queue's forced flush, then a long session of random-depth rollbacks with a
+// fake per-frame resimulation cost, reporting how often a rollback overran
+// one frame's budget, how many displayed frames it was spread over and what
+// each update spent catching up.
+
+#include "rollback_budget.h"
+#include "input_streams.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using namespace FM2K;
+using State::RollbackBudget;
+using State::CATCHUP_QUEUE_FRAMES;
+
+struct Options {
+    uint32_t frames = 100000;
+    uint32_t frame_us = 1500;           // Mean cost of one resimulated frame
+    uint32_t jitter_percent = 30;       // Each frame costs frame_us +/- this much
+    uint32_t rollback_percent = 10;     // Displayed frames that start a rollback
+    uint32_t max_depth = 40;            // Past CATCHUP_QUEUE_FRAMES, so some flush
+    uint32_t seed = 1;
+};
+
+// Fixed cases: each checks one rule of the controller on a fresh budget
+struct CheckList {
+    uint32_t run = 0;
+    uint32_t failed = 0;
+
+    void Check(bool ok, const char* name) {
+        run++;
+        if (ok) return;
+        failed++;
+        std::fprintf(stderr, "Check failed: %s\n", name);
+    }
+};
+
+RollbackBudget::PendingFrame Pending(uint32_t frame) {
+    return RollbackBudget::PendingFrame{ frame, 1, frame, ~frame };
+}
+
+void PushFrames(RollbackBudget& budget, uint32_t first, uint32_t count) {
+    for (uint32_t frame = first; frame < first + count; frame++) budget.Push(Pending(frame));
+}
+
+void RunChecks(CheckList& checks) {
+    RollbackBudget::Config config;      // 10 ms frame, 6 ms catch-up share, at least 2 frames
+    {
+        RollbackBudget budget(config);
+        PushFrames(budget, 100, 5);
+        checks.Check(budget.FramesThisUpdate(1) == 4, "unmeasured budget runs everything owed");
+        checks.Check(budget.FramesThisUpdate(5) == 0, "keep covers the whole backlog");
+        checks.Check(budget.FramesThisUpdate(6) == 0, "keep beyond the backlog");
+    }
+    {
+        RollbackBudget budget(config);
+        budget.RecordUpdate(4, 6000);   // 1500 us per frame, 4 fit in 6000 us
+        PushFrames(budget, 100, 10);
+        checks.Check(budget.FramesThisUpdate(1) == 4, "measured budget caps a catch-up");
+        budget.RecordUpdate(0, 50000);
+        checks.Check(budget.FramesThisUpdate(1) == 4, "an empty update is not a sample");
+        checks.Check(budget.GetStats().over_budget == 0, "an update inside the share is not over budget");
+    }
+    {
+        RollbackBudget budget(config);
+        budget.RecordUpdate(1, 9000);   // Nothing fits: the floor keeps the backlog draining
+        PushFrames(budget, 100, 10);
+        checks.Check(budget.FramesThisUpdate(1) == config.min_frames_per_update, "slow frames still run the minimum");
+        checks.Check(budget.GetStats().over_budget == 1, "an update past the share counts as over budget");
+    }
+    {
+        RollbackBudget budget(config);
+        budget.BeginCatchUp(30);
+        checks.Check(budget.GetStats().overruns == 0, "no overrun before the first measurement");
+        budget.RecordUpdate(2, 3000);
+        budget.BeginCatchUp(4);         // 6000 us: exactly the share
+        checks.Check(budget.GetStats().overruns == 0, "a backlog that fits is not an overrun");
+        budget.BeginCatchUp(5);
+        auto stats = budget.GetStats();
+        checks.Check(stats.overruns == 1 && stats.catchups == 3, "a backlog past the share is an overrun");
+    }
+    {
+        RollbackBudget budget(config);
+        PushFrames(budget, 7, CATCHUP_QUEUE_FRAMES - 3);
+        for (uint32_t n = 0; n < CATCHUP_QUEUE_FRAMES - 3; n++) budget.Pop();
+        PushFrames(budget, 200, CATCHUP_QUEUE_FRAMES);
+        checks.Check(!budget.Push(Pending(999)), "a full queue refuses the next frame");
+        bool in_order = budget.Front().frame == 200;
+        for (uint32_t n = 0; n < CATCHUP_QUEUE_FRAMES; n++) {
+            auto frame = budget.Pop();
+            in_order = in_order && frame.frame == 200 + n && frame.p1 == frame.frame && frame.p2 == ~frame.frame;
+        }
+        checks.Check(in_order && budget.Backlog() == 0, "frames and inputs come out in order across the wrap");
+        checks.Check(budget.GetStats().max_backlog == CATCHUP_QUEUE_FRAMES, "max backlog reaches the queue size");
+    }
+}
+
+// The hook's driver on a simulated clock: the catch-up queue, the forced
+// flush on overflow and one displayed frame per update
+class Session {
+public:
+    struct Result {
+        uint64_t out_of_order = 0;      // Simulated frames not following the previous one
+        uint64_t lost = 0;              // Frames owed and never simulated
+        uint64_t rollbacks = 0;
+        uint64_t flushed = 0;           // Queue overflows that ran everything owed
+        uint64_t over_share = 0;        // Catch-up updates that spent more than the share
+        std::vector<uint32_t> update_us;
+        std::vector<uint32_t> spread;   // Displayed frames drawn behind, per rollback
+    };
+
+    Session(const Options& options, const RollbackBudget::Config& config)
+        : options_(options), config_(config), budget_(config), rng_(options.seed * 0x9E3779B1u | 1) {}
+
+    void Run() {
+        for (uint32_t frame = options_.max_depth + 1; frame < options_.frames; frame++) {
+            if (Bench::NextRandom(rng_) % 100 < options_.rollback_percent) {
+                Rollback(frame, 1 + Bench::NextRandom(rng_) % options_.max_depth);
+            } else {
+                Queue(frame);
+            }
+            Display();
+        }
+
+        // Whatever is still owed runs, and has to end on the last frame
+        while (budget_.Backlog() > 0) Simulate(budget_.Pop().frame);
+        if (next_frame_ != options_.frames) result_.lost += options_.frames - next_frame_;
+        if (behind_) result_.spread.push_back(behind_);
+    }
+
+    const Result& GetResult() const { return result_; }
+    const RollbackBudget& Budget() const { return budget_; }
+
+private:
+    uint32_t FrameCost() {
+        uint32_t spread = options_.frame_us * options_.jitter_percent / 100;
+        if (spread == 0) return options_.frame_us;
+        return options_.frame_us - spread + Bench::NextRandom(rng_) % (2 * spread + 1);
+    }
+
+    uint32_t Simulate(uint32_t frame) {
+        if (frame != next_frame_) result_.out_of_order++;
+        next_frame_ = frame + 1;
+        return FrameCost();
+    }
+
+    // QueueAdvance: owe the frame, or run everything owed if the queue is full
+    void Queue(uint32_t frame) {
+        if (budget_.Push(Pending(frame))) return;
+        budget_.CountForced();
+        result_.flushed++;
+        while (budget_.Backlog() > 0) Simulate(budget_.Pop().frame);
+        budget_.Push(Pending(frame));
+    }
+
+    // A LoadEvent `depth` frames back: the replaced timeline is dropped and
+    // the new one owed, live frame included
+    void Rollback(uint32_t live, uint32_t depth) {
+        if (behind_) result_.spread.push_back(behind_);
+        behind_ = 0;
+        result_.rollbacks++;
+
+        budget_.Clear();
+        next_frame_ = live - depth;
+        for (uint32_t frame = live - depth; frame <= live; frame++) Queue(frame);
+        budget_.BeginCatchUp(budget_.Backlog());
+    }
+
+    // RunCatchUp, then the engine runs and draws the next owed frame
+    void Display() {
+        uint32_t frames = budget_.FramesThisUpdate(1);
+        if (frames > 0) {
+            uint64_t us = 0;
+            for (uint32_t n = 0; n < frames; n++) us += Simulate(budget_.Pop().frame);
+            budget_.RecordUpdate(frames, us);
+            result_.update_us.push_back(static_cast<uint32_t>(us));
+            if (us > static_cast<uint64_t>(config_.frame_budget_us * config_.catchup_share)) result_.over_share++;
+        }
+        if (budget_.Backlog() == 0) return;
+
+        Simulate(budget_.Pop().frame);
+        if (budget_.Backlog() > 0) {
+            budget_.CountSpreadFrame();
+            behind_++;
+        }
+    }
+
+    Options options_;
+    RollbackBudget::Config config_;
+    RollbackBudget budget_;
+    uint32_t rng_;
+    uint32_t next_frame_ = 0;
+    uint32_t behind_ = 0;
+    Result result_;
+};
+
+uint32_t Percentile(std::vector<uint32_t> values, double percent) {
+    if (values.empty()) return 0;
+    size_t index = static_cast<size_t>(percent / 100.0 * static_cast<double>(values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+void PrintUsage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --frames N      Displayed frames to simulate (default 100000)\n"
+        "  --frame-us N    Mean cost of one resimulated frame in us (default 1500)\n"
+        "  --jitter N      Per-frame cost spread, percent of the mean (default 30)\n"
+        "  --rollbacks N   Percent of frames that start a rollback (default 10)\n"
+        "  --max-depth N   Deepest rollback, 1-%u (default 40)\n"
+        "  --seed N        Random seed (default 1)\n",
+        program, 4 * CATCHUP_QUEUE_FRAMES);
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto number = [&](uint32_t& out) {
+            if (!value) return false;
+            out = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+            i++;
+            return true;
+        };
+
+        bool ok = true;
+        if (!std::strcmp(arg, "--frames")) ok = number(options.frames);
+        else if (!std::strcmp(arg, "--frame-us")) ok = number(options.frame_us);
+        else if (!std::strcmp(arg, "--jitter")) ok = number(options.jitter_percent);
+        else if (!std::strcmp(arg, "--rollbacks")) ok = number(options.rollback_percent);
+        else if (!std::strcmp(arg, "--max-depth")) ok = number(options.max_depth);
+        else if (!std::strcmp(arg, "--seed")) ok = number(options.seed);
+        else ok = false;
+
+        if (!ok) return false;
+    }
+    return options.frame_us > 0 && options.jitter_percent <= 100 && options.rollback_percent <= 100 &&
+           options.max_depth >= 1 && options.max_depth <= 4 * CATCHUP_QUEUE_FRAMES &&
+           options.frames > options.max_depth + 1;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    CheckList checks;
+    RunChecks(checks);
+
+    RollbackBudget::Config config;
+    Session session(options, config);
+    session.Run();
+    const auto& result = session.GetResult();
+    auto stats = session.Budget().GetStats();
+
+    uint64_t share_us = static_cast<uint64_t>(config.frame_budget_us * config.catchup_share);
+    std::printf("FM2K rollback budget check: %u frames, %u us per resimulated frame +/-%u%%, %u%% rollbacks up to %u deep\n",
+                options.frames, options.frame_us, options.jitter_percent, options.rollback_percent, options.max_depth);
+    std::printf("Budget:   %llu us frame, %llu us catch-up share, at least %u frames per update, queue of %u\n",
+                (unsigned long long)config.frame_budget_us, (unsigned long long)share_us, config.min_frames_per_update,
+                CATCHUP_QUEUE_FRAMES);
+    std::printf("Catch-up: %llu rollbacks, %llu overruns (%.1f%%), %llu forced flushes, max backlog %u, %.0f us/frame measured\n",
+                (unsigned long long)stats.catchups, (unsigned long long)stats.overruns,
+                stats.catchups ? 100.0 * static_cast<double>(stats.overruns) / static_cast<double>(stats.catchups) : 0.0,
+                (unsigned long long)stats.forced, stats.max_backlog, stats.frame_us);
+    std::printf("Spread:   %llu frames drawn behind, p50 %u / p99 %u / max %u per rollback\n",
+                (unsigned long long)stats.spread_frames, Percentile(result.spread, 50), Percentile(result.spread, 99),
+                Percentile(result.spread, 100));
+    std::printf("Updates:  %zu catch-ups, p50 %u / p99 %u / max %u us, %llu over the share\n", result.update_us.size(),
+                Percentile(result.update_us, 50), Percentile(result.update_us, 99), Percentile(result.update_us, 100),
+                (unsigned long long)stats.over_budget);
+
+    // The budget's own counters have to agree with what the driver saw
+    bool counters_agree = stats.catchups == result.rollbacks && stats.forced == result.flushed &&
+                          stats.over_budget == result.over_share;
+    bool ok = checks.failed == 0 && result.out_of_order == 0 && result.lost == 0 && counters_agree;
+    std::printf("Verify:   %u of %u checks passed, %llu frames out of order, %llu lost, counters %s\n",
+                checks.run - checks.failed, checks.run, (unsigned long long)result.out_of_order,
+                (unsigned long long)result.lost, counters_agree ? "agree" : "DISAGREE");
+    return ok ? 0 : 1;
+}
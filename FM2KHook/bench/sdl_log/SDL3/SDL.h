@@ -0,0 +1,29 @@
+#pragma once
+
+// The slice of SDL the hook sources a bench builds actually call (logging),
+// printed to stderr, so those sources build natively without SDL3
+#include <cstdarg>
+#include <cstdio>
+
+#define SDL_LOG_CATEGORY_APPLICATION 0
+
+inline void FM2KBenchLog(const char* level, const char* fmt, va_list args) {
+    std::fprintf(stderr, "%s: ", level);
+    std::vfprintf(stderr, fmt, args);
+    std::fputc('\n', stderr);
+}
+
+#define FM2K_BENCH_SDL_LOG(name, level)                  \
+    inline void name(int category, const char* fmt, ...) { \
+        (void)category;                                  \
+        va_list args;                                    \
+        va_start(args, fmt);                             \
+        FM2KBenchLog(level, fmt, args);               \
+        va_end(args);                                    \
+    }
+
+FM2K_BENCH_SDL_LOG(SDL_LogError, "ERROR")
+FM2K_BENCH_SDL_LOG(SDL_LogWarn, "WARN")
+FM2K_BENCH_SDL_LOG(SDL_LogInfo, "INFO")
+
+#undef FM2K_BENCH_SDL_LOG
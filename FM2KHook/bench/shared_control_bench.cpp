@@ -0,0 +1,155 @@
+// Shared control block benchmark: a launcher thread republishes the network
+// config as fast as it can while a hook thread polls it the way
+// CheckConfigurationUpdates does, checking every config it accepts is one
+// the launcher wrote whole. Also times the per-frame fast path and checks
+// that attaching refuses unformatted or mismatched blocks.
+
+#include "FM2K_SharedControl.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+using namespace FM2K;
+
+struct Options {
+    uint32_t writes = 2000000;
+    uint32_t fast_path_checks = 100000000;
+};
+
+// Every field derived from n, so a mix of two writes shows up
+NetworkConfig MakeConfig(uint32_t n) {
+    NetworkConfig config = {};
+    config.is_online_mode = (n & 1) != 0;
+    config.is_host = (n & 2) != 0;
+    config.input_delay = static_cast<uint8_t>(n);
+    config.port = static_cast<uint16_t>(n >> 8);
+    std::snprintf(config.remote_address, sizeof(config.remote_address), "10.%u.%u.%u:%u/%u", (n >> 16) & 0xFF,
+                  (n >> 8) & 0xFF, n & 0xFF, n, n ^ 0x5A5A5A5A);
+    return config;
+}
+
+bool Whole(const NetworkConfig& config) {
+    uint32_t n = 0;
+    if (std::sscanf(config.remote_address, "10.%*u.%*u.%*u:%u", &n) != 1) return false;
+    NetworkConfig expected = MakeConfig(n);
+    return std::memcmp(&expected, &config, sizeof(config)) == 0;
+}
+
+void PrintUsage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --writes N    Configs the launcher thread publishes (default 2000000)\n"
+        "  --checks N    Unchanged-generation checks to time (default 100000000)\n",
+        program);
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        uint32_t* out = nullptr;
+        if (!std::strcmp(arg, "--writes")) out = &options.writes;
+        else if (!std::strcmp(arg, "--checks")) out = &options.fast_path_checks;
+        if (!out || !value) return false;
+        *out = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        i++;
+    }
+    return true;
+}
+
+bool CheckAttach() {
+    alignas(SharedControlBlock) static unsigned char memory[sizeof(SharedControlBlock)];
+    std::memset(memory, 0, sizeof(memory));
+    if (SharedControlBlock::Attach(memory)) return false;
+
+    SharedControlBlock* block = SharedControlBlock::Create(memory);
+    if (SharedControlBlock::Attach(memory) != block || block->ConfigChanged(0)) return false;
+
+    block->layout_version = SHARED_CONTROL_LAYOUT + 1;
+    bool refused = SharedControlBlock::Attach(memory) == nullptr;
+    block->layout_version = SHARED_CONTROL_LAYOUT;
+    return refused;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    bool attach_ok = CheckAttach();
+
+    alignas(SharedControlBlock) static unsigned char memory[sizeof(SharedControlBlock)];
+    SharedControlBlock* block = SharedControlBlock::Create(memory);
+    std::atomic<bool> writing{ true };
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    std::thread launcher([&] {
+        for (uint32_t n = 1; n <= options.writes; n++) {
+            block->WriteConfig(MakeConfig(n));
+        }
+        writing.store(false);
+    });
+
+    // Hook side: poll, accept whatever generation is newest
+    uint64_t polls = 0, accepted = 0, busy = 0, torn = 0, regressions = 0;
+    uint32_t generation = 0;
+    bool final_pass = false;
+    while (!final_pass) {
+        final_pass = !writing.load();
+        polls++;
+        if (!block->ConfigChanged(generation)) {
+            std::this_thread::yield();
+            continue;
+        }
+        NetworkConfig config;
+        uint32_t next = 0;
+        if (!block->ReadConfig(&config, &next)) {
+            busy++;
+            final_pass = false;
+            continue;
+        }
+        if (!Whole(config)) torn++;
+        if (static_cast<int32_t>(next - generation) <= 0) regressions++;
+        generation = next;
+        block->AcknowledgeConfig(generation);
+        accepted++;
+    }
+    launcher.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    NetworkConfig last;
+    NetworkConfig expected = MakeConfig(options.writes);
+    uint32_t last_generation = 0;
+    bool final_ok = block->ReadConfig(&last, &last_generation) && last_generation == options.writes * 2 &&
+                    generation == last_generation && block->ConfigApplied(last_generation) &&
+                    std::memcmp(&last, &expected, sizeof(last)) == 0;
+
+    // The per-frame cost when nothing changed
+    Clock::time_point fast_start = Clock::now();
+    uint64_t changed = 0;
+    for (uint32_t i = 0; i < options.fast_path_checks; i++) {
+        changed += block->ConfigChanged(generation);
+    }
+    double fast_ns = std::chrono::duration<double, std::nano>(Clock::now() - fast_start).count();
+
+    std::printf("FM2K shared control bench: %zu-byte block, layout %u, %zu config words\n", sizeof(SharedControlBlock),
+                SHARED_CONTROL_LAYOUT, SharedControlBlock::CONFIG_WORDS);
+    std::printf("Stress:  %u writes in %.2f s, %llu polls, %llu configs read, %llu mid-write retries\n", options.writes,
+                seconds, (unsigned long long)polls, (unsigned long long)accepted, (unsigned long long)busy);
+    std::printf("Fast:    %.2f ns per unchanged-generation check\n",
+                options.fast_path_checks ? fast_ns / options.fast_path_checks : 0.0);
+    std::printf("Verify:  %llu torn, %llu out of order, final config %s, attach checks %s\n",
+                (unsigned long long)torn, (unsigned long long)regressions, final_ok ? "ok" : "FAILED",
+                attach_ok ? "ok" : "FAILED");
+    return torn == 0 && regressions == 0 && final_ok && attach_ok && changed == 0 ? 0 : 1;
+}
@@ -0,0 +1,319 @@
+// State slab allocation check: OnlineSession's save/load loop (StateSlab.h)
+// run for a match's worth of frames under a counting allocator. Every frame
+// saves; every few frames a rollback loads an older frame and resaves the
+// frames after it, as resimulation does. Global operator new, and on glibc
+// malloc itself, count every allocation while the loop runs; the slab has
+// to finish with none. The unordered_map history the slab replaced runs the
+// same loop as a control, which also proves the counter sees allocations.
+
+#include "StateSlab.h"
+#include "input_streams.h"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+std::atomic<bool> counting{ false };
+std::atomic<uint64_t> allocations{ 0 };
+
+void CountAllocation() {
+    if (counting.load(std::memory_order_relaxed)) allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // anonymous namespace
+
+// On glibc, malloc is interposed too, so allocations that bypass operator
+// new are caught; operator new then only forwards to it
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(size_t size) {
+    CountAllocation();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    CountAllocation();
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    CountAllocation();
+    return __libc_realloc(ptr, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    CountAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) {
+    CountAllocation();
+    void* ptr = __libc_memalign(alignment, size);
+    if (!ptr) return ENOMEM;
+    *out = ptr;
+    return 0;
+}
+
+void free(void* ptr) {
+    __libc_free(ptr);
+}
+}
+#define FM2K_COUNT_NEW()
+#else
+#define FM2K_COUNT_NEW() CountAllocation()
+#endif
+
+void* operator new(size_t size) {
+    FM2K_COUNT_NEW();
+    if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return ::operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    FM2K_COUNT_NEW();
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+    return ::operator new(size, tag);
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+
+namespace {
+
+using namespace FM2K;
+
+// sizeof(FM2K::GameState) in the launcher's 32-bit build
+constexpr uint32_t GAME_STATE_BYTES = 9224;
+constexpr size_t STATE_BUFFER_SIZE = 128;       // OnlineSession::STATE_BUFFER_SIZE
+
+struct Options {
+    uint32_t frames = 10000;
+    uint32_t state_bytes = GAME_STATE_BYTES;
+    uint32_t rollback_period = 7;               // Frames between rollbacks
+    uint32_t max_depth = 8;
+    uint32_t seed = 1;
+};
+
+// Stands in for FM2KGameInstance's SaveState/LoadState: a state image the
+// frame writes a few words of, copied out and back whole
+class FakeGame {
+public:
+    explicit FakeGame(size_t state_bytes) : image_(state_bytes / 4) {}
+
+    void Step(uint32_t frame, uint32_t& rng) {
+        image_[0] = frame;
+        for (int n = 0; n < 8; n++) image_[1 + Bench::NextRandom(rng) % (image_.size() - 1)] = frame * 31 + n;
+    }
+
+    bool SaveState(void* buffer, size_t buffer_size) {
+        if (buffer_size < image_.size() * 4) return false;
+        std::memcpy(buffer, image_.data(), image_.size() * 4);
+        return true;
+    }
+
+    bool LoadState(const void* buffer, size_t buffer_size) {
+        if (buffer_size < image_.size() * 4) return false;
+        std::memcpy(image_.data(), buffer, image_.size() * 4);
+        return true;
+    }
+
+    uint32_t Frame() const { return image_[0]; }
+
+private:
+    std::vector<uint32_t> image_;
+};
+
+// OnlineSession::SaveGameState/LoadGameState over the slab
+class SlabHistory {
+public:
+    SlabHistory(FakeGame& game, size_t state_bytes) : game_(game) { saved_states_.Init(STATE_BUFFER_SIZE, state_bytes); }
+
+    bool SaveGameState(int frame) {
+        std::vector<uint8_t>& state_buffer = saved_states_.Spare();
+        if (!game_.SaveState(state_buffer.data(), state_buffer.size())) return false;
+        saved_states_.Store(frame);
+        return true;
+    }
+
+    bool LoadGameState(int frame) {
+        const std::vector<uint8_t>* state_buffer = saved_states_.Find(frame);
+        if (!state_buffer) return false;
+        return game_.LoadState(state_buffer->data(), state_buffer->size());
+    }
+
+    uint64_t OwnAllocations() const { return saved_states_.GetStats().allocations; }
+
+private:
+    FakeGame& game_;
+    StateSlab saved_states_;
+};
+
+// The history OnlineSession kept before the slab
+class MapHistory {
+public:
+    MapHistory(FakeGame& game, size_t state_bytes) : game_(game), state_bytes_(state_bytes) {}
+
+    bool SaveGameState(int frame) {
+        std::vector<uint8_t> state_buffer(state_bytes_);
+        if (!game_.SaveState(state_buffer.data(), state_buffer.size())) return false;
+        saved_states_[frame] = std::move(state_buffer);
+        return true;
+    }
+
+    bool LoadGameState(int frame) {
+        auto it = saved_states_.find(frame);
+        if (it == saved_states_.end()) return false;
+        return game_.LoadState(it->second.data(), it->second.size());
+    }
+
+    uint64_t OwnAllocations() const { return 0; }
+
+private:
+    FakeGame& game_;
+    size_t state_bytes_;
+    std::unordered_map<int, std::vector<uint8_t>> saved_states_;
+};
+
+struct Result {
+    uint64_t allocations;
+    uint64_t own_allocations;   // What the history counts itself
+    uint64_t saves;
+    uint64_t loads;
+    uint64_t failures;          // Saves or loads refused, or a load that restored the wrong frame
+    double ns;
+};
+
+template <typename History>
+Result Run(const Options& options) {
+    Result result = {};
+    FakeGame game(options.state_bytes);
+    History history(game, options.state_bytes);
+    uint32_t rng = options.seed * 0x9E3779B1u | 1;
+
+    // Fill the history first: the loop measures the steady state
+    for (uint32_t frame = 0; frame < STATE_BUFFER_SIZE; frame++) {
+        game.Step(frame, rng);
+        history.SaveGameState(static_cast<int>(frame));
+    }
+
+    uint32_t first = STATE_BUFFER_SIZE;
+    allocations = 0;
+    counting = true;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = first; frame < first + options.frames; frame++) {
+        game.Step(frame, rng);
+        if (!history.SaveGameState(static_cast<int>(frame))) result.failures++;
+        result.saves++;
+
+        if ((frame - first) % options.rollback_period != options.rollback_period - 1) continue;
+
+        uint32_t target = frame - 1 - Bench::NextRandom(rng) % options.max_depth;
+        if (!history.LoadGameState(static_cast<int>(target)) || game.Frame() != target) result.failures++;
+        result.loads++;
+        for (uint32_t resim = target + 1; resim <= frame; resim++) {
+            game.Step(resim, rng);
+            if (!history.SaveGameState(static_cast<int>(resim))) result.failures++;
+            result.saves++;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    counting = false;
+
+    result.allocations = allocations;
+    result.own_allocations = history.OwnAllocations();
+    result.ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    return result;
+}
+
+void PrintUsage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --frames N       Frames to run after the history fills (default 10000)\n"
+        "  --state-bytes N  Bytes per saved state (default %u, sizeof(FM2K::GameState))\n"
+        "  --period N       Frames between rollbacks (default 7)\n"
+        "  --max-depth N    Deepest rollback, 1-%zu (default 8)\n"
+        "  --seed N         Random seed (default 1)\n",
+        program, GAME_STATE_BYTES, STATE_BUFFER_SIZE - 1);
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto number = [&](uint32_t& out) {
+            if (!value) return false;
+            out = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+            i++;
+            return true;
+        };
+
+        bool ok = true;
+        if (!std::strcmp(arg, "--frames")) ok = number(options.frames);
+        else if (!std::strcmp(arg, "--state-bytes")) ok = number(options.state_bytes);
+        else if (!std::strcmp(arg, "--period")) ok = number(options.rollback_period);
+        else if (!std::strcmp(arg, "--max-depth")) ok = number(options.max_depth);
+        else if (!std::strcmp(arg, "--seed")) ok = number(options.seed);
+        else ok = false;
+
+        if (!ok) return false;
+    }
+    return options.frames > 0 && options.state_bytes >= 8 && options.rollback_period >= 1 &&
+           options.max_depth >= 1 && options.max_depth < STATE_BUFFER_SIZE;
+}
+
+void PrintResult(const char* name, const Result& result) {
+    std::printf("%-14s %10llu %10llu %8llu %8llu %10.0f %8llu\n", name, (unsigned long long)result.allocations,
+                (unsigned long long)result.own_allocations, (unsigned long long)result.saves,
+                (unsigned long long)result.loads, result.ns / static_cast<double>(result.saves + result.loads),
+                (unsigned long long)result.failures);
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    std::printf("FM2K state slab check: %u frames, %u-byte states, %zu-frame history, rollback every %u frames up to %u deep\n",
+                options.frames, options.state_bytes, STATE_BUFFER_SIZE, options.rollback_period, options.max_depth);
+    std::printf("%-14s %10s %10s %8s %8s %10s %8s\n", "history", "allocs", "self-count", "saves", "loads", "ns/op",
+                "failures");
+
+    Result slab = Run<SlabHistory>(options);
+    Result map = Run<MapHistory>(options);
+    PrintResult("StateSlab", slab);
+    PrintResult("unordered_map", map);
+
+    // The map allocates on every save, so a silent counter can't pass the slab
+    bool ok = slab.allocations == 0 && slab.own_allocations == 0 && slab.failures == 0 && map.failures == 0 &&
+              map.allocations >= map.saves;
+    std::printf("Verify:  %llu allocations in the slab loop, counter saw %llu in the map loop, %llu failed saves or loads\n",
+                (unsigned long long)slab.allocations, (unsigned long long)map.allocations,
+                (unsigned long long)(slab.failures + map.failures));
+    return ok ? 0 : 1;
+}
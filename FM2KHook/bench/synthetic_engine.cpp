@@ -0,0 +1,186 @@
+#include "synthetic_engine.h"
+#include "FM2K_Checksum.h"
+#include <algorithm>
+#include <cstring>
+
+namespace FM2K {
+namespace Bench {
+
+namespace Mem = State::Memory;
+
+namespace {
+
+// Input bits (docs/INPUT_SYSTEM_ARCHITECTURE.md)
+constexpr uint32_t INPUT_LEFT = 0x04;
+constexpr uint32_t INPUT_RIGHT = 0x08;
+constexpr uint32_t INPUT_BUTTONS = 0x7F0;
+
+constexpr uint32_t ROUND_FRAMES = 100;     // Game frames per round timer tick
+constexpr uint32_t HIT_EFFECT_FRAMES = 16;
+constexpr uint32_t START_HP = 10000;
+
+// Object data starts past the previous slot's active flag, which the pool
+// layout places in the first two bytes of this slot
+constexpr size_t OBJECT_DATA_OFFSET = 2;
+
+} // anonymous namespace
+
+SyntheticEngine::SyntheticEngine()
+    : image_(IMAGE_SIZE)
+    , memory_(image_.data(), IMAGE_BASE, IMAGE_SIZE)
+{}
+
+uint32_t& SyntheticEngine::Word(uintptr_t address) {
+    return *reinterpret_cast<uint32_t*>(memory_.Translate(address, sizeof(uint32_t)));
+}
+
+uint8_t* SyntheticEngine::Slot(size_t slot) {
+    return memory_.Translate(Mem::OBJECT_POOL_ADDR + slot * Mem::OBJECT_SLOT_SIZE, Mem::OBJECT_SLOT_SIZE);
+}
+
+uint16_t& SyntheticEngine::ActiveFlag(size_t slot) {
+    return *reinterpret_cast<uint16_t*>(Slot(slot) + Mem::OBJECT_ACTIVE_FLAG_OFFSET);
+}
+
+// The game's LCG (MSVC rand), kept in game memory so rollbacks rewind it
+uint32_t SyntheticEngine::NextRandom() {
+    uint32_t& seed = Word(Mem::RANDOM_SEED_ADDR);
+    seed = seed * 214013u + 2531011u;
+    return (seed >> 16) & 0x7FFF;
+}
+
+void SyntheticEngine::Spawn(size_t slot) {
+    std::memset(Slot(slot) + OBJECT_DATA_OFFSET, 0, Mem::OBJECT_SLOT_SIZE - OBJECT_DATA_OFFSET);
+    ActiveFlag(slot) = static_cast<uint16_t>(1 + NextRandom() % 0xFFFE);
+}
+
+// Freed slots are cleared, as the sparse pool restore (ZeroFill) assumes
+void SyntheticEngine::Kill(size_t slot) {
+    std::memset(Slot(slot) + OBJECT_DATA_OFFSET, 0, Mem::OBJECT_SLOT_SIZE - OBJECT_DATA_OFFSET);
+    ActiveFlag(slot) = 0;
+}
+
+void SyntheticEngine::Reset(const Config& config) {
+    config_ = config;
+    config_.active_objects = std::min<uint32_t>(config_.active_objects, Mem::MAX_OBJECTS);
+    config_.bytes_per_object = std::min<uint32_t>(config_.bytes_per_object,
+                                                  Mem::OBJECT_SLOT_SIZE - OBJECT_DATA_OFFSET);
+    std::fill(image_.begin(), image_.end(), 0);
+
+    Word(Mem::RANDOM_SEED_ADDR) = config_.seed;
+    Word(Mem::ROUND_TIMER_ADDR) = 99;
+    Word(Mem::P1_STAGE_X_ADDR) = 160;
+    Word(Mem::P1_STAGE_Y_ADDR) = 200;
+    Word(Mem::P1_HP_ADDR) = START_HP;
+    Word(Mem::P1_MAX_HP_ADDR) = START_HP;
+    Word(Mem::P2_HP_ADDR) = START_HP;
+    Word(Mem::P2_MAX_HP_ADDR) = START_HP;
+
+    uint32_t count = config_.active_objects;
+    size_t stride = config_.pattern == ObjectPattern::Scattered && count > 0 ? Mem::MAX_OBJECTS / count : 1;
+    for (uint32_t n = 0; n < count; n++) {
+        Spawn(n * stride);
+    }
+}
+
+uint32_t SyntheticEngine::PollInputs(uint32_t p1, uint32_t p2) {
+    // Current registers and this frame's slot in both history rings, then the index moves on
+    uint32_t& index = Word(Mem::INPUT_BUFFER_INDEX_ADDR);
+    uint32_t polled = index++;
+    size_t ring_slot = polled & (Mem::INPUT_HISTORY_ENTRIES - 1);
+    Word(Mem::P1_INPUT_ADDR) = p1;
+    Word(Mem::P2_INPUT_ADDR) = p2;
+    Word(Mem::P1_INPUT_HISTORY_ADDR + ring_slot * sizeof(uint32_t)) = p1;
+    Word(Mem::P2_INPUT_HISTORY_ADDR + ring_slot * sizeof(uint32_t)) = p2;
+    return polled;
+}
+
+void SyntheticEngine::Step(uint32_t p1, uint32_t p2) {
+    PollInputs(p1, p2);
+    Update();
+}
+
+void SyntheticEngine::Update() {
+    // Inputs come from memory, as the engine's logic reads them: held buttons
+    // from the registers, new presses against last frame's history slot
+    uint32_t index = Word(Mem::INPUT_BUFFER_INDEX_ADDR);
+    size_t previous_slot = (index - 2) & (Mem::INPUT_HISTORY_ENTRIES - 1);
+    uint32_t p1 = Word(Mem::P1_INPUT_ADDR);
+    uint32_t p2 = Word(Mem::P2_INPUT_ADDR);
+    uint32_t p1_pressed = p1 & ~Word(Mem::P1_INPUT_HISTORY_ADDR + previous_slot * sizeof(uint32_t));
+    uint32_t p2_pressed = p2 & ~Word(Mem::P2_INPUT_HISTORY_ADDR + previous_slot * sizeof(uint32_t));
+
+    uint32_t game_timer = ++Word(Mem::GAME_TIMER_ADDR);
+    uint32_t& round_timer = Word(Mem::ROUND_TIMER_ADDR);
+    if (game_timer % ROUND_FRAMES == 0 && round_timer > 0) round_timer--;
+
+    // Players: walk on directions, trade damage on button presses
+    uint32_t& x = Word(Mem::P1_STAGE_X_ADDR);
+    if (p1 & INPUT_LEFT) x -= 4;
+    if (p1 & INPUT_RIGHT) x += 4;
+    uint32_t& p1_hp = Word(Mem::P1_HP_ADDR);
+    uint32_t& p2_hp = Word(Mem::P2_HP_ADDR);
+    uint32_t& hit_target = Word(Mem::HIT_EFFECT_TARGET_ADDR);
+    uint32_t& hit_timer = Word(Mem::HIT_EFFECT_TIMER_ADDR);
+    if (hit_timer > 0) hit_timer--;
+    if ((p2_pressed & INPUT_BUTTONS) && NextRandom() % 2 == 0) {
+        p1_hp -= std::min<uint32_t>(p1_hp, 10);
+        hit_target = 1;
+        hit_timer = HIT_EFFECT_FRAMES;
+    }
+    if ((p1_pressed & INPUT_BUTTONS) && NextRandom() % 2 == 0) {
+        p2_hp -= std::min<uint32_t>(p2_hp, 10);
+        hit_target = 2;
+        hit_timer = HIT_EFFECT_FRAMES;
+    }
+
+    // Objects: every live slot rewrites its leading bytes from its own state,
+    // the frame and the inputs
+    uint32_t mix = index * 0x9E3779B1u ^ p1 ^ (p2 << 11);
+    for (size_t slot = 0; slot < Mem::MAX_OBJECTS; slot++) {
+        if (!ActiveFlag(slot)) continue;
+        uint8_t* data = Slot(slot) + OBJECT_DATA_OFFSET;
+        uint32_t state = ActiveFlag(slot) ^ static_cast<uint32_t>(slot) * 0x85EBCA6Bu;
+        for (uint32_t n = 0; n < config_.bytes_per_object; n++) {
+            state = state * 33u + data[n] + (mix >> (n % 24));
+            data[n] = static_cast<uint8_t>(state);
+        }
+    }
+
+    // Churn: one object dies and another spawns elsewhere, keeping the count
+    if (config_.churn_period && index % config_.churn_period == 0 && config_.active_objects > 0 &&
+        config_.active_objects < Mem::MAX_OBJECTS) {
+        size_t victim = NextRandom() % Mem::MAX_OBJECTS;
+        while (!ActiveFlag(victim)) victim = (victim + 1) % Mem::MAX_OBJECTS;
+        size_t target = config_.pattern == ObjectPattern::Scattered ? NextRandom() % Mem::MAX_OBJECTS : 0;
+        while (ActiveFlag(target) || target == victim) target = (target + 1) % Mem::MAX_OBJECTS;
+        Kill(victim);
+        Spawn(target);
+    }
+}
+
+void SyntheticEngine::ClearDeadSlots() {
+    for (size_t slot = 0; slot < Mem::MAX_OBJECTS; slot++) {
+        if (!ActiveFlag(slot)) {
+            std::memset(Slot(slot) + OBJECT_DATA_OFFSET, 0, Mem::OBJECT_SLOT_SIZE - OBJECT_DATA_OFFSET);
+        }
+    }
+}
+
+uint32_t SyntheticEngine::LiveObjects() const {
+    const uint8_t* pool = memory_.Translate(Mem::OBJECT_POOL_ADDR, Mem::OBJECT_POOL_SIZE);
+    uint32_t live = 0;
+    for (size_t slot = 0; slot < Mem::MAX_OBJECTS; slot++) {
+        uint16_t flag;
+        std::memcpy(&flag, pool + slot * Mem::OBJECT_SLOT_SIZE + Mem::OBJECT_ACTIVE_FLAG_OFFSET, sizeof(flag));
+        if (flag) live++;
+    }
+    return live;
+}
+
+uint64_t SyntheticEngine::Hash() const {
+    return Checksum::Hash64(image_.data(), image_.size());
+}
+
+} // namespace Bench
+} // namespace FM2K
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "state_manager.h"
+
+namespace FM2K {
+namespace Bench {
+
+// How live objects are spread over the pool
+enum class ObjectPattern {
+    Clustered,  // Slots 0..n-1, like a quiet round
+    Scattered   // Evenly spaced over the whole pool, one live slot per few pages
+};
+
+// Deterministic stand-in for the game. Owns a byte image covering every
+// address in State::Memory and, once per frame, mutates it the way the
+// engine does: inputs into the current registers and history rings, frame
+// index, timers, RNG, player and hit effect state, and a tunable set of live
+// objects in the pool. Snapshot code reaches it through Memory(), exactly
+// as it reaches the real game through an in-process backend.
+class SyntheticEngine {
+public:
+    // Covers the image base through the end of the object pool
+    static constexpr uintptr_t IMAGE_BASE = 0x400000;
+    static constexpr size_t IMAGE_SIZE = 0xD0000;
+
+    struct Config {
+        uint32_t active_objects = 64;
+        ObjectPattern pattern = ObjectPattern::Clustered;
+        uint32_t bytes_per_object = 64;     // Rewritten per live object per frame
+        uint32_t churn_period = 30;         // Frames between one object dying and another spawning (0 = never)
+        uint32_t seed = 1;
+    };
+
+    SyntheticEngine();
+
+    // Clears the image and lays out the round start for `config`
+    void Reset(const Config& config);
+
+    // Run one frame on the given player inputs: PollInputs, then Update
+    void Step(uint32_t p1, uint32_t p2);
+
+    // The two halves of a frame, split where the hook sits between
+    // process_game_inputs and update_game_state. PollInputs stores the
+    // devices' inputs in the registers and the history slot at the input
+    // index, then advances it, and returns that slot's index. Update runs the
+    // frame on whatever the registers and history hold by then.
+    uint32_t PollInputs(uint32_t p1, uint32_t p2);
+    void Update();
+
+    State::LocalMemoryBackend& Memory() { return memory_; }
+    uint32_t LiveObjects() const;
+
+    // Clears the bytes of every dead slot, as a spawn does before reusing
+    // one. A pool restored with DeadSlotPolicy::Skip leaves them stale, so
+    // a bench calls this after such a load and Hash() then only tells the
+    // restored flags apart.
+    void ClearDeadSlots();
+
+    // Hash of the whole image, for checking that a resimulated frame
+    // reproduced the original one
+    uint64_t Hash() const;
+
+private:
+    uint32_t& Word(uintptr_t address);
+    uint8_t* Slot(size_t slot);
+    uint16_t& ActiveFlag(size_t slot);
+    uint32_t NextRandom();
+    void Spawn(size_t slot);
+    void Kill(size_t slot);
+
+    Config config_;
+    std::vector<uint8_t> image_;
+    State::LocalMemoryBackend memory_;
+};
+
+} // namespace Bench
+} // namespace FM2K
@@ -0,0 +1,92 @@
+#include "checkpoint_policy.h"
+
+namespace FM2K {
+namespace State {
+
+void CheckpointPolicy::Reset() {
+    interval_ = 1;
+    frames_since_adapt_ = 0;
+    save_us_ = 0.0;
+    frame_us_ = 0.0;
+    rollback_rate_ = 0.0;
+    have_save_sample_ = false;
+    have_frame_sample_ = false;
+    rollbacks_this_frame_ = 0;
+    overhead_this_frame_us_ = 0;
+    every_frame_ = {};
+    checkpointed_ = {};
+}
+
+void CheckpointPolicy::RecordSave(uint64_t us) {
+    double sample = static_cast<double>(us);
+    save_us_ = have_save_sample_ ? save_us_ + (sample - save_us_) * config_.average_weight : sample;
+    have_save_sample_ = true;
+    overhead_this_frame_us_ += us;
+}
+
+void CheckpointPolicy::RecordReplay(uint32_t frames, uint64_t us) {
+    if (frames == 0) return;
+    double sample = static_cast<double>(us) / frames;
+    frame_us_ = have_frame_sample_ ? frame_us_ + (sample - frame_us_) * config_.average_weight : sample;
+    have_frame_sample_ = true;
+    overhead_this_frame_us_ += us;
+}
+
+void CheckpointPolicy::EndFrame(uint32_t interval_in_effect) {
+    ModeCost& mode = interval_in_effect == 1 ? every_frame_ : checkpointed_;
+    mode.frames++;
+    mode.overhead_us += overhead_this_frame_us_;
+    overhead_this_frame_us_ = 0;
+
+    rollback_rate_ += (rollbacks_this_frame_ - rollback_rate_) * config_.average_weight;
+    rollbacks_this_frame_ = 0;
+
+    if (++frames_since_adapt_ < config_.adapt_frames || !have_save_sample_) return;
+    frames_since_adapt_ = 0;
+
+    // Replay cost is unknown until a rollback has replayed something; assume
+    // a frame costs about one save so K only grows once rollbacks are rare
+    uint32_t best = 1;
+    for (uint32_t interval = 2; interval <= config_.max_interval; ++interval) {
+        if (PredictedCost(interval) < PredictedCost(best)) best = interval;
+    }
+    interval_ = best;
+}
+
+double CheckpointPolicy::PredictedCost(uint32_t interval) const {
+    double frame_us = have_frame_sample_ ? frame_us_ : save_us_;
+    return save_us_ / interval + rollback_rate_ * (interval - 1) * 0.5 * frame_us;
+}
+
+CheckpointPolicy::Stats CheckpointPolicy::GetStats() const {
+    Stats stats = {};
+    stats.interval = interval_;
+    stats.save_us = save_us_;
+    stats.frame_us = frame_us_;
+    stats.rollbacks_per_frame = rollback_rate_;
+    for (uint32_t interval = 1; interval <= config_.max_interval && interval <= MAX_CHECKPOINT_INTERVAL; ++interval) {
+        stats.predicted_us[interval] = PredictedCost(interval);
+    }
+    stats.every_frame = every_frame_;
+    stats.checkpointed = checkpointed_;
+    return stats;
+}
+
+void CheckpointAgreement::Reset() {
+    for (Entry& entry : entries_) entry = {};
+}
+
+void CheckpointAgreement::Record(uint32_t frame, uint32_t p1_interval, uint32_t p2_interval) {
+    uint32_t interval = p1_interval < p2_interval ? p1_interval : p2_interval;
+    if (interval == 0 || interval > MAX_CHECKPOINT_INTERVAL) interval = 1;
+    entries_[frame % FRAMES] = { frame, interval, true };
+}
+
+uint32_t CheckpointAgreement::IntervalAt(uint32_t frame) const {
+    if (frame < lag_) return 1;
+    const Entry& entry = entries_[(frame - lag_) % FRAMES];
+    return entry.valid && entry.frame == frame - lag_ ? entry.interval : 1;
+}
+
+} // namespace State
+} // namespace FM2K
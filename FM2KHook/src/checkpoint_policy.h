@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+
+namespace FM2K {
+namespace State {
+
+// Longest checkpoint interval. A frame-keyed ring of S slots only holds
+// checkpoints K apart for lcm(K, S) frames, which must cover the rollback
+// window plus the K - 1 frames back to the previous checkpoint.
+constexpr uint32_t MAX_CHECKPOINT_INTERVAL = 4;
+
+// Decides how often to snapshot. Saving every K-th frame cuts save cost
+// by K, but a rollback then starts from the nearest older checkpoint and
+// replays (K - 1) / 2 extra frames on average:
+//
+//   cost(K) = save_us / K + rollbacks_per_frame * (K - 1) / 2 * frame_us
+//
+// Save and replay costs and the rollback rate are measured as moving
+// averages, and K is re-chosen every `adapt_frames` frames. K = 1 is the
+// every-frame mode, so the measured per-frame overhead is kept separately
+// for K = 1 and K > 1.
+//
+// Interval() is only this peer's preference; which frames are saved is up to
+// CheckpointAgreement, so both peers save (and checksum) the same ones.
+class CheckpointPolicy {
+public:
+    struct Config {
+        uint32_t max_interval = MAX_CHECKPOINT_INTERVAL;
+        uint32_t adapt_frames = 300;
+        double average_weight = 1.0 / 64.0;
+    };
+
+    struct ModeCost {
+        uint64_t frames;
+        uint64_t overhead_us;       // Saves plus checkpoint catch-up replays
+    };
+
+    struct Stats {
+        uint32_t interval;
+        double save_us;             // Moving average per save
+        double frame_us;            // Moving average per replayed frame
+        double rollbacks_per_frame;
+        double predicted_us[MAX_CHECKPOINT_INTERVAL + 1];  // cost(K), index K
+        ModeCost every_frame;
+        ModeCost checkpointed;
+    };
+
+    CheckpointPolicy() = default;
+    explicit CheckpointPolicy(const Config& config) : config_(config) {}
+
+    void Reset();
+
+    uint32_t Interval() const { return interval_; }
+
+    void RecordSave(uint64_t us);
+    void RecordReplay(uint32_t frames, uint64_t us);    // Frames replayed from a checkpoint up to the rollback target
+    void RecordRollback() { rollbacks_this_frame_++; }
+
+    // Once per frame: charges this frame's overhead to the mode of the
+    // interval it was saved with and periodically re-chooses the interval
+    void EndFrame(uint32_t interval_in_effect);
+
+    double PredictedCost(uint32_t interval) const;
+    Stats GetStats() const;
+
+private:
+    Config config_;
+    uint32_t interval_ = 1;
+    uint32_t frames_since_adapt_ = 0;
+
+    double save_us_ = 0.0;
+    double frame_us_ = 0.0;
+    double rollback_rate_ = 0.0;
+    bool have_save_sample_ = false;
+    bool have_frame_sample_ = false;
+
+    uint32_t rollbacks_this_frame_ = 0;
+    uint64_t overhead_this_frame_us_ = 0;
+    ModeCost every_frame_ = {};
+    ModeCost checkpointed_ = {};
+};
+
+// The checkpoint interval both peers save with. Each stamps its policy's
+// interval into its inputs (input_codec.h, WIRE_INTERVAL_MASK), and frame f
+// uses the smaller of the two stamped into frame f - lag. Those inputs are
+// confirmed before f first runs when lag exceeds the prediction window, so
+// both peers and every resimulation of f pick the same interval: they save
+// the same frames, and report checksums for the same frames. With K = 1 on
+// either side that is every frame. A frame whose lagged inputs were never
+// seen, or a peer that stamps nothing (0), is saved every frame.
+class CheckpointAgreement {
+public:
+    static constexpr uint32_t FRAMES = 32;
+
+    explicit CheckpointAgreement(uint32_t lag) : lag_(lag) {}
+
+    void Reset();
+
+    // Every advance, predicted or confirmed, with both players' stamps
+    void Record(uint32_t frame, uint32_t p1_interval, uint32_t p2_interval);
+
+    uint32_t IntervalAt(uint32_t frame) const;
+    bool ShouldSave(uint32_t frame) const { return frame % IntervalAt(frame) == 0; }
+
+private:
+    struct Entry {
+        uint32_t frame;
+        uint32_t interval;
+        bool valid;
+    };
+
+    uint32_t lag_;
+    Entry entries_[FRAMES] = {};
+};
+
+} // namespace State
+} // namespace FM2K
@@ -0,0 +1,75 @@
+#include "checksum_tree.h"
+#include <algorithm>
+
+namespace FM2K {
+namespace State {
+
+void ChecksumTree::Build(const MemoryRegion* regions, size_t count, Checksum::Mode mode) {
+    mode_ = mode;
+    leaves_.clear();
+    for (size_t i = 0; i < count; ++i) {
+        if (regions[i].size == 0) continue;
+        leaves_.push_back({ regions[i].offset, regions[i].size, regions[i].name });
+    }
+    std::sort(leaves_.begin(), leaves_.end(), [](const Leaf& a, const Leaf& b) { return a.offset < b.offset; });
+
+    leaf_base_ = 1;
+    while (leaf_base_ < leaves_.size()) leaf_base_ <<= 1;
+    nodes_.assign(leaf_base_ * 2, 0);
+    changed_.assign(leaves_.size(), 1);
+    leaves_rehashed_ = 0;
+}
+
+void ChecksumTree::MarkAllChanged() {
+    std::fill(changed_.begin(), changed_.end(), 1);
+}
+
+void ChecksumTree::MarkChanged(size_t offset, size_t size) {
+    // First leaf that ends after `offset`
+    auto it = std::partition_point(leaves_.begin(), leaves_.end(),
+                                   [offset](const Leaf& leaf) { return leaf.offset + leaf.size <= offset; });
+    for (; it != leaves_.end() && it->offset < offset + size; ++it) {
+        changed_[static_cast<size_t>(it - leaves_.begin())] = 1;
+    }
+}
+
+uint32_t ChecksumTree::Combine(uint32_t left, uint32_t right) {
+    uint32_t pair[2] = { left, right };
+    return Checksum::Fold32(Checksum::Hash64(pair, sizeof(pair)));
+}
+
+uint32_t ChecksumTree::Update(const uint8_t* buffer) {
+    for (size_t i = 0; i < leaves_.size(); ++i) {
+        if (!changed_[i]) continue;
+        changed_[i] = 0;
+        leaves_rehashed_++;
+
+        size_t node = leaf_base_ + i;
+        uint32_t hash = Checksum::StateChecksum(mode_, buffer + leaves_[i].offset, leaves_[i].size);
+        if (nodes_[node] == hash) continue;   // Never 0 in either mode, so fresh leaves always propagate
+        nodes_[node] = hash;
+
+        for (node >>= 1; node >= 1; node >>= 1) {
+            nodes_[node] = Combine(nodes_[node * 2], nodes_[node * 2 + 1]);
+        }
+    }
+    return Root();
+}
+
+size_t ChecksumTree::Descend(size_t node, uint32_t remote_left, uint32_t remote_right) const {
+    if (IsLeafNode(node)) return 0;
+    if (nodes_[node * 2] != remote_left) return node * 2;
+    if (nodes_[node * 2 + 1] != remote_right) return node * 2 + 1;
+    return 0;
+}
+
+void ChecksumTree::DiffLeaves(const uint32_t* remote, size_t count, std::vector<size_t>& mismatched) const {
+    mismatched.clear();
+    size_t n = std::min(count, leaves_.size());
+    for (size_t i = 0; i < n; ++i) {
+        if (LeafHash(i) != remote[i]) mismatched.push_back(i);
+    }
+}
+
+} // namespace State
+} // namespace FM2K
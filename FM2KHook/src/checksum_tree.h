@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "snapshot.h"
+#include "FM2K_Checksum.h"
+
+namespace FM2K {
+namespace State {
+
+// Merkle tree over a snapshot buffer. Each registered region is a leaf hashed
+// with the desync checksum mode (Fletcher32 unless Hash64 is chosen); parents hash their two children, and the root is the state
+// checksum. Only leaves marked changed are rehashed, and only their paths to
+// the root are recombined.
+//
+// Nodes live in an implicit binary heap: node 1 is the root, node n has
+// children 2n and 2n+1, and leaves occupy [LeafBase(), 2 * LeafBase()).
+// To localize a desync, peers compare the children of a mismatching node and
+// descend into whichever differs (log2(leaves) round trips), or exchange all
+// leaf hashes at once (a few hundred bytes for the hook's layout).
+class ChecksumTree {
+public:
+    struct Leaf {
+        size_t offset;        // Offset into the snapshot buffer
+        size_t size;
+        const char* name;
+    };
+
+    ChecksumTree() = default;
+
+    // Regions are taken in snapshot-buffer terms (offset/size); every leaf
+    // starts out changed
+    void Build(const MemoryRegion* regions, size_t count, Checksum::Mode mode = Checksum::Mode::Fletcher32);
+
+    void MarkAllChanged();
+    void MarkChanged(size_t offset, size_t size);   // Every leaf overlapping the range
+
+    // Rehash changed leaves from `buffer` and return the new root
+    uint32_t Update(const uint8_t* buffer);
+
+    uint32_t Root() const { return nodes_.size() > 1 ? nodes_[1] : 0; }
+    size_t LeafCount() const { return leaves_.size(); }
+    size_t LeafBase() const { return leaf_base_; }
+    const Leaf& GetLeaf(size_t index) const { return leaves_[index]; }
+    uint32_t LeafHash(size_t index) const { return nodes_[leaf_base_ + index]; }
+    uint32_t NodeHash(size_t node) const { return nodes_[node]; }
+    bool IsLeafNode(size_t node) const { return node >= leaf_base_; }
+
+    // One step of the interactive search: given the remote hashes of
+    // `node`'s children, return the first child that differs (0 if neither)
+    size_t Descend(size_t node, uint32_t remote_left, uint32_t remote_right) const;
+
+    // One-shot comparison against the peer's leaf hashes
+    void DiffLeaves(const uint32_t* remote, size_t count, std::vector<size_t>& mismatched) const;
+
+    uint64_t LeavesRehashed() const { return leaves_rehashed_; }
+    Checksum::Mode ChecksumMode() const { return mode_; }
+
+private:
+    static uint32_t Combine(uint32_t left, uint32_t right);
+
+    std::vector<Leaf> leaves_;          // Sorted by offset
+    std::vector<uint8_t> changed_;
+    std::vector<uint32_t> nodes_;
+    size_t leaf_base_ = 0;
+    Checksum::Mode mode_ = Checksum::Mode::Fletcher32;
+    uint64_t leaves_rehashed_ = 0;
+};
+
+} // namespace State
+} // namespace FM2K
@@ -0,0 +1,115 @@
+#include "delay_controller.h"
+#include <algorithm>
+
+namespace FM2K {
+
+void InputDelayController::Reset(uint32_t initial_delay) {
+    current_delay_ = std::clamp(initial_delay, config_.min_delay, MaxDelay());
+    pending_delay_ = current_delay_;
+    candidate_delay_ = current_delay_;
+    candidate_streak_ = 0;
+    rtt_ms_ = 0.0f;
+    jitter_ms_ = 0.0f;
+    std::fill(latency_histogram_, latency_histogram_ + MAX_LATENCY_FRAMES + 1, 0.0);
+    frames_observed_ = 0.0;
+    decision_count_ = 0;
+}
+
+void InputDelayController::SampleNetwork(float rtt_ms, float jitter_ms) {
+    // GekkoNet reports garbage before the first pings land
+    if (rtt_ms < 0.0f || rtt_ms > 10000.0f) return;
+    if (jitter_ms < 0.0f || jitter_ms > 10000.0f) jitter_ms = 0.0f;
+    rtt_ms_ = rtt_ms;
+    jitter_ms_ = jitter_ms;
+}
+
+void InputDelayController::RecordRollback(uint32_t depth) {
+    uint32_t uncovered = std::min(depth + current_delay_, MAX_LATENCY_FRAMES);
+    latency_histogram_[uncovered] += 1.0;
+}
+
+uint32_t InputDelayController::MaxDelay() const {
+    uint32_t ceiling = config_.frame_ms > 0 ? config_.latency_ceiling_ms / config_.frame_ms : 0;
+    return std::max(ceiling, config_.min_delay);
+}
+
+double InputDelayController::ExpectedRollbackFrames(uint32_t delay) const {
+    // Model: a remote input arrives after half the RTT plus a jitter margin
+    double model_latency = (rtt_ms_ * 0.5 + jitter_ms_ * config_.jitter_weight) / config_.frame_ms;
+    double model = std::max(0.0, model_latency - delay);
+    if (frames_observed_ <= 0.0) return model;
+
+    double history = 0.0;
+    for (uint32_t latency = delay + 1; latency <= MAX_LATENCY_FRAMES; ++latency) {
+        history += latency_histogram_[latency] * (latency - delay);
+    }
+    history /= frames_observed_;
+
+    double weight = std::min(1.0, frames_observed_ / config_.warmup_frames);
+    return history * weight + model * (1.0 - weight);
+}
+
+double InputDelayController::ExpectedCost(uint32_t delay) const {
+    return config_.delay_cost * delay + config_.rollback_cost * ExpectedRollbackFrames(delay);
+}
+
+bool InputDelayController::Update() {
+    for (double& count : latency_histogram_) count *= config_.history_decay;
+    frames_observed_ = frames_observed_ * config_.history_decay + 1.0;
+
+    if (pending_delay_ != current_delay_) return true;   // Still waiting for Applied
+
+    uint32_t best = current_delay_;
+    double current_cost = ExpectedCost(current_delay_);
+    double best_cost = current_cost;
+    for (uint32_t delay = config_.min_delay; delay <= MaxDelay(); ++delay) {
+        double cost = ExpectedCost(delay);
+        if (cost < best_cost) {
+            best = delay;
+            best_cost = cost;
+        }
+    }
+
+    if (best == current_delay_ || current_cost - best_cost < config_.hysteresis) {
+        candidate_streak_ = 0;
+        return false;
+    }
+
+    uint32_t step = best > current_delay_ ? current_delay_ + 1 : current_delay_ - 1;
+    if (step != candidate_delay_) {
+        candidate_delay_ = step;
+        candidate_streak_ = 0;
+    }
+    if (++candidate_streak_ < config_.dwell_frames) return false;
+
+    candidate_streak_ = 0;
+    pending_delay_ = step;
+    pending_old_cost_ = current_cost;
+    pending_new_cost_ = ExpectedCost(step);
+    return true;
+}
+
+void InputDelayController::Applied(uint32_t frame) {
+    Decision& decision = decisions_[decision_count_ % DECISION_HISTORY];
+    decision.frame = frame;
+    decision.old_delay = current_delay_;
+    decision.new_delay = pending_delay_;
+    decision.rtt_ms = rtt_ms_;
+    decision.jitter_ms = jitter_ms_;
+    decision.old_cost = pending_old_cost_;
+    decision.new_cost = pending_new_cost_;
+    decision_count_++;
+
+    current_delay_ = pending_delay_;
+}
+
+size_t InputDelayController::DecisionCount() const {
+    return std::min(decision_count_, DECISION_HISTORY);
+}
+
+const InputDelayController::Decision& InputDelayController::GetDecision(size_t index) const {
+    size_t first = decision_count_ > DECISION_HISTORY ? decision_count_ - DECISION_HISTORY : 0;
+    return decisions_[(first + index) % DECISION_HISTORY];
+}
+
+} // namespace FM2K
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FM2K {
+
+// Picks the local input delay that minimizes expected per-frame cost:
+//
+//   cost(d) = delay_cost * d + rollback_cost * E[frames resimulated per frame | d]
+//
+// Rollbacks are recorded as the latency they left uncovered (depth plus the
+// delay in effect), so the history stays valid when the delay changes:
+// delay d would have turned a rollback of uncovered latency L into one of
+// depth max(0, L - d). Until enough frames have been seen, the estimate is
+// blended with a model built from RTT and jitter.
+//
+// A new delay must beat the current one by `hysteresis` for `dwell_frames`
+// consecutive evaluations and moves one frame at a time; the caller applies
+// it at a safe frame boundary and reports back with Applied().
+class InputDelayController {
+public:
+    static constexpr uint32_t MAX_LATENCY_FRAMES = 32;
+    static constexpr size_t DECISION_HISTORY = 64;
+
+    struct Config {
+        uint32_t frame_ms = 10;
+        uint32_t min_delay = 0;
+        uint32_t latency_ceiling_ms = 60;    // Never add more delay than this
+        double delay_cost = 1.0;             // Per frame of delay, every frame
+        double rollback_cost = 3.0;          // Per resimulated frame: a visible correction, not just CPU
+        double jitter_weight = 2.0;          // Jitter standard deviations the model covers
+        double history_decay = 0.999;        // Per frame
+        double warmup_frames = 600.0;        // Frames of history before it fully replaces the model
+        double hysteresis = 0.05;            // Cost margin a new delay must win by
+        uint32_t dwell_frames = 120;
+    };
+
+    struct Decision {
+        uint32_t frame;
+        uint32_t old_delay;
+        uint32_t new_delay;
+        float rtt_ms;
+        float jitter_ms;
+        double old_cost;
+        double new_cost;
+    };
+
+    InputDelayController() = default;
+    explicit InputDelayController(const Config& config) : config_(config) {}
+
+    void Reset(uint32_t initial_delay);
+
+    void SampleNetwork(float rtt_ms, float jitter_ms);
+    void RecordRollback(uint32_t depth);
+
+    // Once per frame. Returns true when a different delay is recommended;
+    // read it with PendingDelay and confirm with Applied once it is in effect.
+    bool Update();
+    uint32_t PendingDelay() const { return pending_delay_; }
+    void Applied(uint32_t frame);
+
+    uint32_t CurrentDelay() const { return current_delay_; }
+    uint32_t MaxDelay() const;
+    double ExpectedCost(uint32_t delay) const;
+
+    // Applied decisions, oldest first
+    size_t DecisionCount() const;
+    const Decision& GetDecision(size_t index) const;
+
+private:
+    double ExpectedRollbackFrames(uint32_t delay) const;
+
+    Config config_;
+    uint32_t current_delay_ = 0;
+    uint32_t pending_delay_ = 0;
+    uint32_t candidate_delay_ = 0;
+    uint32_t candidate_streak_ = 0;
+
+    float rtt_ms_ = 0.0f;
+    float jitter_ms_ = 0.0f;
+
+    // Decayed counts of uncovered latency, and the decayed frame count they are spread over
+    double latency_histogram_[MAX_LATENCY_FRAMES + 1] = {};
+    double frames_observed_ = 0.0;
+
+    Decision decisions_[DECISION_HISTORY] = {};
+    size_t decision_count_ = 0;
+    double pending_old_cost_ = 0.0;
+    double pending_new_cost_ = 0.0;
+};
+
+} // namespace FM2K
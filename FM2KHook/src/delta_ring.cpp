@@ -0,0 +1,398 @@
+#include "delta_ring.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace FM2K {
+namespace State {
+
+namespace {
+
+// Smallest delta arena worth allocating
+constexpr size_t MIN_ARENA_BYTES = 64 * 1024;
+
+// 32-bit word `index` of a state, zero-padded past `size`
+inline uint32_t LoadWord(const uint8_t* data, size_t index, size_t size) {
+    uint32_t word = 0;
+    size_t offset = index * sizeof(uint32_t);
+    if (offset + sizeof(uint32_t) <= size) {
+        std::memcpy(&word, data + offset, sizeof(uint32_t));
+    } else {
+        std::memcpy(&word, data + offset, size - offset);
+    }
+    return word;
+}
+
+inline void StoreWord(uint8_t* data, size_t index, size_t size, uint32_t word) {
+    size_t offset = index * sizeof(uint32_t);
+    if (offset + sizeof(uint32_t) <= size) {
+        std::memcpy(data + offset, &word, sizeof(uint32_t));
+    } else {
+        std::memcpy(data + offset, &word, size - offset);
+    }
+}
+
+inline uint64_t Load64(const uint8_t* data) {
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+// First word from `i` on that differs, or `end`: 32 bytes per step through
+// unchanged memory, then 8, then one word to pin down the change
+inline size_t SkipEqualWords(const uint8_t* a, const uint8_t* b, size_t i, size_t end) {
+    while (i + 8 <= end) {
+        const uint8_t* pa = a + i * sizeof(uint32_t);
+        const uint8_t* pb = b + i * sizeof(uint32_t);
+        uint64_t diff = (Load64(pa) ^ Load64(pb)) | (Load64(pa + 8) ^ Load64(pb + 8)) |
+                        (Load64(pa + 16) ^ Load64(pb + 16)) | (Load64(pa + 24) ^ Load64(pb + 24));
+        if (diff) break;
+        i += 8;
+    }
+    while (i + 2 <= end && Load64(a + i * sizeof(uint32_t)) == Load64(b + i * sizeof(uint32_t))) i += 2;
+    while (i < end && std::memcmp(a + i * sizeof(uint32_t), b + i * sizeof(uint32_t), sizeof(uint32_t)) == 0) i++;
+    return i;
+}
+
+} // anonymous namespace
+
+bool DeltaSnapshotRing::Init(size_t state_size, size_t window, size_t keyframe_interval) {
+    if (state_size == 0 || window == 0 || keyframe_interval == 0) return false;
+
+    state_size_ = state_size;
+    window_ = window;
+    keyframe_interval_ = keyframe_interval;
+
+    // Extra keyframe_interval entries keep the keyframe of the oldest frame in
+    // the window from being overwritten while frames still chain from it
+    entries_.clear();
+    entries_.resize(window + keyframe_interval);
+
+    // Keyframes on one timeline are at least keyframe_interval apart, and the
+    // oldest frame in the window chains from one up to keyframe_interval - 1
+    // frames older; one spare covers a chain restarted after a miss
+    size_t keyframes = (window + keyframe_interval - 1 + keyframe_interval - 1) / keyframe_interval + 1;
+    keyframe_slots_.assign(keyframes, KeyframeSlot{});
+    keyframes_.assign(keyframes * state_size, 0);
+    arena_.clear();
+    last_.assign(state_size, 0);
+    Reset();
+    return true;
+}
+
+void DeltaSnapshotRing::Reset() {
+    for (Entry& entry : entries_) entry.valid = false;
+    for (KeyframeSlot& slot : keyframe_slots_) slot.valid = false;
+    arena_head_ = 0;
+    last_delta_length_ = 0;
+    has_last_ = false;
+    last_frame_ = 0;
+    stats_ = {};
+}
+
+DeltaSnapshotRing::Entry* DeltaSnapshotRing::Find(uint32_t frame) {
+    if (entries_.empty()) return nullptr;
+    Entry& entry = entries_[frame % entries_.size()];
+    return entry.valid && entry.frame == frame ? &entry : nullptr;
+}
+
+const DeltaSnapshotRing::Entry* DeltaSnapshotRing::Find(uint32_t frame) const {
+    if (entries_.empty()) return nullptr;
+    const Entry& entry = entries_[frame % entries_.size()];
+    return entry.valid && entry.frame == frame ? &entry : nullptr;
+}
+
+bool DeltaSnapshotRing::Contains(uint32_t frame) const {
+    const Entry* entry = Find(frame);
+    if (!entry) return false;
+    const Entry* keyframe = Find(entry->keyframe);
+    if (!keyframe || !keyframe->is_keyframe) return false;
+    const KeyframeSlot& slot = keyframe_slots_[keyframe->keyframe_slot];
+    if (!slot.valid || slot.frame != entry->keyframe) return false;
+    for (uint32_t f = entry->keyframe + 1; f != frame + 1; ++f) {
+        const Entry* link = Find(f);
+        if (!link || link->keyframe != entry->keyframe) return false;
+    }
+    return true;
+}
+
+// Drops frames newer than `newer_than` and moves the arena head back to
+// the end of the newest delta left, reusing the abandoned timeline's bytes
+void DeltaSnapshotRing::Invalidate(uint32_t newer_than) {
+    const Entry* newest = nullptr;
+    for (Entry& entry : entries_) {
+        if (!entry.valid) continue;
+        if (entry.frame > newer_than) {
+            entry.valid = false;
+        } else if (!entry.is_keyframe && (!newest || entry.frame > newest->frame)) {
+            newest = &entry;
+        }
+    }
+    for (KeyframeSlot& slot : keyframe_slots_) {
+        if (slot.valid && slot.frame > newer_than) {
+            slot.valid = false;
+        }
+    }
+    if (newest) arena_head_ = newest->offset + newest->length;
+}
+
+// A free pool slot, else the one holding the oldest keyframe
+uint32_t DeltaSnapshotRing::TakeKeyframeSlot() {
+    uint32_t oldest = 0;
+    for (uint32_t n = 0; n < keyframe_slots_.size(); n++) {
+        if (!keyframe_slots_[n].valid) return n;
+        if (keyframe_slots_[n].frame < keyframe_slots_[oldest].frame) oldest = n;
+    }
+    keyframe_slots_[oldest].valid = false;
+    return oldest;
+}
+
+// End of the free arena space starting at `at`: the next live delta, or the
+// arena's end. No live delta straddles the head, so one starting past `at`
+// is the only thing a write there can run into.
+size_t DeltaSnapshotRing::ArenaLimit(size_t at) const {
+    size_t limit = arena_.size();
+    for (const Entry& entry : entries_) {
+        if (entry.valid && !entry.is_keyframe && entry.offset >= at && entry.offset < limit) {
+            limit = entry.offset;
+        }
+    }
+    return limit;
+}
+
+// Repack the live deltas, oldest first, at the front of an arena with room
+// for half as much again plus `need` bytes, and never smaller than before;
+// the head follows them
+void DeltaSnapshotRing::GrowArena(size_t need) {
+    std::vector<Entry*> live;
+    size_t live_bytes = 0;
+    for (Entry& entry : entries_) {
+        if (!entry.valid || entry.is_keyframe) continue;
+        live.push_back(&entry);
+        live_bytes += entry.length;
+    }
+    std::sort(live.begin(), live.end(), [](const Entry* a, const Entry* b) { return a->frame < b->frame; });
+
+    std::vector<uint8_t> grown(std::max({ MIN_ARENA_BYTES, live_bytes + live_bytes / 2 + need, arena_.size() + need }));
+    size_t at = 0;
+    for (Entry* entry : live) {
+        std::memcpy(grown.data() + at, arena_.data() + entry->offset, entry->length);
+        entry->offset = at;
+        at += entry->length;
+    }
+    arena_.swap(grown);
+    arena_head_ = at;
+    stats_.arena_grows++;
+}
+
+// Encode `state` against last_ straight into the arena, leaving last_ equal
+// to `state`: at the head, else from the start once the head is short of
+// room, else after the live deltas once the arena has grown
+bool DeltaSnapshotRing::StoreDelta(const uint8_t* state, Entry& entry) {
+    size_t at = arena_head_;
+    size_t need = std::max<size_t>(2 * last_delta_length_, 4096);
+    bool wrapped = false;
+    for (;;) {
+        size_t limit = ArenaLimit(at);
+        size_t length = 0;
+        bool room = limit - at >= last_delta_length_ || wrapped || at == 0;
+        if (room && Encode(last_.data(), state, state_size_, arena_.data() + at, limit - at, &length)) {
+            entry.offset = at;
+            entry.length = length;
+            arena_head_ = at + length;
+            last_delta_length_ = length;
+            return true;
+        }
+        if (!wrapped && at != 0) {
+            at = 0;
+            wrapped = true;
+            continue;
+        }
+
+        GrowArena(need);
+        at = arena_head_;
+        need *= 2;
+        wrapped = true;
+    }
+}
+
+bool DeltaSnapshotRing::Save(uint32_t frame, const uint8_t* state) {
+    if (entries_.empty() || !state) return false;
+
+    // Anything at or after this frame belongs to a timeline we rolled away from
+    if (frame > 0) {
+        Invalidate(frame - 1);
+    } else {
+        for (Entry& entry : entries_) entry.valid = false;
+        for (KeyframeSlot& slot : keyframe_slots_) slot.valid = false;
+        arena_head_ = 0;
+        has_last_ = false;
+    }
+
+    // The XOR base must be exactly the previous frame
+    const Entry* previous = frame > 0 ? Find(frame - 1) : nullptr;
+    if (previous && !(has_last_ && last_frame_ == frame - 1)) {
+        if (!Rebuild(frame - 1, last_.data())) {
+            previous = nullptr;
+        }
+    }
+
+    bool keyframe = !previous || frame - previous->keyframe >= keyframe_interval_;
+    uint32_t keyframe_number = keyframe ? frame : previous->keyframe;
+
+    Entry& entry = entries_[frame % entries_.size()];
+    if (entry.valid && entry.is_keyframe && keyframe_slots_[entry.keyframe_slot].frame == entry.frame) {
+        keyframe_slots_[entry.keyframe_slot].valid = false;
+    }
+    entry.valid = false;
+    if (keyframe) {
+        uint32_t slot = TakeKeyframeSlot();
+        std::memcpy(keyframes_.data() + slot * state_size_, state, state_size_);
+        keyframe_slots_[slot] = { frame, true };
+        entry.keyframe_slot = slot;
+        stats_.keyframes++;
+        std::memcpy(last_.data(), state, state_size_);
+    } else {
+        StoreDelta(state, entry);
+    }
+    entry.frame = frame;
+    entry.keyframe = keyframe_number;
+    entry.is_keyframe = keyframe;
+    entry.valid = true;
+    last_frame_ = frame;
+    has_last_ = true;
+
+    // Drop what no frame in the window chains back to, so the arena only
+    // has to hold the window's deltas
+    if (frame + 1 >= window_) {
+        uint32_t oldest = frame + 1 - static_cast<uint32_t>(window_);
+        const Entry* chain = Find(oldest);
+        uint32_t cut = chain ? chain->keyframe : oldest;
+        for (Entry& stale : entries_) {
+            if (stale.valid && stale.frame < cut) stale.valid = false;
+        }
+        for (KeyframeSlot& slot : keyframe_slots_) {
+            if (slot.valid && slot.frame < cut) slot.valid = false;
+        }
+    }
+
+    stats_.saves++;
+    return true;
+}
+
+bool DeltaSnapshotRing::Rebuild(uint32_t frame, uint8_t* state) {
+    if (!Contains(frame)) return false;
+
+    const Entry* entry = Find(frame);
+    const Entry* keyframe = Find(entry->keyframe);
+    std::memcpy(state, keyframes_.data() + keyframe->keyframe_slot * state_size_, state_size_);
+
+    for (uint32_t f = entry->keyframe + 1; f != frame + 1; ++f) {
+        const Entry* delta = Find(f);
+        Apply(arena_.data() + delta->offset, delta->length, state, state_size_);
+        stats_.deltas_applied++;
+    }
+    return true;
+}
+
+bool DeltaSnapshotRing::Restore(uint32_t frame, uint8_t* state) {
+    if (!state) return false;
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (has_last_ && last_frame_ == frame && Find(frame)) {
+        std::memcpy(state, last_.data(), state_size_);
+    } else {
+        if (!Rebuild(frame, last_.data())) return false;
+        last_frame_ = frame;
+        has_last_ = true;
+        std::memcpy(state, last_.data(), state_size_);
+    }
+
+    uint64_t elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    stats_.restores++;
+    stats_.restore_ns_total += elapsed;
+    stats_.restore_ns_max = std::max(stats_.restore_ns_max, elapsed);
+    return true;
+}
+
+bool DeltaSnapshotRing::Encode(uint8_t* previous, const uint8_t* current, size_t size, uint8_t* out,
+                               size_t capacity, size_t* length) {
+    size_t words = (size + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+    size_t full_words = size / sizeof(uint32_t);
+    size_t written = 0;
+
+    size_t i = 0;
+    while (i < words) {
+        // Zero run (unchanged words)
+        size_t skip_start = i;
+        i = SkipEqualWords(previous, current, i, full_words);
+        while (i < words && i >= full_words && LoadWord(previous, i, size) == LoadWord(current, i, size)) i++;
+        if (i == words) break;  // Trailing zeros need no record
+
+        // Literal run, ended by two unchanged words in a row so a single
+        // matching word does not cost a new 8-byte record header
+        size_t literal_start = i;
+        while (i < words) {
+            if (LoadWord(previous, i, size) == LoadWord(current, i, size) &&
+                (i + 1 >= words || LoadWord(previous, i + 1, size) == LoadWord(current, i + 1, size))) {
+                break;
+            }
+            i++;
+        }
+
+        uint32_t record[2] = { static_cast<uint32_t>(literal_start - skip_start), static_cast<uint32_t>(i - literal_start) };
+        if (written + sizeof(record) + record[1] * sizeof(uint32_t) > capacity) {
+            Apply(out, written, previous, size);
+            return false;
+        }
+        std::memcpy(out + written, record, sizeof(record));
+        written += sizeof(record);
+        for (size_t w = literal_start; w < i; ++w) {
+            uint32_t next = LoadWord(current, w, size);
+            uint32_t x = LoadWord(previous, w, size) ^ next;
+            StoreWord(previous, w, size, next);
+            std::memcpy(out + written, &x, sizeof(uint32_t));
+            written += sizeof(uint32_t);
+        }
+    }
+    *length = written;
+    return true;
+}
+
+void DeltaSnapshotRing::Apply(const uint8_t* delta, size_t length, uint8_t* state, size_t size) {
+    const uint8_t* cursor = delta;
+    const uint8_t* end = cursor + length;
+    size_t word = 0;
+
+    while (cursor + 2 * sizeof(uint32_t) <= end) {
+        uint32_t skip = 0, literals = 0;
+        std::memcpy(&skip, cursor, sizeof(uint32_t));
+        std::memcpy(&literals, cursor + sizeof(uint32_t), sizeof(uint32_t));
+        cursor += 2 * sizeof(uint32_t);
+        word += skip;
+
+        for (uint32_t n = 0; n < literals; ++n, ++word) {
+            uint32_t x = 0;
+            std::memcpy(&x, cursor, sizeof(uint32_t));
+            cursor += sizeof(uint32_t);
+            StoreWord(state, word, size, LoadWord(state, word, size) ^ x);
+        }
+    }
+}
+
+DeltaSnapshotRing::Stats DeltaSnapshotRing::GetStats() const {
+    Stats stats = stats_;
+    stats.bytes_stored = 0;
+    for (const Entry& entry : entries_) {
+        if (!entry.valid) continue;
+        stats.bytes_stored += entry.is_keyframe ? state_size_ : entry.length;
+    }
+    stats.bytes_reserved = keyframes_.capacity() + arena_.capacity() + last_.capacity();
+    stats.flat_ring_bytes = window_ * state_size_;
+    return stats;
+}
+
+} // namespace State
+} // namespace FM2K
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace FM2K {
+namespace State {
+
+// Rollback ring that keeps a full keyframe every `keyframe_interval` frames
+// and, in between, the XOR of each frame against the previous one encoded as
+// zero-run/literal word spans. Most of a ~400 KB FM2K snapshot does not change
+// between frames, so a delta is usually a few hundred bytes. Restoring a frame
+// copies its keyframe and applies at most keyframe_interval - 1 deltas.
+//
+// Keyframes live in a pool of full-state slots, only as many as the window
+// can reach; deltas are packed one after another into a circular arena that
+// grows to the encoded bytes the window holds and then stops allocating.
+//
+// Encoded delta layout, repeated until the end of the state:
+//   uint32 skip_words, uint32 literal_words, literal_words x uint32 xor
+class DeltaSnapshotRing {
+public:
+    struct Stats {
+        uint64_t saves;
+        uint64_t keyframes;
+        uint64_t restores;
+        uint64_t deltas_applied;     // Total deltas replayed by restores
+        uint64_t arena_grows;        // Times the delta arena had to grow
+        uint64_t restore_ns_total;
+        uint64_t restore_ns_max;
+        size_t bytes_stored;         // Live encoded bytes (keyframes + deltas)
+        size_t bytes_reserved;       // Keyframe pool, delta arena and XOR base
+        size_t flat_ring_bytes;      // Same window stored as full copies
+    };
+
+    DeltaSnapshotRing() = default;
+
+    // `window` is the number of most recent frames that must stay restorable
+    bool Init(size_t state_size, size_t window, size_t keyframe_interval);
+    void Reset();
+
+    // Frames are saved in increasing order; saving frame N after restoring an
+    // older frame discards everything newer than N - 1 (the old timeline).
+    bool Save(uint32_t frame, const uint8_t* state);
+    bool Restore(uint32_t frame, uint8_t* state);
+    bool Contains(uint32_t frame) const;
+
+    size_t StateSize() const { return state_size_; }
+    Stats GetStats() const;
+
+private:
+    struct Entry {
+        uint32_t frame;
+        uint32_t keyframe;           // Frame of the keyframe this entry chains from
+        bool valid;
+        bool is_keyframe;
+        uint32_t keyframe_slot;      // Pool slot, keyframes only
+        size_t offset;               // Delta's bytes in the arena, deltas only
+        size_t length;
+    };
+
+    struct KeyframeSlot {
+        uint32_t frame;
+        bool valid;
+    };
+
+    Entry* Find(uint32_t frame);
+    const Entry* Find(uint32_t frame) const;
+    bool Rebuild(uint32_t frame, uint8_t* state);
+    void Invalidate(uint32_t newer_than);
+    uint32_t TakeKeyframeSlot();
+    size_t ArenaLimit(size_t at) const;
+    void GrowArena(size_t need);
+    bool StoreDelta(const uint8_t* state, Entry& entry);
+
+    // Writes the delta and turns `previous` into `current` as it goes; false,
+    // with `previous` left as it was, if the delta needs more than `capacity`
+    static bool Encode(uint8_t* previous, const uint8_t* current, size_t size, uint8_t* out, size_t capacity,
+                       size_t* length);
+    static void Apply(const uint8_t* delta, size_t length, uint8_t* state, size_t size);
+
+    std::vector<Entry> entries_;
+    std::vector<KeyframeSlot> keyframe_slots_;
+    std::vector<uint8_t> keyframes_;  // keyframe_slots_.size() states back to back
+    std::vector<uint8_t> arena_;      // Encoded deltas
+    size_t arena_head_ = 0;           // Where the next delta goes
+    size_t last_delta_length_ = 0;
+    std::vector<uint8_t> last_;      // State of last_frame_, the XOR base for the next save
+    uint32_t last_frame_ = 0;
+    bool has_last_ = false;
+    size_t state_size_ = 0;
+    size_t keyframe_interval_ = 0;
+    size_t window_ = 0;
+    Stats stats_ = {};
+};
+
+} // namespace State
+} // namespace FM2K
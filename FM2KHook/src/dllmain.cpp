@@ -1,12 +1,32 @@
 #include <windows.h>
+#include <mmsystem.h>
 #include <MinHook.h>
 #include <cstdio>
 #include <cstdint>
+#include <cstdlib>
 #include <iostream>
 #include <SDL3/SDL.h>
 // Direct GekkoNet integration
 #include "gekkonet.h"
 #include "state_manager.h"
+#include "FM2K_Checksum.h"
+#include "FM2K_SharedControl.h"
+#include "page_tracker.h"
+#include "heap_hooks.h"
+#include "state_buffer_table.h"
+#include "checksum_tree.h"
+#include "render_hooks.h"
+#include "rollback_timings.h"
+#include "frame_pacer.h"
+#include "delay_controller.h"
+#include "checkpoint_policy.h"
+#include "input_ledger.h"
+#include "rollback_budget.h"
+#include "input_codec.h"
+#include "replay_recorder.h"
+#include "input_sampler.h"
+#include <vector>
+#include <algorithm>
 
 // Direct GekkoNet session (no shared memory needed)
 static GekkoSession* gekko_session = nullptr;
@@ -16,30 +36,172 @@ static bool gekko_initialized = false;
 static bool is_online_mode = false;
 static bool is_host = false;
 
-// Shared memory for configuration
+// Shared memory for configuration (FM2K_SharedControl.h); the config last
+// taken from the launcher and its generation
 static HANDLE shared_memory_handle = nullptr;
-static void* shared_memory_data = nullptr;
+static FM2K::SharedControlBlock* shared_control = nullptr;
+static FM2K::NetworkConfig network_config = {};
+static uint32_t network_config_generation = 0;
+
+// Start of every snapshot. The rest of the buffer is the region table packed
+// back to back (core variables, then the object pool); the input history
+// rings are kept as a window here instead.
+struct SnapshotHeader {
+    uint32_t frame;
+    uint32_t checksum;
+    FM2K::State::InputHistorySnapshot input_history;
+};
+
+// GekkoNet can roll back up to INPUT_PREDICTION_WINDOW frames; the margin keeps
+// the oldest of those alive while the current frame is being saved
+static constexpr uint32_t INPUT_PREDICTION_WINDOW = 8;
+static constexpr uint32_t SNAPSHOT_RING_MARGIN = 2;
+static constexpr uint32_t SNAPSHOT_RING_SLOTS = INPUT_PREDICTION_WINDOW + SNAPSHOT_RING_MARGIN;
+
+// A rollback may load a checkpoint up to MAX_CHECKPOINT_INTERVAL - 1 frames
+// older than its target, so each snapshot's input history window covers that
+// much on top of the frames the ring can roll back
+static constexpr uint32_t INPUT_HISTORY_WINDOW = SNAPSHOT_RING_SLOTS + FM2K::State::MAX_CHECKPOINT_INTERVAL;
+static_assert(INPUT_HISTORY_WINDOW <= FM2K::State::INPUT_HISTORY_WINDOW_MAX,
+              "Input history window must cover every frame the ring can roll back plus a checkpoint interval");
+
+// Snapshots live in GekkoNet's own state storage, one buffer per saved frame,
+// captured straight into from SaveEvents. Its storage keeps a few buffers past
+// the prediction window; this is room to track every one it hands out.
+static constexpr uint32_t STATE_BUFFER_SLOTS = 2 * SNAPSHOT_RING_SLOTS;
+
+// State buffer layout, generated from the schema: the header, then every
+// Whole field and the whole object pool (Nested fields ride along in it)
+// packed in address order. Input history rings are left to the header's window.
+static constexpr uint32_t HOOK_STATE_CAPTURES =
+    FM2K::State::CaptureBit(FM2K::State::Capture::Whole) | FM2K::State::CaptureBit(FM2K::State::Capture::Pool);
+static constexpr auto HOOK_STATE_REGIONS =
+    FM2K::State::PackFields(FM2K::State::STATE_SCHEMA, HOOK_STATE_CAPTURES, sizeof(SnapshotHeader));
+static constexpr size_t HOOK_STATE_SIZE = HOOK_STATE_REGIONS.buffer_size;  // GekkoNet state_size
+static_assert(FM2K::State::RegionsDisjoint(HOOK_STATE_REGIONS), "Hook state regions overlap");
+
+// Desync checksums cover Critical fields only
+static constexpr auto HOOK_CHECKSUM_REGIONS =
+    FM2K::State::PackFields(FM2K::State::STATE_SCHEMA, HOOK_STATE_CAPTURES, sizeof(SnapshotHeader),
+                            FM2K::State::PriorityBit(FM2K::State::Priority::Critical));
 
 // State management
-static FM2K::State::GameState saved_states[8];  // Ring buffer for 8 frames
-static uint32_t current_state_index = 0;
+static FM2K::State::StateBufferTable state_buffers;     // GekkoNet state buffers by frame
 static bool state_manager_initialized = false;
+static FM2K::State::SnapshotPlan snapshot_plan;         // Merged copy plan into a state buffer
+static FM2K::State::LocalMemoryBackend game_memory;     // In-process view of game memory
+static FM2K::State::TrackedSnapshotRing snapshot_ring;  // Copies only pages written since each buffer's last save
+static std::vector<uint8_t> saved_arenas[STATE_BUFFER_SLOTS];  // Heap arena per buffer, up to its high-water mark plus headroom
+static FM2K::State::ChecksumTree checksum_tree;          // Per-region hashes; root is the state checksum
+// FM2K_DESYNC_CHECKSUM=hash64 trades checksum speed for 64-bit leaf hashes;
+// both peers must be started with the same setting
+static FM2K::Checksum::Mode desync_checksum_mode = FM2K::Checksum::Mode::Fletcher32;
+static std::vector<FM2K::State::MemoryRegion> changed_ranges;
+
+// Object pool leaves in the checksum tree, so a desync points at a few slots
+static constexpr size_t CHECKSUM_POOL_CHUNK = 4096;
+
+// Frame whose start the game's memory holds right now: the engine's frame
+// between calls, the loaded frame after a rollback, and one past each
+// resimulated frame. A SaveEvent for it is captured on the spot; one for a
+// later frame waits until simulation reaches it.
+static uint32_t state_frame = 0;
+
+// Restore + fast-forward cost per rollback distance
+static FM2K::State::RollbackTimings rollback_timings;
+
+// Which frames get a snapshot (every frame, or every K-th when rollbacks are rare)
+static FM2K::State::CheckpointPolicy checkpoint_policy;
+
+// Inputs each frame actually ran with: elides rollbacks whose confirmed inputs
+// already match, and lets a rollback replay from an older checkpoint
+static FM2K::State::InputLedger input_ledger;
+static_assert(INPUT_HISTORY_WINDOW <= FM2K::State::INPUT_LEDGER_FRAMES,
+              "Input ledger must cover the rollback window plus a checkpoint interval");
+
+// Frames saved at the interval both peers agree on, from the inputs of a
+// frame GekkoNet can no longer mispredict
+static constexpr uint32_t CHECKPOINT_AGREEMENT_LAG = INPUT_PREDICTION_WINDOW + 1;
+static_assert(CHECKPOINT_AGREEMENT_LAG + SNAPSHOT_RING_SLOTS < FM2K::State::CheckpointAgreement::FRAMES,
+              "Checkpoint agreement must remember every frame a rollback can revisit");
+static_assert(FM2K::State::MAX_CHECKPOINT_INTERVAL <= (FM2K::WIRE_INTERVAL_MASK >> FM2K::WIRE_INTERVAL_SHIFT),
+              "Checkpoint interval must fit in the wire input's spare bits");
+static FM2K::State::CheckpointAgreement checkpoint_agreement(CHECKPOINT_AGREEMENT_LAG);
 
-// Shared memory structure matching the launcher
-struct SharedInputData {
-    uint32_t frame_number;
-    uint16_t p1_input;
-    uint16_t p2_input;
-    bool valid;
-    
-    // Network configuration
-    bool is_online_mode;
-    bool is_host;
-    char remote_address[64];
-    uint16_t port;
-    uint8_t input_delay;
-    bool config_updated;
+// Game input <-> GekkoNet input (all 11 bits; DEFAULT_INPUT_MAP unless the
+// game lays its bits out differently)
+static FM2K::InputCodec input_codec;
+
+// Frames owed after a rollback, resimulated a budget's worth per real frame
+static FM2K::State::RollbackBudget rollback_budget;
+
+// Replay capture (FM2K_REPLAY_RECORD=<path>): confirmed inputs plus a keyframe
+// every few seconds, encoded and written off the game thread. Keyframes hold
+// whole input rings rather than the rollback window, since playback starts
+// in a fresh process; the heap arena is not part of them.
+static FM2K::ReplayRecorder replay_recorder;
+static char replay_path[MAX_PATH] = {};
+static bool replay_started = false;
+static constexpr uint32_t REPLAY_KEYFRAME_CAPTURES =
+    FM2K::State::CaptureBit(FM2K::State::Capture::Whole) | FM2K::State::CaptureBit(FM2K::State::Capture::Window) |
+    FM2K::State::CaptureBit(FM2K::State::Capture::Pool);
+static constexpr auto REPLAY_KEYFRAME_REGIONS =
+    FM2K::State::PackFields(FM2K::State::STATE_SCHEMA, REPLAY_KEYFRAME_CAPTURES);
+static constexpr auto REPLAY_KEYFRAME_RUNS = FM2K::State::MergeRuns(REPLAY_KEYFRAME_REGIONS);
+static FM2K::State::SnapshotPlan replay_keyframe_plan;
+
+// A frame this far behind the engine can no longer be rolled back; its
+// inputs go to the replay from the ledger
+static constexpr uint32_t REPLAY_CONFIRM_LAG = SNAPSHOT_RING_SLOTS;
+static_assert(REPLAY_CONFIRM_LAG < FM2K::State::INPUT_LEDGER_FRAMES, "Input ledger must cover the replay confirm lag");
+
+// Frame the engine runs this call: the next frame GekkoNet advanced (owed
+// from a catch-up or this update's live advance), run on that advance's
+// inputs. Numbered like GekkoNet's frames, so a SaveEvent for the live frame
+// finds the game sitting at its start. While a session runs and GekkoNet
+// advanced nothing (syncing, or waiting on a remote input), the engine does
+// not run at all: a frame simulated on locally polled inputs would be one
+// the peer never sees. Without a session it runs the frame after the last
+// one on the polled inputs.
+static uint32_t engine_frame = 0;
+static uint32_t next_engine_frame = 0;
+static bool engine_frame_skipped = false;
+static bool engine_inputs_override = false;
+static uint32_t engine_p1 = 0;
+static uint32_t engine_p2 = 0;
+
+// Rollback started this call, timed once its first catch-up has run
+struct RollbackInProgress {
+    bool active;
+    uint32_t depth;
+    uint64_t restore_us;
+    uint64_t replay_us;
 };
+static RollbackInProgress current_rollback = {};
+
+// Online frame pacing: stretches the 10 ms frame while we run ahead of the peer.
+// The engine can only run a frame once its own 10 ms timer has elapsed, so the
+// pacer never shortens a frame below nominal.
+static FM2K::SteadyPacerClock pacer_clock;
+static FM2K::FramePacer frame_pacer(pacer_clock);
+
+// Device sampling thread (FM2K_INPUT_SAMPLER=<Hz>, any non-number for the
+// default rate; FM2K_INPUT_KEYS=<virtual-key codes> rebinds the keyboard).
+// The hook takes its newest sample after the pacer's wait, so the input the
+// engine runs on is at most one poll period old. Only the local players'
+// slots are sampled and replaced; online, the remote slot is GekkoNet's.
+static FM2K::InputSampler input_sampler;
+static uint32_t input_sampler_hz = 0;
+static FM2K::InputBindings input_bindings = FM2K::InputBindings::Defaults();
+static bool input_sampler_failed = false;
+static FM2K::InputSample last_input_sample = {};
+static bool have_input_sample = false;
+static FM2K::InputLatencyHistogram input_latency;
+
+// Online input delay, retuned from ping, jitter and rollback depth
+static FM2K::InputDelayController delay_controller;
+static constexpr uint32_t DEFAULT_INPUT_DELAY = 2;
+static bool rolled_back_this_frame = false;
 
 // Simple hook function types (matching FM2K patterns)
 typedef int (__cdecl *ProcessGameInputsFn)();
@@ -55,56 +217,18 @@ static uint32_t g_frame_counter = 0;
 // Key FM2K addresses (from IDA analysis)
 static constexpr uintptr_t PROCESS_INPUTS_ADDR = 0x4146D0;
 static constexpr uintptr_t UPDATE_GAME_ADDR = 0x404CD0;
-static constexpr uintptr_t FRAME_COUNTER_ADDR = 0x447EE0;
-
-// Input buffer addresses (correct addresses from IDA analysis)
-static constexpr uintptr_t P1_INPUT_ADDR = 0x4259C0;  // g_p1_input[0]
-static constexpr uintptr_t P2_INPUT_ADDR = 0x4259C4;  // g_p2_input
-
-// State memory addresses (from state_manager.h)
-static constexpr uintptr_t P1_HP_ADDR = 0x47010C;
-static constexpr uintptr_t P2_HP_ADDR = 0x47030C;
-static constexpr uintptr_t ROUND_TIMER_ADDR = 0x470060;
-static constexpr uintptr_t GAME_TIMER_ADDR = 0x470044;
-static constexpr uintptr_t RANDOM_SEED_ADDR = 0x41FB1C;
-
-// Simple Fletcher32 implementation for checksums
-namespace FM2K {
-namespace State {
-uint32_t Fletcher32(const uint8_t* data, size_t len) {
-    uint32_t sum1 = 0xFFFF, sum2 = 0xFFFF;
-    size_t blocks = len / 2;
-
-    // Process 2-byte blocks
-    while (blocks) {
-        size_t tlen = blocks > 359 ? 359 : blocks;
-        blocks -= tlen;
-        do {
-            sum1 += (data[0] << 8) | data[1];
-            sum2 += sum1;
-            data += 2;
-        } while (--tlen);
-
-        sum1 = (sum1 & 0xFFFF) + (sum1 >> 16);
-        sum2 = (sum2 & 0xFFFF) + (sum2 >> 16);
-    }
-
-    // Handle remaining byte if length is odd
-    if (len & 1) {
-        sum1 += *data << 8;
-        sum2 += sum1;
-        sum1 = (sum1 & 0xFFFF) + (sum1 >> 16);
-        sum2 = (sum2 & 0xFFFF) + (sum2 >> 16);
-    }
-
-    // Final reduction
-    sum1 = (sum1 & 0xFFFF) + (sum1 >> 16);
-    sum2 = (sum2 & 0xFFFF) + (sum2 >> 16);
-
-    return (sum2 << 16) | sum1;
-}
-} // namespace State
-} // namespace FM2K
+static constexpr uint32_t ENGINE_FRAME_MS = 10;
+
+// Hooked functions are code, and MinHook rewrites their first bytes, so
+// rollback must never snapshot or restore them
+static_assert(FM2K::State::InEngineCode(PROCESS_INPUTS_ADDR) && FM2K::State::InEngineCode(UPDATE_GAME_ADDR),
+              "Hook targets must lie in engine code");
+static_assert(FM2K::State::SchemaAvoids(FM2K::State::STATE_SCHEMA, PROCESS_INPUTS_ADDR) &&
+              FM2K::State::SchemaAvoids(FM2K::State::STATE_SCHEMA, UPDATE_GAME_ADDR),
+              "STATE_SCHEMA covers a hooked function");
+
+// Game variables, typed (state_schema.h)
+namespace Fields = FM2K::State::Fields;
 
 // Initialize shared memory for configuration
 bool InitializeSharedMemory() {
@@ -114,8 +238,8 @@ bool InitializeSharedMemory() {
         nullptr,
         PAGE_READWRITE,
         0,
-        sizeof(SharedInputData),
-        "FM2K_InputSharedMemory"
+        sizeof(FM2K::SharedControlBlock),
+        FM2K::SHARED_CONTROL_NAME
     );
     
     if (shared_memory_handle == nullptr) {
@@ -123,177 +247,491 @@ bool InitializeSharedMemory() {
         return false;
     }
     
-    shared_memory_data = MapViewOfFile(
+    void* view = MapViewOfFile(
         shared_memory_handle,
         FILE_MAP_ALL_ACCESS,
         0,
         0,
-        sizeof(SharedInputData)
+        sizeof(FM2K::SharedControlBlock)
     );
     
-    if (shared_memory_data == nullptr) {
+    if (view == nullptr) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Failed to map shared memory view");
         CloseHandle(shared_memory_handle);
         shared_memory_handle = nullptr;
         return false;
     }
     
-    // Initialize shared memory data
-    SharedInputData* shared_data = static_cast<SharedInputData*>(shared_memory_data);
-    memset(shared_data, 0, sizeof(SharedInputData));
-    shared_data->config_updated = false;
+    // The launcher attaches once the block is formatted
+    shared_control = FM2K::SharedControlBlock::Create(view);
     
-    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Shared memory initialized successfully");
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Shared memory initialized successfully (layout %u, %u bytes)",
+                FM2K::SHARED_CONTROL_LAYOUT, (unsigned)sizeof(FM2K::SharedControlBlock));
     return true;
 }
 
-// Check for configuration updates from launcher
+// Check for configuration updates from launcher. One relaxed load per
+// frame unless the launcher published a new config generation.
 bool CheckConfigurationUpdates() {
-    if (!shared_memory_data) return false;
+    if (!shared_control || !shared_control->ConfigChanged(network_config_generation)) return false;
     
-    SharedInputData* shared_data = static_cast<SharedInputData*>(shared_memory_data);
-    if (shared_data->config_updated) {
-        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Configuration update received - Online: %s, Host: %s", 
-                    shared_data->is_online_mode ? "YES" : "NO", shared_data->is_host ? "YES" : "NO");
-        
-        // Update local configuration
-        is_online_mode = shared_data->is_online_mode;
-        is_host = shared_data->is_host;
-        
-        // Clear the update flag
-        shared_data->config_updated = false;
-        
-        // Reconfigure GekkoNet session if needed
-        if (gekko_session && gekko_initialized) {
-            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Reconfiguring GekkoNet session...");
-            // TODO: Implement session reconfiguration
-        }
-        
-        return true;
+    // Mid-write: the launcher finishes long before the next frame
+    FM2K::NetworkConfig config;
+    uint32_t generation = 0;
+    if (!shared_control->ReadConfig(&config, &generation)) return false;
+    
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Configuration update received (generation %u) - Online: %s, Host: %s", 
+                generation, config.is_online_mode ? "YES" : "NO", config.is_host ? "YES" : "NO");
+    
+    // Update local configuration
+    network_config = config;
+    network_config_generation = generation;
+    is_online_mode = config.is_online_mode;
+    is_host = config.is_host;
+    shared_control->AcknowledgeConfig(generation);
+    
+    // Reconfigure GekkoNet session if needed
+    if (gekko_session && gekko_initialized) {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Reconfiguring GekkoNet session...");
+        // TODO: Implement session reconfiguration
     }
     
-    return false;
+    return true;
 }
 
 // Initialize state manager for rollback
 bool InitializeStateManager() {
-    // Clear state buffer
-    memset(saved_states, 0, sizeof(saved_states));
-    current_state_index = 0;
+    // Validate each field once here instead of per frame. One that is not
+    // accessible in this build of the game is left out of the plan with a
+    // warning; its bytes keep their place in the buffer and stay zero, so the
+    // layout (and GekkoNet's state_size) never changes.
+    std::vector<FM2K::State::MemoryRegion> accessible;
+    accessible.reserve(HOOK_STATE_REGIONS.count);
+    for (const auto& region : HOOK_STATE_REGIONS) {
+        if (IsBadReadPtr((const void*)region.address, region.size) || IsBadWritePtr((void*)region.address, region.size)) {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Skipping state region %s at 0x%08X (%u bytes): not accessible",
+                        region.name, (unsigned)region.address, (unsigned)region.size);
+            continue;
+        }
+        accessible.push_back(region);
+    }
+    if (accessible.empty()) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: No state region is accessible");
+        return false;
+    }
+
+    // Runs merge again at runtime, so skipping a field only splits its run
+    snapshot_plan.Build(accessible.data(), accessible.size());
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: State plan: %u of %u regions merged into %u runs, %u bytes per frame",
+                (unsigned)accessible.size(), (unsigned)HOOK_STATE_REGIONS.count, (unsigned)snapshot_plan.Runs().size(),
+                (unsigned)HOOK_STATE_SIZE);
+
+    state_buffers.Init(STATE_BUFFER_SLOTS);
+    if (!snapshot_ring.Init(snapshot_plan, game_memory, STATE_BUFFER_SLOTS)) {
+        return false;
+    }
+
+    // Checksum leaves: the input history window, each Critical field, plus the object pool in fixed chunks
+    std::vector<FM2K::State::MemoryRegion> leaves;
+    leaves.push_back({ Fields::P1_INPUT_HISTORY.address, sizeof(FM2K::State::InputHistorySnapshot),
+                       offsetof(SnapshotHeader, input_history), "input history" });
+    for (const auto& region : HOOK_CHECKSUM_REGIONS) {
+        if (region.address != Fields::OBJECT_POOL.address) {
+            leaves.push_back(region);
+            continue;
+        }
+        for (size_t offset = 0; offset < region.size; offset += CHECKSUM_POOL_CHUNK) {
+            size_t size = std::min(CHECKSUM_POOL_CHUNK, region.size - offset);
+            leaves.push_back({ region.address + offset, size, region.offset + offset, "object pool" });
+        }
+    }
+    checksum_tree.Build(leaves.data(), leaves.size(), desync_checksum_mode);
+    replay_keyframe_plan.Build(REPLAY_KEYFRAME_RUNS.begin(), REPLAY_KEYFRAME_RUNS.count);
+    changed_ranges.reserve(snapshot_plan.BufferSize() / FM2K::State::TRACKED_PAGE_SIZE + snapshot_plan.Runs().size() * 2);
+
     state_manager_initialized = true;
     
-    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: State manager initialized");
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: State manager initialized (desync checksum: %s, kernel: %s)",
+                FM2K::Checksum::ModeName(desync_checksum_mode),
+                FM2K::Checksum::KernelName(FM2K::Checksum::ActiveKernel()));
     return true;
 }
 
-// Save game state directly (in-process)
-bool SaveGameStateDirect(FM2K::State::GameState* state, uint32_t frame_number) {
-    if (!state) return false;
-    
-    // Read game state directly from memory (no ReadProcessMemory needed)
-    uint32_t* frame_ptr = (uint32_t*)FRAME_COUNTER_ADDR;
-    uint16_t* p1_input_ptr = (uint16_t*)P1_INPUT_ADDR;
-    uint16_t* p2_input_ptr = (uint16_t*)P2_INPUT_ADDR;
-    uint32_t* p1_hp_ptr = (uint32_t*)P1_HP_ADDR;
-    uint32_t* p2_hp_ptr = (uint32_t*)P2_HP_ADDR;
-    uint32_t* round_timer_ptr = (uint32_t*)ROUND_TIMER_ADDR;
-    uint32_t* game_timer_ptr = (uint32_t*)GAME_TIMER_ADDR;
-    uint32_t* random_seed_ptr = (uint32_t*)RANDOM_SEED_ADDR;
+// Capture the game straight into the GekkoNet buffer bound to `slot`, filling
+// in GekkoNet's checksum and length in the same pass
+bool SaveGameStateDirect(uint32_t slot, uint32_t frame_number) {
+    auto& entry = state_buffers.Get(slot);
+    SnapshotHeader& header = *reinterpret_cast<SnapshotHeader*>(entry.buffer);
     
-    // Validate pointers and read state
-    if (!IsBadReadPtr(frame_ptr, sizeof(uint32_t))) {
-        state->core.input_buffer_index = *frame_ptr;
-    }
-    if (!IsBadReadPtr(p1_input_ptr, sizeof(uint16_t))) {
-        state->core.p1_input_current = *p1_input_ptr;
+    // Copies only pages written since this buffer was last saved (no ReadProcessMemory needed)
+    if (!snapshot_ring.Save(slot, entry.buffer)) {
+        return false;
     }
-    if (!IsBadReadPtr(p2_input_ptr, sizeof(uint16_t))) {
-        state->core.p2_input_current = *p2_input_ptr;
+    if (!FM2K::State::SaveInputHistory(game_memory, FM2K::State::INPUT_HISTORY_LAYOUT, INPUT_HISTORY_WINDOW,
+                                       header.input_history)) {
+        return false;
     }
-    if (!IsBadReadPtr(p1_hp_ptr, sizeof(uint32_t))) {
-        state->core.p1_hp = *p1_hp_ptr;
+    if (FM2K::State::HeapHooksActive() && !FM2K::State::SaveHeapArena(saved_arenas[slot])) {
+        return false;
     }
-    if (!IsBadReadPtr(p2_hp_ptr, sizeof(uint32_t))) {
-        state->core.p2_hp = *p2_hp_ptr;
+    
+    // Rehash only the regions written since the last save or load
+    snapshot_ring.TakeChangedRanges(changed_ranges);
+    for (const auto& range : changed_ranges) {
+        checksum_tree.MarkChanged(range.offset, range.size);
     }
-    if (!IsBadReadPtr(round_timer_ptr, sizeof(uint32_t))) {
-        state->core.round_timer = *round_timer_ptr;
+    checksum_tree.MarkChanged(offsetof(SnapshotHeader, input_history), sizeof(header.input_history));
+    header.frame = frame_number;
+    header.checksum = checksum_tree.Update(entry.buffer);
+    
+    // Only frames on the agreed schedule are captured, and both peers
+    // capture the same ones, so every captured checksum can be compared
+    if (entry.checksum) *entry.checksum = header.checksum;
+    if (entry.length) *entry.length = (uint32_t)HOOK_STATE_SIZE;
+    state_buffers.MarkCaptured(slot);
+    return true;
+}
+
+// Restore the game straight from the GekkoNet buffer bound to `slot`
+bool LoadGameStateDirect(uint32_t slot) {
+    const uint8_t* buffer = state_buffers.Get(slot).buffer;
+    const SnapshotHeader& header = *reinterpret_cast<const SnapshotHeader*>(buffer);
+    
+    // Input history first: it checks the saved window against the live index,
+    // which the ring load below rewinds
+    if (!FM2K::State::LoadInputHistory(game_memory, FM2K::State::INPUT_HISTORY_LAYOUT, header.input_history)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Input history for frame %u is outside the saved window",
+                     header.frame);
+        return false;
     }
-    if (!IsBadReadPtr(game_timer_ptr, sizeof(uint32_t))) {
-        state->core.game_timer = *game_timer_ptr;
+    
+    // Writes back only pages that differ from the buffer (no WriteProcessMemory needed)
+    if (!snapshot_ring.Load(slot, buffer)) {
+        return false;
     }
-    if (!IsBadReadPtr(random_seed_ptr, sizeof(uint32_t))) {
-        state->core.random_seed = *random_seed_ptr;
+    if (FM2K::State::HeapHooksActive() && !FM2K::State::LoadHeapArena(saved_arenas[slot])) {
+        return false;
     }
     
-    // Set metadata
-    state->frame_number = frame_number;
-    state->timestamp_ms = SDL_GetTicks();
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: State loaded for frame %u", header.frame);
+    return true;
+}
+
+// Load the captured state for `frame_number`
+bool LoadStateFromBuffer(uint32_t frame_number) {
+    if (!state_manager_initialized) return false;
     
-    // Calculate checksum using Fletcher32
-    state->checksum = FM2K::State::Fletcher32(reinterpret_cast<const uint8_t*>(&state->core), sizeof(FM2K::State::CoreGameState));
+    uint32_t slot = 0;
+    if (!state_buffers.FindCaptured(frame_number, &slot)) {
+        auto stats = state_buffers.GetStats();
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: No snapshot for frame %u (%u/%u buffers seen, %u captured, %llu stale hits, %llu misses)",
+                    frame_number, (unsigned)stats.buffers, (unsigned)stats.capacity, (unsigned)stats.occupancy,
+                    (unsigned long long)stats.stale_hits, (unsigned long long)stats.misses);
+        return false;
+    }
+    if (!LoadGameStateDirect(slot)) {
+        return false;
+    }
     
+    // Frames after the target belong to the timeline being replaced
+    state_buffers.InvalidateAfter(frame_number);
+    replay_recorder.Invalidate(frame_number);
+    state_frame = frame_number;
     return true;
 }
 
-// Load game state directly (in-process)
-bool LoadGameStateDirect(const FM2K::State::GameState* state) {
-    if (!state) return false;
+// Elapsed microseconds since an SDL performance counter reading
+static uint64_t ElapsedMicroseconds(uint64_t start) {
+    return (SDL_GetPerformanceCounter() - start) * 1000000 / SDL_GetPerformanceFrequency();
+}
+
+static void LogFrameInputs(uint32_t frame) {
+    input_ledger.Record(frame, Fields::P1_INPUT.Ref(), Fields::P2_INPUT.Ref());
+}
+
+// Copy the start of `frame` into the replay's keyframe staging buffer if it
+// falls on a keyframe; a resimulated start replaces the copy
+static void StageReplayKeyframe(uint32_t frame) {
+    if (!replay_recorder.WantsKeyframe(frame)) return;
+    uint8_t* buffer = replay_recorder.StageKeyframe(frame);
+    if (buffer && replay_keyframe_plan.Capture(game_memory, buffer)) {
+        replay_recorder.KeyframeStaged(frame);
+    }
+}
+
+// Start recording at the next frame once the state plan exists, then hand
+// the replay every frame that has left the rollback window
+static void RecordReplayFrames() {
+    if (!replay_started && replay_path[0] && state_manager_initialized) {
+        replay_started = true;
+        FM2K::ReplayRecorder::Config config;
+        config.path = replay_path;
+        config.state_size = (uint32_t)replay_keyframe_plan.BufferSize();
+        config.first_frame = engine_frame + 1;
+        if (!replay_recorder.Start(config)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Cannot record replay to %s", replay_path);
+            return;
+        }
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Recording replay to %s from frame %u",
+                    replay_path, config.first_frame);
+    }
     
-    // Write game state directly to memory (no WriteProcessMemory needed)
-    uint32_t* frame_ptr = (uint32_t*)FRAME_COUNTER_ADDR;
-    uint16_t* p1_input_ptr = (uint16_t*)P1_INPUT_ADDR;
-    uint16_t* p2_input_ptr = (uint16_t*)P2_INPUT_ADDR;
-    uint32_t* p1_hp_ptr = (uint32_t*)P1_HP_ADDR;
-    uint32_t* p2_hp_ptr = (uint32_t*)P2_HP_ADDR;
-    uint32_t* round_timer_ptr = (uint32_t*)ROUND_TIMER_ADDR;
-    uint32_t* game_timer_ptr = (uint32_t*)GAME_TIMER_ADDR;
-    uint32_t* random_seed_ptr = (uint32_t*)RANDOM_SEED_ADDR;
+    while (replay_recorder.Active() && replay_recorder.NextFrame() + REPLAY_CONFIRM_LAG <= engine_frame) {
+        uint32_t frame = replay_recorder.NextFrame();
+        const FM2K::State::InputLedger::Entry* inputs = input_ledger.Find(frame);
+        if (!inputs) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: No logged inputs for frame %u, replay ends there", frame);
+            replay_recorder.Stop();
+            return;
+        }
+        replay_recorder.AppendFrame(input_codec.ToWire(inputs->p1), input_codec.ToWire(inputs->p2));
+    }
+}
+
+// Snapshot the start of `frame` into its GekkoNet buffer, if GekkoNet asked
+// for it, the checkpoint policy wants it, and it is not already held
+static void SaveCheckpoint(uint32_t frame) {
+    uint32_t slot = 0;
+    if (!state_manager_initialized || !checkpoint_agreement.ShouldSave(frame) ||
+        !state_buffers.FindBound(frame, &slot) || state_buffers.Get(slot).captured) {
+        return;
+    }
     
-    // Validate pointers and write state
-    if (!IsBadWritePtr(frame_ptr, sizeof(uint32_t))) {
-        *frame_ptr = state->core.input_buffer_index;
+    uint64_t save_start = SDL_GetPerformanceCounter();
+    if (SaveGameStateDirect(slot, frame)) {
+        checkpoint_policy.RecordSave(ElapsedMicroseconds(save_start));
     }
-    if (!IsBadWritePtr(p1_input_ptr, sizeof(uint16_t))) {
-        *p1_input_ptr = (uint16_t)state->core.p1_input_current;
+}
+
+// Bind a SaveEvent's buffer to its frame and capture it now if the game sits
+// at that frame's start; otherwise SaveCheckpoint fills it in once
+// simulation gets there
+static void HandleSaveEvent(const GekkoGameEvent* update) {
+    const auto& save = update->data.save;
+    uint32_t frame = (uint32_t)save.frame;
+    uint32_t slot = 0;
+    if (!state_buffers.Bind(frame, save.state, save.checksum, save.state_len, &slot)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: GekkoNet handed out more than %u state buffers, frame %u not saved",
+                     STATE_BUFFER_SLOTS, frame);
+        return;
     }
-    if (!IsBadWritePtr(p2_input_ptr, sizeof(uint16_t))) {
-        *p2_input_ptr = (uint16_t)state->core.p2_input_current;
+    if (!state_buffers.Get(slot).captured) {
+        *save.checksum = 0;
+        *save.state_len = 0;
     }
-    if (!IsBadWritePtr(p1_hp_ptr, sizeof(uint32_t))) {
-        *p1_hp_ptr = state->core.p1_hp;
+    if (frame == state_frame) {
+        SaveCheckpoint(frame);
     }
-    if (!IsBadWritePtr(p2_hp_ptr, sizeof(uint32_t))) {
-        *p2_hp_ptr = state->core.p2_hp;
+}
+
+// Make the frame the engine just polled run on `p1`/`p2`. process_game_inputs
+// has stored what it read from the devices both in the input registers and in
+// the history slot at `index` (the input index before the call), and the
+// frame's logic reads both, so both are overwritten before update_game_state.
+static void OverridePolledInputs(uint32_t index, uint32_t p1, uint32_t p2) {
+    Fields::P1_INPUT.Ref() = p1;
+    Fields::P2_INPUT.Ref() = p2;
+    FM2K::State::WriteInputHistorySlot(game_memory, FM2K::State::INPUT_HISTORY_LAYOUT, index, p1, p2);
+}
+
+// Run one frame through both trampolines back to back. This happens inside
+// the hook rather than the engine's main loop, so its frame timer and sleep
+// never apply and a whole catch-up fits in one real frame.
+static void SimulateFrame(uint32_t frame, bool has_inputs, uint32_t p1, uint32_t p2) {
+    SaveCheckpoint(frame);
+    StageReplayKeyframe(frame);
+    
+    FM2K::State::BeginHeapFrame();
+    FM2K::Render::BeginRenderFrame();
+    uint32_t input_index = Fields::INPUT_INDEX.Ref();
+    if (original_process_inputs) {
+        original_process_inputs();
     }
-    if (!IsBadWritePtr(round_timer_ptr, sizeof(uint32_t))) {
-        *round_timer_ptr = state->core.round_timer;
+    if (has_inputs) {
+        OverridePolledInputs(input_index, p1, p2);
     }
-    if (!IsBadWritePtr(game_timer_ptr, sizeof(uint32_t))) {
-        *game_timer_ptr = state->core.game_timer;
+    LogFrameInputs(frame);
+    if (original_update_game) {
+        original_update_game();
+    }
+    state_frame = frame + 1;
+}
+
+// Load the snapshot for `target`, or the nearest older checkpoint when
+// `target` fell between checkpoints. Returns the frame actually loaded.
+static bool LoadNearestCheckpoint(uint32_t target, uint32_t* loaded) {
+    for (uint32_t back = 0; back < FM2K::State::MAX_CHECKPOINT_INTERVAL && back <= target; back++) {
+        if (state_buffers.Contains(target - back)) {
+            *loaded = target - back;
+            return LoadStateFromBuffer(target - back);
+        }
     }
-    if (!IsBadWritePtr(random_seed_ptr, sizeof(uint32_t))) {
-        *random_seed_ptr = state->core.random_seed;
+    return LoadStateFromBuffer(target);    // Logs the miss
+}
+
+// Bring a checkpoint at `from` up to the rollback target with the inputs
+// those frames originally ran with (all confirmed: the target is the first
+// mispredicted frame)
+static bool ReplayToTarget(uint32_t from, uint32_t target) {
+    for (uint32_t frame = from; frame < target; frame++) {
+        const FM2K::State::InputLedger::Entry* inputs = input_ledger.Find(frame);
+        if (!inputs) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: No logged inputs to replay frame %u", frame);
+            return false;
+        }
+        SimulateFrame(frame, true, inputs->p1, inputs->p2);
     }
-    
-    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: State loaded for frame %u", state->frame_number);
     return true;
 }
 
-// Save state to ring buffer
-bool SaveStateToBuffer(uint32_t frame_number) {
-    if (!state_manager_initialized) return false;
+// Game input for `player` from an AdvanceEvent's wire inputs
+static uint32_t AdvanceInput(const unsigned char* inputs, size_t player) {
+    return inputs ? input_codec.FromWire(FM2K::LoadWireInput(inputs, player)) : 0;
+}
+
+// Both players' checkpoint interval stamps from an advance, predicted or confirmed
+static void RecordAdvanceIntervals(const GekkoGameEvent* update) {
+    const unsigned char* inputs = update->data.adv.inputs;
+    if (!inputs) return;
+    checkpoint_agreement.Record((uint32_t)update->data.adv.frame, FM2K::LoadWireInterval(inputs, 0),
+                                FM2K::LoadWireInterval(inputs, 1));
+}
+
+// Owe an AdvanceEvent's frame to the catch-up queue, which hands the engine
+// each frame it runs along with that frame's inputs. If the queue is full,
+// everything owed runs now, whatever the budget says.
+static void QueueAdvance(const GekkoGameEvent* update) {
+    RecordAdvanceIntervals(update);
+    const unsigned char* inputs = update->data.adv.inputs;
+    FM2K::State::RollbackBudget::PendingFrame frame = {
+        (uint32_t)update->data.adv.frame, inputs != nullptr, AdvanceInput(inputs, 0), AdvanceInput(inputs, 1)
+    };
+    if (rollback_budget.Push(frame)) return;
     
-    uint32_t index = frame_number % 8;
-    return SaveGameStateDirect(&saved_states[index], frame_number);
+    rollback_budget.CountForced();
+    FM2K::Render::SuppressRenderFrames(rollback_budget.Backlog());
+    while (rollback_budget.Backlog() > 0) {
+        auto owed = rollback_budget.Pop();
+        SimulateFrame(owed.frame, owed.has_inputs != 0, owed.p1, owed.p2);
+    }
+    rollback_budget.Push(frame);
 }
 
-// Load state from ring buffer
-bool LoadStateFromBuffer(uint32_t frame_number) {
-    if (!state_manager_initialized) return false;
+// Resimulate as many owed frames as this frame's budget allows, without
+// drawing, keeping the last one for the engine to run and draw
+static uint64_t RunCatchUp() {
+    uint32_t frames = rollback_budget.FramesThisUpdate(1);
+    if (frames == 0) return 0;
+    
+    uint64_t start = SDL_GetPerformanceCounter();
+    FM2K::Render::SuppressRenderFrames(frames);
+    for (uint32_t n = 0; n < frames; n++) {
+        auto owed = rollback_budget.Pop();
+        SimulateFrame(owed.frame, owed.has_inputs != 0, owed.p1, owed.p2);
+    }
+    uint64_t us = ElapsedMicroseconds(start);
+    rollback_budget.RecordUpdate(frames, us);
+    return us;
+}
+
+// Handle the LoadEvent at updates[index] and the Save/AdvanceEvents after it.
+// Returns the last index handled; the event loop continues after it.
+static int HandleRollback(GekkoGameEvent** updates, int index, int count) {
+    uint32_t target_frame = updates[index]->data.load.frame;
+    input_ledger.CountRequested();
+    
+    if (!state_manager_initialized || target_frame > g_frame_counter) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "GekkoNet: Invalid rollback target frame %u", target_frame);
+        return index;
+    }
+    
+    // Every advance after the load but the last is a frame that already ran
+    // and must be resimulated; the last is the live frame
+    int live_advance = index;
+    uint32_t rollback_depth = 0;
+    for (int j = index + 1; j < count; j++) {
+        if (updates[j] && updates[j]->type == LoadEvent) break;
+        if (updates[j] && updates[j]->type == AdvanceEvent) {
+            live_advance = j;
+            rollback_depth++;
+        }
+    }
+    
+    // Nothing to redo if every frame that already ran consumed what was
+    // confirmed (not decidable while frames are still owed from a catch-up).
+    // Inputs compare on every bit the wire map carries, whatever the game
+    // mode: only bits GekkoNet never sends can differ without a rollback.
+    bool unverifiable = false;
+    bool mismatch = rollback_budget.Backlog() > 0;
+    for (int j = index + 1; j < live_advance && !mismatch; j++) {
+        if (!updates[j] || updates[j]->type != AdvanceEvent) continue;
+        const auto& adv = updates[j]->data.adv;
+        if (!adv.inputs || !input_ledger.Find(adv.frame)) {
+            unverifiable = true;
+            mismatch = true;
+        } else if (!input_ledger.Matches(adv.frame, AdvanceInput(adv.inputs, 0), AdvanceInput(adv.inputs, 1),
+                                         input_codec.GameMask())) {
+            mismatch = true;
+        }
+    }
+    if (!mismatch) {
+        // The frames that ran stand, and so do their captures. The live
+        // frame still runs, on its advance's inputs.
+        for (int j = index + 1; j < live_advance; j++) {
+            if (!updates[j]) continue;
+            if (updates[j]->type == SaveEvent) {
+                HandleSaveEvent(updates[j]);
+            } else if (updates[j]->type == AdvanceEvent) {
+                RecordAdvanceIntervals(updates[j]);
+            }
+        }
+        if (live_advance > index) {
+            QueueAdvance(updates[live_advance]);
+        }
+        input_ledger.CountElided();
+        return live_advance;
+    }
+    
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "GekkoNet: Rollback to frame %u (current: %u)", target_frame, g_frame_counter);
+    uint64_t restore_start = SDL_GetPerformanceCounter();
+    uint32_t loaded_frame = target_frame;
+    if (!LoadNearestCheckpoint(target_frame, &loaded_frame)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "GekkoNet: Failed to load state for frame %u", target_frame);
+        return index;
+    }
+    uint64_t restore_us = ElapsedMicroseconds(restore_start);
+    input_ledger.CountExecuted(unverifiable);
+    
+    // A checkpoint older than the target first replays up to it
+    uint32_t replay_frames = target_frame - loaded_frame;
+    uint64_t replay_start = SDL_GetPerformanceCounter();
+    uint64_t replay_us = 0;
+    if (replay_frames > 0) {
+        FM2K::Render::SuppressRenderFrames(replay_frames);
+        ReplayToTarget(loaded_frame, target_frame);
+        replay_us = ElapsedMicroseconds(replay_start);
+        checkpoint_policy.RecordReplay(replay_frames, replay_us);
+    }
     
-    uint32_t index = frame_number % 8;
-    return LoadGameStateDirect(&saved_states[index]);
+    // Anything still owed belonged to the replaced timeline; owe the new one
+    // instead, live frame included, and let the budget pace it. Its saves are
+    // captured as simulation reaches each frame.
+    rollback_budget.Clear();
+    for (int j = index + 1; j <= live_advance; j++) {
+        if (!updates[j]) continue;
+        if (updates[j]->type == SaveEvent) {
+            HandleSaveEvent(updates[j]);
+        } else if (updates[j]->type == AdvanceEvent) {
+            QueueAdvance(updates[j]);
+        }
+    }
+    rollback_budget.BeginCatchUp(rollback_budget.Backlog());
+    
+    current_rollback = { true, rollback_depth, restore_us, replay_us };
+    delay_controller.RecordRollback(rollback_depth);
+    checkpoint_policy.RecordRollback();
+    rolled_back_this_frame = true;
+    return live_advance;
 }
 
 // Configure network session based on mode
@@ -306,6 +744,40 @@ bool ConfigureNetworkMode(bool online_mode, bool host_mode) {
     return true;
 }
 
+// Set the input delay of every local player
+static void ApplyLocalDelay(uint32_t delay) {
+    if (p1_handle >= 0) {
+        gekko_set_local_delay(gekko_session, p1_handle, (unsigned char)delay);
+    }
+    if (p2_handle >= 0) {
+        gekko_set_local_delay(gekko_session, p2_handle, (unsigned char)delay);
+    }
+}
+
+// Feed the delay controller and apply its decision at a safe frame boundary:
+// before this frame's local input is added, and never straight after a
+// rollback, so a delay change never lands inside a resimulated span
+static void UpdateInputDelay() {
+    int remote_handle = is_host ? p2_handle : p1_handle;
+    if (remote_handle >= 0) {
+        GekkoNetworkStats stats = {};
+        gekko_network_stats(gekko_session, remote_handle, &stats);
+        delay_controller.SampleNetwork(stats.avg_ping, stats.jitter);
+    }
+    
+    if (!delay_controller.Update() || rolled_back_this_frame) return;
+    
+    uint32_t old_delay = delay_controller.CurrentDelay();
+    ApplyLocalDelay(delay_controller.PendingDelay());
+    delay_controller.Applied(g_frame_counter);
+    
+    // One line per decision, prefixed for offline analysis
+    const auto& decision = delay_controller.GetDecision(delay_controller.DecisionCount() - 1);
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K DELAY: frame=%u old=%u new=%u rtt_ms=%.1f jitter_ms=%.1f cost_old=%.3f cost_new=%.3f",
+                decision.frame, old_delay, decision.new_delay, decision.rtt_ms, decision.jitter_ms,
+                decision.old_cost, decision.new_cost);
+}
+
 // Initialize GekkoNet session for rollback netcode
 bool InitializeGekkoNet() {
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: *** INSIDE InitializeGekkoNet FUNCTION ***");
@@ -323,15 +795,19 @@ bool InitializeGekkoNet() {
     GekkoConfig config;
     config.num_players = 2;
     config.max_spectators = 0;
-    config.input_prediction_window = 8;
+    config.input_prediction_window = INPUT_PREDICTION_WINDOW;
     config.spectator_delay = 0;
-    config.input_size = 1;  // 1 byte per player (8-bit input)
-    config.state_size = 1024;  // Starting with 1KB state size
+    config.input_size = FM2K::WIRE_INPUT_BYTES;  // 11-bit input per player
+    config.state_size = state_manager_initialized ? (unsigned int)HOOK_STATE_SIZE : sizeof(uint32_t);  // Header + packed regions
     config.limited_saving = false;
     config.post_sync_joining = false;
     config.desync_detection = true;
     
     gekko_start(gekko_session, &config);
+    
+    // 1 ms sleep granularity for the frame pacer's sleep phase
+    timeBeginPeriod(1);
+    frame_pacer.Reset();
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: GekkoNet session configured for 2 players");
     
     // Add players based on session mode
@@ -367,22 +843,66 @@ bool InitializeGekkoNet() {
     
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Players added - P1 handle: %d, P2 handle: %d", p1_handle, p2_handle);
     
-    // Set input delay (can be configured later)
-    if (p1_handle >= 0) {
-        gekko_set_local_delay(gekko_session, p1_handle, 2);
-    }
-    if (p2_handle >= 0) {
-        gekko_set_local_delay(gekko_session, p2_handle, 2);
+    // Start from the launcher's input delay; online sessions retune it from there
+    uint32_t initial_delay = DEFAULT_INPUT_DELAY;
+    if (network_config_generation != 0 && is_online_mode) {
+        initial_delay = network_config.input_delay;
     }
+    delay_controller.Reset(initial_delay);
+    ApplyLocalDelay(is_online_mode ? delay_controller.CurrentDelay() : DEFAULT_INPUT_DELAY);
     
     gekko_initialized = true;
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: GekkoNet initialization complete!");
     return true;
 }
 
+// Players whose inputs come from this machine: both offline, the one this
+// peer added as LocalPlayer online
+static uint32_t LocalPlayerMask() {
+    if (!is_online_mode) return FM2K::LOCAL_PLAYERS_BOTH;
+    return is_host ? FM2K::LOCAL_PLAYER_1 : FM2K::LOCAL_PLAYER_2;
+}
+
+// Newest sampler input, replacing what the engine polled for the local
+// players only; the last one is reused when nothing new arrived since the
+// previous frame. Returns the mask of players replaced.
+static uint32_t TakeInputSample(uint32_t* p1, uint32_t* p2) {
+    if (input_sampler_hz == 0 || input_sampler_failed) return 0;
+    if (!input_sampler.Running() && !input_sampler.Start(input_sampler_hz, input_bindings)) {
+        input_sampler_failed = true;
+        return 0;
+    }
+    
+    // A mode change reaches the sampler for its next poll; until then a
+    // sample may carry the old layout, so only slots local in both count
+    uint32_t local = LocalPlayerMask();
+    uint32_t sampled = input_sampler.LocalPlayers();
+    if (sampled != local) {
+        input_sampler.SetLocalPlayers(local);
+        have_input_sample = false;
+    }
+
+    FM2K::InputSample sample;
+    if (input_sampler.Ring().PopLatest(&sample)) {
+        input_latency.Record(FM2K::InputSampler::NowNs() - sample.timestamp_ns);
+        last_input_sample = sample;
+        have_input_sample = true;
+    }
+    if (!have_input_sample) return 0;
+    local &= sampled;
+    if (local & FM2K::LOCAL_PLAYER_1) *p1 = last_input_sample.p1 & FM2K::State::FM2K_INPUT_MASK;
+    if (local & FM2K::LOCAL_PLAYER_2) *p2 = last_input_sample.p2 & FM2K::State::FM2K_INPUT_MASK;
+    return local;
+}
+
 // Simple hook implementations (like your working ML2 code)
 int __cdecl Hook_ProcessGameInputs() {
     g_frame_counter++;
+    engine_frame = rollback_budget.Backlog() > 0 ? rollback_budget.Front().frame : next_engine_frame;
+    state_frame = engine_frame;
+    engine_inputs_override = false;
+    engine_frame_skipped = false;
+    bool engine_frame_advanced = false;
     
     // Always output on first few calls to verify hook is working
     if (g_frame_counter <= 5) {
@@ -391,7 +911,7 @@ int __cdecl Hook_ProcessGameInputs() {
     
     // Read the actual frame counter from game memory (with basic validation)
     uint32_t game_frame = 0;
-    uint32_t* frame_ptr = (uint32_t*)FRAME_COUNTER_ADDR;
+    uint32_t* frame_ptr = &Fields::INPUT_INDEX.Ref();
     if (frame_ptr && !IsBadReadPtr(frame_ptr, sizeof(uint32_t))) {
         game_frame = *frame_ptr;
     }
@@ -405,8 +925,8 @@ int __cdecl Hook_ProcessGameInputs() {
     bool p1_input_valid = false;
     bool p2_input_valid = false;
     
-    uint32_t* p1_input_ptr = (uint32_t*)P1_INPUT_ADDR;
-    uint32_t* p2_input_ptr = (uint32_t*)P2_INPUT_ADDR;
+    uint32_t* p1_input_ptr = &Fields::P1_INPUT.Ref();
+    uint32_t* p2_input_ptr = &Fields::P2_INPUT.Ref();
     
     if (p1_input_ptr && !IsBadReadPtr(p1_input_ptr, sizeof(uint32_t))) {
         p1_input = *p1_input_ptr;
@@ -429,6 +949,22 @@ int __cdecl Hook_ProcessGameInputs() {
     
     // Check for configuration updates from launcher
     CheckConfigurationUpdates();
+    if (shared_control) {
+        shared_control->PublishFrame(g_frame_counter);
+    }
+    
+    // Pace online frames against the peer. Rewinding the engine's frame
+    // timestamp to one frame before now keeps its own timer from batching
+    // catch-up frames after a stretched one.
+    if (gekko_initialized && gekko_session && is_online_mode) {
+        // Frames still owed from a spread-out rollback count as being behind
+        frame_pacer.Wait(gekko_frames_ahead(gekko_session) - (float)rollback_budget.Backlog());
+        Fields::LAST_FRAME_TIME.Ref() = timeGetTime() - ENGINE_FRAME_MS;
+    }
+    
+    uint32_t input_sampled = TakeInputSample(&p1_input, &p2_input);
+    if (input_sampled & FM2K::LOCAL_PLAYER_1) p1_input_valid = true;
+    if (input_sampled & FM2K::LOCAL_PLAYER_2) p2_input_valid = true;
     
     // Log more frequently to debug input capture
     if (g_frame_counter % 1 == 0) {
@@ -455,41 +991,28 @@ int __cdecl Hook_ProcessGameInputs() {
     if (gekko_initialized && gekko_session) {
         // Only process inputs if we have valid data
         if (p1_input_valid || p2_input_valid) {
-            // Convert 16-bit FM2K inputs to 8-bit GekkoNet format
-            uint8_t p1_gekko = 0;
-            uint8_t p2_gekko = 0;
+            // Full 11-bit inputs through the game's wire mapping
+            unsigned char p1_wire[FM2K::WIRE_INPUT_BYTES];
+            unsigned char p2_wire[FM2K::WIRE_INPUT_BYTES];
+            uint32_t interval = checkpoint_policy.Interval();
+            FM2K::StoreWireInput(FM2K::WithWireInterval(input_codec.ToWire(p1_input), interval), p1_wire);
+            FM2K::StoreWireInput(FM2K::WithWireInterval(input_codec.ToWire(p2_input), interval), p2_wire);
             
-            // Map FM2K input bits to 8-bit GekkoNet format (matching bridge logic)
-            if (p1_input & 0x01) p1_gekko |= 0x01;  // left
-            if (p1_input & 0x02) p1_gekko |= 0x02;  // right
-            if (p1_input & 0x04) p1_gekko |= 0x04;  // up
-            if (p1_input & 0x08) p1_gekko |= 0x08;  // down
-            if (p1_input & 0x10) p1_gekko |= 0x10;  // button1
-            if (p1_input & 0x20) p1_gekko |= 0x20;  // button2
-            if (p1_input & 0x40) p1_gekko |= 0x40;  // button3
-            if (p1_input & 0x80) p1_gekko |= 0x80;  // button4
-            
-            if (p2_input & 0x01) p2_gekko |= 0x01;  // left
-            if (p2_input & 0x02) p2_gekko |= 0x02;  // right
-            if (p2_input & 0x04) p2_gekko |= 0x04;  // up
-            if (p2_input & 0x08) p2_gekko |= 0x08;  // down
-            if (p2_input & 0x10) p2_gekko |= 0x10;  // button1
-            if (p2_input & 0x20) p2_gekko |= 0x20;  // button2
-            if (p2_input & 0x40) p2_gekko |= 0x40;  // button3
-            if (p2_input & 0x80) p2_gekko |= 0x80;  // button4
+            if (is_online_mode) {
+                UpdateInputDelay();
+            }
+            rolled_back_this_frame = false;
             
             // Add inputs to GekkoNet session based on valid player handles and input data
             if (p1_handle >= 0 && p1_input_valid) {
-                gekko_add_local_input(gekko_session, p1_handle, &p1_gekko);
+                gekko_add_local_input(gekko_session, p1_handle, p1_wire);
             }
             if (p2_handle >= 0 && p2_input_valid) {
-                gekko_add_local_input(gekko_session, p2_handle, &p2_gekko);
+                gekko_add_local_input(gekko_session, p2_handle, p2_wire);
             }
             
-            // Save current state before processing GekkoNet updates
-            if (state_manager_initialized && (g_frame_counter % 1) == 0) {  // Save every frame
-                SaveStateToBuffer(g_frame_counter);
-            }
+            // Fill a save GekkoNet asked for while this frame was still owed
+            SaveCheckpoint(engine_frame);
             
             // Process GekkoNet updates after adding inputs
             int update_count = 0;
@@ -505,26 +1028,50 @@ int __cdecl Hook_ProcessGameInputs() {
                     }
                     
                     if (update->type == LoadEvent) {
-                        // Rollback to specific frame
-                        uint32_t target_frame = update->data.load.frame;
-                        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "GekkoNet: Rollback to frame %u (current: %u)", target_frame, g_frame_counter);
-                        
-                        if (state_manager_initialized && target_frame <= g_frame_counter) {
-                            if (!LoadStateFromBuffer(target_frame)) {
-                                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "GekkoNet: Failed to load state for frame %u", target_frame);
-                            }
-                        } else {
-                            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "GekkoNet: Invalid rollback target frame %u", target_frame);
-                        }
+                        i = HandleRollback(updates, i, update_count);
+                    } else if (update->type == SaveEvent) {
+                        HandleSaveEvent(update);
+                    } else if (update->type == AdvanceEvent) {
+                        // Every advance carries both players' inputs, the
+                        // remote one's included; none may be dropped
+                        QueueAdvance(update);
                     }
                 }
             }
             
+            // Spend this frame's budget on owed frames; the engine then runs
+            // and draws the next one on its advance's inputs, at reduced
+            // fidelity while still behind. Without a rollback that is just
+            // this update's live advance.
+            if (rollback_budget.Backlog() > 0) {
+                uint64_t catchup_us = RunCatchUp();
+                auto next = rollback_budget.Pop();
+                engine_frame_advanced = true;
+                engine_frame = next.frame;
+                engine_inputs_override = next.has_inputs != 0;
+                engine_p1 = next.p1;
+                engine_p2 = next.p2;
+                
+                bool behind = rollback_budget.Backlog() > 0;
+                if (behind) rollback_budget.CountSpreadFrame();
+                FM2K::Render::SetReducedFidelity(behind);
+                
+                if (current_rollback.active) {
+                    rollback_timings.Record(current_rollback.depth, current_rollback.restore_us,
+                                            current_rollback.replay_us + catchup_us);
+                    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "GekkoNet: Rolled back %u frames, %u still owed",
+                                current_rollback.depth, rollback_budget.Backlog());
+                }
+            } else {
+                FM2K::Render::SetReducedFidelity(false);
+            }
+            current_rollback.active = false;
+            
             // Log successful input processing occasionally
             if (g_frame_counter % 100 == 0) {
-                SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "GekkoNet: Frame %u - P1: 0x%08X->0x%02X (%s), P2: 0x%08X->0x%02X (%s), Updates: %d", 
-                         g_frame_counter, p1_input, p1_gekko, p1_input_valid ? "valid" : "invalid", 
-                         p2_input, p2_gekko, p2_input_valid ? "valid" : "invalid", update_count);
+                SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "GekkoNet: Frame %u - P1: 0x%08X->0x%03X (%s), P2: 0x%08X->0x%03X (%s), Updates: %d", 
+                         g_frame_counter, p1_input, FM2K::LoadWireInput(p1_wire, 0), p1_input_valid ? "valid" : "invalid", 
+                         p2_input, FM2K::LoadWireInput(p2_wire, 0), p2_input_valid ? "valid" : "invalid", update_count);
             }
         } else {
             // No valid inputs - still need to update GekkoNet
@@ -539,11 +1086,31 @@ int __cdecl Hook_ProcessGameInputs() {
         }
     }
     
+    // Nothing confirmed to run: the game stays at the start of engine_frame
+    // until GekkoNet advances it
+    if (gekko_initialized && gekko_session && !engine_frame_advanced) {
+        engine_frame_skipped = true;
+        return 0;
+    }
+    
+    // The game sits at the start of the frame the engine is about to run
+    next_engine_frame = engine_frame + 1;
+    StageReplayKeyframe(engine_frame);
+    
     // Call original function
     int result = 0;
+    uint32_t input_index = Fields::INPUT_INDEX.Ref();
     if (original_process_inputs) {
         result = original_process_inputs();
     }
+    if (engine_inputs_override) {
+        OverridePolledInputs(input_index, engine_p1, engine_p2);
+    } else if (input_sampled) {
+        // A slot the sampler does not own keeps what the engine just polled
+        uint32_t p1 = (input_sampled & FM2K::LOCAL_PLAYER_1) ? p1_input : Fields::P1_INPUT.Ref();
+        uint32_t p2 = (input_sampled & FM2K::LOCAL_PLAYER_2) ? p2_input : Fields::P2_INPUT.Ref();
+        OverridePolledInputs(input_index, p1, p2);
+    }
     
     return result;
 }
@@ -551,6 +1118,88 @@ int __cdecl Hook_ProcessGameInputs() {
 int __cdecl Hook_UpdateGameState() {
     //SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: update_game_state called!");
     
+    // Hook_ProcessGameInputs held this frame back for GekkoNet
+    if (engine_frame_skipped) {
+        return 0;
+    }
+    
+    FM2K::State::BeginHeapFrame();
+    FM2K::Render::BeginRenderFrame();
+    LogFrameInputs(engine_frame);
+    RecordReplayFrames();
+    checkpoint_policy.EndFrame(checkpoint_agreement.IntervalAt(engine_frame));
+    if (state_manager_initialized && g_frame_counter % 600 == 0) {
+        auto stats = state_buffers.GetStats();
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: GekkoNet state buffers - %u/%u seen, %u holding captures, %llu saves requested, %llu captured, %llu overwrites, %llu loads, %llu stale hits, %llu misses, %llu refused",
+                    (unsigned)stats.buffers, (unsigned)stats.capacity, (unsigned)stats.occupancy, (unsigned long long)stats.binds,
+                    (unsigned long long)stats.captures, (unsigned long long)stats.overwrites, (unsigned long long)stats.loads,
+                    (unsigned long long)stats.stale_hits, (unsigned long long)stats.misses, (unsigned long long)stats.overflows);
+    }
+    if (FM2K::State::HeapHooksActive() && g_frame_counter % 600 == 0) {
+        auto stats = FM2K::State::GetHeapArenaStats();
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Heap arena - live %u B (peak %u B), high water %u/%u B, last frame +%u/-%u allocs, %u failures, %u stale frees",
+                    (unsigned)stats.bytes_live, (unsigned)stats.bytes_peak, (unsigned)stats.high_water, (unsigned)stats.capacity,
+                    stats.frame_allocations, stats.frame_frees, (unsigned)stats.failures, (unsigned)stats.stale);
+    }
+    if (state_manager_initialized && g_frame_counter % 600 == 0) {
+        auto stats = checkpoint_policy.GetStats();
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Checkpoints every %u frames, %u preferred (save %.0f us, replay %.0f us/frame, %.3f rollbacks/frame) - per-frame cost every-frame %.1f us over %llu frames, checkpointed %.1f us over %llu frames",
+                    checkpoint_agreement.IntervalAt(engine_frame), stats.interval, stats.save_us, stats.frame_us, stats.rollbacks_per_frame,
+                    stats.every_frame.frames ? (double)stats.every_frame.overhead_us / stats.every_frame.frames : 0.0,
+                    (unsigned long long)stats.every_frame.frames,
+                    stats.checkpointed.frames ? (double)stats.checkpointed.overhead_us / stats.checkpointed.frames : 0.0,
+                    (unsigned long long)stats.checkpointed.frames);
+    }
+    if (gekko_initialized && g_frame_counter % 600 == 0) {
+        auto stats = input_ledger.GetStats();
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Rollbacks - %llu requested, %llu executed (%llu unverifiable), %llu elided",
+                    (unsigned long long)stats.requested, (unsigned long long)stats.executed,
+                    (unsigned long long)stats.unverifiable, (unsigned long long)stats.elided);
+    }
+    if (rollback_timings.TotalRollbacks() > 0 && g_frame_counter % 600 == 0) {
+        auto stats = rollback_budget.GetStats();
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Catch-up - %llu rollbacks, %llu over budget and spread (%llu frames drawn behind, max backlog %u), %llu updates over budget, %llu forced, %.0f us/frame",
+                    (unsigned long long)stats.catchups, (unsigned long long)stats.overruns, (unsigned long long)stats.spread_frames,
+                    stats.max_backlog, (unsigned long long)stats.over_budget, (unsigned long long)stats.forced, stats.frame_us);
+
+        for (uint32_t depth = 1; depth <= FM2K::State::MAX_TIMED_ROLLBACK_DEPTH; depth++) {
+            const auto& timing = rollback_timings.Get(depth);
+            if (timing.count == 0) continue;
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Rollback depth %2u%s - %llu times, avg %llu us (restore %llu, fast-forward %llu), max %llu us, %llu over budget",
+                        depth, depth == FM2K::State::MAX_TIMED_ROLLBACK_DEPTH ? "+" : "", (unsigned long long)timing.count,
+                        (unsigned long long)((timing.restore_us + timing.fastforward_us) / timing.count),
+                        (unsigned long long)(timing.restore_us / timing.count), (unsigned long long)(timing.fastforward_us / timing.count),
+                        (unsigned long long)timing.max_total_us, (unsigned long long)timing.over_budget);
+        }
+    }
+    if (is_online_mode && g_frame_counter % 600 == 0) {
+        auto stats = frame_pacer.GetStats();
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Pacer - period x%.4f, error p50 %u us / p99 %u us / max %u us, %llu late, %llu resyncs",
+                    stats.scale, stats.error_p50_us, stats.error_p99_us, stats.error_max_us,
+                    (unsigned long long)stats.late_wakes, (unsigned long long)stats.resyncs);
+    }
+    if (replay_started && g_frame_counter % 600 == 0) {
+        auto stats = replay_recorder.GetStats();
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Replay - %u frames written, %llu keyframes (%llu dropped, %.1fx compressed), %llu bytes, queue max %u%s",
+                    stats.frames, (unsigned long long)stats.keyframes_written, (unsigned long long)stats.keyframes_dropped,
+                    stats.keyframe_encoded_bytes ? (double)stats.keyframe_raw_bytes / stats.keyframe_encoded_bytes : 0.0,
+                    (unsigned long long)stats.bytes_written, stats.max_queued, stats.failed ? ", FAILED" : "");
+    }
+    if (input_sampler.Running() && g_frame_counter % 600 == 0) {
+        auto stats = input_sampler.GetStats();
+        auto latency = input_latency.GetStats();
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Input sampler - %llu samples (%llu dropped), %u gamepads, latency p50 %u us / p99 %u us / max %u us over %llu frames",
+                    (unsigned long long)stats.samples, (unsigned long long)stats.dropped, stats.gamepads,
+                    latency.p50_us, latency.p99_us, latency.max_us, (unsigned long long)latency.samples);
+    }
+    if (FM2K::Render::RenderHooksActive() && g_frame_counter % 600 == 0) {
+        auto stats = FM2K::Render::GetRenderStats();
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Render - %llu frames drawn (avg %.0f us), %llu suppressed, %.1f ms saved (%llu blits, %llu sprites, %llu presents skipped)",
+                    (unsigned long long)stats.frames_rendered, stats.avg_render_us, (unsigned long long)stats.frames_suppressed,
+                    stats.render_us_saved / 1000.0, (unsigned long long)stats.blits_skipped,
+                    (unsigned long long)stats.sprites_skipped, (unsigned long long)stats.presents_skipped);
+    }
+    
     // Call original function
     int result = 0;
     if (original_update_game) {
@@ -609,6 +1258,26 @@ bool InitializeHooks() {
         return false;
     }
     
+    // Serve the game's heap from the rollback arena (non-fatal: static regions still roll back)
+    if (!FM2K::State::InstallHeapHooks()) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Heap hooks not installed, dynamic allocations will not roll back");
+    } else {
+        // Headroom now, so the first saves don't grow buffers on the game
+        // thread; they grow again only as the arena's high-water mark does
+        size_t reserved = 0;
+        for (auto& saved : saved_arenas) {
+            FM2K::State::ReserveHeapArenaSnapshot(saved);
+            reserved += saved.capacity();
+        }
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Reserved %u KB of heap arena snapshots (%u buffers)",
+                    (unsigned)(reserved / 1024), (unsigned)STATE_BUFFER_SLOTS);
+    }
+    
+    // Skip drawing on resimulated frames (non-fatal: resims just cost a full render)
+    if (!FM2K::Render::InstallRenderHooks()) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Render hooks not installed, resimulated frames will still draw");
+    }
+    
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "SUCCESS FM2K HOOK: All hooks installed successfully!");
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "   - Input processing hook at 0x%08X", PROCESS_INPUTS_ADDR);
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "   - Game state update hook at 0x%08X", UPDATE_GAME_ADDR);
@@ -660,6 +1329,32 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserv
                 fclose(log);
             }
             
+            // Replay recording starts with the first frame once the state plan is up
+            if (GetEnvironmentVariableA("FM2K_REPLAY_RECORD", replay_path, sizeof(replay_path)) >= sizeof(replay_path)) {
+                replay_path[0] = '\0';
+            }
+            
+            // The input sampler starts from the first hooked frame, once the game has its window
+            char sampler_hz[16] = {};
+            DWORD sampler_len = GetEnvironmentVariableA("FM2K_INPUT_SAMPLER", sampler_hz, sizeof(sampler_hz));
+            if (sampler_len > 0 && sampler_len < sizeof(sampler_hz)) {
+                input_sampler_hz = (uint32_t)strtoul(sampler_hz, nullptr, 10);
+                if (input_sampler_hz == 0) input_sampler_hz = FM2K::InputSampler::DEFAULT_POLL_HZ;
+            }
+            char sampler_keys[128] = {};
+            DWORD keys_len = GetEnvironmentVariableA("FM2K_INPUT_KEYS", sampler_keys, sizeof(sampler_keys));
+            if (keys_len > 0 && keys_len < sizeof(sampler_keys) && !input_bindings.ParseKeys(sampler_keys)) {
+                SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Ignoring FM2K_INPUT_KEYS \"%s\", keeping default keys", sampler_keys);
+            }
+            
+            char checksum_mode[16] = {};
+            DWORD mode_len = GetEnvironmentVariableA("FM2K_DESYNC_CHECKSUM", checksum_mode, sizeof(checksum_mode));
+            if (mode_len > 0 && mode_len < sizeof(checksum_mode) &&
+                !FM2K::Checksum::ParseMode(checksum_mode, &desync_checksum_mode)) {
+                SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Ignoring FM2K_DESYNC_CHECKSUM \"%s\", keeping %s",
+                            checksum_mode, FM2K::Checksum::ModeName(desync_checksum_mode));
+            }
+            
             // Initialize shared memory for configuration
             SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Initializing shared memory...");
             if (!InitializeSharedMemory()) {
@@ -726,9 +1421,9 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserv
         }
         
         // Cleanup shared memory
-        if (shared_memory_data) {
-            UnmapViewOfFile(shared_memory_data);
-            shared_memory_data = nullptr;
+        if (shared_control) {
+            UnmapViewOfFile(shared_control);
+            shared_control = nullptr;
         }
         if (shared_memory_handle) {
             CloseHandle(shared_memory_handle);
@@ -736,6 +1431,15 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserv
         }
         
         ShutdownHooks();
+        
+        // The writer cannot be joined under the loader lock; the replay file
+        // is complete up to its last flush
+        replay_recorder.Abandon();
+        input_sampler.Abandon();
+        
+        // Drop write protection before the game tears down its memory
+        snapshot_ring.Shutdown();
+        state_buffers.Clear();
         break;
     }
     return TRUE;
@@ -0,0 +1,108 @@
+#include "frame_pacer.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace FM2K {
+
+uint64_t SteadyPacerClock::NowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void SteadyPacerClock::SleepNs(uint64_t ns) {
+    std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+}
+
+void FramePacer::Reset() {
+    started_ = false;
+    deadline_ns_ = 0;
+    last_wake_ns_ = 0;
+    last_period_ns_ = 0;
+    integral_ = 0.0;
+    scale_ = 1.0;
+    frames_ = 0;
+    resyncs_ = 0;
+    late_wakes_ = 0;
+    error_max_us_ = 0;
+    error_samples_ = 0;
+    std::fill(error_histogram_, error_histogram_ + ERROR_HISTOGRAM_US, 0u);
+}
+
+uint64_t FramePacer::NextPeriod(float frames_ahead) {
+    // GekkoNet reports garbage before the session has synced
+    double error = (frames_ahead > -1000.0f && frames_ahead < 1000.0f) ? frames_ahead : 0.0;
+
+    integral_ = std::clamp(integral_ * config_.integral_decay + error, -config_.integral_limit, config_.integral_limit);
+    scale_ = std::clamp(1.0 + config_.kp * error + config_.ki * integral_, config_.min_scale, config_.max_scale);
+    return static_cast<uint64_t>(static_cast<double>(config_.frame_ns) * scale_);
+}
+
+void FramePacer::Wait(float frames_ahead) {
+    uint64_t period = NextPeriod(frames_ahead);
+    uint64_t now = clock_.NowNs();
+
+    if (!started_) {
+        started_ = true;
+        deadline_ns_ = now;
+        last_wake_ns_ = now;
+        last_period_ns_ = period;
+        return;
+    }
+
+    deadline_ns_ += period;
+    if (now > deadline_ns_ + config_.resync_ns) {
+        // Stalled (debugger, window drag, load): catching up would fast-forward the game
+        deadline_ns_ = now;
+        resyncs_++;
+    } else if (now >= deadline_ns_) {
+        late_wakes_++;
+    } else {
+        if (deadline_ns_ - now > config_.spin_ns) {
+            clock_.SleepNs(deadline_ns_ - now - config_.spin_ns);
+        }
+        while ((now = clock_.NowNs()) < deadline_ns_) {
+        }
+    }
+
+    RecordError(now - last_wake_ns_, last_period_ns_);
+    last_wake_ns_ = now;
+    last_period_ns_ = period;
+    frames_++;
+}
+
+void FramePacer::RecordError(uint64_t actual_ns, uint64_t target_ns) {
+    uint64_t error_ns = actual_ns > target_ns ? actual_ns - target_ns : target_ns - actual_ns;
+    uint64_t error_us = error_ns / 1000;
+    if (error_us > error_max_us_) error_max_us_ = static_cast<uint32_t>(std::min<uint64_t>(error_us, UINT32_MAX));
+    error_histogram_[std::min<uint64_t>(error_us, ERROR_HISTOGRAM_US - 1)]++;
+    error_samples_++;
+}
+
+uint32_t FramePacer::ErrorPercentile(double percentile) const {
+    if (error_samples_ == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(static_cast<double>(error_samples_) * percentile / 100.0);
+    if (rank >= error_samples_) rank = error_samples_ - 1;
+
+    uint64_t seen = 0;
+    for (size_t us = 0; us < ERROR_HISTOGRAM_US; ++us) {
+        seen += error_histogram_[us];
+        if (seen > rank) return static_cast<uint32_t>(us);
+    }
+    return ERROR_HISTOGRAM_US - 1;
+}
+
+FramePacer::Stats FramePacer::GetStats() const {
+    Stats stats = {};
+    stats.frames = frames_;
+    stats.resyncs = resyncs_;
+    stats.late_wakes = late_wakes_;
+    stats.scale = scale_;
+    stats.integral = integral_;
+    stats.error_p50_us = ErrorPercentile(50.0);
+    stats.error_p99_us = ErrorPercentile(99.0);
+    stats.error_max_us = error_max_us_;
+    return stats;
+}
+
+} // namespace FM2K
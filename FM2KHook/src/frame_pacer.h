@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FM2K {
+
+// Time source for FramePacer. NowNs must be monotonic; it is polled in a tight
+// loop during the spin phase, so a fake clock should advance on every call.
+class PacerClock {
+public:
+    virtual ~PacerClock() = default;
+    virtual uint64_t NowNs() = 0;
+    virtual void SleepNs(uint64_t ns) = 0;
+};
+
+// std::chrono::steady_clock plus a thread sleep
+class SteadyPacerClock : public PacerClock {
+public:
+    uint64_t NowNs() override;
+    void SleepNs(uint64_t ns) override;
+};
+
+// Paces a fixed-rate loop against absolute deadlines, so wake-up error never
+// accumulates into drift. Each wait sleeps until shortly before the deadline
+// (OS sleeps overshoot by up to a scheduler tick) and spins the rest.
+//
+// The period is stretched continuously by a PI controller on frames ahead of
+// the remote peer: being ahead slows the loop until the peer catches up,
+// bounded to [min_scale, max_scale] of the nominal period.
+class FramePacer {
+public:
+    struct Config {
+        uint64_t frame_ns = 10000000;        // 100 FPS
+        uint64_t spin_ns = 2000000;          // Spin instead of sleeping this close to the deadline
+        uint64_t resync_ns = 50000000;       // Further behind than this, restart from now instead of catching up
+        double kp = 0.02;                    // Period stretch per frame ahead
+        double ki = 0.002;                   // Period stretch per frame-ahead per frame, accumulated
+        double integral_limit = 10.0;        // Frame-ahead-frames
+        double integral_decay = 0.98;        // Per frame, so a settled peer stops stretching
+        double min_scale = 1.0;
+        double max_scale = 1.05;
+    };
+
+    // Absolute error between the measured and the requested period
+    static constexpr size_t ERROR_HISTOGRAM_US = 2048;
+
+    struct Stats {
+        uint64_t frames;
+        uint64_t resyncs;
+        uint64_t late_wakes;                 // Already past the deadline when the wait began
+        double scale;                        // Last period / nominal period
+        double integral;
+        uint32_t error_p50_us;
+        uint32_t error_p99_us;
+        uint32_t error_max_us;
+    };
+
+    explicit FramePacer(PacerClock& clock) : clock_(clock) {}
+    FramePacer(PacerClock& clock, const Config& config) : clock_(clock), config_(config) {}
+
+    void Reset();
+
+    // Period for the next frame; advances the controller
+    uint64_t NextPeriod(float frames_ahead);
+
+    // Block until the next frame is due. The first call only starts the clock.
+    void Wait(float frames_ahead);
+
+    // Error at `percentile` (0-100) in microseconds; the last bucket also
+    // counts every error past ERROR_HISTOGRAM_US
+    uint32_t ErrorPercentile(double percentile) const;
+    Stats GetStats() const;
+
+private:
+    void RecordError(uint64_t actual_ns, uint64_t target_ns);
+
+    PacerClock& clock_;
+    Config config_;
+
+    bool started_ = false;
+    uint64_t deadline_ns_ = 0;
+    uint64_t last_wake_ns_ = 0;
+    uint64_t last_period_ns_ = 0;
+    double integral_ = 0.0;
+    double scale_ = 1.0;
+
+    uint64_t frames_ = 0;
+    uint64_t resyncs_ = 0;
+    uint64_t late_wakes_ = 0;
+    uint32_t error_max_us_ = 0;
+    uint64_t error_samples_ = 0;
+    uint32_t error_histogram_[ERROR_HISTOGRAM_US] = {};
+};
+
+} // namespace FM2K
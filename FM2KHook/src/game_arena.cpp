@@ -0,0 +1,223 @@
+#include "game_arena.h"
+#include <algorithm>
+#include <cstring>
+
+namespace FM2K {
+namespace State {
+
+namespace {
+constexpr uint32_t ARENA_MAGIC = 0x414E5241;   // 'ARNA'
+constexpr uint32_t BLOCK_MAGIC = 0xB10CB10C;
+}
+
+bool GameArena::Init(uint8_t* memory, size_t capacity) {
+    // Offsets are stored as uint32, and the base must keep blocks aligned
+    if (!memory || capacity < ALIGNMENT * 2 || capacity > UINT32_MAX ||
+        reinterpret_cast<uintptr_t>(memory) % ALIGNMENT != 0) {
+        return false;
+    }
+    memory_ = memory;
+    capacity_ = capacity;
+    Reset();
+    return true;
+}
+
+void GameArena::Reset() {
+    layout_ = {};
+    layout_.magic = ARENA_MAGIC;
+    bytes_peak_ = 0;
+    allocations_ = frees_ = failures_ = stale_ = 0;
+    frame_allocations_ = last_frame_allocations_ = 0;
+    frame_frees_ = last_frame_frees_ = 0;
+    frame_bytes_allocated_ = last_frame_bytes_allocated_ = 0;
+    frame_bytes_freed_ = last_frame_bytes_freed_ = 0;
+}
+
+size_t GameArena::ClassFor(size_t block_size) {
+    size_t size_class = 0;
+    while (size_class < CLASS_COUNT && ClassSize(size_class) < block_size) {
+        size_class++;
+    }
+    return size_class;
+}
+
+GameArena::BlockHeader* GameArena::HeaderOf(const void* ptr) const {
+    return reinterpret_cast<BlockHeader*>(const_cast<uint8_t*>(static_cast<const uint8_t*>(ptr)) - sizeof(BlockHeader));
+}
+
+void* GameArena::Allocate(size_t size) {
+    if (!memory_) return nullptr;
+
+    size_t block_size = std::max(size, size_t(1)) + sizeof(BlockHeader);
+    size_t size_class = ClassFor(block_size);
+    if (size_class >= CLASS_COUNT || size > UINT32_MAX) {
+        failures_++;
+        return nullptr;
+    }
+
+    uint32_t offset;
+    uint32_t& head = layout_.free_heads[size_class];
+    if (head != 0) {
+        offset = head - 1;
+        uint32_t next;
+        std::memcpy(&next, memory_ + offset + sizeof(BlockHeader), sizeof(next));
+        head = next;
+    } else {
+        size_t class_size = ClassSize(size_class);
+        if (class_size > capacity_ - layout_.bump) {
+            failures_++;
+            return nullptr;
+        }
+        offset = layout_.bump;
+        layout_.bump += static_cast<uint32_t>(class_size);
+    }
+
+    BlockHeader* header = reinterpret_cast<BlockHeader*>(memory_ + offset);
+    header->size_class = static_cast<uint32_t>(size_class);
+    header->requested = static_cast<uint32_t>(size);
+    header->magic = BLOCK_MAGIC;
+    header->reserved = 0;
+
+    layout_.bytes_live += static_cast<uint32_t>(size);
+    layout_.bytes_reserved += static_cast<uint32_t>(ClassSize(size_class));
+    bytes_peak_ = std::max<size_t>(bytes_peak_, layout_.bytes_live);
+    allocations_++;
+    frame_allocations_++;
+    frame_bytes_allocated_ += size;
+    return header + 1;
+}
+
+void GameArena::Free(void* ptr) {
+    if (!ptr || !Owns(ptr)) return;
+    if (!IsLive(ptr)) {     // Double free, not a block start, or rewound past by a load
+        stale_++;
+        return;
+    }
+
+    BlockHeader* header = HeaderOf(ptr);
+    uint32_t offset = static_cast<uint32_t>(reinterpret_cast<uint8_t*>(header) - memory_);
+    size_t size_class = header->size_class;
+
+    layout_.bytes_live -= header->requested;
+    layout_.bytes_reserved -= static_cast<uint32_t>(ClassSize(size_class));
+    frees_++;
+    frame_frees_++;
+    frame_bytes_freed_ += header->requested;
+
+    header->magic = 0;
+    uint32_t next = layout_.free_heads[size_class];
+    std::memcpy(ptr, &next, sizeof(next));
+    layout_.free_heads[size_class] = offset + 1;
+}
+
+void* GameArena::Reallocate(void* ptr, size_t size) {
+    if (!ptr) return Allocate(size);
+    if (!Owns(ptr)) return nullptr;
+    if (!IsLive(ptr)) {
+        stale_++;
+        return nullptr;
+    }
+
+    BlockHeader* header = HeaderOf(ptr);
+    if (size <= BlockCapacity(ptr)) {
+        layout_.bytes_live = layout_.bytes_live - header->requested + static_cast<uint32_t>(size);
+        bytes_peak_ = std::max<size_t>(bytes_peak_, layout_.bytes_live);
+        header->requested = static_cast<uint32_t>(size);
+        return ptr;
+    }
+
+    void* moved = Allocate(size);
+    if (!moved) return nullptr;
+    std::memcpy(moved, ptr, header->requested);
+    Free(ptr);
+    return moved;
+}
+
+bool GameArena::Owns(const void* ptr) const {
+    const uint8_t* p = static_cast<const uint8_t*>(ptr);
+    return memory_ && p >= memory_ && p < memory_ + capacity_;
+}
+
+bool GameArena::IsLive(const void* ptr) const {
+    if (!Owns(ptr)) return false;
+    size_t offset = static_cast<size_t>(static_cast<const uint8_t*>(ptr) - memory_);
+    if (offset < sizeof(BlockHeader) || offset % ALIGNMENT != 0 || offset >= layout_.bump) return false;
+    const BlockHeader* header = HeaderOf(ptr);
+    return header->magic == BLOCK_MAGIC && header->size_class < CLASS_COUNT &&
+           offset - sizeof(BlockHeader) + ClassSize(header->size_class) <= layout_.bump;
+}
+
+size_t GameArena::AllocationSize(const void* ptr) const {
+    return IsLive(ptr) ? HeaderOf(ptr)->requested : 0;
+}
+
+size_t GameArena::BlockCapacity(const void* ptr) const {
+    return IsLive(ptr) ? ClassSize(HeaderOf(ptr)->size_class) - sizeof(BlockHeader) : 0;
+}
+
+void GameArena::BeginFrame() {
+    last_frame_allocations_ = frame_allocations_;
+    last_frame_frees_ = frame_frees_;
+    last_frame_bytes_allocated_ = frame_bytes_allocated_;
+    last_frame_bytes_freed_ = frame_bytes_freed_;
+    frame_allocations_ = frame_frees_ = 0;
+    frame_bytes_allocated_ = frame_bytes_freed_ = 0;
+}
+
+size_t GameArena::SnapshotSize() const {
+    return sizeof(Layout) + layout_.bump;
+}
+
+size_t GameArena::MaxSnapshotSize() const {
+    return sizeof(Layout) + capacity_;
+}
+
+size_t GameArena::Save(uint8_t* out, size_t capacity) const {
+    size_t size = SnapshotSize();
+    if (!memory_ || !out || capacity < size) return 0;
+
+    std::memcpy(out, &layout_, sizeof(Layout));
+    std::memcpy(out + sizeof(Layout), memory_, layout_.bump);
+    return size;
+}
+
+bool GameArena::Load(const uint8_t* in, size_t size) {
+    if (!memory_ || !in || size < sizeof(Layout)) return false;
+
+    Layout saved;
+    std::memcpy(&saved, in, sizeof(Layout));
+    if (saved.magic != ARENA_MAGIC || saved.bump > capacity_ || size < sizeof(Layout) + saved.bump) {
+        return false;
+    }
+
+    // Bytes past the saved bump are unreachable once the layout is restored;
+    // wiping what was carved out since keeps their stale headers from
+    // passing for live blocks if the game still holds pointers to them
+    std::memcpy(memory_, in + sizeof(Layout), saved.bump);
+    if (layout_.bump > saved.bump) {
+        std::memset(memory_ + saved.bump, 0, layout_.bump - saved.bump);
+    }
+    layout_ = saved;
+    return true;
+}
+
+GameArena::Stats GameArena::GetStats() const {
+    Stats stats = {};
+    stats.bytes_live = layout_.bytes_live;
+    stats.bytes_peak = bytes_peak_;
+    stats.bytes_reserved = layout_.bytes_reserved;
+    stats.high_water = layout_.bump;
+    stats.capacity = capacity_;
+    stats.allocations = allocations_;
+    stats.frees = frees_;
+    stats.failures = failures_;
+    stats.stale = stale_;
+    stats.frame_allocations = last_frame_allocations_;
+    stats.frame_frees = last_frame_frees_;
+    stats.frame_bytes_allocated = last_frame_bytes_allocated_;
+    stats.frame_bytes_freed = last_frame_bytes_freed_;
+    return stats;
+}
+
+} // namespace State
+} // namespace FM2K
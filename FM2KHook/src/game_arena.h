@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FM2K {
+namespace State {
+
+// Size-class arena that serves the game's heap allocations from one fixed
+// block of memory, so every dynamic object is covered by a single memcpy of
+// [base, high-water mark). Blocks are power-of-two classes from 16 bytes up;
+// freed blocks go onto per-class free lists threaded through the arena itself,
+// so the allocator metadata that has to roll back is a few dozen words.
+//
+// A load rewinds the arena, so a pointer the game kept outside the saved
+// state can name a block that no longer exists there. Ownership is decided
+// by the arena's whole fixed range, never the current bump, so such a
+// pointer is still recognised as the arena's and is never handed to the
+// real heap; freeing or resizing it is refused and counted as stale, and
+// Load clears the block headers it rewinds past so none of them look live.
+//
+// Platform-neutral and not thread-safe: the caller provides the memory and
+// any locking (see heap_hooks.cpp).
+class GameArena {
+public:
+    static constexpr size_t ALIGNMENT = 16;
+    static constexpr size_t MIN_CLASS_SHIFT = 4;     // 16-byte smallest block
+    static constexpr size_t CLASS_COUNT = 24;        // Up to 128 MB per block
+
+    struct Stats {
+        size_t bytes_live;           // Requested bytes currently allocated
+        size_t bytes_peak;           // Highest bytes_live seen
+        size_t bytes_reserved;       // Block bytes (headers and class rounding included) currently allocated
+        size_t high_water;           // Bump offset, i.e. bytes a snapshot has to copy
+        size_t capacity;
+        uint64_t allocations;
+        uint64_t frees;
+        uint64_t failures;           // Requests the arena could not satisfy
+        uint64_t stale;              // Frees/resizes of arena pointers that were not live blocks
+        // Churn during the last completed frame (see BeginFrame)
+        uint32_t frame_allocations;
+        uint32_t frame_frees;
+        size_t frame_bytes_allocated;
+        size_t frame_bytes_freed;
+    };
+
+    GameArena() = default;
+
+    // `memory` must stay valid and fixed in place for the arena's lifetime
+    bool Init(uint8_t* memory, size_t capacity);
+    void Reset();
+
+    void* Allocate(size_t size);
+    void Free(void* ptr);
+    // Grows in place when the block's class still fits; nullptr leaves `ptr` untouched
+    void* Reallocate(void* ptr, size_t size);
+
+    // Anywhere in the arena's memory, live block or not
+    bool Owns(const void* ptr) const;
+    // An allocated block's start at the current layout
+    bool IsLive(const void* ptr) const;
+    size_t AllocationSize(const void* ptr) const;  // Requested size of a live block, else 0
+    size_t BlockCapacity(const void* ptr) const;   // Usable bytes of a live block, else 0
+
+    // Closes the current frame's churn counters
+    void BeginFrame();
+
+    // Snapshot: allocator metadata followed by the arena bytes up to the
+    // high-water mark. Load rewinds the arena to exactly the saved layout.
+    size_t SnapshotSize() const;
+    size_t MaxSnapshotSize() const;
+    size_t Save(uint8_t* out, size_t capacity) const;
+    bool Load(const uint8_t* in, size_t size);
+
+    uint8_t* Base() const { return memory_; }
+    size_t Capacity() const { return capacity_; }
+    Stats GetStats() const;
+
+private:
+    // Everything that has to roll back together with the arena bytes
+    struct Layout {
+        uint32_t magic;
+        uint32_t bump;                       // Offset of the first never-used byte
+        uint32_t bytes_live;
+        uint32_t bytes_reserved;
+        uint32_t free_heads[CLASS_COUNT];    // Block offset + 1, 0 = empty
+    };
+
+    struct BlockHeader {
+        uint32_t size_class;
+        uint32_t requested;
+        uint32_t magic;
+        uint32_t reserved;
+    };
+
+    static size_t ClassFor(size_t block_size);
+    static size_t ClassSize(size_t size_class) { return size_t(1) << (size_class + MIN_CLASS_SHIFT); }
+
+    BlockHeader* HeaderOf(const void* ptr) const;
+
+    uint8_t* memory_ = nullptr;
+    size_t capacity_ = 0;
+    Layout layout_ = {};
+
+    size_t bytes_peak_ = 0;
+    uint64_t allocations_ = 0;
+    uint64_t frees_ = 0;
+    uint64_t failures_ = 0;
+    uint64_t stale_ = 0;
+    uint32_t frame_allocations_ = 0, last_frame_allocations_ = 0;
+    uint32_t frame_frees_ = 0, last_frame_frees_ = 0;
+    size_t frame_bytes_allocated_ = 0, last_frame_bytes_allocated_ = 0;
+    size_t frame_bytes_freed_ = 0, last_frame_bytes_freed_ = 0;
+};
+
+} // namespace State
+} // namespace FM2K
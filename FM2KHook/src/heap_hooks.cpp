@@ -0,0 +1,206 @@
+#include "heap_hooks.h"
+#include <windows.h>
+#include <MinHook.h>
+#include <SDL3/SDL.h>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define FM2K_RETURN_ADDRESS() _ReturnAddress()
+#else
+#define FM2K_RETURN_ADDRESS() __builtin_return_address(0)
+#endif
+
+namespace FM2K {
+namespace State {
+
+namespace {
+
+typedef LPVOID (WINAPI *HeapAllocFn)(HANDLE, DWORD, SIZE_T);
+typedef BOOL (WINAPI *HeapFreeFn)(HANDLE, DWORD, LPVOID);
+typedef LPVOID (WINAPI *HeapReAllocFn)(HANDLE, DWORD, LPVOID, SIZE_T);
+typedef SIZE_T (WINAPI *HeapSizeFn)(HANDLE, DWORD, LPCVOID);
+
+HeapAllocFn original_heap_alloc = nullptr;
+HeapFreeFn original_heap_free = nullptr;
+HeapReAllocFn original_heap_realloc = nullptr;
+HeapSizeFn original_heap_size = nullptr;
+
+GameArena arena;
+CRITICAL_SECTION arena_lock;
+bool hooks_active = false;
+
+// Game image range; only calls returning into it are served from the arena
+uintptr_t game_image_start = 0;
+uintptr_t game_image_end = 0;
+
+struct ArenaLock {
+    ArenaLock() { EnterCriticalSection(&arena_lock); }
+    ~ArenaLock() { LeaveCriticalSection(&arena_lock); }
+};
+
+inline bool IsGameCaller(void* return_address) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(return_address);
+    return address >= game_image_start && address < game_image_end;
+}
+
+LPVOID WINAPI Hook_HeapAlloc(HANDLE heap, DWORD flags, SIZE_T size) {
+    if (IsGameCaller(FM2K_RETURN_ADDRESS())) {
+        ArenaLock lock;
+        void* block = arena.Allocate(size);
+        if (block) {
+            if (flags & HEAP_ZERO_MEMORY) std::memset(block, 0, size);
+            return block;
+        }
+        // Arena exhausted: fall through to the real heap (shows up as failures in the stats)
+    }
+    return original_heap_alloc(heap, flags, size);
+}
+
+BOOL WINAPI Hook_HeapFree(HANDLE heap, DWORD flags, LPVOID ptr) {
+    {
+        ArenaLock lock;
+        if (arena.Owns(ptr)) {
+            arena.Free(ptr);
+            return TRUE;
+        }
+    }
+    return original_heap_free(heap, flags, ptr);
+}
+
+LPVOID WINAPI Hook_HeapReAlloc(HANDLE heap, DWORD flags, LPVOID ptr, SIZE_T size) {
+    {
+        ArenaLock lock;
+        if (arena.Owns(ptr)) {
+            size_t old_size = arena.AllocationSize(ptr);
+            if ((flags & HEAP_REALLOC_IN_PLACE_ONLY) && size > arena.BlockCapacity(ptr)) {
+                return nullptr;
+            }
+            void* block = arena.Reallocate(ptr, size);
+            if (block && (flags & HEAP_ZERO_MEMORY) && size > old_size) {
+                std::memset(static_cast<uint8_t*>(block) + old_size, 0, size - old_size);
+            }
+            return block;
+        }
+    }
+    return original_heap_realloc(heap, flags, ptr, size);
+}
+
+SIZE_T WINAPI Hook_HeapSize(HANDLE heap, DWORD flags, LPCVOID ptr) {
+    {
+        ArenaLock lock;
+        if (arena.Owns(ptr)) {
+            return arena.AllocationSize(ptr);
+        }
+    }
+    return original_heap_size(heap, flags, ptr);
+}
+
+bool FindGameImage() {
+    HMODULE module = GetModuleHandleA(nullptr);
+    if (!module) return false;
+
+    const IMAGE_DOS_HEADER* dos = reinterpret_cast<const IMAGE_DOS_HEADER*>(module);
+    const IMAGE_NT_HEADERS* nt = reinterpret_cast<const IMAGE_NT_HEADERS*>(
+        reinterpret_cast<const uint8_t*>(module) + dos->e_lfanew);
+    game_image_start = reinterpret_cast<uintptr_t>(module);
+    game_image_end = game_image_start + nt->OptionalHeader.SizeOfImage;
+    return true;
+}
+
+// Creates the hook and queues it, so all four switch on together and no block
+// can land in the arena while its free is still unhooked
+bool QueueApiHook(const char* name, LPVOID detour, LPVOID* original) {
+    LPVOID target = nullptr;
+    MH_STATUS status = MH_CreateHookApiEx(L"kernel32", name, detour, original, &target);
+    if (status == MH_OK) {
+        status = MH_QueueEnableHook(target);
+    }
+    if (status != MH_OK) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Failed to hook %s: %d", name, status);
+        return false;
+    }
+    return true;
+}
+
+// Grows `out` past `size` by the headroom, only when it has to
+void GrowSnapshot(std::vector<uint8_t>& out, size_t size) {
+    if (out.capacity() < size) out.reserve(size + HEAP_ARENA_SNAPSHOT_HEADROOM);
+}
+
+} // anonymous namespace
+
+bool InstallHeapHooks(size_t arena_size) {
+    if (hooks_active) return true;
+
+    if (!FindGameImage()) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Could not locate the game image for heap hooks");
+        return false;
+    }
+
+    uint8_t* memory = static_cast<uint8_t*>(VirtualAlloc(nullptr, arena_size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    if (!memory || !arena.Init(memory, arena_size)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Failed to allocate %u byte heap arena", (unsigned)arena_size);
+        if (memory) VirtualFree(memory, 0, MEM_RELEASE);
+        return false;
+    }
+    InitializeCriticalSection(&arena_lock);
+
+    if (!QueueApiHook("HeapAlloc", (LPVOID)Hook_HeapAlloc, (LPVOID*)&original_heap_alloc) ||
+        !QueueApiHook("HeapFree", (LPVOID)Hook_HeapFree, (LPVOID*)&original_heap_free) ||
+        !QueueApiHook("HeapReAlloc", (LPVOID)Hook_HeapReAlloc, (LPVOID*)&original_heap_realloc) ||
+        !QueueApiHook("HeapSize", (LPVOID)Hook_HeapSize, (LPVOID*)&original_heap_size)) {
+        return false;
+    }
+
+    MH_STATUS status = MH_ApplyQueued();
+    if (status != MH_OK) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Failed to enable heap hooks: %d", status);
+        return false;
+    }
+
+    hooks_active = true;
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Heap arena active (%u KB, game image 0x%08X-0x%08X)",
+                (unsigned)(arena_size / 1024), (unsigned)game_image_start, (unsigned)game_image_end);
+    return true;
+}
+
+bool HeapHooksActive() {
+    return hooks_active;
+}
+
+void BeginHeapFrame() {
+    if (!hooks_active) return;
+    ArenaLock lock;
+    arena.BeginFrame();
+}
+
+void ReserveHeapArenaSnapshot(std::vector<uint8_t>& out) {
+    if (!hooks_active) return;
+    ArenaLock lock;
+    GrowSnapshot(out, arena.SnapshotSize());
+}
+
+bool SaveHeapArena(std::vector<uint8_t>& out) {
+    if (!hooks_active) return false;
+    ArenaLock lock;
+    size_t size = arena.SnapshotSize();
+    GrowSnapshot(out, size);
+    out.resize(size);
+    return arena.Save(out.data(), out.size()) != 0;
+}
+
+bool LoadHeapArena(const std::vector<uint8_t>& in) {
+    if (!hooks_active) return false;
+    ArenaLock lock;
+    return arena.Load(in.data(), in.size());
+}
+
+GameArena::Stats GetHeapArenaStats() {
+    if (!hooks_active) return GameArena::Stats{};
+    ArenaLock lock;
+    return arena.GetStats();
+}
+
+} // namespace State
+} // namespace FM2K
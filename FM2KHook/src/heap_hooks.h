@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "game_arena.h"
+
+namespace FM2K {
+namespace State {
+
+constexpr size_t DEFAULT_HEAP_ARENA_SIZE = 16 * 1024 * 1024;
+// Slack a snapshot buffer gets past the high-water mark whenever it grows
+constexpr size_t HEAP_ARENA_SNAPSHOT_HEADROOM = 256 * 1024;
+
+// Routes HeapAlloc/HeapFree/HeapReAlloc/HeapSize calls made from the game's
+// own image (its CRT malloc/new end up there) into a GameArena, so dynamic
+// game objects roll back with one copy. Calls from other modules (SDL,
+// GekkoNet, system DLLs) and blocks allocated before the hooks went in keep
+// using the real heap. Requires MH_Initialize to have been called.
+bool InstallHeapHooks(size_t arena_size = DEFAULT_HEAP_ARENA_SIZE);
+bool HeapHooksActive();
+
+// Start of a game frame: rolls the per-frame churn counters
+void BeginHeapFrame();
+
+// Arena snapshot (metadata + bytes up to the high-water mark). `out` only
+// grows, HEAP_ARENA_SNAPSHOT_HEADROOM past the mark at a time, so a reused
+// buffer reallocates a few times while the arena grows and then never.
+// ReserveHeapArenaSnapshot sizes one that way ahead of its first save.
+void ReserveHeapArenaSnapshot(std::vector<uint8_t>& out);
+bool SaveHeapArena(std::vector<uint8_t>& out);
+bool LoadHeapArena(const std::vector<uint8_t>& in);
+
+GameArena::Stats GetHeapArenaStats();
+
+} // namespace State
+} // namespace FM2K
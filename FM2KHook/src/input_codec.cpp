@@ -0,0 +1,136 @@
+#include "input_codec.h"
+#include <cstring>
+
+namespace FM2K {
+
+namespace {
+
+bool SingleBit(uint32_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+// LSB-first bit stream over a caller-owned buffer, a byte at a time
+class BitWriter {
+public:
+    BitWriter(uint8_t* out, size_t capacity) : out_(out), capacity_(capacity) {}
+
+    bool Write(uint32_t value, uint32_t bits) {
+        if (bytes_ + (pending_bits_ + bits + 7) / 8 > capacity_) return false;
+        pending_ |= static_cast<uint64_t>(value & ((1ull << bits) - 1)) << pending_bits_;
+        pending_bits_ += bits;
+        while (pending_bits_ >= 8) {
+            out_[bytes_++] = static_cast<uint8_t>(pending_);
+            pending_ >>= 8;
+            pending_bits_ -= 8;
+        }
+        return true;
+    }
+
+    // Flush the last partial byte; returns the bytes written
+    size_t Finish() {
+        if (pending_bits_ > 0) {
+            out_[bytes_++] = static_cast<uint8_t>(pending_);
+            pending_ = 0;
+            pending_bits_ = 0;
+        }
+        return bytes_;
+    }
+
+private:
+    uint8_t* out_;
+    size_t capacity_;
+    size_t bytes_ = 0;
+    uint64_t pending_ = 0;
+    uint32_t pending_bits_ = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    bool Read(uint32_t bits, uint32_t* value) {
+        while (pending_bits_ < bits) {
+            if (bytes_ == size_) return false;
+            pending_ |= static_cast<uint64_t>(data_[bytes_++]) << pending_bits_;
+            pending_bits_ += 8;
+        }
+        *value = static_cast<uint32_t>(pending_ & ((1ull << bits) - 1));
+        pending_ >>= bits;
+        pending_bits_ -= bits;
+        return true;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t bytes_ = 0;
+    uint64_t pending_ = 0;
+    uint32_t pending_bits_ = 0;
+};
+
+} // anonymous namespace
+
+InputCodec::InputCodec() {
+    Init(DEFAULT_INPUT_MAP);
+}
+
+bool InputCodec::Init(const InputMap& map) {
+    uint32_t seen = 0;
+    for (uint32_t game_bit : map.game_bits) {
+        if (!SingleBit(game_bit) || (seen & game_bit)) return false;
+        seen |= game_bit;
+    }
+
+    // Each table entry is the OR of the bits its index byte carries
+    std::memset(to_wire_, 0, sizeof(to_wire_));
+    std::memset(from_wire_, 0, sizeof(from_wire_));
+    for (uint32_t wire_bit = 0; wire_bit < WIRE_INPUT_BITS; wire_bit++) {
+        uint32_t game_bit = map.game_bits[wire_bit];
+        uint32_t game_byte = 0;
+        while (!((game_bit >> (game_byte * 8)) & 0xFF)) game_byte++;
+
+        for (uint32_t index = 0; index < 256; index++) {
+            if (index & (game_bit >> (game_byte * 8))) to_wire_[game_byte][index] |= static_cast<uint16_t>(1u << wire_bit);
+            if (index & (1u << (wire_bit % 8))) from_wire_[wire_bit / 8][index] |= game_bit;
+        }
+    }
+    game_mask_ = seen;
+    return true;
+}
+
+size_t PackInputFrames(uint32_t first_frame, const uint16_t* inputs, size_t count, uint8_t* out, size_t capacity) {
+    if (!inputs || !out || count == 0 || count > MAX_PACKED_FRAMES) return 0;
+
+    BitWriter writer(out, capacity);
+    if (!writer.Write(first_frame, 32) || !writer.Write(static_cast<uint32_t>(count), 8)) return 0;
+
+    size_t frame = 0;
+    while (frame < count) {
+        uint16_t input = inputs[frame] & WIRE_INPUT_MASK;
+        uint32_t run = 1;
+        while (run < MAX_INPUT_RUN && frame + run < count && (inputs[frame + run] & WIRE_INPUT_MASK) == input) run++;
+        if (!writer.Write(input, WIRE_INPUT_BITS) || !writer.Write(run - 1, INPUT_RUN_LENGTH_BITS)) return 0;
+        frame += run;
+    }
+    return writer.Finish();
+}
+
+size_t UnpackInputFrames(const uint8_t* data, size_t size, uint32_t* first_frame, uint16_t* inputs, size_t capacity) {
+    if (!data || !first_frame || !inputs) return 0;
+
+    BitReader reader(data, size);
+    uint32_t count = 0;
+    if (!reader.Read(32, first_frame) || !reader.Read(8, &count) || count == 0 || count > capacity) return 0;
+
+    size_t frame = 0;
+    while (frame < count) {
+        uint32_t input = 0, run = 0;
+        if (!reader.Read(WIRE_INPUT_BITS, &input) || !reader.Read(INPUT_RUN_LENGTH_BITS, &run)) return 0;
+        run++;
+        if (frame + run > count) return 0;
+        for (uint32_t n = 0; n < run; n++) inputs[frame++] = static_cast<uint16_t>(input);
+    }
+    return count;
+}
+
+} // namespace FM2K
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FM2K {
+
+// Inputs on the wire: the full FM2K::Input bitfield, 4 directions and 7
+// buttons per player
+constexpr uint32_t WIRE_INPUT_BITS = 11;
+constexpr uint16_t WIRE_INPUT_MASK = (1u << WIRE_INPUT_BITS) - 1;
+constexpr size_t WIRE_INPUT_BYTES = sizeof(uint16_t);  // GekkoNet input_size per player
+
+// Wire bits above the input carry the sender's preferred checkpoint interval
+// (checkpoint_policy.h, CheckpointAgreement); 0 from a sender that does not
+// stamp one. The codec and LoadWireInput ignore them.
+constexpr uint32_t WIRE_INTERVAL_SHIFT = WIRE_INPUT_BITS;
+constexpr uint16_t WIRE_INTERVAL_MASK = 0x7 << WIRE_INTERVAL_SHIFT;
+
+// Per-game input layout: the game's input bit carried by each wire bit, in
+// FM2K::Input order (left, right, up, down, button1..button7)
+struct InputMap {
+    uint32_t game_bits[WIRE_INPUT_BITS];
+};
+
+// Wire bit n is game bit n
+inline constexpr InputMap DEFAULT_INPUT_MAP = {
+    { 0x001, 0x002, 0x004, 0x008, 0x010, 0x020, 0x040, 0x080, 0x100, 0x200, 0x400 }
+};
+
+// Game input <-> wire input through byte-indexed tables built from an
+// InputMap: a handful of lookups ORed together each way, no branch per bit.
+// Game bits outside the map are dropped; wire bits above WIRE_INPUT_BITS
+// are ignored.
+class InputCodec {
+public:
+    InputCodec();   // DEFAULT_INPUT_MAP
+
+    // False (codec unchanged) unless every wire bit maps to exactly one game
+    // bit and no two wire bits share one
+    bool Init(const InputMap& map);
+
+    uint16_t ToWire(uint32_t game) const {
+        return to_wire_[0][game & 0xFF] | to_wire_[1][(game >> 8) & 0xFF] |
+               to_wire_[2][(game >> 16) & 0xFF] | to_wire_[3][game >> 24];
+    }
+
+    uint32_t FromWire(uint16_t wire) const {
+        return from_wire_[0][wire & 0xFF] | from_wire_[1][(wire >> 8) & (WIRE_INPUT_MASK >> 8)];
+    }
+
+    // Game bits the map carries
+    uint32_t GameMask() const { return game_mask_; }
+
+private:
+    uint16_t to_wire_[4][256];
+    uint32_t from_wire_[2][256];
+    uint32_t game_mask_ = 0;
+};
+
+// GekkoNet input bytes for one player (little-endian, WIRE_INPUT_BYTES each)
+inline void StoreWireInput(uint16_t wire, unsigned char* out) {
+    out[0] = static_cast<unsigned char>(wire);
+    out[1] = static_cast<unsigned char>(wire >> 8);
+}
+
+inline uint16_t LoadWireInput(const unsigned char* inputs, size_t player) {
+    const unsigned char* in = inputs + player * WIRE_INPUT_BYTES;
+    return static_cast<uint16_t>(in[0] | (in[1] << 8)) & WIRE_INPUT_MASK;
+}
+
+inline uint16_t WithWireInterval(uint16_t wire, uint32_t interval) {
+    return static_cast<uint16_t>((wire & ~WIRE_INTERVAL_MASK) | ((interval << WIRE_INTERVAL_SHIFT) & WIRE_INTERVAL_MASK));
+}
+
+inline uint32_t LoadWireInterval(const unsigned char* inputs, size_t player) {
+    const unsigned char* in = inputs + player * WIRE_INPUT_BYTES;
+    return (static_cast<uint32_t>(in[0] | (in[1] << 8)) & WIRE_INTERVAL_MASK) >> WIRE_INTERVAL_SHIFT;
+}
+
+// Packed input window: consecutive frames of one player's wire inputs,
+// least significant bit first:
+//
+//   32 bits  first frame
+//    8 bits  frame count
+//   runs     11-bit input + 4-bit (run length - 1), until every frame is covered
+//
+// A held input costs 15 bits for up to 16 frames, so a redundant window of
+// mostly held inputs shrinks to a few bytes; a fresh input every frame costs
+// 15 bits instead of 16.
+constexpr uint32_t INPUT_RUN_LENGTH_BITS = 4;
+constexpr uint32_t MAX_INPUT_RUN = 1u << INPUT_RUN_LENGTH_BITS;
+constexpr size_t MAX_PACKED_FRAMES = 255;
+constexpr size_t INPUT_PACKET_HEADER_BITS = 32 + 8;
+
+// Worst case for `frames` frames (every frame its own run)
+constexpr size_t MaxPackedInputSize(size_t frames) {
+    return (INPUT_PACKET_HEADER_BITS + frames * (WIRE_INPUT_BITS + INPUT_RUN_LENGTH_BITS) + 7) / 8;
+}
+
+// Returns the bytes written, or 0 if `count` is 0, above MAX_PACKED_FRAMES,
+// or does not fit in `capacity`
+size_t PackInputFrames(uint32_t first_frame, const uint16_t* inputs, size_t count, uint8_t* out, size_t capacity);
+
+// Returns the frames decoded into `inputs`, or 0 if the packet is truncated,
+// malformed, or holds more than `capacity` frames
+size_t UnpackInputFrames(const uint8_t* data, size_t size, uint32_t* first_frame, uint16_t* inputs, size_t capacity);
+
+} // namespace FM2K
@@ -0,0 +1,64 @@
+#include "input_history.h"
+
+namespace FM2K {
+namespace State {
+
+namespace {
+
+// Copy `count` ring slots starting at `first`, in at most two spans
+bool ReadRing(MemoryBackend& memory, uintptr_t ring, size_t entries, uint32_t first, uint32_t count, uint32_t* out) {
+    uint32_t head = static_cast<uint32_t>(entries - first);
+    if (head > count) head = count;
+    if (!memory.Read(ring + first * sizeof(uint32_t), out, head * sizeof(uint32_t))) return false;
+    if (head < count && !memory.Read(ring, out + head, (count - head) * sizeof(uint32_t))) return false;
+    return true;
+}
+
+bool WriteRing(MemoryBackend& memory, uintptr_t ring, size_t entries, uint32_t first, uint32_t count, const uint32_t* in) {
+    uint32_t head = static_cast<uint32_t>(entries - first);
+    if (head > count) head = count;
+    if (!memory.Write(ring + first * sizeof(uint32_t), in, head * sizeof(uint32_t))) return false;
+    if (head < count && !memory.Write(ring, in + head, (count - head) * sizeof(uint32_t))) return false;
+    return true;
+}
+
+} // anonymous namespace
+
+bool SaveInputHistory(MemoryBackend& memory, const InputHistoryLayout& layout, size_t window,
+                      InputHistorySnapshot& out) {
+    if (window > INPUT_HISTORY_WINDOW_MAX || window + 2 > layout.entries) return false;
+
+    uint32_t index = 0;
+    if (!memory.Read(layout.index_address, &index, sizeof(index))) return false;
+
+    uint32_t mask = static_cast<uint32_t>(layout.entries - 1);
+    out.index = index;
+    out.first = (index - 1) & mask;
+    out.count = static_cast<uint32_t>(window + 2);
+    out.reserved = 0;
+
+    return ReadRing(memory, layout.p1_address, layout.entries, out.first, out.count, out.p1) &&
+           ReadRing(memory, layout.p2_address, layout.entries, out.first, out.count, out.p2);
+}
+
+bool WriteInputHistorySlot(MemoryBackend& memory, const InputHistoryLayout& layout, uint32_t index,
+                           uint32_t p1, uint32_t p2) {
+    uintptr_t offset = (index & (layout.entries - 1)) * sizeof(uint32_t);
+    return memory.Write(layout.p1_address + offset, &p1, sizeof(p1)) &&
+           memory.Write(layout.p2_address + offset, &p2, sizeof(p2));
+}
+
+bool LoadInputHistory(MemoryBackend& memory, const InputHistoryLayout& layout, const InputHistorySnapshot& in) {
+    uint32_t mask = static_cast<uint32_t>(layout.entries - 1);
+    if (in.count < 2 || in.count > INPUT_HISTORY_WINDOW_MAX + 2 || in.first > mask) return false;
+
+    uint32_t live_index = 0;
+    if (!memory.Read(layout.index_address, &live_index, sizeof(live_index))) return false;
+    if (((live_index - in.index) & mask) > in.count - 2) return false;
+
+    return WriteRing(memory, layout.p1_address, layout.entries, in.first, in.count, in.p1) &&
+           WriteRing(memory, layout.p2_address, layout.entries, in.first, in.count, in.p2);
+}
+
+} // namespace State
+} // namespace FM2K
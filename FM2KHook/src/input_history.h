@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "snapshot.h"
+
+namespace FM2K {
+namespace State {
+
+// The game's per-player input rings: `entries` uint32 slots each, one slot
+// written per frame at the position held in the shared index
+struct InputHistoryLayout {
+    uintptr_t index_address;
+    uintptr_t p1_address;
+    uintptr_t p2_address;
+    size_t entries;             // Power of two
+};
+
+constexpr size_t INPUT_HISTORY_WINDOW_MAX = 32;
+
+// Slots [index - 1, index + window] of both rings. Only those can change
+// between saving a frame and rolling back to it `window` frames later; every
+// other slot in live memory still holds its value from the saved frame, so
+// writing these back reconstructs both full arrays.
+struct InputHistorySnapshot {
+    uint32_t index;
+    uint32_t first;             // Ring position of p1[0] / p2[0]
+    uint32_t count;
+    uint32_t reserved;
+    uint32_t p1[INPUT_HISTORY_WINDOW_MAX + 2];
+    uint32_t p2[INPUT_HISTORY_WINDOW_MAX + 2];
+};
+
+bool SaveInputHistory(MemoryBackend& memory, const InputHistoryLayout& layout, size_t window,
+                      InputHistorySnapshot& out);
+
+// Overwrite slot `index` of both rings: what the engine's input poll stored
+// for the frame it just polled, `index` being the input index before the poll
+// advanced it. Used to make a frame run on inputs other than the devices'.
+bool WriteInputHistorySlot(MemoryBackend& memory, const InputHistoryLayout& layout, uint32_t index,
+                           uint32_t p1, uint32_t p2);
+
+// Must run before the index itself is restored: fails without writing if the
+// live index has moved more than the saved window past the snapshot
+bool LoadInputHistory(MemoryBackend& memory, const InputHistoryLayout& layout, const InputHistorySnapshot& in);
+
+} // namespace State
+} // namespace FM2K
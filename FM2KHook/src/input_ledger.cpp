@@ -0,0 +1,29 @@
+#include "input_ledger.h"
+
+namespace FM2K {
+namespace State {
+
+void InputLedger::Clear() {
+    for (Entry& entry : entries_) entry = Entry{};
+}
+
+void InputLedger::Record(uint32_t frame, uint32_t p1, uint32_t p2) {
+    Entry& entry = entries_[frame % INPUT_LEDGER_FRAMES];
+    entry.frame = frame;
+    entry.p1 = p1;
+    entry.p2 = p2;
+    entry.valid = 1;
+}
+
+const InputLedger::Entry* InputLedger::Find(uint32_t frame) const {
+    const Entry& entry = entries_[frame % INPUT_LEDGER_FRAMES];
+    return entry.valid && entry.frame == frame ? &entry : nullptr;
+}
+
+bool InputLedger::Matches(uint32_t frame, uint32_t p1, uint32_t p2, uint32_t mask) const {
+    const Entry* entry = Find(frame);
+    return entry && ((entry->p1 ^ p1) & mask) == 0 && ((entry->p2 ^ p2) & mask) == 0;
+}
+
+} // namespace State
+} // namespace FM2K
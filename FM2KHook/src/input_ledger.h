@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FM2K {
+namespace State {
+
+// Bits of g_p1_input / g_p2_input the engine reads: 4 directions + 7 buttons
+constexpr uint32_t FM2K_INPUT_MASK = 0x7FF;
+
+constexpr uint32_t INPUT_LEDGER_FRAMES = 32;
+
+// Per-frame record of the inputs the engine actually consumed. A rollback
+// only changes anything if a confirmed input differs from the consumed one
+// in a bit the engine reads; when none of the rolled-back frames do, the
+// live state is already the confirmed state and the rollback can be elided.
+// The same record lets a rollback replay from an older checkpoint.
+class InputLedger {
+public:
+    struct Entry {
+        uint32_t frame;
+        uint32_t p1;
+        uint32_t p2;
+        uint32_t valid;
+    };
+
+    struct Stats {
+        uint64_t requested;         // LoadEvents received
+        uint64_t executed;          // Restored and resimulated
+        uint64_t elided;            // Every rolled-back frame already matched
+        uint64_t unverifiable;      // Executed because a frame was missing from the ledger
+    };
+
+    void Clear();
+
+    void Record(uint32_t frame, uint32_t p1, uint32_t p2);
+    const Entry* Find(uint32_t frame) const;
+
+    // True if `frame` was recorded and its consumed inputs equal the
+    // confirmed ones in every bit of `mask`. The hook passes every bit the
+    // wire map carries, in every game mode, so only bits that never reach
+    // GekkoNet can differ in a frame whose rollback is elided.
+    bool Matches(uint32_t frame, uint32_t p1, uint32_t p2, uint32_t mask = FM2K_INPUT_MASK) const;
+
+    void CountRequested() { stats_.requested++; }
+    void CountExecuted(bool unverifiable) { stats_.executed++; if (unverifiable) stats_.unverifiable++; }
+    void CountElided() { stats_.elided++; }
+    Stats GetStats() const { return stats_; }
+
+private:
+    Entry entries_[INPUT_LEDGER_FRAMES] = {};
+    Stats stats_ = {};
+};
+
+} // namespace State
+} // namespace FM2K
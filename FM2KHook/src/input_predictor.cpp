@@ -0,0 +1,147 @@
+#include "input_predictor.h"
+#include <algorithm>
+#include <cstring>
+
+namespace FM2K {
+
+const char* PredictionStrategyName(PredictionStrategy strategy) {
+    switch (strategy) {
+        case PredictionStrategy::RepeatLast: return "repeat-last";
+        case PredictionStrategy::HoldAware:  return "hold-aware";
+        case PredictionStrategy::Markov:     return "markov";
+        case PredictionStrategy::Hybrid:     return "hybrid";
+    }
+    return "unknown";
+}
+
+std::unique_ptr<InputPredictor> CreateInputPredictor(PredictionStrategy strategy) {
+    switch (strategy) {
+        case PredictionStrategy::RepeatLast: return std::make_unique<RepeatLastPredictor>();
+        case PredictionStrategy::HoldAware:  return std::make_unique<HoldAwarePredictor>();
+        case PredictionStrategy::Markov:     return std::make_unique<MarkovPredictor>();
+        case PredictionStrategy::Hybrid:     return std::make_unique<HybridPredictor>();
+    }
+    return nullptr;
+}
+
+void HoldAwarePredictor::Reset() {
+    last_ = 0;
+    std::memset(button_frames_, 0, sizeof(button_frames_));
+}
+
+void HoldAwarePredictor::Observe(uint16_t input) {
+    last_ = input;
+    for (uint32_t bit = 0; bit < WIRE_INPUT_BITS; bit++) {
+        if (!(input & (1u << bit))) button_frames_[bit] = 0;
+        else if (button_frames_[bit] < HOLD_BUTTON_FRAMES) button_frames_[bit]++;
+    }
+}
+
+uint16_t HoldAwarePredictor::Predict(uint32_t ahead) const {
+    (void)ahead;
+    uint16_t held = 0;
+    for (uint32_t bit = 0; bit < WIRE_INPUT_BITS; bit++) {
+        if (button_frames_[bit] >= HOLD_BUTTON_FRAMES) held |= static_cast<uint16_t>(1u << bit);
+    }
+    return (last_ & WIRE_DIRECTION_MASK) | (held & WIRE_BUTTON_MASK);
+}
+
+void MarkovPredictor::Reset() {
+    std::fill(table_.get(), table_.get() + TABLE_SIZE, Context{});
+    std::memset(history_, 0, sizeof(history_));
+    observed_ = 0;
+}
+
+uint32_t MarkovPredictor::Hash(const uint16_t* history) {
+    uint32_t hash = 2166136261u;
+    for (uint32_t n = 0; n < ORDER; n++) {
+        hash = (hash ^ history[n]) * 16777619u;
+    }
+    return hash | 1;    // 0 marks an empty context
+}
+
+const MarkovPredictor::Context* MarkovPredictor::Find(const uint16_t* history) const {
+    uint32_t tag = Hash(history);
+    const Context& context = table_[tag & (TABLE_SIZE - 1)];
+    return context.tag == tag ? &context : nullptr;
+}
+
+void MarkovPredictor::Observe(uint16_t input) {
+    if (observed_ >= ORDER) {
+        uint32_t tag = Hash(history_);
+        Context& context = table_[tag & (TABLE_SIZE - 1)];
+        if (context.tag != tag) {
+            context = Context{};    // A colliding context takes the slot over
+            context.tag = tag;
+        }
+
+        // Count the successor, or replace the least frequent one
+        Candidate* slot = nullptr;
+        for (Candidate& candidate : context.candidates) {
+            if (candidate.count && candidate.input == input) { slot = &candidate; break; }
+        }
+        if (!slot) {
+            slot = std::min_element(std::begin(context.candidates), std::end(context.candidates),
+                                    [](const Candidate& a, const Candidate& b) { return a.count < b.count; });
+            *slot = { input, 0 };
+        }
+        if (slot->count == MAX_COUNT) {
+            for (Candidate& candidate : context.candidates) candidate.count /= 2;
+        }
+        slot->count++;
+        context.total++;
+    } else {
+        observed_++;
+    }
+
+    std::memmove(history_, history_ + 1, (ORDER - 1) * sizeof(history_[0]));
+    history_[ORDER - 1] = input;
+}
+
+bool MarkovPredictor::Chain(uint32_t ahead, uint32_t min_count, uint16_t* input) const {
+    uint16_t history[ORDER];
+    std::memcpy(history, history_, sizeof(history));
+    bool confident = observed_ >= ORDER;
+
+    for (uint32_t step = 0; step < ahead; step++) {
+        uint16_t next = history[ORDER - 1];
+        const Context* context = confident ? Find(history) : nullptr;
+        const Candidate* best = nullptr;
+        if (context) {
+            best = std::max_element(std::begin(context->candidates), std::end(context->candidates),
+                                    [](const Candidate& a, const Candidate& b) { return a.count < b.count; });
+        }
+        if (best && best->count >= min_count) {
+            next = best->input;
+        } else {
+            confident = false;
+        }
+        std::memmove(history, history + 1, (ORDER - 1) * sizeof(history[0]));
+        history[ORDER - 1] = next;
+    }
+    *input = history[ORDER - 1];
+    return confident;
+}
+
+uint16_t MarkovPredictor::Predict(uint32_t ahead) const {
+    uint16_t input = 0;
+    Chain(ahead, 1, &input);
+    return input;
+}
+
+void HybridPredictor::Reset() {
+    markov_.Reset();
+    hold_.Reset();
+}
+
+void HybridPredictor::Observe(uint16_t input) {
+    markov_.Observe(input);
+    hold_.Observe(input);
+}
+
+uint16_t HybridPredictor::Predict(uint32_t ahead) const {
+    uint16_t input = 0;
+    return markov_.Chain(ahead, MIN_CONTEXT_COUNT, &input) ? input : hold_.Predict(ahead);
+}
+
+} // namespace FM2K
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "input_codec.h"
+
+namespace FM2K {
+
+// Guesses a remote player's upcoming inputs from the confirmed ones. Every
+// wrong guess costs a rollback, so strategies are compared by how often
+// they miss at a given latency (see bench/input_prediction_eval.cpp).
+// Inputs are wire inputs (input_codec.h); one predictor per player.
+class InputPredictor {
+public:
+    virtual ~InputPredictor() = default;
+
+    virtual const char* Name() const = 0;
+    virtual void Reset() = 0;
+
+    // The next confirmed input, in frame order
+    virtual void Observe(uint16_t input) = 0;
+
+    // Input for the frame `ahead` frames after the last observed one (1 = next)
+    virtual uint16_t Predict(uint32_t ahead) const = 0;
+};
+
+enum class PredictionStrategy {
+    RepeatLast,     // What GekkoNet does: the last confirmed input, unchanged
+    HoldAware,      // Directions and long-held buttons persist, fresh presses release
+    Markov,         // Per-player n-gram over recent inputs, trained online
+    Hybrid          // Markov where its context is well seen, HoldAware elsewhere
+};
+constexpr size_t PREDICTION_STRATEGY_COUNT = 4;
+
+const char* PredictionStrategyName(PredictionStrategy strategy);
+std::unique_ptr<InputPredictor> CreateInputPredictor(PredictionStrategy strategy);
+
+// Directions in wire bit order (DEFAULT_INPUT_MAP: left, right, up, down)
+constexpr uint16_t WIRE_DIRECTION_MASK = 0x00F;
+constexpr uint16_t WIRE_BUTTON_MASK = WIRE_INPUT_MASK & ~WIRE_DIRECTION_MASK;
+
+class RepeatLastPredictor : public InputPredictor {
+public:
+    const char* Name() const override { return "repeat-last"; }
+    void Reset() override { last_ = 0; }
+    void Observe(uint16_t input) override { last_ = input; }
+    uint16_t Predict(uint32_t) const override { return last_; }
+
+private:
+    uint16_t last_ = 0;
+};
+
+// Directions are held for many frames; a button pressed for only a frame or
+// two is usually a tap that will be released. Buttons held at least
+// HOLD_BUTTON_FRAMES are treated as held (charge inputs, blocking).
+class HoldAwarePredictor : public InputPredictor {
+public:
+    static constexpr uint32_t HOLD_BUTTON_FRAMES = 3;
+
+    const char* Name() const override { return "hold-aware"; }
+    void Reset() override;
+    void Observe(uint16_t input) override;
+    uint16_t Predict(uint32_t ahead) const override;
+
+private:
+    uint16_t last_ = 0;
+    uint8_t button_frames_[WIRE_INPUT_BITS] = {};   // Frames each button has been held, saturating
+};
+
+// Order-N Markov model: a hashed table from the last N inputs to the inputs
+// that followed them, with counts. Predicting several frames ahead feeds
+// each guess back in as context. Unseen or thin contexts fall back to
+// repeating the last input.
+class MarkovPredictor : public InputPredictor {
+public:
+    static constexpr uint32_t ORDER = 3;
+    static constexpr size_t TABLE_SIZE = 4096;          // Contexts (power of two)
+    static constexpr size_t CANDIDATES = 4;             // Next inputs tracked per context
+    static constexpr uint16_t MAX_COUNT = 0xFFFF;
+
+    const char* Name() const override { return "markov"; }
+    void Reset() override;
+    void Observe(uint16_t input) override;
+    uint16_t Predict(uint32_t ahead) const override;
+
+    // Walk the model `ahead` frames, each step taking the most frequent
+    // successor of the context so far. A context seen fewer than
+    // `min_count` times repeats the input before it instead and makes the
+    // result unconfident (false).
+    bool Chain(uint32_t ahead, uint32_t min_count, uint16_t* input) const;
+
+private:
+    struct Candidate {
+        uint16_t input;
+        uint16_t count;
+    };
+    struct Context {
+        uint32_t tag;           // Full context hash, 0 = empty
+        uint32_t total;
+        Candidate candidates[CANDIDATES];
+    };
+
+    static uint32_t Hash(const uint16_t* history);
+    const Context* Find(const uint16_t* history) const;
+
+    std::unique_ptr<Context[]> table_ = std::make_unique<Context[]>(TABLE_SIZE);
+    uint16_t history_[ORDER] = {};      // Most recent last
+    uint32_t observed_ = 0;
+};
+
+// The "hybrid prediction" of docs/outline/fm2k_rollback_strategy.md: trust
+// the learned pattern where the player has shown it often enough, otherwise
+// let directions persist and taps release
+class HybridPredictor : public InputPredictor {
+public:
+    static constexpr uint32_t MIN_CONTEXT_COUNT = 8;
+
+    const char* Name() const override { return "hybrid"; }
+    void Reset() override;
+    void Observe(uint16_t input) override;
+    uint16_t Predict(uint32_t ahead) const override;
+
+private:
+    MarkovPredictor markov_;
+    HoldAwarePredictor hold_;
+};
+
+} // namespace FM2K
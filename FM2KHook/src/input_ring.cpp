@@ -0,0 +1,42 @@
+#include "input_ring.h"
+#include <algorithm>
+#include <cstring>
+
+namespace FM2K {
+
+void InputLatencyHistogram::Record(uint64_t latency_ns) {
+    uint64_t us = latency_ns / 1000;
+    max_us_ = std::max(max_us_, static_cast<uint32_t>(std::min<uint64_t>(us, UINT32_MAX)));
+    histogram_[std::min<uint64_t>(us, HISTOGRAM_US - 1)]++;
+    samples_++;
+}
+
+void InputLatencyHistogram::Reset() {
+    samples_ = 0;
+    max_us_ = 0;
+    std::memset(histogram_, 0, sizeof(histogram_));
+}
+
+uint32_t InputLatencyHistogram::Percentile(double percentile) const {
+    if (samples_ == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(static_cast<double>(samples_) * percentile / 100.0);
+    if (rank >= samples_) rank = samples_ - 1;
+
+    uint64_t seen = 0;
+    for (size_t us = 0; us < HISTOGRAM_US; ++us) {
+        seen += histogram_[us];
+        if (seen > rank) return static_cast<uint32_t>(us);
+    }
+    return HISTOGRAM_US - 1;
+}
+
+InputLatencyHistogram::Stats InputLatencyHistogram::GetStats() const {
+    Stats stats = {};
+    stats.samples = samples_;
+    stats.p50_us = Percentile(50.0);
+    stats.p99_us = Percentile(99.0);
+    stats.max_us = max_us_;
+    return stats;
+}
+
+} // namespace FM2K
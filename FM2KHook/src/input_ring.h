@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace FM2K {
+
+// One poll of both players' devices, as FM2K::Input bits (input_ledger.h
+// FM2K_INPUT_MASK), stamped with the sampler's clock
+struct InputSample {
+    uint64_t timestamp_ns;
+    uint32_t sequence;      // Increments per sample; gaps are samples the ring dropped
+    uint16_t p1;
+    uint16_t p2;
+};
+
+// Lock-free single-producer/single-consumer ring. One thread only pushes,
+// one thread only pops; each index is written by one side and read by the
+// other with acquire/release ordering, and each side keeps a cached copy of
+// the other's index so an uncontended push or pop touches one shared line.
+// Capacity is a power of two; one slot is never used.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Producer. False (nothing written) when full.
+    bool Push(const T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t next = (head + 1) & MASK;
+        if (next == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (next == cached_tail_) return false;
+        }
+        items_[head] = item;
+        head_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer. False when empty.
+    bool Pop(T* item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == cached_head_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail == cached_head_) return false;
+        }
+        *item = items_[tail];
+        tail_.store((tail + 1) & MASK, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer. Drain everything queued and keep the newest; `drained`
+    // receives how many items were taken. False when empty.
+    bool PopLatest(T* item, size_t* drained = nullptr) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_acquire);
+        cached_head_ = head;
+        if (tail == head) {
+            if (drained) *drained = 0;
+            return false;
+        }
+        *item = items_[(head - 1) & MASK];
+        tail_.store(head, std::memory_order_release);
+        if (drained) *drained = (head - tail) & MASK;
+        return true;
+    }
+
+    // Either side; a snapshot that may be stale by the time it returns
+    size_t Size() const {
+        return (head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire)) & MASK;
+    }
+
+    static constexpr size_t MaxSize() { return Capacity - 1; }
+
+private:
+    static constexpr size_t MASK = Capacity - 1;
+    static constexpr size_t CACHE_LINE = 64;
+
+    alignas(CACHE_LINE) std::atomic<size_t> head_{ 0 };     // Written by the producer
+    size_t cached_tail_ = 0;                                // Producer's view of tail_
+    alignas(CACHE_LINE) std::atomic<size_t> tail_{ 0 };     // Written by the consumer
+    size_t cached_head_ = 0;                                // Consumer's view of head_
+    alignas(CACHE_LINE) T items_[Capacity];
+};
+
+// A quarter second of samples at 1 kHz; the hook drains every 10 ms frame
+constexpr size_t INPUT_SAMPLE_RING_SIZE = 256;
+using InputSampleRing = SpscRing<InputSample, INPUT_SAMPLE_RING_SIZE>;
+
+// Age of each sample the hook consumed (consume time - sample time), in
+// microsecond buckets like FramePacer's error histogram
+class InputLatencyHistogram {
+public:
+    static constexpr size_t HISTOGRAM_US = 4096;
+
+    struct Stats {
+        uint64_t samples;
+        uint32_t p50_us;
+        uint32_t p99_us;
+        uint32_t max_us;
+    };
+
+    void Record(uint64_t latency_ns);
+    void Reset();
+
+    // Latency at `percentile` (0-100) in microseconds; the last bucket also
+    // counts every latency past HISTOGRAM_US
+    uint32_t Percentile(double percentile) const;
+    Stats GetStats() const;
+
+private:
+    uint64_t samples_ = 0;
+    uint32_t max_us_ = 0;
+    uint32_t histogram_[HISTOGRAM_US] = {};
+};
+
+} // namespace FM2K
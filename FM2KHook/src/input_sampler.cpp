@@ -0,0 +1,219 @@
+#include "input_sampler.h"
+#include <windows.h>
+#include <cstdlib>
+
+namespace FM2K {
+
+namespace {
+
+// FM2K::Input bits: left, right, up, down, then buttons 1-7
+constexpr uint16_t INPUT_LEFT = 0x001;
+constexpr uint16_t INPUT_RIGHT = 0x002;
+constexpr uint16_t INPUT_UP = 0x004;
+constexpr uint16_t INPUT_DOWN = 0x008;
+constexpr uint16_t INPUT_BUTTON1 = 0x010;
+
+// Left stick past half travel counts as a direction
+constexpr Sint16 STICK_THRESHOLD = 16384;
+
+// Gamepads are looked for again this often, so one plugged in mid-session joins
+constexpr uint64_t GAMEPAD_REFRESH_NS = 1000000000;
+
+} // anonymous namespace
+
+InputBindings InputBindings::Defaults() {
+    return InputBindings{
+        { VK_LEFT, VK_RIGHT, VK_UP, VK_DOWN, 'Z', 'X', 'C', 'A', 'S', 'D', 'Q' },
+        { SDL_GAMEPAD_BUTTON_SOUTH, SDL_GAMEPAD_BUTTON_EAST, SDL_GAMEPAD_BUTTON_WEST, SDL_GAMEPAD_BUTTON_NORTH,
+          SDL_GAMEPAD_BUTTON_LEFT_SHOULDER, SDL_GAMEPAD_BUTTON_RIGHT_SHOULDER, SDL_GAMEPAD_BUTTON_START },
+    };
+}
+
+bool InputBindings::ParseKeys(const char* spec) {
+    int parsed[DIRECTIONS + BUTTONS];
+    int count = 0;
+    const char* at = spec;
+    while (*at) {
+        if (count == DIRECTIONS + BUTTONS) return false;
+        char* end = nullptr;
+        unsigned long key = std::strtoul(at, &end, 0);
+        if (end == at || key == 0 || key > 0xFE) return false;
+        parsed[count++] = static_cast<int>(key);
+        at = end;
+        if (*at == ',') at++;
+        else if (*at) return false;
+    }
+    if (count == 0) return false;
+    for (int i = 0; i < count; i++) keys[i] = parsed[i];
+    return true;
+}
+
+InputSampler::~InputSampler() {
+    Stop();
+}
+
+bool InputSampler::Start(uint32_t poll_hz, const InputBindings& bindings) {
+    if (thread_ || poll_hz == 0) return false;
+    bindings_ = bindings;
+
+    // Same background gamepad setup as framestep: events keep flowing while
+    // the game window, not an SDL one, has focus
+    SDL_SetHint(SDL_HINT_JOYSTICK_THREAD, "1");
+    SDL_SetHint(SDL_HINT_JOYSTICK_ALLOW_BACKGROUND_EVENTS, "1");
+    if (!SDL_InitSubSystem(SDL_INIT_GAMEPAD)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Input sampler: SDL gamepad init failed: %s", SDL_GetError());
+        return false;
+    }
+
+    period_ns_ = 1000000000ull / poll_hz;
+    running_.store(true);
+    thread_ = SDL_CreateThread(ThreadMain, "FM2KInputSampler", this);
+    if (!thread_) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Input sampler: SDL_CreateThread failed: %s", SDL_GetError());
+        running_.store(false);
+        SDL_QuitSubSystem(SDL_INIT_GAMEPAD);
+        return false;
+    }
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Input sampler: polling at %u Hz", poll_hz);
+    return true;
+}
+
+void InputSampler::Stop() {
+    if (!thread_) return;
+    running_.store(false);
+    SDL_WaitThread(thread_, nullptr);
+    thread_ = nullptr;
+    SDL_QuitSubSystem(SDL_INIT_GAMEPAD);
+}
+
+void InputSampler::Abandon() {
+    if (!thread_) return;
+    running_.store(false);
+    SDL_DetachThread(thread_);
+    thread_ = nullptr;
+}
+
+int SDLCALL InputSampler::ThreadMain(void* data) {
+    static_cast<InputSampler*>(data)->Run();
+    return 0;
+}
+
+void InputSampler::Run() {
+    SDL_SetCurrentThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+    uint32_t sequence = 0;
+    uint64_t next_poll = NowNs();
+    uint64_t next_refresh = 0;
+
+    while (running_.load(std::memory_order_relaxed)) {
+        uint64_t now = NowNs();
+        if (now >= next_refresh) {
+            RefreshGamepads();
+            next_refresh = now + GAMEPAD_REFRESH_NS;
+        }
+
+        SDL_UpdateGamepads();
+        InputSample sample;
+        uint16_t first = ReadKeyboard() | ReadGamepad(gamepads_[0]);
+        uint32_t local = local_players_.load(std::memory_order_relaxed);
+        sample.p1 = 0;
+        sample.p2 = 0;
+        if (local == LOCAL_PLAYERS_BOTH) {
+            sample.p1 = first;
+            sample.p2 = ReadGamepad(gamepads_[1]);
+        } else if (local == LOCAL_PLAYER_2) {
+            sample.p2 = first;
+        } else if (local == LOCAL_PLAYER_1) {
+            sample.p1 = first;
+        }
+        sample.sequence = sequence++;
+        sample.timestamp_ns = NowNs();
+        if (ring_.Push(sample)) {
+            samples_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Absolute deadlines so the rate does not drift with poll cost
+        next_poll += period_ns_;
+        now = NowNs();
+        if (next_poll > now) {
+            SDL_DelayPrecise(next_poll - now);
+        } else {
+            next_poll = now;
+        }
+    }
+
+    for (SDL_Gamepad*& gamepad : gamepads_) {
+        if (gamepad) SDL_CloseGamepad(gamepad);
+        gamepad = nullptr;
+    }
+}
+
+// Keep the first two connected gamepads, in the order SDL lists them
+void InputSampler::RefreshGamepads() {
+    for (SDL_Gamepad*& gamepad : gamepads_) {
+        if (gamepad && !SDL_GamepadConnected(gamepad)) {
+            SDL_CloseGamepad(gamepad);
+            gamepad = nullptr;
+        }
+    }
+
+    int count = 0;
+    SDL_JoystickID* ids = SDL_GetGamepads(&count);
+    for (int i = 0; ids && i < count; i++) {
+        bool open = false;
+        for (SDL_Gamepad* gamepad : gamepads_) {
+            if (gamepad && SDL_GetGamepadID(gamepad) == ids[i]) open = true;
+        }
+        for (SDL_Gamepad*& gamepad : gamepads_) {
+            if (open || gamepad) continue;
+            gamepad = SDL_OpenGamepad(ids[i]);
+            open = true;
+        }
+    }
+    SDL_free(ids);
+
+    uint32_t opened = 0;
+    for (SDL_Gamepad* gamepad : gamepads_) {
+        if (gamepad) opened++;
+    }
+    gamepad_count_.store(opened, std::memory_order_relaxed);
+}
+
+uint16_t InputSampler::ReadGamepad(SDL_Gamepad* gamepad) const {
+    if (!gamepad) return 0;
+
+    uint16_t input = 0;
+    Sint16 x = SDL_GetGamepadAxis(gamepad, SDL_GAMEPAD_AXIS_LEFTX);
+    Sint16 y = SDL_GetGamepadAxis(gamepad, SDL_GAMEPAD_AXIS_LEFTY);
+    if (SDL_GetGamepadButton(gamepad, SDL_GAMEPAD_BUTTON_DPAD_LEFT) || x < -STICK_THRESHOLD) input |= INPUT_LEFT;
+    if (SDL_GetGamepadButton(gamepad, SDL_GAMEPAD_BUTTON_DPAD_RIGHT) || x > STICK_THRESHOLD) input |= INPUT_RIGHT;
+    if (SDL_GetGamepadButton(gamepad, SDL_GAMEPAD_BUTTON_DPAD_UP) || y < -STICK_THRESHOLD) input |= INPUT_UP;
+    if (SDL_GetGamepadButton(gamepad, SDL_GAMEPAD_BUTTON_DPAD_DOWN) || y > STICK_THRESHOLD) input |= INPUT_DOWN;
+    for (int button = 0; button < InputBindings::BUTTONS; button++) {
+        if (SDL_GetGamepadButton(gamepad, bindings_.buttons[button])) input |= INPUT_BUTTON1 << button;
+    }
+    return input;
+}
+
+uint16_t InputSampler::ReadKeyboard() const {
+    DWORD focused_process = 0;
+    GetWindowThreadProcessId(GetForegroundWindow(), &focused_process);
+    if (focused_process != GetCurrentProcessId()) return 0;
+
+    uint16_t input = 0;
+    for (int bit = 0; bit < InputBindings::DIRECTIONS + InputBindings::BUTTONS; bit++) {
+        if (GetAsyncKeyState(bindings_.keys[bit]) & 0x8000) input |= 1u << bit;
+    }
+    return input;
+}
+
+InputSampler::Stats InputSampler::GetStats() const {
+    Stats stats = {};
+    stats.samples = samples_.load(std::memory_order_relaxed);
+    stats.dropped = dropped_.load(std::memory_order_relaxed);
+    stats.gamepads = gamepad_count_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace FM2K
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <SDL3/SDL.h>
+#include "input_ring.h"
+
+namespace FM2K {
+
+// Which players' slots the sampler fills: both offline, only the local one
+// online. The remote slot is GekkoNet's and is never touched.
+enum LocalPlayerMask : uint32_t {
+    LOCAL_PLAYER_1 = 1,
+    LOCAL_PLAYER_2 = 2,
+    LOCAL_PLAYERS_BOTH = LOCAL_PLAYER_1 | LOCAL_PLAYER_2,
+};
+
+// Keyboard keys (virtual-key codes) and gamepad buttons for each FM2K input
+// bit: left, right, up, down, then buttons 1-7. Gamepad directions are
+// always the d-pad or left stick.
+struct InputBindings {
+    static constexpr int DIRECTIONS = 4;
+    static constexpr int BUTTONS = 7;
+
+    int keys[DIRECTIONS + BUTTONS];
+    SDL_GamepadButton buttons[BUTTONS];
+
+    // Arrows and Z X C A S D Q; south, east, west, north, shoulders, Start
+    static InputBindings Defaults();
+
+    // Comma-separated virtual-key codes (decimal or 0x hex) in bit order,
+    // replacing the first keys given. False, with the keys unchanged, on
+    // anything that does not parse.
+    bool ParseKeys(const char* spec);
+};
+
+// Polls the local players' devices on its own thread at a fixed rate and
+// pushes every poll into an InputSampleRing, so the hook can take an input
+// sampled moments before the engine runs instead of whenever the engine
+// itself polled.
+//
+// Devices: the keyboard (while the game window has focus) and the first SDL
+// gamepad belong to the first local player, and the second gamepad to P2
+// when both players are local. The keyboard is read with GetAsyncKeyState,
+// since SDL only sees keys for its own windows. Slots of players that are
+// not local stay 0.
+class InputSampler {
+public:
+    static constexpr uint32_t DEFAULT_POLL_HZ = 1000;
+
+    struct Stats {
+        uint64_t samples;           // Pushed
+        uint64_t dropped;           // Ring full; the hook fell behind
+        uint32_t gamepads;          // Open right now
+    };
+
+    ~InputSampler();
+
+    bool Start(uint32_t poll_hz = DEFAULT_POLL_HZ, const InputBindings& bindings = InputBindings::Defaults());
+    void Stop();
+    // Signal the thread to finish without waiting for it (DllMain detach)
+    void Abandon();
+    bool Running() const { return thread_ != nullptr; }
+
+    // Any thread; takes effect from the next poll
+    void SetLocalPlayers(uint32_t mask) { local_players_.store(mask, std::memory_order_relaxed); }
+    uint32_t LocalPlayers() const { return local_players_.load(std::memory_order_relaxed); }
+
+    // Consumer side, for the hook thread only
+    InputSampleRing& Ring() { return ring_; }
+
+    // Clock the samples are stamped with
+    static uint64_t NowNs() { return SDL_GetTicksNS(); }
+
+    Stats GetStats() const;
+
+private:
+    static int SDLCALL ThreadMain(void* data);
+    void Run();
+    void RefreshGamepads();
+    uint16_t ReadGamepad(SDL_Gamepad* gamepad) const;
+    uint16_t ReadKeyboard() const;
+
+    InputSampleRing ring_;
+    SDL_Thread* thread_ = nullptr;
+    std::atomic<bool> running_{ false };
+    uint64_t period_ns_ = 0;
+    InputBindings bindings_ = {};
+    std::atomic<uint32_t> local_players_{ LOCAL_PLAYERS_BOTH };
+    SDL_Gamepad* gamepads_[2] = {};
+
+    std::atomic<uint64_t> samples_{ 0 };
+    std::atomic<uint64_t> dropped_{ 0 };
+    std::atomic<uint32_t> gamepad_count_{ 0 };
+};
+
+} // namespace FM2K
@@ -0,0 +1,319 @@
+#include "object_pool.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FM2K_POOL_SCAN_SSE2 1
+#endif
+
+namespace FM2K {
+namespace State {
+
+namespace {
+
+constexpr size_t FLAG_SIZE = sizeof(uint16_t);
+
+inline size_t BitmapWords(const ObjectPoolLayout& layout) {
+    return (layout.slot_count + 31) / 32;
+}
+
+// Bytes from the first slot to the end of the last slot's captured data
+inline size_t PoolSpan(const ObjectPoolLayout& layout) {
+    return layout.slot_count == 0 ? 0 : (layout.slot_count - 1) * layout.slot_size + ObjectSlotBytes(layout);
+}
+
+inline uint16_t LoadFlag(const uint8_t* pool, const ObjectPoolLayout& layout, size_t slot) {
+    uint16_t flag;
+    std::memcpy(&flag, pool + slot * layout.slot_size + layout.active_flag_offset, sizeof(flag));
+    return flag;
+}
+
+inline unsigned LowestBit(uint32_t word) {
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctz(word));
+#else
+    unsigned bit = 0;
+    while (!(word & 1u)) { word >>= 1; bit++; }
+    return bit;
+#endif
+}
+
+inline bool SlotLive(const uint32_t* bitmap, size_t slot) {
+    return (bitmap[slot / 32] >> (slot % 32)) & 1u;
+}
+
+// Calls fn(first, count) for each run of consecutive slots that are live
+// (or dead) in `bitmap`, in slot order
+template<typename Fn>
+void ForEachRun(const uint32_t* bitmap, size_t slot_count, bool live, Fn&& fn) {
+    size_t slot = 0;
+    while (slot < slot_count) {
+        if (SlotLive(bitmap, slot) != live) {
+            slot++;
+            continue;
+        }
+        size_t first = slot;
+        while (slot < slot_count && SlotLive(bitmap, slot) == live) slot++;
+        fn(first, slot - first);
+    }
+}
+
+// Bytes a run of `count` slots covers, captured data of the last one included
+inline size_t RunSpan(const ObjectPoolLayout& layout, size_t count) {
+    return (count - 1) * layout.slot_size + ObjectSlotBytes(layout);
+}
+
+inline size_t PopCount(uint32_t word) {
+#if defined(__GNUC__)
+    return static_cast<size_t>(__builtin_popcount(word));
+#else
+    size_t count = 0;
+    for (; word; word &= word - 1) count++;
+    return count;
+#endif
+}
+
+} // anonymous namespace
+
+size_t ObjectSlotBytes(const ObjectPoolLayout& layout) {
+    return std::max(layout.slot_size, layout.active_flag_offset + FLAG_SIZE);
+}
+
+size_t MaxObjectPoolSnapshotSize(const ObjectPoolLayout& layout) {
+    return sizeof(ObjectPoolHeader) + BitmapWords(layout) * sizeof(uint32_t) +
+           layout.slot_count * ObjectSlotBytes(layout);
+}
+
+bool ScanKernelSupported(ScanKernel kernel) {
+#ifdef FM2K_POOL_SCAN_SSE2
+    return kernel == ScanKernel::Scalar || kernel == ScanKernel::SSE2;
+#else
+    return kernel == ScanKernel::Scalar;
+#endif
+}
+
+size_t ScanActiveSlotsWith(ScanKernel kernel, const uint8_t* pool, const ObjectPoolLayout& layout, uint32_t* bitmap) {
+    std::memset(bitmap, 0, BitmapWords(layout) * sizeof(uint32_t));
+
+    size_t live = 0;
+    size_t slot = 0;
+
+#ifdef FM2K_POOL_SCAN_SSE2
+    // Eight flags per step: gather them into one vector, compare against zero
+    // and pack the result down to an 8-bit dead mask. The loads are still one
+    // per slot; only the mask build is cheaper.
+    if (kernel == ScanKernel::SSE2) {
+        const __m128i zero = _mm_setzero_si128();
+        for (; slot + 8 <= layout.slot_count; slot += 8) {
+            __m128i flags = zero;
+            flags = _mm_insert_epi16(flags, LoadFlag(pool, layout, slot + 0), 0);
+            flags = _mm_insert_epi16(flags, LoadFlag(pool, layout, slot + 1), 1);
+            flags = _mm_insert_epi16(flags, LoadFlag(pool, layout, slot + 2), 2);
+            flags = _mm_insert_epi16(flags, LoadFlag(pool, layout, slot + 3), 3);
+            flags = _mm_insert_epi16(flags, LoadFlag(pool, layout, slot + 4), 4);
+            flags = _mm_insert_epi16(flags, LoadFlag(pool, layout, slot + 5), 5);
+            flags = _mm_insert_epi16(flags, LoadFlag(pool, layout, slot + 6), 6);
+            flags = _mm_insert_epi16(flags, LoadFlag(pool, layout, slot + 7), 7);
+
+            __m128i dead = _mm_cmpeq_epi16(flags, zero);
+            uint32_t live_mask = ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(dead, dead))) & 0xFFu;
+
+            bitmap[slot / 32] |= live_mask << (slot % 32);
+            live += PopCount(live_mask);
+        }
+    }
+#else
+    (void)kernel;
+#endif
+
+    // Branch-free scalar loop, eight slots per step
+    for (; slot + 8 <= layout.slot_count; slot += 8) {
+        uint32_t live_mask = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            live_mask |= static_cast<uint32_t>(LoadFlag(pool, layout, slot + i) != 0) << i;
+        }
+        bitmap[slot / 32] |= live_mask << (slot % 32);
+        live += PopCount(live_mask);
+    }
+
+    for (; slot < layout.slot_count; ++slot) {
+        uint32_t active = LoadFlag(pool, layout, slot) != 0;
+        bitmap[slot / 32] |= active << (slot % 32);
+        live += active;
+    }
+    return live;
+}
+
+size_t ScanActiveSlots(const uint8_t* pool, const ObjectPoolLayout& layout, uint32_t* bitmap) {
+    return ScanActiveSlotsWith(ScanKernelSupported(ScanKernel::SSE2) ? ScanKernel::SSE2 : ScanKernel::Scalar, pool,
+                               layout, bitmap);
+}
+
+namespace {
+
+// Backends without direct addressing: read just the flags, then each run of
+// live slots, so a save moves the live objects rather than the whole pool
+size_t SaveObjectPoolSparse(MemoryBackend& memory, const ObjectPoolLayout& layout, uint8_t* out, size_t capacity,
+                            uint32_t* bitmap, std::vector<uint8_t>& scratch) {
+    size_t words = BitmapWords(layout);
+    size_t slot_bytes = ObjectSlotBytes(layout);
+    size_t prefix = sizeof(ObjectPoolHeader) + words * sizeof(uint32_t);
+
+    std::memset(bitmap, 0, words * sizeof(uint32_t));
+    size_t live = 0;
+    for (size_t slot = 0; slot < layout.slot_count; ++slot) {
+        uint16_t flag;
+        if (!memory.Read(layout.address + slot * layout.slot_size + layout.active_flag_offset, &flag, sizeof(flag))) {
+            return 0;
+        }
+        if (flag) {
+            bitmap[slot / 32] |= 1u << (slot % 32);
+            live++;
+        }
+    }
+    if (capacity < prefix + live * slot_bytes) return 0;
+
+    uint8_t* cursor = out + prefix;
+    bool ok = true;
+    ForEachRun(bitmap, layout.slot_count, true, [&](size_t first, size_t count) {
+        size_t run = RunSpan(layout, count);
+        scratch.resize(std::max(scratch.size(), run));
+        if (!ok || !memory.Read(layout.address + first * layout.slot_size, scratch.data(), run)) {
+            ok = false;
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            std::memcpy(cursor, scratch.data() + i * layout.slot_size, slot_bytes);
+            cursor += slot_bytes;
+        }
+    });
+    if (!ok) return 0;
+
+    ObjectPoolHeader header = {};
+    header.slot_count = static_cast<uint32_t>(layout.slot_count);
+    header.live_count = static_cast<uint32_t>(live);
+    header.slot_bytes = static_cast<uint32_t>(slot_bytes);
+    std::memcpy(out, &header, sizeof(header));
+    return static_cast<size_t>(cursor - out);
+}
+
+// Backends without direct addressing: write dead slots (or just their
+// flags) and then each run of live slots, rather than the whole pool
+bool LoadObjectPoolSparse(MemoryBackend& memory, const ObjectPoolLayout& layout, const uint32_t* bitmap,
+                          const uint8_t* cursor, DeadSlotPolicy policy) {
+    size_t slot_bytes = ObjectSlotBytes(layout);
+    std::vector<uint8_t> run_bytes;
+    bool ok = true;
+
+    // Dead slots first, as in the direct path
+    if (policy == DeadSlotPolicy::ZeroFill) {
+        ForEachRun(bitmap, layout.slot_count, false, [&](size_t first, size_t count) {
+            run_bytes.assign(RunSpan(layout, count), 0);
+            ok = ok && memory.Write(layout.address + first * layout.slot_size, run_bytes.data(), run_bytes.size());
+        });
+    } else {
+        const uint16_t cleared = 0;
+        for (size_t slot = 0; ok && slot < layout.slot_count; ++slot) {
+            if (SlotLive(bitmap, slot)) continue;
+            ok = memory.Write(layout.address + slot * layout.slot_size + layout.active_flag_offset, &cleared,
+                              sizeof(cleared));
+        }
+    }
+
+    // A run is assembled the way the direct path copies it, later slots
+    // over the flag bytes of earlier ones, and written in one call
+    ForEachRun(bitmap, layout.slot_count, true, [&](size_t first, size_t count) {
+        run_bytes.resize(RunSpan(layout, count));
+        for (size_t i = 0; i < count; ++i) {
+            std::memcpy(run_bytes.data() + i * layout.slot_size, cursor, slot_bytes);
+            cursor += slot_bytes;
+        }
+        ok = ok && memory.Write(layout.address + first * layout.slot_size, run_bytes.data(), run_bytes.size());
+    });
+    return ok;
+}
+
+} // anonymous namespace
+
+size_t SaveObjectPool(MemoryBackend& memory, const ObjectPoolLayout& layout,
+                      uint8_t* out, size_t capacity, std::vector<uint8_t>& scratch) {
+    size_t span = PoolSpan(layout);
+    size_t words = BitmapWords(layout);
+    size_t slot_bytes = ObjectSlotBytes(layout);
+    size_t prefix = sizeof(ObjectPoolHeader) + words * sizeof(uint32_t);
+    if (!out || span == 0 || capacity < prefix) return 0;
+
+    uint32_t* bitmap = reinterpret_cast<uint32_t*>(out + sizeof(ObjectPoolHeader));
+    const uint8_t* pool = memory.Translate(layout.address, span);
+    if (!pool) {
+        return SaveObjectPoolSparse(memory, layout, out, capacity, bitmap, scratch);
+    }
+
+    // In-process the scan reads game memory directly
+    size_t live = ScanActiveSlots(pool, layout, bitmap);
+    if (capacity < prefix + live * slot_bytes) return 0;
+
+    ObjectPoolHeader header = {};
+    header.slot_count = static_cast<uint32_t>(layout.slot_count);
+    header.live_count = static_cast<uint32_t>(live);
+    header.slot_bytes = static_cast<uint32_t>(slot_bytes);
+    std::memcpy(out, &header, sizeof(header));
+
+    uint8_t* cursor = out + prefix;
+    for (size_t w = 0; w < words; ++w) {
+        for (uint32_t bits = bitmap[w]; bits; bits &= bits - 1) {
+            size_t slot = w * 32 + LowestBit(bits);
+            std::memcpy(cursor, pool + slot * layout.slot_size, slot_bytes);
+            cursor += slot_bytes;
+        }
+    }
+    return static_cast<size_t>(cursor - out);
+}
+
+bool LoadObjectPool(MemoryBackend& memory, const ObjectPoolLayout& layout,
+                    const uint8_t* in, size_t size, DeadSlotPolicy policy) {
+    size_t span = PoolSpan(layout);
+    size_t words = BitmapWords(layout);
+    size_t slot_bytes = ObjectSlotBytes(layout);
+    size_t prefix = sizeof(ObjectPoolHeader) + words * sizeof(uint32_t);
+    if (!in || span == 0 || size < prefix) return false;
+
+    ObjectPoolHeader header;
+    std::memcpy(&header, in, sizeof(header));
+    if (header.slot_count != layout.slot_count || header.slot_bytes != slot_bytes ||
+        size < prefix + header.live_count * slot_bytes) {
+        return false;
+    }
+    const uint32_t* bitmap = reinterpret_cast<const uint32_t*>(in + sizeof(ObjectPoolHeader));
+
+    const uint8_t* cursor = in + prefix;
+    uint8_t* pool = memory.Translate(layout.address, span);
+    if (!pool) {
+        return LoadObjectPoolSparse(memory, layout, bitmap, cursor, policy);
+    }
+
+    // Dead slots first: a live slot's flag may sit in the next slot's bytes.
+    // Their flags are cleared either way, or objects spawned after the save
+    // would stay active.
+    for (size_t slot = 0; slot < layout.slot_count; ++slot) {
+        if (SlotLive(bitmap, slot)) continue;
+        if (policy == DeadSlotPolicy::ZeroFill) {
+            std::memset(pool + slot * layout.slot_size, 0, slot_bytes);
+        } else {
+            std::memset(pool + slot * layout.slot_size + layout.active_flag_offset, 0, FLAG_SIZE);
+        }
+    }
+
+    for (size_t w = 0; w < words; ++w) {
+        for (uint32_t bits = bitmap[w]; bits; bits &= bits - 1) {
+            size_t slot = w * 32 + LowestBit(bits);
+            std::memcpy(pool + slot * layout.slot_size, cursor, slot_bytes);
+            cursor += slot_bytes;
+        }
+    }
+    return true;
+}
+
+} // namespace State
+} // namespace FM2K
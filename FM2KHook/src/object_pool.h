@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "snapshot.h"
+
+namespace FM2K {
+namespace State {
+
+// Fixed-stride object pool with a 16-bit active flag per slot
+struct ObjectPoolLayout {
+    uintptr_t address;
+    size_t slot_count;          // Slots that can hold live objects
+    size_t slot_size;           // Stride between slots
+    size_t active_flag_offset;  // Offset of the uint16 active flag from the slot start
+};
+
+// What LoadObjectPool does with slots that were dead when the pool was saved.
+// Their active flag is cleared under either policy.
+enum class DeadSlotPolicy {
+    ZeroFill,   // Clear them, so the restored pool matches a freshly cleared one
+    Skip        // Clear only the flag (cheaper; only safe if the game initializes slots on allocation)
+};
+
+// Sparse pool snapshot layout:
+//   ObjectPoolHeader, uint32 occupancy bitmap[(slot_count + 31) / 32],
+//   live_count x slot_bytes of live slot data in slot order
+struct ObjectPoolHeader {
+    uint32_t slot_count;
+    uint32_t live_count;
+    uint32_t slot_bytes;        // Bytes stored per live slot (includes the flag)
+    uint32_t reserved;
+};
+
+// Bytes captured per live slot: the slot plus its flag if the flag sits past the stride
+size_t ObjectSlotBytes(const ObjectPoolLayout& layout);
+
+// Upper bound on a sparse snapshot (every slot live)
+size_t MaxObjectPoolSnapshotSize(const ObjectPoolLayout& layout);
+
+// Fill one bit per slot (set = active) and return the live count.
+// `pool` points at the first slot; `bitmap` holds (slot_count + 31) / 32 words.
+size_t ScanActiveSlots(const uint8_t* pool, const ObjectPoolLayout& layout, uint32_t* bitmap);
+
+// Loops ScanActiveSlots can run, SSE2 by default where it is compiled in.
+// Flags sit a stride apart, so both load them one at a time; SSE2 turns each
+// group of eight into a mask with one compare and pack instead of eight
+// shift-ors. That only shows with the pool in cache; cold, every flag is a
+// cache miss and the two run alike (fm2k_pool_scan_bench).
+enum class ScanKernel {
+    Scalar,
+    SSE2
+};
+
+bool ScanKernelSupported(ScanKernel kernel);
+
+// Run a specific kernel (unsupported kernels fall back to scalar)
+size_t ScanActiveSlotsWith(ScanKernel kernel, const uint8_t* pool, const ObjectPoolLayout& layout, uint32_t* bitmap);
+
+// Serialize live slots into `out`. Returns bytes written, 0 on failure.
+// Backends without direct addressing read each slot's flag and then each
+// run of live slots (through `scratch`), never the whole pool; loading
+// through them likewise writes only dead runs (or flags) and live runs.
+size_t SaveObjectPool(MemoryBackend& memory, const ObjectPoolLayout& layout,
+                      uint8_t* out, size_t capacity, std::vector<uint8_t>& scratch);
+
+bool LoadObjectPool(MemoryBackend& memory, const ObjectPoolLayout& layout,
+                    const uint8_t* in, size_t size, DeadSlotPolicy policy = DeadSlotPolicy::ZeroFill);
+
+} // namespace State
+} // namespace FM2K
@@ -0,0 +1,412 @@
+#include "page_tracker.h"
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/mman.h>
+#endif
+
+namespace FM2K {
+namespace State {
+
+// The fault handler has no context argument, so it finds the tracker here
+static PageTracker* active_tracker = nullptr;
+
+#ifdef _WIN32
+static PVOID exception_handler = nullptr;
+
+static LONG CALLBACK TrackerExceptionHandler(EXCEPTION_POINTERS* info) {
+    EXCEPTION_RECORD* record = info->ExceptionRecord;
+    if (record->ExceptionCode != EXCEPTION_ACCESS_VIOLATION || record->NumberParameters < 2 ||
+        record->ExceptionInformation[0] != 1) {  // 1 = write access
+        return EXCEPTION_CONTINUE_SEARCH;
+    }
+
+    PageTracker* tracker = active_tracker;
+    if (tracker && tracker->OnWriteFault(static_cast<uintptr_t>(record->ExceptionInformation[1]))) {
+        return EXCEPTION_CONTINUE_EXECUTION;
+    }
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
+// Read-only protection that keeps the execute bit of the original
+static DWORD ReadOnlyProtect(DWORD original) {
+    switch (original & 0xFF) {
+        case PAGE_READWRITE:
+        case PAGE_WRITECOPY:
+            return PAGE_READONLY;
+        case PAGE_EXECUTE_READWRITE:
+        case PAGE_EXECUTE_WRITECOPY:
+            return PAGE_EXECUTE_READ;
+        default:
+            return 0;  // Not writable, nothing to track
+    }
+}
+#else
+static struct sigaction previous_action;
+
+static void TrackerSignalHandler(int sig, siginfo_t* info, void* context) {
+    PageTracker* tracker = active_tracker;
+    if (tracker && tracker->OnWriteFault(reinterpret_cast<uintptr_t>(info->si_addr))) {
+        return;
+    }
+
+    // Not one of ours: hand it to whoever had SIGSEGV before us and stay
+    // installed, so tracking carries on if that handler resolves the fault
+    if (previous_action.sa_flags & SA_SIGINFO) {
+        if (previous_action.sa_sigaction) {
+            previous_action.sa_sigaction(sig, info, context);
+            return;
+        }
+    } else if (previous_action.sa_handler != SIG_DFL && previous_action.sa_handler != SIG_IGN) {
+        previous_action.sa_handler(sig);
+        return;
+    }
+
+    // Nobody to chain to, so the fault is fatal: restore the default action
+    // and let it repeat. The process ends there, tracker and all.
+    signal(SIGSEGV, SIG_DFL);
+}
+#endif
+
+PageTracker::~PageTracker() {
+    Stop();
+}
+
+size_t PageTracker::AddRange(uint8_t* pages, size_t page_count) {
+    size_t first_page = dirty_.size();
+    if (active_ || !pages || page_count == 0) return first_page;
+
+    ranges_.push_back({ pages, page_count, first_page, 0 });
+    dirty_.resize(first_page + page_count, 0);
+    return first_page;
+}
+
+bool PageTracker::Protect(const Range& range, size_t first, size_t count, bool writable) {
+    uint8_t* address = range.base + first * TRACKED_PAGE_SIZE;
+    size_t size = count * TRACKED_PAGE_SIZE;
+#ifdef _WIN32
+    DWORD old_protect = 0;
+    DWORD protect = writable ? range.original_protect : ReadOnlyProtect(range.original_protect);
+    return VirtualProtect(address, size, protect, &old_protect) != FALSE;
+#else
+    return mprotect(address, size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ) == 0;
+#endif
+}
+
+bool PageTracker::Start() {
+    if (active_) return true;
+    if (ranges_.empty()) return false;
+    if (active_tracker) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "PageTracker: another tracker is already active");
+        return false;
+    }
+
+#ifdef _WIN32
+    for (Range& range : ranges_) {
+        MEMORY_BASIC_INFORMATION info = {};
+        if (!VirtualQuery(range.base, &info, sizeof(info)) || ReadOnlyProtect(info.Protect) == 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "PageTracker: range at %p is not writable", range.base);
+            return false;
+        }
+        range.original_protect = info.Protect;
+    }
+
+    exception_handler = AddVectoredExceptionHandler(1, TrackerExceptionHandler);
+    if (!exception_handler) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "PageTracker: AddVectoredExceptionHandler failed");
+        return false;
+    }
+#else
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_sigaction = TrackerSignalHandler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGSEGV, &action, &previous_action) != 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "PageTracker: sigaction failed");
+        return false;
+    }
+#endif
+
+    active_tracker = this;
+    active_ = true;
+    std::fill(dirty_.begin(), dirty_.end(), 0);
+
+    for (const Range& range : ranges_) {
+        if (!Protect(range, 0, range.page_count, false)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "PageTracker: failed to protect range at %p", range.base);
+            Stop();
+            return false;
+        }
+    }
+    return true;
+}
+
+void PageTracker::Stop() {
+    if (!active_) return;
+
+    for (const Range& range : ranges_) {
+        Protect(range, 0, range.page_count, true);
+    }
+
+#ifdef _WIN32
+    if (exception_handler) {
+        RemoveVectoredExceptionHandler(exception_handler);
+        exception_handler = nullptr;
+    }
+#else
+    sigaction(SIGSEGV, &previous_action, nullptr);
+#endif
+
+    active_tracker = nullptr;
+    active_ = false;
+}
+
+void PageTracker::Reset() {
+    Stop();
+    ranges_.clear();
+    dirty_.clear();
+    fault_count_ = 0;
+}
+
+bool PageTracker::OnWriteFault(uintptr_t address) {
+    for (const Range& range : ranges_) {
+        uintptr_t base = reinterpret_cast<uintptr_t>(range.base);
+        if (address < base || address >= base + range.page_count * TRACKED_PAGE_SIZE) continue;
+
+        size_t page = (address - base) / TRACKED_PAGE_SIZE;
+        dirty_[range.first_page + page] = 1;
+        fault_count_++;
+        return Protect(range, page, 1, true);
+    }
+    return false;
+}
+
+size_t PageTracker::TakeDirty(std::vector<uint8_t>& dirty) {
+    if (dirty.size() < dirty_.size()) {
+        dirty.resize(dirty_.size(), 0);
+    }
+
+    size_t count = 0;
+    for (const Range& range : ranges_) {
+        for (size_t page = 0; page < range.page_count; ++page) {
+            size_t index = range.first_page + page;
+            if (!dirty_[index]) continue;
+
+            dirty_[index] = 0;
+            dirty[index] = 1;
+            count++;
+            if (active_) {
+                Protect(range, page, 1, false);
+            }
+        }
+    }
+    return count;
+}
+
+bool TrackedSnapshotRing::Init(const SnapshotPlan& plan, LocalMemoryBackend& memory, size_t slot_count, bool track_writes) {
+    Shutdown();
+    if (slot_count == 0) return false;
+
+    plan_ = &plan;
+    memory_ = &memory;
+
+    // Page spans of every run large enough to be worth tracking
+    struct Span { uintptr_t begin; uintptr_t end; };
+    std::vector<Span> spans;
+    for (const MemoryRegion& run : plan.Runs()) {
+        uint8_t* host = memory.Translate(run.address, run.size);
+        if (!host) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "TrackedSnapshotRing: run 0x%08X is outside game memory",
+                         (unsigned)run.address);
+            Shutdown();
+            return false;
+        }
+        if (!track_writes || run.size < TRACKED_PAGE_SIZE) {
+            untracked_.push_back(run);
+            continue;
+        }
+        uintptr_t begin = reinterpret_cast<uintptr_t>(host) & ~(uintptr_t)(TRACKED_PAGE_SIZE - 1);
+        uintptr_t end = (reinterpret_cast<uintptr_t>(host) + run.size + TRACKED_PAGE_SIZE - 1) &
+                        ~(uintptr_t)(TRACKED_PAGE_SIZE - 1);
+        spans.push_back({ begin, end });
+    }
+
+    // Merge overlapping spans so each page is registered once
+    std::sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) { return a.begin < b.begin; });
+    std::vector<Span> merged;
+    for (const Span& span : spans) {
+        if (!merged.empty() && span.begin <= merged.back().end) {
+            merged.back().end = std::max(merged.back().end, span.end);
+        } else {
+            merged.push_back(span);
+        }
+    }
+    std::vector<size_t> first_pages;
+    for (const Span& span : merged) {
+        first_pages.push_back(tracker_.AddRange(reinterpret_cast<uint8_t*>(span.begin),
+                                                (span.end - span.begin) / TRACKED_PAGE_SIZE));
+    }
+
+    // Split tracked runs at page boundaries
+    for (const MemoryRegion& run : plan.Runs()) {
+        if (!track_writes || run.size < TRACKED_PAGE_SIZE) continue;
+
+        uint8_t* host = memory.Translate(run.address, run.size);
+        uintptr_t cursor = reinterpret_cast<uintptr_t>(host);
+        uintptr_t end = cursor + run.size;
+        size_t span_index = 0;
+        while (merged[span_index].end <= cursor) span_index++;
+
+        while (cursor < end) {
+            uintptr_t page_end = (cursor & ~(uintptr_t)(TRACKED_PAGE_SIZE - 1)) + TRACKED_PAGE_SIZE;
+            size_t size = static_cast<size_t>(std::min(page_end, end) - cursor);
+            size_t page = first_pages[span_index] + (cursor - merged[span_index].begin) / TRACKED_PAGE_SIZE;
+            size_t offset = run.offset + static_cast<size_t>(cursor - reinterpret_cast<uintptr_t>(host));
+            segments_.push_back({ reinterpret_cast<uint8_t*>(cursor), size, offset, page });
+            cursor += size;
+        }
+    }
+
+    // Every slot starts out stale everywhere
+    stale_.assign(slot_count, std::vector<uint8_t>(tracker_.PageCount(), 1));
+    live_.assign(tracker_.PageCount(), 0);
+    changed_.assign(tracker_.PageCount(), 1);
+    scratch_.assign(tracker_.PageCount(), 0);
+
+    if (tracker_.PageCount() > 0 && !tracker_.Start()) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "TrackedSnapshotRing: write tracking unavailable, using full copies");
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "TrackedSnapshotRing: %u slots, %u tracked pages, %u untracked runs",
+                (unsigned)slot_count, (unsigned)tracker_.PageCount(), (unsigned)untracked_.size());
+    return true;
+}
+
+void TrackedSnapshotRing::Shutdown() {
+    tracker_.Reset();
+    segments_.clear();
+    untracked_.clear();
+    stale_.clear();
+    live_.clear();
+    changed_.clear();
+    scratch_.clear();
+    plan_ = nullptr;
+    memory_ = nullptr;
+    stats_ = {};
+}
+
+void TrackedSnapshotRing::MarkLive(std::vector<uint8_t>& pages) {
+    std::fill(pages.begin(), pages.end(), 0);
+    if (tracker_.TakeDirty(pages) == 0) return;
+
+    for (size_t page = 0; page < pages.size(); ++page) {
+        if (!pages[page]) continue;
+        changed_[page] = 1;
+        for (auto& slot : stale_) {
+            slot[page] = 1;
+        }
+    }
+}
+
+bool TrackedSnapshotRing::Save(size_t slot, uint8_t* buffer) {
+    if (!plan_ || !buffer || slot >= stale_.size()) return false;
+
+    bool tracking = tracker_.IsActive();
+    if (tracking) {
+        MarkLive(live_);
+    }
+
+    uint64_t copied = 0;
+    for (const MemoryRegion& run : untracked_) {
+        if (!memory_->Read(run.address, buffer + run.offset, run.size)) return false;
+        copied += run.size;
+    }
+
+    std::vector<uint8_t>& stale = stale_[slot];
+    for (const Segment& segment : segments_) {
+        if (tracking && !stale[segment.page]) continue;
+        std::memcpy(buffer + segment.offset, segment.host, segment.size);
+        copied += segment.size;
+    }
+    std::fill(stale.begin(), stale.end(), 0);
+
+    stats_.saves++;
+    stats_.bytes_copied += copied;
+    stats_.bytes_full += plan_->BufferSize();
+    return true;
+}
+
+bool TrackedSnapshotRing::Load(size_t slot, const uint8_t* buffer) {
+    if (!plan_ || !buffer || slot >= stale_.size()) return false;
+
+    bool tracking = tracker_.IsActive();
+    std::vector<uint8_t>& changed = live_;
+    if (tracking) {
+        // Pages where memory may differ from the slot: written since the last
+        // save/load, or already different from it at that point
+        std::fill(changed.begin(), changed.end(), 0);
+        tracker_.TakeDirty(changed);
+        for (size_t page = 0; page < changed.size(); ++page) {
+            changed[page] |= stale_[slot][page];
+        }
+    }
+
+    uint64_t copied = 0;
+    for (const MemoryRegion& run : untracked_) {
+        if (!memory_->Write(run.address, buffer + run.offset, run.size)) return false;
+        copied += run.size;
+    }
+
+    for (const Segment& segment : segments_) {
+        if (tracking && !changed[segment.page]) continue;
+        std::memcpy(segment.host, buffer + segment.offset, segment.size);
+        copied += segment.size;
+    }
+
+    if (tracking) {
+        // Our own writes faulted too; memory now matches the slot, so drop them
+        std::fill(scratch_.begin(), scratch_.end(), 0);
+        tracker_.TakeDirty(scratch_);
+
+        for (size_t page = 0; page < changed.size(); ++page) {
+            changed_[page] |= changed[page];
+        }
+        for (size_t other = 0; other < stale_.size(); ++other) {
+            if (other == slot) continue;
+            for (size_t page = 0; page < changed.size(); ++page) {
+                stale_[other][page] |= changed[page];
+            }
+        }
+    }
+    std::fill(stale_[slot].begin(), stale_[slot].end(), 0);
+
+    stats_.loads++;
+    stats_.bytes_copied += copied;
+    stats_.bytes_full += plan_->BufferSize();
+    return true;
+}
+
+void TrackedSnapshotRing::TakeChangedRanges(std::vector<MemoryRegion>& out) {
+    out.clear();
+    out.insert(out.end(), untracked_.begin(), untracked_.end());
+
+    bool tracking = tracker_.IsActive();
+    for (const Segment& segment : segments_) {
+        if (tracking && !changed_[segment.page]) continue;
+        out.push_back({ 0, segment.size, segment.offset });
+    }
+    std::fill(changed_.begin(), changed_.end(), 0);
+}
+
+TrackedSnapshotRing::Stats TrackedSnapshotRing::GetStats() const {
+    Stats stats = stats_;
+    stats.faults = tracker_.FaultCount();
+    return stats;
+}
+
+} // namespace State
+} // namespace FM2K
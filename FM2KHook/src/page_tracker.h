@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "snapshot.h"
+
+namespace FM2K {
+namespace State {
+
+constexpr size_t TRACKED_PAGE_SIZE = 4096;
+
+// Page-granular write tracking over host memory. Armed pages are made
+// read-only; the first write to one faults into our handler, which records the
+// page and makes it writable again. Windows uses a vectored exception handler
+// with VirtualProtect, everything else a SIGSEGV handler with mprotect.
+// Only one tracker can be started per process.
+class PageTracker {
+public:
+    PageTracker() = default;
+    ~PageTracker();
+
+    PageTracker(const PageTracker&) = delete;
+    PageTracker& operator=(const PageTracker&) = delete;
+
+    // Register a page-aligned range before Start(). Returns the index of its first page.
+    size_t AddRange(uint8_t* pages, size_t page_count);
+
+    bool Start();
+    void Stop();
+    void Reset();   // Stop and forget all ranges
+    bool IsActive() const { return active_; }
+
+    size_t PageCount() const { return dirty_.size(); }
+
+    // OR every page written since the last call into `dirty` (one byte per
+    // page) and re-protect those pages. Returns the number of dirty pages.
+    size_t TakeDirty(std::vector<uint8_t>& dirty);
+
+    uint64_t FaultCount() const { return fault_count_; }
+
+    // Called from the platform fault handler. Returns false if the address is
+    // not ours so the fault can be passed on.
+    bool OnWriteFault(uintptr_t address);
+
+private:
+    struct Range {
+        uint8_t* base;
+        size_t page_count;
+        size_t first_page;
+        uint32_t original_protect;  // Windows page protection to restore on write
+    };
+
+    bool Protect(const Range& range, size_t first, size_t count, bool writable);
+
+    std::vector<Range> ranges_;
+    std::vector<uint8_t> dirty_;         // Written from the fault handler
+    uint64_t fault_count_ = 0;
+    bool active_ = false;
+};
+
+// Snapshot ring that copies only pages written since each slot was last
+// brought up to date. Every slot keeps a stale-page mask relative to the live
+// memory at the last save/load; a save copies the target slot's stale pages, a
+// load writes back the pages that differ between memory and that slot. Runs
+// smaller than a page are copied every time; they are cheap and may sit on
+// pages we must not write-protect.
+class TrackedSnapshotRing {
+public:
+    struct Stats {
+        uint64_t saves;
+        uint64_t loads;
+        uint64_t bytes_copied;   // Bytes actually moved by saves and loads
+        uint64_t bytes_full;     // Bytes a full copy would have moved
+        uint64_t faults;         // Write faults taken by the tracker
+    };
+
+    TrackedSnapshotRing() = default;
+
+    // `plan` and `memory` must outlive the ring. Without write tracking (or if
+    // the tracker cannot start) every save and load copies the whole plan.
+    bool Init(const SnapshotPlan& plan, LocalMemoryBackend& memory, size_t slot_count, bool track_writes = true);
+    void Shutdown();
+
+    bool Save(size_t slot, uint8_t* buffer);
+    bool Load(size_t slot, const uint8_t* buffer);
+
+    // Slot-buffer ranges (offset/size) whose live contents may have changed
+    // since the previous call: written by the game, or rewritten by a load.
+    // Untracked runs are always reported, and everything is while tracking is off.
+    void TakeChangedRanges(std::vector<MemoryRegion>& out);
+
+    bool IsTracking() const { return tracker_.IsActive(); }
+    Stats GetStats() const;
+
+private:
+    struct Segment {
+        uint8_t* host;      // Live memory
+        size_t size;
+        size_t offset;      // Offset into the slot buffer
+        size_t page;        // Tracker page index
+    };
+
+    void MarkLive(std::vector<uint8_t>& pages);
+
+    const SnapshotPlan* plan_ = nullptr;
+    LocalMemoryBackend* memory_ = nullptr;
+    PageTracker tracker_;
+    std::vector<Segment> segments_;             // Page-sized pieces of tracked runs
+    std::vector<MemoryRegion> untracked_;       // Sub-page runs, always copied
+    std::vector<std::vector<uint8_t>> stale_;   // Per slot, per page
+    std::vector<uint8_t> live_;
+    std::vector<uint8_t> changed_;              // Per page, since the last TakeChangedRanges
+    std::vector<uint8_t> scratch_;
+    Stats stats_ = {};
+};
+
+} // namespace State
+} // namespace FM2K
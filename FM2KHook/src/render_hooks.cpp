@@ -0,0 +1,300 @@
+#include "render_hooks.h"
+#include "state_schema.h"
+#include <windows.h>
+#include <MinHook.h>
+#include <SDL3/SDL.h>
+
+namespace FM2K {
+namespace Render {
+
+// The render entry points are engine code that MinHook patches; rollback
+// must never snapshot or restore their bytes
+static_assert(State::InEngineCode(GRAPHICS_BLITTER_ADDR) && State::InEngineCode(SPRITE_RENDERING_ENGINE_ADDR) &&
+              State::InEngineCode(RENDER_FRAME_ADDR), "Render hook targets must lie in engine code");
+static_assert(State::SchemaAvoids(State::STATE_SCHEMA, GRAPHICS_BLITTER_ADDR) &&
+              State::SchemaAvoids(State::STATE_SCHEMA, SPRITE_RENDERING_ENGINE_ADDR) &&
+              State::SchemaAvoids(State::STATE_SCHEMA, RENDER_FRAME_ADDR),
+              "STATE_SCHEMA covers a hooked render function");
+
+namespace {
+
+// Calling convention. None of the three functions has its arguments or its
+// convention mapped yet, and this engine has __thiscall and __fastcall
+// routines that take arguments in ECX/EDX. So the detours are naked stubs
+// that leave the caller's registers and stack as they arrived: they save
+// ECX and EDX around the bookkeeping call (EAX carries no argument in any
+// MSVC x86 convention), then jump to the trampoline. To time the call, the
+// stub swaps the return address for RenderReturn, which stops the clock and
+// jumps back to the real caller with EAX:EDX as the callee left them, no
+// matter how many argument bytes the callee popped.
+//
+// Skipping a call is the one place the convention still matters: the skip
+// stub returns with a bare `ret`. That is right for __cdecl and for
+// __thiscall/__fastcall calls whose arguments all fit in registers; a
+// target found to end in `ret n` must not be suppressed until its
+// arguments are mapped.
+static_assert(sizeof(void*) == sizeof(uint32_t), "Render detours are x86 stubs; the hook must be built 32-bit");
+
+typedef void (*RenderFn)();
+
+// The return value (eax) is not mapped either. A skipped call hands back
+// what that function last returned rather than an invented 0, so a caller
+// that does test it sees the same answer it saw on drawn frames.
+struct RenderTarget {
+    RenderFn original;
+    uint32_t last_result;
+    uint64_t Stats::*skipped;
+    bool reducible;             // Skipped while catching up at reduced fidelity
+};
+
+// The stubs reach these by symbol name from assembly, so they are also kept
+// from being discarded as unused
+#if defined(_MSC_VER)
+#define FM2K_RENDER_SYMBOL(name)
+#define FM2K_RENDER_USED
+#else
+#define FM2K_RENDER_SYMBOL(name) __asm__(name)
+#define FM2K_RENDER_USED __attribute__((used))
+#endif
+
+FM2K_RENDER_USED RenderTarget blitter FM2K_RENDER_SYMBOL("fm2k_render_blitter") =
+    { nullptr, 0, &Stats::blits_skipped, true };
+FM2K_RENDER_USED RenderTarget sprite_engine FM2K_RENDER_SYMBOL("fm2k_render_sprite_engine") =
+    { nullptr, 0, &Stats::sprites_skipped, false };
+FM2K_RENDER_USED RenderTarget render_frame FM2K_RENDER_SYMBOL("fm2k_render_frame") =
+    { nullptr, 0, &Stats::presents_skipped, false };
+FM2K_RENDER_USED uint32_t skip_result FM2K_RENDER_SYMBOL("fm2k_render_skip_result") = 0;
+
+bool hooks_active = false;
+bool suppress_current = false;
+bool reduced_fidelity = false;     // Requested for upcoming frames
+bool reduced_current = false;      // Latched at the start of the frame being drawn
+uint32_t pending_suppressed = 0;
+
+// Render time is measured at the outermost hooked call only, since the
+// sprite engine may blit through the blitter. Each timed call's real return
+// address waits here until RenderReturn; calls nested deeper than this go
+// through untimed.
+constexpr uint32_t MAX_RENDER_DEPTH = 16;
+struct PendingReturn {
+    uintptr_t address;
+    RenderTarget* target;
+};
+PendingReturn pending_returns[MAX_RENDER_DEPTH];
+uint32_t render_depth = 0;
+LARGE_INTEGER render_start = {};
+int64_t frame_render_ticks = 0;
+double ticks_per_us = 0.0;
+
+constexpr double RENDER_AVERAGE_WEIGHT = 1.0 / 32.0;
+
+Stats stats = {};
+
+extern "C" void RenderReturn() FM2K_RENDER_SYMBOL("fm2k_render_return");
+extern "C" void RenderSkipped() FM2K_RENDER_SYMBOL("fm2k_render_skipped");
+uintptr_t __cdecl RenderEnter(RenderTarget* target, uintptr_t* return_slot) FM2K_RENDER_SYMBOL("fm2k_render_enter");
+uintptr_t __cdecl RenderLeave(uint32_t result) FM2K_RENDER_SYMBOL("fm2k_render_leave");
+
+// Called by a stub with the slot holding its caller's return address.
+// Returns where the stub jumps: the trampoline, or RenderSkipped.
+FM2K_RENDER_USED uintptr_t __cdecl RenderEnter(RenderTarget* target, uintptr_t* return_slot) {
+    if (suppress_current || (target->reducible && reduced_current)) {
+        if (suppress_current) {
+            stats.*(target->skipped) += 1;
+        } else {
+            stats.blits_reduced++;
+        }
+        skip_result = target->last_result;
+        return reinterpret_cast<uintptr_t>(&RenderSkipped);
+    }
+    if (render_depth == MAX_RENDER_DEPTH) {
+        return reinterpret_cast<uintptr_t>(target->original);
+    }
+
+    if (render_depth == 0) QueryPerformanceCounter(&render_start);
+    pending_returns[render_depth++] = { *return_slot, target };
+    *return_slot = reinterpret_cast<uintptr_t>(&RenderReturn);
+    return reinterpret_cast<uintptr_t>(target->original);
+}
+
+// Called by RenderReturn with the callee's EAX; returns the caller's
+// real return address
+FM2K_RENDER_USED uintptr_t __cdecl RenderLeave(uint32_t result) {
+    PendingReturn pending = pending_returns[--render_depth];
+    pending.target->last_result = result;
+    if (render_depth == 0) {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        frame_render_ticks += now.QuadPart - render_start.QuadPart;
+    }
+    return pending.address;
+}
+
+#if defined(_MSC_VER)
+
+#define FM2K_RENDER_STUB(name, target)                                          \
+    __declspec(naked) void name() {                                            \
+        __asm push ecx                                                          \
+        __asm push edx                                                          \
+        __asm lea eax, [esp + 8]                                                \
+        __asm push eax                                                          \
+        __asm push offset target                                                \
+        __asm call RenderEnter                                                  \
+        __asm add esp, 8                                                        \
+        __asm pop edx                                                           \
+        __asm pop ecx                                                           \
+        __asm jmp eax                                                           \
+    }
+
+// Timed calls come back here instead of to their caller. ECX is free: no
+// convention expects it preserved across a call.
+extern "C" __declspec(naked) void RenderReturn() {
+    __asm {
+        push eax
+        push edx
+        push eax
+        call RenderLeave
+        add esp, 4
+        mov ecx, eax
+        pop edx
+        pop eax
+        jmp ecx
+    }
+}
+
+extern "C" __declspec(naked) void RenderSkipped() {
+    __asm {
+        mov eax, skip_result
+        ret
+    }
+}
+
+#else
+
+#define FM2K_RENDER_STUB(name, symbol)                                          \
+    __attribute__((naked)) void name() {                                       \
+        __asm__("push %ecx\n\t"                                                 \
+                "push %edx\n\t"                                                 \
+                "lea 8(%esp), %eax\n\t"                                         \
+                "push %eax\n\t"                                                 \
+                "push $" symbol "\n\t"                                          \
+                "call fm2k_render_enter\n\t"                                    \
+                "add $8, %esp\n\t"                                              \
+                "pop %edx\n\t"                                                  \
+                "pop %ecx\n\t"                                                  \
+                "jmp *%eax\n\t");                                               \
+    }
+
+extern "C" __attribute__((naked)) void RenderReturn() {
+    __asm__("push %eax\n\t"
+            "push %edx\n\t"
+            "push %eax\n\t"
+            "call fm2k_render_leave\n\t"
+            "add $4, %esp\n\t"
+            "mov %eax, %ecx\n\t"
+            "pop %edx\n\t"
+            "pop %eax\n\t"
+            "jmp *%ecx\n\t");
+}
+
+extern "C" __attribute__((naked)) void RenderSkipped() {
+    __asm__("mov fm2k_render_skip_result, %eax\n\t"
+            "ret\n\t");
+}
+
+#endif
+
+#if defined(_MSC_VER)
+FM2K_RENDER_STUB(BlitterDetour, blitter)
+FM2K_RENDER_STUB(SpriteEngineDetour, sprite_engine)
+FM2K_RENDER_STUB(RenderFrameDetour, render_frame)
+#else
+FM2K_RENDER_STUB(BlitterDetour, "fm2k_render_blitter")
+FM2K_RENDER_STUB(SpriteEngineDetour, "fm2k_render_sprite_engine")
+FM2K_RENDER_STUB(RenderFrameDetour, "fm2k_render_frame")
+#endif
+
+bool QueueRenderHook(uintptr_t address, LPVOID detour, RenderFn* original, const char* name) {
+    MH_STATUS status = MH_CreateHook((LPVOID)address, detour, (LPVOID*)original);
+    if (status == MH_OK) {
+        status = MH_QueueEnableHook((LPVOID)address);
+    }
+    if (status != MH_OK) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Failed to hook %s at 0x%08X: %d",
+                     name, (unsigned)address, status);
+        return false;
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+bool InstallRenderHooks() {
+    if (hooks_active) return true;
+
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    ticks_per_us = static_cast<double>(frequency.QuadPart) / 1000000.0;
+
+    if (!QueueRenderHook(GRAPHICS_BLITTER_ADDR, (LPVOID)&BlitterDetour, &blitter.original, "graphics_blitter") ||
+        !QueueRenderHook(SPRITE_RENDERING_ENGINE_ADDR, (LPVOID)&SpriteEngineDetour, &sprite_engine.original,
+                         "sprite_rendering_engine") ||
+        !QueueRenderHook(RENDER_FRAME_ADDR, (LPVOID)&RenderFrameDetour, &render_frame.original, "render_frame")) {
+        return false;
+    }
+
+    MH_STATUS status = MH_ApplyQueued();
+    if (status != MH_OK) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "FM2K HOOK: Failed to enable render hooks: %d", status);
+        return false;
+    }
+
+    hooks_active = true;
+    return true;
+}
+
+bool RenderHooksActive() {
+    return hooks_active;
+}
+
+void BeginRenderFrame() {
+    if (!hooks_active) return;
+
+    if (suppress_current) {
+        stats.frames_suppressed++;
+        stats.render_us_saved += stats.avg_render_us;
+    } else if (reduced_current) {
+        // Cheaper than a full draw, so kept out of the average
+        stats.frames_reduced++;
+    } else if (frame_render_ticks > 0) {
+        double frame_us = static_cast<double>(frame_render_ticks) / ticks_per_us;
+        stats.avg_render_us = stats.frames_rendered == 0
+            ? frame_us
+            : stats.avg_render_us + (frame_us - stats.avg_render_us) * RENDER_AVERAGE_WEIGHT;
+        stats.frames_rendered++;
+    }
+    frame_render_ticks = 0;
+
+    suppress_current = pending_suppressed > 0;
+    if (suppress_current) pending_suppressed--;
+    reduced_current = reduced_fidelity && !suppress_current;
+}
+
+void SuppressRenderFrames(uint32_t frames) {
+    pending_suppressed = frames;
+}
+
+bool RenderSuppressed() {
+    return suppress_current;
+}
+
+void SetReducedFidelity(bool reduced) {
+    reduced_fidelity = reduced;
+}
+
+Stats GetRenderStats() {
+    return stats;
+}
+
+} // namespace Render
+} // namespace FM2K
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+namespace FM2K {
+namespace Render {
+
+// Engine render entry points (from IDA analysis)
+constexpr uintptr_t GRAPHICS_BLITTER_ADDR        = 0x40C140;
+constexpr uintptr_t SPRITE_RENDERING_ENGINE_ADDR = 0x40CC30;
+constexpr uintptr_t RENDER_FRAME_ADDR            = 0x404C10;  // Frame buffer to screen
+
+struct Stats {
+    uint64_t frames_rendered;
+    uint64_t frames_suppressed;
+    uint64_t blits_skipped;
+    uint64_t sprites_skipped;
+    uint64_t presents_skipped;
+    uint64_t frames_reduced;    // Drawn without the blitter while catching up
+    uint64_t blits_reduced;
+    double avg_render_us;       // Moving average over rendered frames
+    double render_us_saved;     // avg_render_us charged for each suppressed frame
+};
+
+// Hooks the blitter, sprite engine and present so simulation-only frames can
+// skip them. Requires MH_Initialize to have been called.
+bool InstallRenderHooks();
+bool RenderHooksActive();
+
+// Start of a game frame: closes the previous frame's render timing and
+// decides whether this one draws
+void BeginRenderFrame();
+
+// The next `frames` game frames run logic only; the one after renders
+// normally. Replaces any pending count, so a rollback issued mid-resim
+// simply restarts it.
+void SuppressRenderFrames(uint32_t frames);
+bool RenderSuppressed();
+
+// Frames drawn while a rollback catch-up is spread over several displayed
+// frames skip the blitter (blend-mode effects) but keep sprites and present
+void SetReducedFidelity(bool reduced);
+
+Stats GetRenderStats();
+
+} // namespace Render
+} // namespace FM2K
@@ -0,0 +1,227 @@
+#include "replay_format.h"
+#include <algorithm>
+#include <cstring>
+
+namespace FM2K {
+
+namespace {
+
+constexpr uint32_t SPAN_FILL = 0x80000000u;
+constexpr uint32_t SPAN_COUNT_MASK = 0x7FFFFFFFu;
+constexpr size_t MIN_FILL_WORDS = 3;    // Shorter repeats stay literal
+
+uint32_t LoadWord(const uint8_t* state, size_t state_size, size_t word) {
+    uint32_t value = 0;
+    size_t offset = word * 4;
+    std::memcpy(&value, state + offset, std::min<size_t>(4, state_size - offset));
+    return value;
+}
+
+void StoreWord(uint8_t*& out, uint32_t value) {
+    std::memcpy(out, &value, 4);
+    out += 4;
+}
+
+} // anonymous namespace
+
+size_t MaxEncodedKeyframeSize(size_t state_size) {
+    // Worst case: literal spans broken up by minimal fills
+    size_t words = (state_size + 3) / 4;
+    return (words + 2 * (words / MIN_FILL_WORDS + 1)) * 4;
+}
+
+size_t EncodeKeyframe(const uint8_t* state, size_t state_size, uint8_t* out) {
+    size_t words = (state_size + 3) / 4;
+    uint8_t* start = out;
+    size_t literal_start = 0;
+    size_t word = 0;
+
+    auto flush_literal = [&](size_t end) {
+        if (end == literal_start) return;
+        StoreWord(out, static_cast<uint32_t>(end - literal_start));
+        for (size_t n = literal_start; n < end; n++) StoreWord(out, LoadWord(state, state_size, n));
+    };
+
+    while (word < words) {
+        uint32_t value = LoadWord(state, state_size, word);
+        size_t run = 1;
+        while (word + run < words && run < SPAN_COUNT_MASK && LoadWord(state, state_size, word + run) == value) run++;
+        if (run < MIN_FILL_WORDS) {
+            word += run;
+            continue;
+        }
+        flush_literal(word);
+        StoreWord(out, SPAN_FILL | static_cast<uint32_t>(run));
+        StoreWord(out, value);
+        word += run;
+        literal_start = word;
+    }
+    flush_literal(words);
+    return static_cast<size_t>(out - start);
+}
+
+bool DecodeKeyframe(const uint8_t* data, size_t size, uint8_t* state, size_t state_size) {
+    size_t words = (state_size + 3) / 4;
+    size_t word = 0;
+    size_t offset = 0;
+
+    // Whole words go straight to the state; the padded last one is trimmed
+    auto put = [&](uint32_t value) {
+        size_t at = word * 4;
+        std::memcpy(state + at, &value, std::min<size_t>(4, state_size - at));
+        word++;
+    };
+
+    while (offset + 4 <= size) {
+        uint32_t control = 0;
+        std::memcpy(&control, data + offset, 4);
+        offset += 4;
+        size_t count = control & SPAN_COUNT_MASK;
+        if (count == 0 || word + count > words) return false;
+
+        if (control & SPAN_FILL) {
+            if (offset + 4 > size) return false;
+            uint32_t value = 0;
+            std::memcpy(&value, data + offset, 4);
+            offset += 4;
+            for (size_t n = 0; n < count; n++) put(value);
+        } else {
+            if (offset + count * 4 > size) return false;
+            for (size_t n = 0; n < count; n++, offset += 4) {
+                uint32_t value = 0;
+                std::memcpy(&value, data + offset, 4);
+                put(value);
+            }
+        }
+    }
+    return offset == size && word == words;
+}
+
+bool ReplayReader::Open(const uint8_t* data, size_t size) {
+    data_ = nullptr;
+    size_ = 0;
+    end_frame_ = 0;
+    keyframes_.clear();
+
+    if (!data || size < sizeof(ReplayFileHeader)) return false;
+    std::memcpy(&header_, data, sizeof(header_));
+    if (header_.magic != REPLAY_MAGIC || header_.version != REPLAY_VERSION ||
+        header_.header_size < sizeof(ReplayFileHeader) || header_.header_size % 4 != 0 || header_.header_size > size ||
+        header_.block_frames == 0 || header_.block_frames > MAX_PACKED_FRAMES || header_.state_size == 0) {
+        return false;
+    }
+    data_ = data;
+    size_ = size;
+
+    if (size >= header_.header_size + sizeof(ReplayFooter)) {
+        ReplayFooter footer;
+        std::memcpy(&footer, data + size - sizeof(footer), sizeof(footer));
+        if (footer.magic == REPLAY_FOOTER_MAGIC && ReadIndex(footer)) return true;
+    }
+    return Scan();
+}
+
+const ReplayRecord* ReplayReader::RecordAt(uint64_t offset) const {
+    if (offset < header_.header_size || offset % 4 != 0 || offset + sizeof(ReplayRecord) > size_) return nullptr;
+    const ReplayRecord* record = reinterpret_cast<const ReplayRecord*>(data_ + offset);
+    if (record->size > size_ - offset - sizeof(ReplayRecord)) return nullptr;
+    return record;
+}
+
+bool ReplayReader::ReadIndex(const ReplayFooter& footer) {
+    const ReplayRecord* record = RecordAt(footer.index_offset);
+    if (!record || record->type != static_cast<uint32_t>(ReplayRecordType::Index) ||
+        record->size != record->count * sizeof(ReplayIndexEntry)) {
+        return false;
+    }
+
+    const uint8_t* entries = reinterpret_cast<const uint8_t*>(record + 1);
+    keyframes_.resize(record->count);
+    for (size_t n = 0; n < keyframes_.size(); n++) {
+        std::memcpy(&keyframes_[n], entries + n * sizeof(ReplayIndexEntry), sizeof(ReplayIndexEntry));
+        const ReplayRecord* keyframe = RecordAt(keyframes_[n].offset);
+        if (!keyframe || keyframe->type != static_cast<uint32_t>(ReplayRecordType::Keyframe) ||
+            keyframe->frame != keyframes_[n].frame || (n > 0 && keyframes_[n].frame <= keyframes_[n - 1].frame)) {
+            keyframes_.clear();
+            return false;
+        }
+    }
+    end_frame_ = footer.end_frame;
+    return true;
+}
+
+// No usable footer: walk the records up to the first one cut short
+bool ReplayReader::Scan() {
+    uint64_t offset = header_.header_size;
+    end_frame_ = header_.first_frame;
+    while (const ReplayRecord* record = RecordAt(offset)) {
+        if (record->type == static_cast<uint32_t>(ReplayRecordType::Keyframe)) {
+            keyframes_.push_back({ record->frame, 0, offset });
+        } else if (record->type == static_cast<uint32_t>(ReplayRecordType::Inputs)) {
+            end_frame_ = record->frame + record->count;
+        } else {
+            break;
+        }
+        offset += sizeof(ReplayRecord) + ReplayPadded(record->size);
+    }
+    return true;
+}
+
+bool ReplayReader::LoadKeyframe(uint32_t frame, uint32_t* keyframe, uint8_t* state) const {
+    auto next = std::upper_bound(keyframes_.begin(), keyframes_.end(), frame,
+                                 [](uint32_t value, const ReplayIndexEntry& entry) { return value < entry.frame; });
+    if (next == keyframes_.begin()) return false;
+    const ReplayIndexEntry& entry = *(next - 1);
+
+    const ReplayRecord* record = RecordAt(entry.offset);
+    if (!record || !DecodeKeyframe(reinterpret_cast<const uint8_t*>(record + 1), record->size, state,
+                                   header_.state_size)) {
+        return false;
+    }
+    *keyframe = entry.frame;
+    return true;
+}
+
+bool ReplayReader::ReadInputs(uint32_t frame, size_t count, uint16_t* p1, uint16_t* p2) const {
+    if (count == 0) return true;
+    if (frame < header_.first_frame || frame + count > end_frame_) return false;
+
+    // Inputs records after the nearest keyframe (or the header) cover the range in order
+    auto next = std::upper_bound(keyframes_.begin(), keyframes_.end(), frame,
+                                 [](uint32_t value, const ReplayIndexEntry& entry) { return value < entry.frame; });
+    uint64_t offset = next == keyframes_.begin() ? header_.header_size : (next - 1)->offset;
+
+    uint16_t block[2][MAX_PACKED_FRAMES];
+    uint32_t end = frame + static_cast<uint32_t>(count);
+    uint32_t cursor = frame;
+    while (cursor < end) {
+        const ReplayRecord* record = RecordAt(offset);
+        if (!record || record->type == static_cast<uint32_t>(ReplayRecordType::Index)) return false;
+        offset += sizeof(ReplayRecord) + ReplayPadded(record->size);
+        if (record->type != static_cast<uint32_t>(ReplayRecordType::Inputs)) continue;
+        if (record->frame + record->count <= cursor) continue;
+        if (record->frame > cursor || record->size < sizeof(ReplayInputBlock)) return false;
+
+        ReplayInputBlock sizes;
+        const uint8_t* payload = reinterpret_cast<const uint8_t*>(record + 1);
+        std::memcpy(&sizes, payload, sizeof(sizes));
+        if (sizeof(sizes) + sizes.p1_size + sizes.p2_size > record->size) return false;
+
+        uint32_t first[2] = {};
+        size_t frames[2] = {
+            UnpackInputFrames(payload + sizeof(sizes), sizes.p1_size, &first[0], block[0], MAX_PACKED_FRAMES),
+            UnpackInputFrames(payload + sizeof(sizes) + sizes.p1_size, sizes.p2_size, &first[1], block[1],
+                              MAX_PACKED_FRAMES)
+        };
+        if (frames[0] != record->count || frames[1] != record->count) return false;
+
+        uint32_t stop = std::min(end, record->frame + record->count);
+        for (; cursor < stop; cursor++) {
+            p1[cursor - frame] = block[0][cursor - record->frame];
+            p2[cursor - frame] = block[1][cursor - record->frame];
+        }
+    }
+    return true;
+}
+
+} // namespace FM2K
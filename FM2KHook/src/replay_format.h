@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "input_codec.h"
+
+namespace FM2K {
+
+// Replay file: confirmed inputs plus periodic state keyframes, appended as
+// records after a fixed header and closed by a seek index. Every field is
+// little-endian and every record 4-byte aligned, so a mapped file is read in
+// place. The recorder rewrites the index and footer after each flush, so a
+// file cut short by a crash still opens up to its last flush; without a
+// footer the reader falls back to scanning the records.
+//
+//   ReplayFileHeader
+//   records:  ReplayRecord + payload, padded to 4 bytes
+//             Inputs:   a block of frames, ReplayInputBlock then each
+//                       player's PackInputFrames() window (runs of unchanged
+//                       wire inputs)
+//             Keyframe: state at the start of `frame`, EncodeKeyframe()
+//             Index:    ReplayIndexEntry per keyframe, last record
+//   ReplayFooter
+//
+// Keyframes come first at their frame: seeking loads the nearest keyframe at
+// or before the target and replays the Inputs records after it.
+constexpr uint32_t REPLAY_MAGIC = 0x52324D46;           // "FM2R"
+constexpr uint32_t REPLAY_FOOTER_MAGIC = 0x49324D46;    // "FM2I"
+constexpr uint32_t REPLAY_VERSION = 1;
+
+struct ReplayFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t state_size;            // Decoded keyframe bytes
+    uint32_t keyframe_interval;     // Frames between keyframes
+    uint32_t block_frames;          // Frames per Inputs record
+    uint32_t first_frame;
+    uint32_t reserved;
+    InputMap input_map;             // Wire bit -> game bit, for FromWire on playback
+};
+
+enum class ReplayRecordType : uint32_t {
+    Inputs = 1,
+    Keyframe = 2,
+    Index = 3
+};
+
+struct ReplayRecord {
+    uint32_t type;                  // ReplayRecordType
+    uint32_t frame;                 // First frame covered
+    uint32_t count;                 // Frames (Inputs) or entries (Index)
+    uint32_t size;                  // Payload bytes, before padding
+};
+
+struct ReplayInputBlock {
+    uint16_t p1_size;               // Packed bytes per player
+    uint16_t p2_size;
+};
+
+struct ReplayIndexEntry {
+    uint32_t frame;                 // Keyframe frame
+    uint32_t reserved;
+    uint64_t offset;                // File offset of its record
+};
+
+struct ReplayFooter {
+    uint64_t index_offset;          // File offset of the Index record
+    uint32_t end_frame;             // One past the last recorded frame
+    uint32_t magic;
+};
+
+constexpr size_t ReplayPadded(size_t size) {
+    return (size + 3) & ~size_t(3);
+}
+
+// Keyframe compression: the state as 32-bit words (the last one zero
+// padded), coded as spans. Most of an FM2K state is empty object slots and
+// cleared tables, so long fills of one word dominate.
+//
+//   uint32 control: bit 31 set   = fill, low bits word count, one word follows
+//                   bit 31 clear = literal, low bits word count, words follow
+//
+// Returns the encoded size in bytes; `out` needs MaxEncodedKeyframeSize().
+size_t MaxEncodedKeyframeSize(size_t state_size);
+size_t EncodeKeyframe(const uint8_t* state, size_t state_size, uint8_t* out);
+
+// False if the data is malformed or does not decode to exactly `state_size`
+bool DecodeKeyframe(const uint8_t* data, size_t size, uint8_t* state, size_t state_size);
+
+// Random access over a replay file in memory (mapped or read whole). The
+// data must stay alive and unchanged while the reader is used.
+class ReplayReader {
+public:
+    bool Open(const uint8_t* data, size_t size);
+
+    const ReplayFileHeader& Header() const { return header_; }
+    uint32_t FirstFrame() const { return header_.first_frame; }
+    uint32_t EndFrame() const { return end_frame_; }
+    size_t KeyframeCount() const { return keyframes_.size(); }
+
+    // Decode the nearest keyframe at or before `frame` into `state`
+    // (Header().state_size bytes). `keyframe` receives its frame.
+    bool LoadKeyframe(uint32_t frame, uint32_t* keyframe, uint8_t* state) const;
+
+    // Wire inputs for frames [frame, frame + count)
+    bool ReadInputs(uint32_t frame, size_t count, uint16_t* p1, uint16_t* p2) const;
+
+private:
+    const ReplayRecord* RecordAt(uint64_t offset) const;
+    bool ReadIndex(const ReplayFooter& footer);
+    bool Scan();
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    ReplayFileHeader header_ = {};
+    uint32_t end_frame_ = 0;
+    std::vector<ReplayIndexEntry> keyframes_;
+};
+
+} // namespace FM2K
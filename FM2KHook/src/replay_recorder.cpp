@@ -0,0 +1,320 @@
+#include "replay_recorder.h"
+#include <algorithm>
+#include <cstring>
+
+namespace FM2K {
+
+ReplayRecorder::~ReplayRecorder() {
+    if (running_) Stop();
+}
+
+bool ReplayRecorder::Start(const Config& config) {
+    if (running_ || !config.path || config.state_size == 0 || config.block_frames == 0 ||
+        config.block_frames > MAX_PACKED_FRAMES || config.keyframe_interval == 0 ||
+        config.keyframe_interval % config.block_frames != 0) {
+        return false;
+    }
+
+    file_ = std::fopen(config.path, "wb");
+    if (!file_) return false;
+
+    ReplayFileHeader header = {};
+    header.magic = REPLAY_MAGIC;
+    header.version = REPLAY_VERSION;
+    header.header_size = sizeof(ReplayFileHeader);
+    header.state_size = config.state_size;
+    header.keyframe_interval = config.keyframe_interval;
+    header.block_frames = config.block_frames;
+    header.first_frame = config.first_frame;
+    header.input_map = config.input_map;
+    if (std::fwrite(&header, sizeof(header), 1, file_) != 1) {
+        std::fclose(file_);
+        file_ = nullptr;
+        return false;
+    }
+
+    config_ = config;
+    config_.path = nullptr;
+    next_frame_ = config.first_frame;
+    block_count_ = 0;
+    for (Staging& staging : staging_) {
+        staging.state.assign(config.state_size, 0);
+        staging.staged = false;
+        staging.writing.store(false);
+    }
+    stage_ = 0;
+
+    jobs_.assign(INPUT_JOB_SLOTS + 2, Job{});     // Room for both keyframes on top of the input blocks
+    job_head_ = 0;
+    job_count_ = 0;
+    stopping_ = false;
+    encoded_.assign(std::max(MaxEncodedKeyframeSize(config.state_size),
+                             sizeof(ReplayInputBlock) + 2 * MaxPackedInputSize(MAX_PACKED_FRAMES)), 0);
+    index_.clear();
+    records_end_ = sizeof(ReplayFileHeader);
+    end_frame_ = config.first_frame;
+    failed_.store(false);
+    stats_ = {};
+
+    // An empty replay is already a valid file
+    if (!WriteIndex()) {
+        std::fclose(file_);
+        file_ = nullptr;
+        return false;
+    }
+
+    writer_ = std::thread(&ReplayRecorder::WriterLoop, this);
+    running_ = true;
+    return true;
+}
+
+void ReplayRecorder::Stop() {
+    if (!running_) return;
+    if (block_count_ > 0 && Active()) SubmitBlock();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    writer_.join();
+    std::fclose(file_);
+    file_ = nullptr;
+    running_ = false;
+}
+
+void ReplayRecorder::Abandon() {
+    if (!running_) return;
+    writer_.detach();
+    running_ = false;
+}
+
+bool ReplayRecorder::WantsKeyframe(uint32_t frame) const {
+    if (!Active() || frame < next_frame_ || (frame - config_.first_frame) % config_.keyframe_interval != 0) {
+        return false;
+    }
+    const Staging& staging = staging_[stage_];
+    return !(staging.staged && staging.frame == frame);
+}
+
+uint8_t* ReplayRecorder::StageKeyframe(uint32_t frame) {
+    Staging& staging = staging_[stage_];
+    if (staging.writing.load(std::memory_order_acquire)) return nullptr;   // Writer still encoding it
+    staging.staged = false;
+    staging.frame = frame;
+    return staging.state.data();
+}
+
+void ReplayRecorder::KeyframeStaged(uint32_t frame) {
+    Staging& staging = staging_[stage_];
+    if (staging.frame == frame) staging.staged = true;
+}
+
+void ReplayRecorder::Invalidate(uint32_t frame) {
+    Staging& staging = staging_[stage_];
+    if (staging.staged && staging.frame > frame) staging.staged = false;
+}
+
+void ReplayRecorder::AppendFrame(uint16_t p1, uint16_t p2) {
+    if (!Active()) return;
+
+    // Keyframes go ahead of the inputs of their frame
+    if ((next_frame_ - config_.first_frame) % config_.keyframe_interval == 0) {
+        SubmitKeyframe();
+    }
+
+    if (block_count_ == 0) block_first_ = next_frame_;
+    block_p1_[block_count_] = p1;
+    block_p2_[block_count_] = p2;
+    block_count_++;
+    next_frame_++;
+    if (block_count_ == config_.block_frames) {
+        SubmitBlock();
+    }
+}
+
+void ReplayRecorder::SubmitKeyframe() {
+    Staging& staging = staging_[stage_];
+    if (!staging.staged || staging.frame != next_frame_) {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.keyframes_dropped++;
+        return;
+    }
+
+    Job job;
+    job.type = JobType::Keyframe;
+    job.frame = next_frame_;
+    job.count = 0;
+    job.staging = stage_;
+    staging.staged = false;
+    staging.writing.store(true, std::memory_order_release);
+    if (!Submit(job)) {
+        staging.writing.store(false, std::memory_order_release);
+        return;
+    }
+    stage_ ^= 1;
+}
+
+void ReplayRecorder::SubmitBlock() {
+    Job job;
+    job.type = JobType::Inputs;
+    job.frame = block_first_;
+    job.count = block_count_;
+    job.staging = 0;
+    std::memcpy(job.p1, block_p1_, block_count_ * sizeof(uint16_t));
+    std::memcpy(job.p2, block_p2_, block_count_ * sizeof(uint16_t));
+    block_count_ = 0;
+    Submit(job);
+}
+
+// Copy a job into the queue. A full queue means the disk cannot keep up;
+// recording stops rather than stalling the game.
+bool ReplayRecorder::Submit(const Job& job) {
+    size_t queued = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (job_count_ == jobs_.size()) {
+            queued = job_count_ + 1;
+        } else {
+            size_t slot = (job_head_ + job_count_) % jobs_.size();
+            jobs_[slot].type = job.type;
+            jobs_[slot].frame = job.frame;
+            jobs_[slot].count = job.count;
+            jobs_[slot].staging = job.staging;
+            if (job.type == JobType::Inputs) {
+                std::memcpy(jobs_[slot].p1, job.p1, job.count * sizeof(uint16_t));
+                std::memcpy(jobs_[slot].p2, job.p2, job.count * sizeof(uint16_t));
+            }
+            queued = ++job_count_;
+        }
+    }
+    if (queued > jobs_.size()) {
+        Fail();
+        return false;
+    }
+    wake_.notify_one();
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.max_queued = std::max(stats_.max_queued, static_cast<uint32_t>(queued));
+    return true;
+}
+
+void ReplayRecorder::Fail() {
+    failed_.store(true, std::memory_order_relaxed);
+}
+
+void ReplayRecorder::WriterLoop() {
+    Job job;
+    for (;;) {
+        bool more = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return job_count_ > 0 || stopping_; });
+            if (job_count_ == 0) break;     // Stopping and drained
+            const Job& next = jobs_[job_head_];
+            job.type = next.type;
+            job.frame = next.frame;
+            job.count = next.count;
+            job.staging = next.staging;
+            if (next.type == JobType::Inputs) {
+                std::memcpy(job.p1, next.p1, next.count * sizeof(uint16_t));
+                std::memcpy(job.p2, next.p2, next.count * sizeof(uint16_t));
+            }
+            job_head_ = (job_head_ + 1) % jobs_.size();
+            more = --job_count_ > 0;
+        }
+
+        bool failed = failed_.load(std::memory_order_relaxed);
+        if (!failed && !WriteJob(job)) {
+            Fail();
+            failed = true;
+        }
+        if (job.type == JobType::Keyframe) {
+            staging_[job.staging].writing.store(false, std::memory_order_release);
+        }
+
+        // Close the file over after every batch so it is always readable
+        if (!more && !failed && !WriteIndex()) {
+            Fail();
+        }
+    }
+}
+
+bool ReplayRecorder::WriteJob(const Job& job) {
+    if (job.type == JobType::Keyframe) {
+        size_t size = EncodeKeyframe(staging_[job.staging].state.data(), config_.state_size, encoded_.data());
+        uint64_t offset = records_end_;
+        if (!WriteRecord(ReplayRecordType::Keyframe, job.frame, 0, encoded_.data(), size)) return false;
+        index_.push_back({ job.frame, 0, offset });
+
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.keyframes_written++;
+        stats_.keyframe_raw_bytes += config_.state_size;
+        stats_.keyframe_encoded_bytes += size;
+        return true;
+    }
+
+    // Inputs: each player's frames as a packed run-length window
+    uint8_t* out = encoded_.data() + sizeof(ReplayInputBlock);
+    size_t capacity = MaxPackedInputSize(job.count);
+    ReplayInputBlock sizes;
+    size_t p1_size = PackInputFrames(job.frame, job.p1, job.count, out, capacity);
+    size_t p2_size = PackInputFrames(job.frame, job.p2, job.count, out + p1_size, capacity);
+    if (p1_size == 0 || p2_size == 0) return false;
+    sizes.p1_size = static_cast<uint16_t>(p1_size);
+    sizes.p2_size = static_cast<uint16_t>(p2_size);
+    std::memcpy(encoded_.data(), &sizes, sizeof(sizes));
+    if (!WriteRecord(ReplayRecordType::Inputs, job.frame, job.count, encoded_.data(),
+                     sizeof(sizes) + p1_size + p2_size)) {
+        return false;
+    }
+    end_frame_ = job.frame + job.count;
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.blocks_written++;
+    stats_.frames = end_frame_ - config_.first_frame;
+    return true;
+}
+
+bool ReplayRecorder::WriteRecord(ReplayRecordType type, uint32_t frame, uint32_t count, const void* payload,
+                                 size_t size) {
+    static const uint8_t PADDING[4] = {};
+    ReplayRecord record = { static_cast<uint32_t>(type), frame, count, static_cast<uint32_t>(size) };
+    size_t padding = ReplayPadded(size) - size;
+    if (std::fseek(file_, static_cast<long>(records_end_), SEEK_SET) != 0 ||
+        std::fwrite(&record, sizeof(record), 1, file_) != 1 ||
+        (size > 0 && std::fwrite(payload, size, 1, file_) != 1) ||
+        (padding > 0 && std::fwrite(PADDING, padding, 1, file_) != 1)) {
+        return false;
+    }
+    records_end_ += sizeof(record) + size + padding;
+    return true;
+}
+
+// Index record and footer after the last record; the next record overwrites
+// them and the next flush writes them again, one keyframe longer
+bool ReplayRecorder::WriteIndex() {
+    uint64_t index_offset = records_end_;
+    size_t index_size = index_.size() * sizeof(ReplayIndexEntry);
+    ReplayRecord record = { static_cast<uint32_t>(ReplayRecordType::Index), config_.first_frame,
+                            static_cast<uint32_t>(index_.size()), static_cast<uint32_t>(index_size) };
+    ReplayFooter footer = { index_offset, end_frame_, REPLAY_FOOTER_MAGIC };
+    if (std::fseek(file_, static_cast<long>(index_offset), SEEK_SET) != 0 ||
+        std::fwrite(&record, sizeof(record), 1, file_) != 1 ||
+        (index_size > 0 && std::fwrite(index_.data(), index_size, 1, file_) != 1) ||
+        std::fwrite(&footer, sizeof(footer), 1, file_) != 1 || std::fflush(file_) != 0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.bytes_written = index_offset + sizeof(record) + index_size + sizeof(footer);
+    return true;
+}
+
+ReplayRecorder::Stats ReplayRecorder::GetStats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    Stats stats = stats_;
+    stats.failed = failed_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace FM2K
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "replay_format.h"
+
+namespace FM2K {
+
+// Writes a replay (replay_format.h) as frames are confirmed. The game thread
+// only copies: inputs into the current block, keyframe state into a staging
+// buffer, finished blocks and keyframes into preallocated job slots. A
+// writer thread encodes, writes and rewrites the index after each batch, so
+// recording allocates nothing per frame and never waits on the disk.
+//
+// Game thread, per frame:
+//   - at the start of every frame, while WantsKeyframe(frame), capture the
+//     state into StageKeyframe(frame) and call KeyframeStaged(frame); a
+//     rollback past the staged frame calls Invalidate() and the resimulated
+//     start captures it again
+//   - once a frame can no longer roll back, AppendFrame() its inputs
+class ReplayRecorder {
+public:
+    static constexpr uint32_t DEFAULT_KEYFRAME_INTERVAL = 600;     // 6 s at 100 FPS
+    static constexpr uint32_t DEFAULT_BLOCK_FRAMES = 200;
+    static constexpr size_t INPUT_JOB_SLOTS = 16;                  // Blocks the writer may fall behind by
+
+    struct Config {
+        const char* path = nullptr;
+        uint32_t state_size = 0;
+        uint32_t first_frame = 0;
+        uint32_t keyframe_interval = DEFAULT_KEYFRAME_INTERVAL;    // Multiple of block_frames
+        uint32_t block_frames = DEFAULT_BLOCK_FRAMES;              // 1..MAX_PACKED_FRAMES
+        InputMap input_map = DEFAULT_INPUT_MAP;
+    };
+
+    struct Stats {
+        uint32_t frames;                // Frames appended
+        uint64_t blocks_written;
+        uint64_t keyframes_written;
+        uint64_t keyframes_dropped;     // Not staged in time, or the writer still held both buffers
+        uint64_t keyframe_raw_bytes;
+        uint64_t keyframe_encoded_bytes;
+        uint64_t bytes_written;         // File size, index included
+        uint32_t max_queued;            // Deepest the job queue got
+        bool failed;                    // Queue overflow or write error; recording stopped
+    };
+
+    ReplayRecorder() = default;
+    ~ReplayRecorder();
+    ReplayRecorder(const ReplayRecorder&) = delete;
+    ReplayRecorder& operator=(const ReplayRecorder&) = delete;
+
+    // Open the file, write its header and start the writer thread
+    bool Start(const Config& config);
+
+    // Drain the queue, write the final index and close the file
+    void Stop();
+
+    // Let go of the writer thread without waiting for it (DLL unload, where
+    // joining would deadlock); the file holds everything up to its last flush
+    void Abandon();
+
+    bool Active() const { return running_ && !failed_.load(std::memory_order_relaxed); }
+
+    // Next frame AppendFrame() records
+    uint32_t NextFrame() const { return next_frame_; }
+
+    bool WantsKeyframe(uint32_t frame) const;
+    uint8_t* StageKeyframe(uint32_t frame);
+    void KeyframeStaged(uint32_t frame);
+
+    // A rollback loaded the start of `frame`; a keyframe staged for a later
+    // frame no longer holds the timeline that will be confirmed
+    void Invalidate(uint32_t frame);
+
+    // Wire inputs of frame NextFrame()
+    void AppendFrame(uint16_t p1, uint16_t p2);
+
+    Stats GetStats() const;
+
+private:
+    enum class JobType : uint32_t { Inputs, Keyframe };
+
+    struct Job {
+        JobType type;
+        uint32_t frame;
+        uint32_t count;
+        uint32_t staging;           // Keyframe buffer index
+        uint16_t p1[MAX_PACKED_FRAMES];
+        uint16_t p2[MAX_PACKED_FRAMES];
+    };
+
+    struct Staging {
+        std::vector<uint8_t> state;
+        uint32_t frame;
+        bool staged;                            // Game thread: holds the state of `frame`
+        std::atomic<bool> writing{ false };     // Handed to the writer
+    };
+
+    bool Submit(const Job& job);
+    void SubmitBlock();
+    void SubmitKeyframe();
+    void WriterLoop();
+    bool WriteJob(const Job& job);
+    bool WriteRecord(ReplayRecordType type, uint32_t frame, uint32_t count, const void* payload, size_t size);
+    bool WriteIndex();
+    void Fail();
+
+    Config config_ = {};
+    FILE* file_ = nullptr;
+    std::thread writer_;
+    bool running_ = false;
+
+    // Game thread
+    uint32_t next_frame_ = 0;
+    uint32_t block_first_ = 0;
+    uint32_t block_count_ = 0;
+    uint16_t block_p1_[MAX_PACKED_FRAMES] = {};
+    uint16_t block_p2_[MAX_PACKED_FRAMES] = {};
+    Staging staging_[2];
+    uint32_t stage_ = 0;                        // Buffer StageKeyframe() fills
+
+    // Queue, under mutex_
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::vector<Job> jobs_;
+    size_t job_head_ = 0;
+    size_t job_count_ = 0;
+    bool stopping_ = false;
+
+    // Writer thread
+    std::vector<uint8_t> encoded_;
+    std::vector<ReplayIndexEntry> index_;
+    uint64_t records_end_ = 0;                  // Where the next record goes (the index follows it)
+    uint32_t end_frame_ = 0;                    // One past the last frame written
+
+    std::atomic<bool> failed_{ false };
+    mutable std::mutex stats_mutex_;
+    Stats stats_ = {};
+};
+
+} // namespace FM2K
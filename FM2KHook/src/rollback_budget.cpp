@@ -0,0 +1,59 @@
+#include "rollback_budget.h"
+#include <algorithm>
+
+namespace FM2K {
+namespace State {
+
+bool RollbackBudget::Push(const PendingFrame& frame) {
+    if (size_ == CATCHUP_QUEUE_FRAMES) return false;
+    queue_[(head_ + size_) % CATCHUP_QUEUE_FRAMES] = frame;
+    size_++;
+    stats_.max_backlog = std::max(stats_.max_backlog, size_);
+    return true;
+}
+
+RollbackBudget::PendingFrame RollbackBudget::Pop() {
+    PendingFrame frame = queue_[head_];
+    head_ = (head_ + 1) % CATCHUP_QUEUE_FRAMES;
+    size_--;
+    return frame;
+}
+
+uint64_t RollbackBudget::CatchUpBudgetUs() const {
+    return static_cast<uint64_t>(static_cast<double>(config_.frame_budget_us) * config_.catchup_share);
+}
+
+uint32_t RollbackBudget::FramesThisUpdate(uint32_t keep) const {
+    if (size_ <= keep) return 0;
+    uint32_t owed = size_ - keep;
+
+    // No measurement yet: assume everything fits, the first catch-up measures it
+    if (!have_sample_ || frame_us_ <= 0.0) return owed;
+
+    uint32_t affordable = static_cast<uint32_t>(static_cast<double>(CatchUpBudgetUs()) / frame_us_);
+    return std::min(owed, std::max(affordable, config_.min_frames_per_update));
+}
+
+void RollbackBudget::BeginCatchUp(uint32_t backlog) {
+    stats_.catchups++;
+    if (have_sample_ && backlog * frame_us_ > static_cast<double>(CatchUpBudgetUs())) {
+        stats_.overruns++;
+    }
+}
+
+void RollbackBudget::RecordUpdate(uint32_t frames, uint64_t us) {
+    if (frames == 0) return;
+    double sample = static_cast<double>(us) / frames;
+    frame_us_ = have_sample_ ? frame_us_ + (sample - frame_us_) * config_.average_weight : sample;
+    have_sample_ = true;
+    if (us > CatchUpBudgetUs()) stats_.over_budget++;
+}
+
+RollbackBudget::Stats RollbackBudget::GetStats() const {
+    Stats stats = stats_;
+    stats.frame_us = frame_us_;
+    return stats;
+}
+
+} // namespace State
+} // namespace FM2K
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FM2K {
+namespace State {
+
+constexpr uint32_t CATCHUP_QUEUE_FRAMES = 32;
+
+// Caps how much resimulation runs per displayed frame. Frames still owed
+// after a rollback wait in a queue with their confirmed inputs; each real
+// frame resimulates as many as fit in the catch-up share of the frame budget
+// (measured per-frame cost, moving average) and the engine then runs and
+// draws the next one, so a long rollback is spread over several displayed
+// frames instead of stalling one.
+//
+// min_frames_per_update must be at least 2: GekkoNet adds one frame per real
+// frame, so anything less never drains the backlog.
+class RollbackBudget {
+public:
+    struct Config {
+        uint64_t frame_budget_us = 10000;
+        double catchup_share = 0.6;          // Of the frame, the rest is the live frame + render
+        uint32_t min_frames_per_update = 2;
+        double average_weight = 1.0 / 16.0;
+    };
+
+    struct PendingFrame {
+        uint32_t frame;
+        uint32_t has_inputs;
+        uint32_t p1;
+        uint32_t p2;
+    };
+
+    struct Stats {
+        uint64_t catchups;
+        uint64_t overruns;          // Catch-ups that needed more than one frame's budget
+        uint64_t spread_frames;     // Displayed frames drawn while still behind
+        uint64_t over_budget;       // Updates whose measured catch-up exceeded the share anyway
+        uint64_t forced;            // Queue overflowed, so everything ran at once
+        uint32_t max_backlog;
+        double frame_us;            // Moving average per resimulated frame
+    };
+
+    RollbackBudget() = default;
+    explicit RollbackBudget(const Config& config) : config_(config) {}
+
+    void Clear() { head_ = 0; size_ = 0; }
+
+    // False when full; the caller then runs the frame immediately
+    bool Push(const PendingFrame& frame);
+    PendingFrame Pop();
+    const PendingFrame& Front() const { return queue_[head_]; }
+    uint32_t Backlog() const { return size_; }
+
+    // Frames to resimulate now, leaving `keep` queued (the frame the engine runs next)
+    uint32_t FramesThisUpdate(uint32_t keep) const;
+
+    void BeginCatchUp(uint32_t backlog);
+    void RecordUpdate(uint32_t frames, uint64_t us);
+    void CountSpreadFrame() { stats_.spread_frames++; }
+    void CountForced() { stats_.forced++; }
+
+    Stats GetStats() const;
+
+private:
+    uint64_t CatchUpBudgetUs() const;
+
+    Config config_;
+    PendingFrame queue_[CATCHUP_QUEUE_FRAMES] = {};
+    uint32_t head_ = 0;
+    uint32_t size_ = 0;
+
+    double frame_us_ = 0.0;
+    bool have_sample_ = false;
+    Stats stats_ = {};
+};
+
+} // namespace State
+} // namespace FM2K
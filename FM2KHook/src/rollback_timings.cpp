@@ -0,0 +1,33 @@
+#include "rollback_timings.h"
+
+namespace FM2K {
+namespace State {
+
+uint32_t RollbackTimings::Bucket(uint32_t depth) {
+    if (depth < 1) depth = 1;
+    if (depth > MAX_TIMED_ROLLBACK_DEPTH) depth = MAX_TIMED_ROLLBACK_DEPTH;
+    return depth - 1;
+}
+
+void RollbackTimings::Record(uint32_t depth, uint64_t restore_us, uint64_t fastforward_us) {
+    Depth& entry = depths_[Bucket(depth)];
+    uint64_t total_us = restore_us + fastforward_us;
+    entry.count++;
+    entry.restore_us += restore_us;
+    entry.fastforward_us += fastforward_us;
+    if (total_us > entry.max_total_us) entry.max_total_us = total_us;
+    if (total_us > frame_budget_us_) entry.over_budget++;
+    total_++;
+}
+
+void RollbackTimings::Reset() {
+    for (Depth& entry : depths_) entry = Depth{};
+    total_ = 0;
+}
+
+const RollbackTimings::Depth& RollbackTimings::Get(uint32_t depth) const {
+    return depths_[Bucket(depth)];
+}
+
+} // namespace State
+} // namespace FM2K
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FM2K {
+namespace State {
+
+// Deepest rollback bucketed on its own; anything deeper lands in the last bucket
+constexpr uint32_t MAX_TIMED_ROLLBACK_DEPTH = 16;
+
+// Rollback cost by distance: restore time plus fast-forward time for every
+// rollback of a given depth, laid out like the rollback-distance table in
+// docs/outline/fm2k_performance.md
+class RollbackTimings {
+public:
+    struct Depth {
+        uint64_t count;
+        uint64_t restore_us;        // Totals; divide by count for the average
+        uint64_t fastforward_us;
+        uint64_t max_total_us;
+        uint64_t over_budget;       // Rollbacks that did not fit in one frame
+    };
+
+    explicit RollbackTimings(uint64_t frame_budget_us = 10000) : frame_budget_us_(frame_budget_us) {}
+
+    void Record(uint32_t depth, uint64_t restore_us, uint64_t fastforward_us);
+    void Reset();
+
+    // `depth` of 1..MAX_TIMED_ROLLBACK_DEPTH
+    const Depth& Get(uint32_t depth) const;
+    uint64_t TotalRollbacks() const { return total_; }
+
+private:
+    static uint32_t Bucket(uint32_t depth);
+
+    Depth depths_[MAX_TIMED_ROLLBACK_DEPTH] = {};
+    uint64_t frame_budget_us_;
+    uint64_t total_ = 0;
+};
+
+} // namespace State
+} // namespace FM2K
@@ -0,0 +1,139 @@
+#include "snapshot.h"
+#include <algorithm>
+#include <cstring>
+
+namespace FM2K {
+namespace State {
+
+LocalMemoryBackend::LocalMemoryBackend()
+    : image_(nullptr)
+    , image_base_(0)
+    , image_size_(0)
+{}
+
+LocalMemoryBackend::LocalMemoryBackend(uint8_t* image, uintptr_t image_base, size_t image_size)
+    : image_(image)
+    , image_base_(image_base)
+    , image_size_(image_size)
+{}
+
+uint8_t* LocalMemoryBackend::Translate(uintptr_t address, size_t size) const {
+    // In-process: game addresses are our addresses
+    if (!image_) {
+        return reinterpret_cast<uint8_t*>(address);
+    }
+
+    if (address < image_base_ || size > image_size_ || address - image_base_ > image_size_ - size) {
+        return nullptr;
+    }
+    return image_ + (address - image_base_);
+}
+
+bool LocalMemoryBackend::Read(uintptr_t address, void* dst, size_t size) {
+    const uint8_t* src = Translate(address, size);
+    if (!src || !dst) return false;
+    std::memcpy(dst, src, size);
+    return true;
+}
+
+bool LocalMemoryBackend::Write(uintptr_t address, const void* src, size_t size) {
+    uint8_t* dst = Translate(address, size);
+    if (!dst || !src) return false;
+    std::memcpy(dst, src, size);
+    return true;
+}
+
+#ifdef _WIN32
+bool RemoteMemoryBackend::Read(uintptr_t address, void* dst, size_t size) {
+    if (!process_ || !dst) return false;
+    SIZE_T bytes_read = 0;
+    return ReadProcessMemory(process_, reinterpret_cast<LPCVOID>(address), dst, size, &bytes_read) &&
+           bytes_read == size;
+}
+
+bool RemoteMemoryBackend::Write(uintptr_t address, const void* src, size_t size) {
+    if (!process_ || !src) return false;
+    SIZE_T bytes_written = 0;
+    return WriteProcessMemory(process_, reinterpret_cast<LPVOID>(address), src, size, &bytes_written) &&
+           bytes_written == size;
+}
+#endif
+
+SnapshotPlan::SnapshotPlan(const MemoryRegion* regions, size_t count) {
+    Build(regions, count);
+}
+
+void SnapshotPlan::Build(const MemoryRegion* regions, size_t count) {
+    runs_.clear();
+    buffer_size_ = 0;
+    region_count_ = count;
+    if (!regions || count == 0) return;
+
+    std::vector<MemoryRegion> sorted(regions, regions + count);
+    std::sort(sorted.begin(), sorted.end(), [](const MemoryRegion& a, const MemoryRegion& b) {
+        return a.address != b.address ? a.address < b.address : a.size > b.size;
+    });
+
+    for (const MemoryRegion& region : sorted) {
+        if (region.size == 0) continue;
+        buffer_size_ = std::max(buffer_size_, region.offset + region.size);
+
+        if (!runs_.empty()) {
+            MemoryRegion& run = runs_.back();
+            uintptr_t run_end = run.address + run.size;
+
+            // Mergeable when the region starts inside or right after the run
+            // and sits at the same relative position in the buffer
+            if (region.address <= run_end &&
+                region.offset == run.offset + (region.address - run.address)) {
+                uintptr_t region_end = region.address + region.size;
+                if (region_end > run_end) {
+                    run.size = region_end - run.address;
+                }
+                continue;
+            }
+        }
+        runs_.push_back(region);
+    }
+}
+
+void PackRegions(MemoryRegion* regions, size_t count, size_t base) {
+    std::sort(regions, regions + count, [](const MemoryRegion& a, const MemoryRegion& b) {
+        return a.address < b.address;
+    });
+
+    size_t offset = base;
+    for (size_t i = 0; i < count; i++) {
+        regions[i].offset = offset;
+        offset += regions[i].size;
+    }
+}
+
+SnapshotPlan SnapshotPlan::Packed(const MemoryRegion* regions, size_t count) {
+    std::vector<MemoryRegion> packed(regions, regions + count);
+    PackRegions(packed.data(), packed.size());
+    return SnapshotPlan(packed.data(), packed.size());
+}
+
+bool SnapshotPlan::Capture(MemoryBackend& backend, uint8_t* buffer) const {
+    if (!buffer) return false;
+    for (const MemoryRegion& run : runs_) {
+        if (!backend.Read(run.address, buffer + run.offset, run.size)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SnapshotPlan::Restore(MemoryBackend& backend, const uint8_t* buffer) const {
+    if (!buffer) return false;
+    for (const MemoryRegion& run : runs_) {
+        if (!backend.Write(run.address, buffer + run.offset, run.size)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace State
+} // namespace FM2K
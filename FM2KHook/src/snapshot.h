@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace FM2K {
+namespace State {
+
+// One contiguous range of game memory and where it lives in a snapshot buffer
+struct MemoryRegion {
+    uintptr_t address;   // Game address
+    size_t size;         // Size in bytes
+    size_t offset;       // Offset into the flat snapshot buffer
+    const char* name = nullptr;  // Label for logs and desync reports
+};
+
+// Source/sink for game memory. Snapshot code never touches addresses directly,
+// so the same plan runs in-process, through another process, or against a
+// plain byte span standing in for the game's address space.
+class MemoryBackend {
+public:
+    virtual ~MemoryBackend() = default;
+
+    virtual bool Read(uintptr_t address, void* dst, size_t size) = 0;
+    virtual bool Write(uintptr_t address, const void* src, size_t size) = 0;
+
+    // Host pointer for a game range when memory is directly addressable,
+    // nullptr when every access has to go through Read/Write
+    virtual uint8_t* Translate(uintptr_t address, size_t size) const {
+        (void)address;
+        (void)size;
+        return nullptr;
+    }
+};
+
+// memcpy backend. The default constructor treats game addresses as host
+// pointers (injected DLL); the span constructor maps [image_base, image_base +
+// image_size) onto a caller-owned buffer (benchmarks, synthetic engine).
+class LocalMemoryBackend : public MemoryBackend {
+public:
+    LocalMemoryBackend();
+    LocalMemoryBackend(uint8_t* image, uintptr_t image_base, size_t image_size);
+
+    bool Read(uintptr_t address, void* dst, size_t size) override;
+    bool Write(uintptr_t address, const void* src, size_t size) override;
+
+    // Host pointer for a game range, or nullptr if it falls outside the image
+    uint8_t* Translate(uintptr_t address, size_t size) const override;
+
+private:
+    uint8_t* image_;
+    uintptr_t image_base_;
+    size_t image_size_;
+};
+
+#ifdef _WIN32
+// ReadProcessMemory/WriteProcessMemory backend used by the launcher side
+class RemoteMemoryBackend : public MemoryBackend {
+public:
+    explicit RemoteMemoryBackend(HANDLE process) : process_(process) {}
+
+    bool Read(uintptr_t address, void* dst, size_t size) override;
+    bool Write(uintptr_t address, const void* src, size_t size) override;
+
+private:
+    HANDLE process_;
+};
+#endif
+
+// Lay regions out back-to-back in address order from `base`, rewriting each
+// region's offset (sorts the array in place)
+void PackRegions(MemoryRegion* regions, size_t count, size_t base = 0);
+
+// Copy plan built from a region table. Regions are sorted by address and
+// merged whenever they are contiguous both in game memory and in the buffer,
+// so each run costs exactly one bulk copy (one syscall for the remote backend).
+class SnapshotPlan {
+public:
+    SnapshotPlan() = default;
+    SnapshotPlan(const MemoryRegion* regions, size_t count);
+
+    void Build(const MemoryRegion* regions, size_t count);
+
+    // Lay regions out back-to-back in address order, ignoring their offsets
+    static SnapshotPlan Packed(const MemoryRegion* regions, size_t count);
+
+    bool Capture(MemoryBackend& backend, uint8_t* buffer) const;
+    bool Restore(MemoryBackend& backend, const uint8_t* buffer) const;
+
+    const std::vector<MemoryRegion>& Runs() const { return runs_; }
+    size_t BufferSize() const { return buffer_size_; }
+    size_t RegionCount() const { return region_count_; }
+
+private:
+    std::vector<MemoryRegion> runs_;
+    size_t buffer_size_ = 0;
+    size_t region_count_ = 0;
+};
+
+} // namespace State
+} // namespace FM2K
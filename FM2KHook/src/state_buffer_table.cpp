@@ -0,0 +1,113 @@
+#include "state_buffer_table.h"
+
+namespace FM2K {
+namespace State {
+
+void StateBufferTable::Init(size_t max_buffers) {
+    capacity_ = max_buffers;
+    entries_.clear();
+    entries_.reserve(max_buffers);
+    newest_recycled_ = 0;
+    recycled_any_ = false;
+    stats_ = {};
+}
+
+void StateBufferTable::Clear() {
+    entries_.clear();
+    newest_recycled_ = 0;
+    recycled_any_ = false;
+}
+
+bool StateBufferTable::Bind(uint32_t frame, uint8_t* buffer, uint32_t* checksum, uint32_t* length, uint32_t* slot) {
+    if (!buffer) return false;
+
+    // A handful of buffers: a scan beats a map
+    size_t index = 0;
+    while (index < entries_.size() && entries_[index].buffer != buffer) index++;
+    if (index == entries_.size()) {
+        if (entries_.size() == capacity_) {
+            stats_.overflows++;
+            return false;
+        }
+        entries_.push_back(Entry{ buffer, nullptr, nullptr, 0, false, false });
+    }
+
+    Entry& entry = entries_[index];
+    bool same_frame = entry.bound && entry.frame == frame;
+    if (!same_frame && entry.captured) {
+        // Recycled for a newer frame: everything up to the evicted one is gone
+        stats_.overwrites++;
+        if (!recycled_any_ || entry.frame > newest_recycled_) newest_recycled_ = entry.frame;
+        recycled_any_ = true;
+        entry.captured = false;
+    }
+    // The frame moved to another buffer: its old one no longer holds it
+    for (Entry& other : entries_) {
+        if (&other != &entry && other.bound && other.frame == frame) {
+            other.bound = false;
+            other.captured = false;
+        }
+    }
+    entry.checksum = checksum;
+    entry.length = length;
+    entry.frame = frame;
+    entry.bound = true;
+
+    stats_.binds++;
+    *slot = static_cast<uint32_t>(index);
+    return true;
+}
+
+bool StateBufferTable::FindBound(uint32_t frame, uint32_t* slot) const {
+    for (size_t index = 0; index < entries_.size(); index++) {
+        if (entries_[index].bound && entries_[index].frame == frame) {
+            *slot = static_cast<uint32_t>(index);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool StateBufferTable::FindCaptured(uint32_t frame, uint32_t* slot) {
+    if (FindBound(frame, slot) && entries_[*slot].captured) {
+        stats_.loads++;
+        return true;
+    }
+    // Behind a capture whose buffer was since recycled: fell out of the window
+    if (recycled_any_ && frame <= newest_recycled_) {
+        stats_.stale_hits++;
+    } else {
+        stats_.misses++;
+    }
+    return false;
+}
+
+bool StateBufferTable::Contains(uint32_t frame) const {
+    uint32_t slot = 0;
+    return FindBound(frame, &slot) && entries_[slot].captured;
+}
+
+void StateBufferTable::MarkCaptured(uint32_t slot) {
+    entries_[slot].captured = true;
+    stats_.captures++;
+}
+
+void StateBufferTable::InvalidateAfter(uint32_t frame) {
+    for (Entry& entry : entries_) {
+        if (entry.bound && entry.frame > frame) entry.captured = false;
+    }
+}
+
+StateBufferTable::Stats StateBufferTable::GetStats() const {
+    Stats stats = stats_;
+    stats.occupancy = 0;
+    for (const Entry& entry : entries_) {
+        if (entry.captured) stats.occupancy++;
+    }
+    stats.buffers = entries_.size();
+    stats.capacity = capacity_;
+    return stats;
+}
+
+} // namespace State
+} // namespace FM2K
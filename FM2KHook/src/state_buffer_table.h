@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace FM2K {
+namespace State {
+
+// Frame-keyed index over snapshot buffers owned by someone else (GekkoNet's
+// state storage, handed out in SaveEvents). Each distinct buffer gets a
+// stable slot number the first time it is seen, so per-slot bookkeeping
+// (dirty-page masks, heap arenas) follows the buffer as its owner recycles
+// it for newer frames. A bound frame is only loadable once it is captured.
+class StateBufferTable {
+public:
+    struct Stats {
+        uint64_t binds;
+        uint64_t captures;
+        uint64_t loads;
+        uint64_t overwrites;     // Binds that recycled a buffer still holding a capture
+        uint64_t stale_hits;     // Lookups for a frame at or behind a recycled capture
+        uint64_t misses;         // Other lookups with no captured buffer
+        uint64_t overflows;      // Binds refused because every slot was taken
+        size_t occupancy;        // Captured buffers right now
+        size_t buffers;          // Distinct buffers seen
+        size_t capacity;
+    };
+
+    struct Entry {
+        uint8_t* buffer;
+        uint32_t* checksum;      // Owner's checksum and length fields for this frame
+        uint32_t* length;
+        uint32_t frame;
+        bool bound;
+        bool captured;
+    };
+
+    void Init(size_t max_buffers);
+    void Clear();
+
+    // Bind `frame` to `buffer` and return its slot. Rebinding a buffer to the
+    // frame it already holds keeps the capture; any other frame drops it.
+    bool Bind(uint32_t frame, uint8_t* buffer, uint32_t* checksum, uint32_t* length, uint32_t* slot);
+
+    // Slot bound to `frame` (captured or not)
+    bool FindBound(uint32_t frame, uint32_t* slot) const;
+
+    // Slot holding a capture of `frame`; counts a load, a stale hit or a miss
+    bool FindCaptured(uint32_t frame, uint32_t* slot);
+    bool Contains(uint32_t frame) const;
+
+    void MarkCaptured(uint32_t slot);
+
+    // Captures newer than `frame` belong to an abandoned timeline
+    void InvalidateAfter(uint32_t frame);
+
+    Entry& Get(uint32_t slot) { return entries_[slot]; }
+    const Entry& Get(uint32_t slot) const { return entries_[slot]; }
+    size_t Capacity() const { return capacity_; }
+    Stats GetStats() const;
+
+private:
+    std::vector<Entry> entries_;     // One per distinct buffer, in first-seen order
+    size_t capacity_ = 0;
+    uint32_t newest_recycled_ = 0;   // Newest frame whose buffer was reused for a later one
+    bool recycled_any_ = false;
+    Stats stats_ = {};
+};
+
+} // namespace State
+} // namespace FM2K
@@ -1,4 +1,5 @@
 #include "state_manager.h"
+#include "FM2K_Checksum.h"
 #include <SDL3/SDL.h>
 
 namespace FM2K {
@@ -7,6 +8,8 @@ namespace State {
 // Static state
 static HANDLE process_handle = nullptr;
 static GameState* current_state = nullptr;
+static SnapshotPlan core_plan;
+static std::vector<uint8_t> object_pool_scratch;
 
 bool Init(HANDLE process) {
     if (!process) {
@@ -15,6 +18,7 @@ bool Init(HANDLE process) {
     }
 
     process_handle = process;
+    core_plan.Build(CORE_STATE_RUNS.begin(), CORE_STATE_RUNS.count);
 
     // Allocate state buffer
     current_state = new GameState();
@@ -27,6 +31,8 @@ bool Init(HANDLE process) {
 }
 
 void Shutdown() {
+    object_pool_scratch.clear();
+    object_pool_scratch.shrink_to_fit();
     delete current_state;
     current_state = nullptr;
     process_handle = nullptr;
@@ -38,92 +44,12 @@ bool SaveCoreState(CoreGameState* state) {
         return false;
     }
 
-    SIZE_T bytes_read;
-    
-    // Read input system state
-    if (!ReadProcessMemory(process_handle, 
-                          reinterpret_cast<LPCVOID>(Memory::INPUT_BUFFER_INDEX_ADDR),
-                          &state->input_buffer_index, sizeof(uint32_t), &bytes_read)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read input buffer index");
-        return false;
-    }
-    
-    // Read current inputs
-    if (!ReadProcessMemory(process_handle, 
-                          reinterpret_cast<LPCVOID>(Memory::P1_INPUT_ADDR),
-                          &state->p1_input_current, sizeof(uint32_t), &bytes_read) ||
-        !ReadProcessMemory(process_handle, 
-                          reinterpret_cast<LPCVOID>(Memory::P2_INPUT_ADDR),
-                          &state->p2_input_current, sizeof(uint32_t), &bytes_read)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read current inputs");
-        return false;
-    }
-    
-    // Read input histories
-    if (!ReadProcessMemory(process_handle, 
-                          reinterpret_cast<LPCVOID>(Memory::P1_INPUT_HISTORY_ADDR),
-                          state->p1_input_history, Memory::INPUT_HISTORY_SIZE, &bytes_read) ||
-        !ReadProcessMemory(process_handle, 
-                          reinterpret_cast<LPCVOID>(Memory::P2_INPUT_HISTORY_ADDR),
-                          state->p2_input_history, Memory::INPUT_HISTORY_SIZE, &bytes_read)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read input histories");
-        return false;
-    }
-    
-    // Read player state
-    if (!ReadProcessMemory(process_handle, 
-                          reinterpret_cast<LPCVOID>(Memory::P1_STAGE_X_ADDR),
-                          &state->p1_stage_x, sizeof(uint32_t), &bytes_read) ||
-        !ReadProcessMemory(process_handle, 
-                          reinterpret_cast<LPCVOID>(Memory::P1_STAGE_Y_ADDR),
-                          &state->p1_stage_y, sizeof(uint32_t), &bytes_read) ||
-        !ReadProcessMemory(process_handle, 
-                          reinterpret_cast<LPCVOID>(Memory::P1_HP_ADDR),
-                          &state->p1_hp, sizeof(uint32_t), &bytes_read) ||
-        !ReadProcessMemory(process_handle, 
-                          reinterpret_cast<LPCVOID>(Memory::P1_MAX_HP_ADDR),
-                          &state->p1_max_hp, sizeof(uint32_t), &bytes_read) ||
-        !ReadProcessMemory(process_handle, 
-                          reinterpret_cast<LPCVOID>(Memory::P2_HP_ADDR),
-                          &state->p2_hp, sizeof(uint32_t), &bytes_read) ||
-        !ReadProcessMemory(process_handle, 
-                          reinterpret_cast<LPCVOID>(Memory::P2_MAX_HP_ADDR),
-                          &state->p2_max_hp, sizeof(uint32_t), &bytes_read)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read player state");
+    RemoteMemoryBackend backend(process_handle);
+    if (!core_plan.Capture(backend, reinterpret_cast<uint8_t*>(state))) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read core state");
         return false;
     }
-    
-    // Read global state
-    if (!ReadProcessMemory(process_handle, 
-                          reinterpret_cast<LPCVOID>(Memory::ROUND_TIMER_ADDR),
-                          &state->round_timer, sizeof(uint32_t), &bytes_read) ||
-        !ReadProcessMemory(process_handle, 
-                          reinterpret_cast<LPCVOID>(Memory::GAME_TIMER_ADDR),
-                          &state->game_timer, sizeof(uint32_t), &bytes_read) ||
-        !ReadProcessMemory(process_handle, 
-                          reinterpret_cast<LPCVOID>(Memory::RANDOM_SEED_ADDR),
-                          &state->random_seed, sizeof(uint32_t), &bytes_read)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read global state");
-        return false;
-    }
-    
-    // Read visual effects
-    if (!ReadProcessMemory(process_handle, 
-                          reinterpret_cast<LPCVOID>(Memory::EFFECT_ACTIVE_FLAGS),
-                          &state->effect_active_flags, sizeof(uint32_t), &bytes_read) ||
-        !ReadProcessMemory(process_handle, 
-                          reinterpret_cast<LPCVOID>(Memory::EFFECT_TIMERS_BASE),
-                          state->effect_timers, Memory::EFFECT_TIMERS_SIZE, &bytes_read) ||
-        !ReadProcessMemory(process_handle, 
-                          reinterpret_cast<LPCVOID>(Memory::EFFECT_COLORS_BASE),
-                          state->effect_colors, Memory::EFFECT_COLORS_SIZE, &bytes_read) ||
-        !ReadProcessMemory(process_handle, 
-                          reinterpret_cast<LPCVOID>(Memory::EFFECT_TARGETS_BASE),
-                          state->effect_targets, Memory::EFFECT_TARGETS_SIZE, &bytes_read)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read visual effects");
-        return false;
-    }
-    
+
     return true;
 }
 
@@ -133,92 +59,43 @@ bool LoadCoreState(const CoreGameState* state) {
         return false;
     }
 
-    SIZE_T bytes_written;
-    
-    // Write input system state
-    if (!WriteProcessMemory(process_handle, 
-                           reinterpret_cast<LPVOID>(Memory::INPUT_BUFFER_INDEX_ADDR),
-                           &state->input_buffer_index, sizeof(uint32_t), &bytes_written)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write input buffer index");
+    RemoteMemoryBackend backend(process_handle);
+    if (!core_plan.Restore(backend, reinterpret_cast<const uint8_t*>(state))) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write core state");
         return false;
     }
-    
-    // Write current inputs
-    if (!WriteProcessMemory(process_handle, 
-                           reinterpret_cast<LPVOID>(Memory::P1_INPUT_ADDR),
-                           &state->p1_input_current, sizeof(uint32_t), &bytes_written) ||
-        !WriteProcessMemory(process_handle, 
-                           reinterpret_cast<LPVOID>(Memory::P2_INPUT_ADDR),
-                           &state->p2_input_current, sizeof(uint32_t), &bytes_written)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write current inputs");
-        return false;
-    }
-    
-    // Write input histories
-    if (!WriteProcessMemory(process_handle, 
-                           reinterpret_cast<LPVOID>(Memory::P1_INPUT_HISTORY_ADDR),
-                           state->p1_input_history, Memory::INPUT_HISTORY_SIZE, &bytes_written) ||
-        !WriteProcessMemory(process_handle, 
-                           reinterpret_cast<LPVOID>(Memory::P2_INPUT_HISTORY_ADDR),
-                           state->p2_input_history, Memory::INPUT_HISTORY_SIZE, &bytes_written)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write input histories");
+
+    return true;
+}
+
+bool SaveObjectPool(uint8_t* buffer, size_t capacity, size_t* size) {
+    if (!process_handle || !buffer || !size) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Invalid save object pool parameters");
         return false;
     }
-    
-    // Write player state
-    if (!WriteProcessMemory(process_handle, 
-                           reinterpret_cast<LPVOID>(Memory::P1_STAGE_X_ADDR),
-                           &state->p1_stage_x, sizeof(uint32_t), &bytes_written) ||
-        !WriteProcessMemory(process_handle, 
-                           reinterpret_cast<LPVOID>(Memory::P1_STAGE_Y_ADDR),
-                           &state->p1_stage_y, sizeof(uint32_t), &bytes_written) ||
-        !WriteProcessMemory(process_handle, 
-                           reinterpret_cast<LPVOID>(Memory::P1_HP_ADDR),
-                           &state->p1_hp, sizeof(uint32_t), &bytes_written) ||
-        !WriteProcessMemory(process_handle, 
-                           reinterpret_cast<LPVOID>(Memory::P1_MAX_HP_ADDR),
-                           &state->p1_max_hp, sizeof(uint32_t), &bytes_written) ||
-        !WriteProcessMemory(process_handle, 
-                           reinterpret_cast<LPVOID>(Memory::P2_HP_ADDR),
-                           &state->p2_hp, sizeof(uint32_t), &bytes_written) ||
-        !WriteProcessMemory(process_handle, 
-                           reinterpret_cast<LPVOID>(Memory::P2_MAX_HP_ADDR),
-                           &state->p2_max_hp, sizeof(uint32_t), &bytes_written)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write player state");
+
+    RemoteMemoryBackend backend(process_handle);
+    *size = SaveObjectPool(backend, OBJECT_POOL_LAYOUT, buffer, capacity, object_pool_scratch);
+    if (*size == 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to read object pool");
         return false;
     }
-    
-    // Write global state
-    if (!WriteProcessMemory(process_handle, 
-                           reinterpret_cast<LPVOID>(Memory::ROUND_TIMER_ADDR),
-                           &state->round_timer, sizeof(uint32_t), &bytes_written) ||
-        !WriteProcessMemory(process_handle, 
-                           reinterpret_cast<LPVOID>(Memory::GAME_TIMER_ADDR),
-                           &state->game_timer, sizeof(uint32_t), &bytes_written) ||
-        !WriteProcessMemory(process_handle, 
-                           reinterpret_cast<LPVOID>(Memory::RANDOM_SEED_ADDR),
-                           &state->random_seed, sizeof(uint32_t), &bytes_written)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write global state");
+
+    return true;
+}
+
+bool LoadObjectPool(const uint8_t* buffer, size_t size, DeadSlotPolicy policy) {
+    if (!process_handle || !buffer) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Invalid load object pool parameters");
         return false;
     }
-    
-    // Write visual effects
-    if (!WriteProcessMemory(process_handle, 
-                           reinterpret_cast<LPVOID>(Memory::EFFECT_ACTIVE_FLAGS),
-                           &state->effect_active_flags, sizeof(uint32_t), &bytes_written) ||
-        !WriteProcessMemory(process_handle, 
-                           reinterpret_cast<LPVOID>(Memory::EFFECT_TIMERS_BASE),
-                           state->effect_timers, Memory::EFFECT_TIMERS_SIZE, &bytes_written) ||
-        !WriteProcessMemory(process_handle, 
-                           reinterpret_cast<LPVOID>(Memory::EFFECT_COLORS_BASE),
-                           state->effect_colors, Memory::EFFECT_COLORS_SIZE, &bytes_written) ||
-        !WriteProcessMemory(process_handle, 
-                           reinterpret_cast<LPVOID>(Memory::EFFECT_TARGETS_BASE),
-                           state->effect_targets, Memory::EFFECT_TARGETS_SIZE, &bytes_written)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write visual effects");
+
+    RemoteMemoryBackend backend(process_handle);
+    if (!LoadObjectPool(backend, OBJECT_POOL_LAYOUT, buffer, size, policy)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write object pool");
         return false;
     }
-    
+
     return true;
 }
 
@@ -299,39 +176,6 @@ uint32_t CalculateStateChecksum() {
     return checksum;
 }
 
-uint32_t Fletcher32(const uint8_t* data, size_t len) {
-    uint32_t sum1 = 0xFFFF, sum2 = 0xFFFF;
-    size_t blocks = len / 2;
-
-    // Process 2-byte blocks
-    while (blocks) {
-        size_t tlen = blocks > 359 ? 359 : blocks;
-        blocks -= tlen;
-        do {
-            sum1 += (data[0] << 8) | data[1];
-            sum2 += sum1;
-            data += 2;
-        } while (--tlen);
-
-        sum1 = (sum1 & 0xFFFF) + (sum1 >> 16);
-        sum2 = (sum2 & 0xFFFF) + (sum2 >> 16);
-    }
-
-    // Handle remaining byte if length is odd
-    if (len & 1) {
-        sum1 += *data << 8;
-        sum2 += sum1;
-        sum1 = (sum1 & 0xFFFF) + (sum1 >> 16);
-        sum2 = (sum2 & 0xFFFF) + (sum2 >> 16);
-    }
-
-    // Final reduction
-    sum1 = (sum1 & 0xFFFF) + (sum1 >> 16);
-    sum2 = (sum2 & 0xFFFF) + (sum2 >> 16);
-
-    return (sum2 << 16) | sum1;
-}
-
 uint32_t CalculateCoreStateChecksum(const CoreGameState* state) {
     if (!state) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Invalid core state for checksum");
@@ -339,7 +183,7 @@ uint32_t CalculateCoreStateChecksum(const CoreGameState* state) {
     }
 
     // Calculate Fletcher32 checksum over the entire CoreGameState structure
-    return Fletcher32(reinterpret_cast<const uint8_t*>(state), sizeof(CoreGameState));
+    return Checksum::Fletcher32(state, sizeof(CoreGameState));
 }
 
 } // namespace State
@@ -1,73 +1,44 @@
 #pragma once
 
+#include <cstddef>
+#include "snapshot.h"
+#include "state_schema.h"
+#include "object_pool.h"
+#include "input_history.h"
+
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 namespace FM2K {
 namespace State {
 
-// Memory addresses for game state (from FM2K_Integration.h)
-namespace Memory {
-    // Input (from fm2k_input_system.md)
-    constexpr uintptr_t P1_INPUT_ADDR           = 0x4259C0;
-    constexpr uintptr_t P2_INPUT_ADDR           = 0x4259C4;
-    constexpr uintptr_t P1_INPUT_HISTORY_ADDR   = 0x4280E0;
-    constexpr uintptr_t P2_INPUT_HISTORY_ADDR   = 0x4290E0;
-    constexpr uintptr_t INPUT_BUFFER_INDEX_ADDR = 0x447EE0;
-
-    // Timers & Counters (verified in IDA)
-    constexpr uintptr_t FRAME_NUMBER_ADDR       = 0x447EE0; // g_input_history_frame_index (actual frame counter)
-    constexpr uintptr_t ROUND_TIMER_ADDR        = 0x470060; // g_round_timer  
-    constexpr uintptr_t GAME_TIMER_ADDR         = 0x470044; // g_game_timer
-
-    // Player State
-    constexpr uintptr_t P1_STAGE_X_ADDR         = 0x470104;
-    constexpr uintptr_t P1_STAGE_Y_ADDR         = 0x470108;
-    constexpr uintptr_t P1_HP_ADDR              = 0x47010C;
-    constexpr uintptr_t P1_MAX_HP_ADDR          = 0x470110;
-    
-    constexpr uintptr_t P2_HP_ADDR              = 0x47030C;
-    constexpr uintptr_t P2_MAX_HP_ADDR          = 0x470310;
-
-    // System
-    constexpr uintptr_t RANDOM_SEED_ADDR        = 0x41FB1C;
-    
-    // Visual effects
-    constexpr uintptr_t EFFECT_ACTIVE_FLAGS     = 0x40CC30;
-    constexpr uintptr_t EFFECT_TIMERS_BASE      = 0x40CC34;
-    constexpr uintptr_t EFFECT_COLORS_BASE      = 0x40CC54;
-    constexpr uintptr_t EFFECT_TARGETS_BASE     = 0x40CCD4;
-    
-    // Memory region sizes
-    constexpr size_t INPUT_HISTORY_SIZE         = 1024 * sizeof(uint32_t);
-    constexpr size_t EFFECT_TIMERS_SIZE         = 8 * sizeof(uint32_t);
-    constexpr size_t EFFECT_COLORS_SIZE         = 8 * 3 * sizeof(uint32_t);
-    constexpr size_t EFFECT_TARGETS_SIZE        = 8 * sizeof(uint32_t);
-} // namespace Memory
+// Core state (every Whole and Window field) packed in address order.
+// Contiguous fields (player block, input histories, hit effect state)
+// merge into single bulk copies at compile time.
+inline constexpr uint32_t CORE_STATE_CAPTURES = CaptureBit(Capture::Whole) | CaptureBit(Capture::Window);
+inline constexpr auto CORE_STATE_REGIONS = PackFields(STATE_SCHEMA, CORE_STATE_CAPTURES);
+inline constexpr auto CORE_STATE_RUNS = MergeRuns(CORE_STATE_REGIONS);
+static_assert(RegionsDisjoint(CORE_STATE_REGIONS), "Core state regions overlap");
 
-// Comprehensive game state structure
+// Snapshot of the core state; fields are read through the schema
+// (DiffFields with CORE_STATE_CAPTURES) rather than by member
 struct CoreGameState {
-    // Input system
-    uint32_t input_buffer_index;     // Current position in input ring buffer
-    uint32_t p1_input_current;       // Player 1 current input
-    uint32_t p2_input_current;       // Player 2 current input
-    uint32_t p1_input_history[1024]; // Player 1 input history (1024 frames)
-    uint32_t p2_input_history[1024]; // Player 2 input history (1024 frames)
-    
-    // Player state
-    uint32_t p1_stage_x, p1_stage_y; // Player 1 position
-    uint32_t p1_hp, p1_max_hp;       // Player 1 health
-    uint32_t p2_hp, p2_max_hp;       // Player 2 health
-    
-    // Global state
-    uint32_t round_timer;             // Round timer
-    uint32_t game_timer;              // Game timer
-    uint32_t random_seed;             // RNG seed
-    
-    // Visual effects
-    uint32_t effect_active_flags;     // Bitfield of active effects
-    uint32_t effect_timers[8];        // Effect timer array
-    uint32_t effect_colors[8][3];     // Effect colors (RGB)
-    uint32_t effect_targets[8];       // Effect target IDs
+    uint8_t bytes[CORE_STATE_REGIONS.buffer_size];
+};
+
+// Object pool as a sparse region: only slots with a non-zero active flag are
+// captured. Scanning stops at MAX_OBJECTS so every slot's flag (which sits
+// past the 382-byte stride) stays inside the pool.
+inline constexpr ObjectPoolLayout OBJECT_POOL_LAYOUT = {
+    Memory::OBJECT_POOL_ADDR, Memory::MAX_OBJECTS, Memory::OBJECT_SLOT_SIZE, Memory::OBJECT_ACTIVE_FLAG_OFFSET
+};
+
+// Input history rings, indexed by input_buffer_index. Rollback snapshots keep
+// only the slots a bounded window of frames can overwrite (see input_history.h).
+inline constexpr InputHistoryLayout INPUT_HISTORY_LAYOUT = {
+    Memory::INPUT_BUFFER_INDEX_ADDR, Memory::P1_INPUT_HISTORY_ADDR, Memory::P2_INPUT_HISTORY_ADDR,
+    Memory::INPUT_HISTORY_ENTRIES
 };
 
 // Enhanced game state structure
@@ -78,8 +49,10 @@ struct GameState {
     uint64_t timestamp_ms;       // SDL timestamp when captured
 };
 
+#ifdef _WIN32
 // Initialize state manager
 bool Init(HANDLE process);
+#endif
 
 // Shutdown state manager
 void Shutdown();
@@ -92,6 +65,11 @@ bool LoadGameState(const GameState* state);
 bool SaveCoreState(CoreGameState* state);
 bool LoadCoreState(const CoreGameState* state);
 
+// Object pool operations (sparse; see object_pool.h for the buffer layout).
+// `capacity` of MaxObjectPoolSnapshotSize(OBJECT_POOL_LAYOUT) always suffices.
+bool SaveObjectPool(uint8_t* buffer, size_t capacity, size_t* size);
+bool LoadObjectPool(const uint8_t* buffer, size_t size, DeadSlotPolicy policy = DeadSlotPolicy::ZeroFill);
+
 // Legacy compatibility
 bool SaveState(GameState* state, uint32_t* checksum = nullptr);
 bool LoadState(const GameState* state);
@@ -100,9 +78,6 @@ bool LoadState(const GameState* state);
 uint32_t CalculateStateChecksum();
 uint32_t CalculateCoreStateChecksum(const CoreGameState* state);
 
-// Helper functions
-uint32_t Fletcher32(const uint8_t* data, size_t len);
-
 // Visual state operations (disabled - no IPC)
 // bool ReadVisualState(IPC::VisualState* state);
 // bool WriteVisualState(const IPC::VisualState* state);
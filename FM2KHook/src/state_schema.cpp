@@ -0,0 +1,102 @@
+#include "state_schema.h"
+#include <cstdio>
+#include <cstring>
+
+namespace FM2K {
+namespace State {
+
+namespace {
+
+uint32_t ReadElement(const uint8_t* data, FieldType type) {
+    switch (type) {
+        case FieldType::U8:
+            return data[0];
+        case FieldType::U16: {
+            uint16_t value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+        default: {
+            uint32_t value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+    }
+}
+
+// Compare one field at `offset` in both buffers; false if it matches
+bool DiffField(const FieldInfo& field, size_t offset, const uint8_t* local, const uint8_t* remote, FieldDiff* diff) {
+    if (std::memcmp(local + offset, remote + offset, field.size) == 0) return false;
+
+    size_t element_size = FieldTypeSize(field.type);
+    *diff = { &field, 0, 0, 0, 0 };
+    for (size_t element = 0; element * element_size < field.size; element++) {
+        size_t at = offset + element * element_size;
+        if (std::memcmp(local + at, remote + at, element_size) == 0) continue;
+        if (diff->differing++ == 0) {
+            diff->element = element;
+            diff->local = ReadElement(local + at, field.type);
+            diff->remote = ReadElement(remote + at, field.type);
+        }
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+size_t DiffFields(const FieldInfo* fields, size_t count, uint32_t captures, size_t base,
+                  const uint8_t* local, const uint8_t* remote, FieldDiff* diffs, size_t max_diffs) {
+    if (!fields || !local || !remote) return 0;
+
+    size_t total = 0;
+    for (Priority priority : { Priority::Critical, Priority::Visual }) {
+        size_t offset = base;
+        const FieldInfo* pool = nullptr;
+        size_t pool_offset = 0;
+        for (size_t i = 0; i < count; i++) {
+            const FieldInfo& field = fields[i];
+            size_t field_offset = offset;
+            if (field.capture == Capture::Nested) {
+                // Laid out only as part of the pool
+                if (!pool) continue;
+                field_offset = pool_offset + (field.address - pool->address);
+            } else if (!(captures & CaptureBit(field.capture))) {
+                continue;
+            } else {
+                offset += field.size;
+                if (field.capture == Capture::Pool) {
+                    pool = &field;
+                    pool_offset = field_offset;
+                }
+            }
+
+            FieldDiff diff;
+            if (field.priority != priority || !DiffField(field, field_offset, local, remote, &diff)) continue;
+            if (diffs && total < max_diffs) diffs[total] = diff;
+            total++;
+        }
+    }
+    return total;
+}
+
+int FormatFieldDiff(const FieldDiff& diff, char* out, size_t size) {
+    const FieldInfo& field = *diff.field;
+    size_t element_size = FieldTypeSize(field.type);
+    uintptr_t address = field.address + diff.element * element_size;
+
+    char values[32];
+    if (field.type == FieldType::I32) {
+        std::snprintf(values, sizeof(values), "%d != %d", (int32_t)diff.local, (int32_t)diff.remote);
+    } else {
+        std::snprintf(values, sizeof(values), "0x%X != 0x%X", diff.local, diff.remote);
+    }
+    if (field.size == element_size) {
+        return std::snprintf(out, size, "%s @ 0x%08X: %s", field.name, (unsigned)address, values);
+    }
+    return std::snprintf(out, size, "%s[%u] @ 0x%08X: %s (%u of %u elements differ)", field.name,
+                         (unsigned)diff.element, (unsigned)address, values, (unsigned)diff.differing,
+                         (unsigned)(field.size / element_size));
+}
+
+} // namespace State
+} // namespace FM2K
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "snapshot.h"
+
+namespace FM2K {
+namespace State {
+
+// Single source of truth for the game variables the hook touches. Each field
+// is declared once with its address, element type and count, how rollback
+// treats it and how snapshots reach it. Everything else is generated from
+// STATE_SCHEMA at compile time: packed snapshot layouts, merged copy runs,
+// checksum region lists and the address constants in Memory. Adding a field
+// next to an existing one merges into that copy run, so it costs neither a
+// runtime lookup nor an extra read.
+
+// What a field's value means to rollback
+enum class Priority : uint8_t {
+    Critical,   // Drives the simulation: restored and checksummed
+    Visual      // Only changes what is drawn: restored, left out of desync checksums
+};
+
+// How snapshots reach a field
+enum class Capture : uint8_t {
+    Whole,      // Copied as is
+    Window,     // Ring indexed by frame; rollback keeps a window of it (input_history.h)
+    Pool,       // The object pool; whole in the hook, live slots only elsewhere (object_pool.h)
+    Nested,     // Lies inside the pool and is captured with it
+    None        // Engine bookkeeping the hook reads or writes but never rolls back
+};
+
+enum class FieldType : uint8_t { U8, U16, U32, I32 };
+
+constexpr uint32_t CaptureBit(Capture capture) { return 1u << static_cast<uint32_t>(capture); }
+constexpr uint32_t PriorityBit(Priority priority) { return 1u << static_cast<uint32_t>(priority); }
+constexpr uint32_t ALL_PRIORITIES = PriorityBit(Priority::Critical) | PriorityBit(Priority::Visual);
+
+constexpr size_t FieldTypeSize(FieldType type) {
+    return type == FieldType::U8 ? 1 : type == FieldType::U16 ? 2 : 4;
+}
+
+template <typename T> constexpr FieldType FieldTypeOf();
+template <> constexpr FieldType FieldTypeOf<uint8_t>() { return FieldType::U8; }
+template <> constexpr FieldType FieldTypeOf<uint16_t>() { return FieldType::U16; }
+template <> constexpr FieldType FieldTypeOf<uint32_t>() { return FieldType::U32; }
+template <> constexpr FieldType FieldTypeOf<int32_t>() { return FieldType::I32; }
+
+// Untyped schema entry, as the generators below see it
+struct FieldInfo {
+    const char* name;
+    uintptr_t address;
+    size_t size;        // Bytes
+    FieldType type;
+    Priority priority;
+    Capture capture;
+};
+
+// Typed field: the accessors are plain pointer arithmetic on a constant
+template <typename T>
+struct Field {
+    using Type = T;
+
+    const char* name;
+    uintptr_t address;
+    size_t count;
+    Priority priority;
+    Capture capture;
+
+    constexpr size_t Size() const { return sizeof(T) * count; }
+    constexpr FieldInfo Info() const { return { name, address, Size(), FieldTypeOf<T>(), priority, capture }; }
+
+    // In-process: the hook shares the game's address space
+    T& Ref(size_t index = 0) const { return reinterpret_cast<T*>(address)[index]; }
+
+    // Through a backend that maps game memory directly; nullptr otherwise
+    T* In(const MemoryBackend& memory) const { return reinterpret_cast<T*>(memory.Translate(address, Size())); }
+};
+
+// Geometry the field declarations depend on
+namespace Memory {
+    constexpr size_t INPUT_HISTORY_ENTRIES      = 1024;
+    constexpr size_t OBJECT_SLOT_SIZE           = 382;
+    constexpr size_t OBJECT_POOL_SLOTS          = 1024;
+    constexpr size_t OBJECT_ACTIVE_FLAG_OFFSET  = 0x17E;
+    constexpr size_t MAX_OBJECTS                = 1023;
+    constexpr size_t OBJECT_POOL_SIZE           = OBJECT_POOL_SLOTS * OBJECT_SLOT_SIZE;
+
+    // The engine's code: from the first page past the headers up to the first
+    // known global (g_frame_time_ms at 0x41E2F0). MinHook patches functions in
+    // here, so no field may point into it.
+    constexpr uintptr_t ENGINE_CODE_BEGIN       = 0x401000;
+    constexpr uintptr_t ENGINE_CODE_END         = 0x41E000;
+} // namespace Memory
+
+constexpr bool InEngineCode(uintptr_t address, size_t size = 1) {
+    return address < Memory::ENGINE_CODE_END && address + size > Memory::ENGINE_CODE_BEGIN;
+}
+
+// Game variables (IDA; fm2k_input_system.md, fm2k_game_state.md), in address order
+namespace Fields {
+    inline constexpr Field<uint32_t> RANDOM_SEED        { "rng seed",         0x41FB1C, 1,                              Priority::Critical, Capture::Whole };
+    inline constexpr Field<uint32_t> P1_INPUT           { "p1 input",         0x4259C0, 1,                              Priority::Critical, Capture::Whole };  // g_p1_input[0]
+    inline constexpr Field<uint32_t> P2_INPUT           { "p2 input",         0x4259C4, 1,                              Priority::Critical, Capture::Whole };  // g_p2_input
+    inline constexpr Field<uint32_t> P1_INPUT_HISTORY   { "p1 input history", 0x4280E0, Memory::INPUT_HISTORY_ENTRIES,  Priority::Critical, Capture::Window };
+    inline constexpr Field<uint32_t> P2_INPUT_HISTORY   { "p2 input history", 0x4290E0, Memory::INPUT_HISTORY_ENTRIES,  Priority::Critical, Capture::Window };
+    inline constexpr Field<uint32_t> LAST_FRAME_TIME    { "last frame time",  0x447DD4, 1,                              Priority::Critical, Capture::None };   // g_last_frame_time (timeGetTime ms)
+    inline constexpr Field<uint32_t> INPUT_INDEX        { "input index",      0x447EE0, 1,                              Priority::Critical, Capture::Whole };  // g_input_history_frame_index, the frame counter
+    inline constexpr Field<uint32_t> GAME_TIMER         { "game timer",       0x470044, 1,                              Priority::Critical, Capture::Whole };
+    inline constexpr Field<uint32_t> ROUND_TIMER        { "round timer",      0x470060, 1,                              Priority::Critical, Capture::Whole };
+    inline constexpr Field<uint32_t> P1_STAGE_X         { "p1 stage x",       0x470104, 1,                              Priority::Critical, Capture::Whole };
+    inline constexpr Field<uint32_t> P1_STAGE_Y         { "p1 stage y",       0x470108, 1,                              Priority::Critical, Capture::Whole };
+    inline constexpr Field<uint32_t> P1_HP              { "p1 hp",            0x47010C, 1,                              Priority::Critical, Capture::Whole };
+    inline constexpr Field<uint32_t> P1_MAX_HP          { "p1 max hp",        0x470110, 1,                              Priority::Critical, Capture::Whole };
+    inline constexpr Field<uint32_t> HIT_EFFECT_TARGET  { "hit effect target", 0x4701C4, 1,                              Priority::Critical, Capture::Whole };  // g_hit_effect_target
+    inline constexpr Field<uint32_t> HIT_EFFECT_TIMER   { "hit effect timer", 0x4701C8, 1,                              Priority::Critical, Capture::Whole };  // g_hit_effect_timer
+    inline constexpr Field<uint8_t>  OBJECT_POOL        { "object pool",      0x4701E0, Memory::OBJECT_POOL_SIZE,       Priority::Critical, Capture::Pool };
+    // Inside object slot 0
+    inline constexpr Field<uint32_t> P2_HP              { "p2 hp",            0x47030C, 1,                              Priority::Critical, Capture::Nested };
+    inline constexpr Field<uint32_t> P2_MAX_HP          { "p2 max hp",        0x470310, 1,                              Priority::Critical, Capture::Nested };
+} // namespace Fields
+
+inline constexpr FieldInfo STATE_SCHEMA[] = {
+    Fields::RANDOM_SEED.Info(),
+    Fields::P1_INPUT.Info(),
+    Fields::P2_INPUT.Info(),
+    Fields::P1_INPUT_HISTORY.Info(),
+    Fields::P2_INPUT_HISTORY.Info(),
+    Fields::LAST_FRAME_TIME.Info(),
+    Fields::INPUT_INDEX.Info(),
+    Fields::GAME_TIMER.Info(),
+    Fields::ROUND_TIMER.Info(),
+    Fields::P1_STAGE_X.Info(),
+    Fields::P1_STAGE_Y.Info(),
+    Fields::P1_HP.Info(),
+    Fields::P1_MAX_HP.Info(),
+    Fields::HIT_EFFECT_TARGET.Info(),
+    Fields::HIT_EFFECT_TIMER.Info(),
+    Fields::OBJECT_POOL.Info(),
+    Fields::P2_HP.Info(),
+    Fields::P2_MAX_HP.Info(),
+};
+constexpr size_t STATE_SCHEMA_COUNT = sizeof(STATE_SCHEMA) / sizeof(STATE_SCHEMA[0]);
+
+// Fields must be non-empty, outside the engine's code, in address order and
+// disjoint, except that a Nested field sits wholly inside the Pool field
+// before it
+template <size_t N>
+constexpr bool SchemaIsValid(const FieldInfo (&fields)[N]) {
+    uintptr_t end = 0;
+    const FieldInfo* pool = nullptr;
+    for (const FieldInfo& field : fields) {
+        if (field.size == 0 || field.size % FieldTypeSize(field.type) != 0) return false;
+        if (InEngineCode(field.address, field.size)) return false;
+        if (field.capture == Capture::Nested) {
+            if (!pool || field.address < pool->address ||
+                field.address + field.size > pool->address + pool->size) {
+                return false;
+            }
+            continue;
+        }
+        if (field.address < end) return false;
+        end = field.address + field.size;
+        pool = field.capture == Capture::Pool ? &field : nullptr;
+    }
+    return true;
+}
+static_assert(SchemaIsValid(STATE_SCHEMA),
+              "STATE_SCHEMA fields must be outside engine code, in address order and must not overlap (only Nested fields may sit inside the pool)");
+
+// No field may cover any byte of `code` (a hooked function's entry)
+template <size_t N>
+constexpr bool SchemaAvoids(const FieldInfo (&fields)[N], uintptr_t code, size_t size = 1) {
+    for (const FieldInfo& field : fields) {
+        if (code < field.address + field.size && code + size > field.address) return false;
+    }
+    return true;
+}
+
+// Regions generated from the schema. Fixed capacity, `count` of them used;
+// `buffer_size` is one past the last byte laid out.
+template <size_t N>
+struct RegionList {
+    std::array<MemoryRegion, N> regions{};
+    size_t count = 0;
+    size_t buffer_size = 0;
+
+    constexpr const MemoryRegion* begin() const { return regions.data(); }
+    constexpr const MemoryRegion* end() const { return regions.data() + count; }
+};
+
+// Lay the fields whose capture is in `captures` back to back in address
+// order from `base`, and list those whose priority is in `priorities` (the
+// rest keep their place in the layout, so a filtered list shares offsets
+// with the full one)
+template <size_t N>
+constexpr RegionList<N> PackFields(const FieldInfo (&fields)[N], uint32_t captures, size_t base = 0,
+                                   uint32_t priorities = ALL_PRIORITIES) {
+    RegionList<N> list;
+    size_t offset = base;
+    for (const FieldInfo& field : fields) {
+        if (!(captures & CaptureBit(field.capture))) continue;
+        if (priorities & PriorityBit(field.priority)) {
+            list.regions[list.count++] = { field.address, field.size, offset, field.name };
+        }
+        offset += field.size;
+    }
+    list.buffer_size = offset;
+    return list;
+}
+
+// Merge regions contiguous both in game memory and in the buffer into single
+// runs, as SnapshotPlan::Build does at runtime
+template <size_t N>
+constexpr RegionList<N> MergeRuns(const RegionList<N>& list) {
+    RegionList<N> runs;
+    runs.buffer_size = list.buffer_size;
+    for (const MemoryRegion& region : list) {
+        if (runs.count > 0) {
+            MemoryRegion& run = runs.regions[runs.count - 1];
+            if (region.address == run.address + run.size && region.offset == run.offset + run.size) {
+                run.size += region.size;
+                continue;
+            }
+        }
+        runs.regions[runs.count++] = region;
+    }
+    return runs;
+}
+
+// No two regions touch the same game byte
+template <size_t N>
+constexpr bool RegionsDisjoint(const RegionList<N>& list) {
+    for (size_t i = 1; i < list.count; i++) {
+        const MemoryRegion& previous = list.regions[i - 1];
+        if (list.regions[i].address < previous.address + previous.size) return false;
+    }
+    return true;
+}
+
+// Game addresses for code that works in raw addresses (layouts, the
+// synthetic engine), generated from the fields above
+namespace Memory {
+    constexpr uintptr_t P1_INPUT_ADDR           = Fields::P1_INPUT.address;
+    constexpr uintptr_t P2_INPUT_ADDR           = Fields::P2_INPUT.address;
+    constexpr uintptr_t P1_INPUT_HISTORY_ADDR   = Fields::P1_INPUT_HISTORY.address;
+    constexpr uintptr_t P2_INPUT_HISTORY_ADDR   = Fields::P2_INPUT_HISTORY.address;
+    constexpr uintptr_t INPUT_BUFFER_INDEX_ADDR = Fields::INPUT_INDEX.address;
+    constexpr uintptr_t FRAME_NUMBER_ADDR       = Fields::INPUT_INDEX.address;
+    constexpr uintptr_t ROUND_TIMER_ADDR        = Fields::ROUND_TIMER.address;
+    constexpr uintptr_t GAME_TIMER_ADDR         = Fields::GAME_TIMER.address;
+    constexpr uintptr_t P1_STAGE_X_ADDR         = Fields::P1_STAGE_X.address;
+    constexpr uintptr_t P1_STAGE_Y_ADDR         = Fields::P1_STAGE_Y.address;
+    constexpr uintptr_t P1_HP_ADDR              = Fields::P1_HP.address;
+    constexpr uintptr_t P1_MAX_HP_ADDR          = Fields::P1_MAX_HP.address;
+    constexpr uintptr_t P2_HP_ADDR              = Fields::P2_HP.address;
+    constexpr uintptr_t P2_MAX_HP_ADDR          = Fields::P2_MAX_HP.address;
+    constexpr uintptr_t RANDOM_SEED_ADDR        = Fields::RANDOM_SEED.address;
+    constexpr uintptr_t HIT_EFFECT_TARGET_ADDR  = Fields::HIT_EFFECT_TARGET.address;
+    constexpr uintptr_t HIT_EFFECT_TIMER_ADDR   = Fields::HIT_EFFECT_TIMER.address;
+    constexpr uintptr_t OBJECT_POOL_ADDR        = Fields::OBJECT_POOL.address;
+
+    constexpr size_t INPUT_HISTORY_SIZE         = Fields::P1_INPUT_HISTORY.Size();
+} // namespace Memory
+
+// One field that differs between two snapshot buffers
+struct FieldDiff {
+    const FieldInfo* field;
+    size_t element;         // First differing element
+    size_t differing;       // Elements that differ
+    uint32_t local;         // First differing element's value on each side
+    uint32_t remote;
+};
+
+// Field-level comparison of two buffers laid out by PackFields(fields, count,
+// captures, base). Nested fields are found inside the pool when the pool is
+// part of the layout. Writes up to `max_diffs` entries, Critical fields
+// first, and returns how many fields differ in total.
+size_t DiffFields(const FieldInfo* fields, size_t count, uint32_t captures, size_t base,
+                  const uint8_t* local, const uint8_t* remote, FieldDiff* diffs, size_t max_diffs);
+
+// One line for a desync report, e.g. "p1 hp @ 0x47010C: 9990 != 10000"
+int FormatFieldDiff(const FieldDiff& diff, char* out, size_t size);
+
+} // namespace State
+} // namespace FM2K
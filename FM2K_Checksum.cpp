@@ -0,0 +1,365 @@
+#include "FM2K_Checksum.h"
+#include <cstring>
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define FM2K_CHECKSUM_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define FM2K_TARGET(isa)
+#else
+#include <cpuid.h>
+#define FM2K_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace FM2K {
+namespace Checksum {
+
+namespace {
+
+constexpr uint32_t MOD = 65535;
+
+// Running Fletcher sums, both kept reduced below MOD between blocks
+struct Sums {
+    uint32_t a;
+    uint32_t b;
+};
+
+// Fold a block into the running sums. For block words w_0..w_{n-1}:
+// block_a = sum(w_i), block_b = sum((n - i) * w_i).
+inline void Combine(Sums& sums, uint64_t block_a, uint64_t block_b, size_t words) {
+    sums.b = static_cast<uint32_t>((sums.b + static_cast<uint64_t>(words) * sums.a + block_b) % MOD);
+    sums.a = static_cast<uint32_t>((sums.a + block_a) % MOD);
+}
+
+inline uint32_t LoadWord(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 8) | p[1];
+}
+
+void ScalarWords(Sums& sums, const uint8_t* data, size_t words) {
+    // 359 words keep b below 2^32 starting from reduced sums
+    while (words) {
+        size_t block = words > 359 ? 359 : words;
+        words -= block;
+        uint32_t a = sums.a, b = sums.b;
+        for (size_t i = 0; i < block; ++i, data += 2) {
+            a += LoadWord(data);
+            b += a;
+        }
+        sums.a = a % MOD;
+        sums.b = b % MOD;
+    }
+}
+
+#ifdef FM2K_CHECKSUM_X86
+
+// Per-lane sums over up to 256 chunks stay below 2^32
+constexpr size_t SIMD_BLOCK_CHUNKS = 256;
+
+FM2K_TARGET("sse2")
+void Sse2Words(Sums& sums, const uint8_t* data, size_t words) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t chunks = words / 8;
+
+    while (chunks) {
+        size_t block = chunks > SIMD_BLOCK_CHUNKS ? SIMD_BLOCK_CHUNKS : chunks;
+        chunks -= block;
+
+        // Lane j of a/b covers words j, j + 8, j + 16, ... of the block;
+        // b accumulates a before each chunk is added
+        __m128i a_lo = zero, a_hi = zero, b_lo = zero, b_hi = zero;
+        for (size_t c = 0; c < block; ++c, data += 16) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+            x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));   // Big-endian words
+            b_lo = _mm_add_epi32(b_lo, a_lo);
+            b_hi = _mm_add_epi32(b_hi, a_hi);
+            a_lo = _mm_add_epi32(a_lo, _mm_unpacklo_epi16(x, zero));
+            a_hi = _mm_add_epi32(a_hi, _mm_unpackhi_epi16(x, zero));
+        }
+
+        alignas(16) uint32_t a[8], b[8];
+        _mm_store_si128(reinterpret_cast<__m128i*>(a), a_lo);
+        _mm_store_si128(reinterpret_cast<__m128i*>(a + 4), a_hi);
+        _mm_store_si128(reinterpret_cast<__m128i*>(b), b_lo);
+        _mm_store_si128(reinterpret_cast<__m128i*>(b + 4), b_hi);
+
+        uint64_t block_a = 0, block_b = 0;
+        for (uint32_t j = 0; j < 8; ++j) {
+            block_a += a[j];
+            block_b += 8ull * b[j] + static_cast<uint64_t>(8 - j) * a[j];
+        }
+        Combine(sums, block_a, block_b, block * 8);
+    }
+
+    ScalarWords(sums, data, words % 8);
+}
+
+FM2K_TARGET("avx2")
+void Avx2Words(Sums& sums, const uint8_t* data, size_t words) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t chunks = words / 16;
+
+    while (chunks) {
+        size_t block = chunks > SIMD_BLOCK_CHUNKS ? SIMD_BLOCK_CHUNKS : chunks;
+        chunks -= block;
+
+        __m256i a_lo = zero, a_hi = zero, b_lo = zero, b_hi = zero;
+        for (size_t c = 0; c < block; ++c, data += 32) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+            x = _mm256_or_si256(_mm256_slli_epi16(x, 8), _mm256_srli_epi16(x, 8));
+            b_lo = _mm256_add_epi32(b_lo, a_lo);
+            b_hi = _mm256_add_epi32(b_hi, a_hi);
+            a_lo = _mm256_add_epi32(a_lo, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(x)));
+            a_hi = _mm256_add_epi32(a_hi, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(x, 1)));
+        }
+
+        alignas(32) uint32_t a[16], b[16];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(a), a_lo);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(a + 8), a_hi);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(b), b_lo);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(b + 8), b_hi);
+
+        uint64_t block_a = 0, block_b = 0;
+        for (uint32_t j = 0; j < 16; ++j) {
+            block_a += a[j];
+            block_b += 16ull * b[j] + static_cast<uint64_t>(16 - j) * a[j];
+        }
+        Combine(sums, block_a, block_b, block * 16);
+    }
+
+    ScalarWords(sums, data, words % 16);
+}
+
+struct CpuFeatures {
+    bool sse2;
+    bool avx2;
+};
+
+CpuFeatures DetectCpu() {
+    CpuFeatures features = {};
+    uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    uint32_t max_leaf = static_cast<uint32_t>(regs[0]);
+    __cpuid(regs, 1);
+    ecx = static_cast<uint32_t>(regs[2]);
+    edx = static_cast<uint32_t>(regs[3]);
+#else
+    uint32_t max_leaf = __get_cpuid_max(0, nullptr);
+    if (max_leaf >= 1) {
+        __cpuid(1, eax, ebx, ecx, edx);
+    }
+#endif
+    features.sse2 = (edx >> 26) & 1;
+
+    // AVX state must be enabled by the OS (OSXSAVE + XCR0 bits 1 and 2)
+    bool os_avx = false;
+    if (((ecx >> 27) & 1) && ((ecx >> 28) & 1)) {
+#if defined(_MSC_VER)
+        os_avx = (_xgetbv(0) & 6) == 6;
+#else
+        uint32_t xcr0_lo = 0, xcr0_hi = 0;
+        __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+        os_avx = (xcr0_lo & 6) == 6;
+#endif
+    }
+
+    if (os_avx && max_leaf >= 7) {
+#if defined(_MSC_VER)
+        __cpuidex(regs, 7, 0);
+        ebx = static_cast<uint32_t>(regs[1]);
+#else
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+#endif
+        features.avx2 = (ebx >> 5) & 1;
+    }
+    return features;
+}
+
+const CpuFeatures& Cpu() {
+    static const CpuFeatures features = DetectCpu();
+    return features;
+}
+
+#endif // FM2K_CHECKSUM_X86
+
+uint32_t Finish(Sums sums, const uint8_t* data, size_t len) {
+    if (len & 1) {
+        sums.a = (sums.a + (static_cast<uint32_t>(data[len - 1]) << 8)) % MOD;
+        sums.b = (sums.b + sums.a) % MOD;
+    }
+    uint32_t a = sums.a ? sums.a : MOD;
+    uint32_t b = sums.b ? sums.b : MOD;
+    return (b << 16) | a;
+}
+
+// XXH64 primes
+constexpr uint64_t P1 = 11400714785074694791ull;
+constexpr uint64_t P2 = 14029467366897019727ull;
+constexpr uint64_t P3 = 1609587929392839161ull;
+constexpr uint64_t P4 = 9650029242287828579ull;
+constexpr uint64_t P5 = 2870177450012600261ull;
+
+inline uint64_t Rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t Read64(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t Read32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t Round(uint64_t acc, uint64_t input) {
+    acc += input * P2;
+    acc = Rotl64(acc, 31);
+    return acc * P1;
+}
+
+inline uint64_t MergeRound(uint64_t acc, uint64_t val) {
+    acc ^= Round(0, val);
+    return acc * P1 + P4;
+}
+
+} // anonymous namespace
+
+bool KernelSupported(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::Scalar: return true;
+#ifdef FM2K_CHECKSUM_X86
+        case Kernel::SSE2: return Cpu().sse2;
+        case Kernel::AVX2: return Cpu().avx2;
+#endif
+        default: return false;
+    }
+}
+
+Kernel ActiveKernel() {
+    static const Kernel kernel = KernelSupported(Kernel::AVX2) ? Kernel::AVX2
+                               : KernelSupported(Kernel::SSE2) ? Kernel::SSE2
+                               : Kernel::Scalar;
+    return kernel;
+}
+
+const char* KernelName(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::Scalar: return "scalar";
+        case Kernel::SSE2: return "SSE2";
+        case Kernel::AVX2: return "AVX2";
+    }
+    return "unknown";
+}
+
+uint32_t Fletcher32With(Kernel kernel, const void* data, size_t len) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    Sums sums = { 0, 0 };
+
+    if (!KernelSupported(kernel)) kernel = Kernel::Scalar;
+    switch (kernel) {
+#ifdef FM2K_CHECKSUM_X86
+        case Kernel::AVX2: Avx2Words(sums, bytes, len / 2); break;
+        case Kernel::SSE2: Sse2Words(sums, bytes, len / 2); break;
+#endif
+        default: ScalarWords(sums, bytes, len / 2); break;
+    }
+    return Finish(sums, bytes, len);
+}
+
+uint32_t Fletcher32(const void* data, size_t len) {
+    return Fletcher32With(ActiveKernel(), data, len);
+}
+
+uint32_t StateChecksum(Mode mode, const void* data, size_t len) {
+    if (mode != Mode::Hash64) return Fletcher32(data, len);
+    uint32_t folded = Fold32(Hash64(data, len));
+    return folded ? folded : 0xFFFFFFFFu;
+}
+
+bool ParseMode(const char* text, Mode* mode) {
+    char lower[16] = {};
+    for (size_t i = 0; text[i]; ++i) {
+        if (i + 1 == sizeof(lower)) return false;
+        char c = text[i];
+        lower[i] = (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+    if (std::strcmp(lower, "fletcher32") == 0) {
+        *mode = Mode::Fletcher32;
+    } else if (std::strcmp(lower, "hash64") == 0) {
+        *mode = Mode::Hash64;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* ModeName(Mode mode) {
+    switch (mode) {
+        case Mode::Fletcher32: return "Fletcher32";
+        case Mode::Hash64: return "Hash64";
+    }
+    return "unknown";
+}
+
+uint64_t Hash64(const void* data, size_t len, uint64_t seed) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        uint64_t v1 = seed + P1 + P2;
+        uint64_t v2 = seed + P2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - P1;
+        const uint8_t* limit = end - 32;
+        do {
+            v1 = Round(v1, Read64(p));
+            v2 = Round(v2, Read64(p + 8));
+            v3 = Round(v3, Read64(p + 16));
+            v4 = Round(v4, Read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = Rotl64(v1, 1) + Rotl64(v2, 7) + Rotl64(v3, 12) + Rotl64(v4, 18);
+        h = MergeRound(h, v1);
+        h = MergeRound(h, v2);
+        h = MergeRound(h, v3);
+        h = MergeRound(h, v4);
+    } else {
+        h = seed + P5;
+    }
+
+    h += static_cast<uint64_t>(len);
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= Round(0, Read64(p));
+        h = Rotl64(h, 27) * P1 + P4;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<uint64_t>(Read32(p)) * P1;
+        h = Rotl64(h, 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        h ^= static_cast<uint64_t>(*p) * P5;
+        h = Rotl64(h, 11) * P1;
+    }
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+} // namespace Checksum
+} // namespace FM2K
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// State checksums shared by the hook DLL and the launcher.
+//
+// Fletcher32 is the checksum handed to GekkoNet for desync detection. It is
+// defined over big-endian 16-bit words (a trailing odd byte is the high byte
+// of a final word), with both sums mod 65535 and 0 reported as 0xFFFF. The
+// SSE2 and AVX2 kernels produce exactly the scalar result; the fastest one
+// the CPU supports is picked on first use.
+//
+// Hash64 (XXH64) is the optional stronger mode: 64 bits of well-mixed hash,
+// so two diverged states practically never collide. It is not the faster
+// one: fm2k_checksum_bench puts it at roughly half the AVX2 kernel's GB/s on
+// x64, and a 32-bit build has to split its 64-bit multiplies. Fletcher32
+// stays the default; pick Hash64 with Mode when collisions matter more than
+// time per save.
+namespace FM2K {
+namespace Checksum {
+
+// Desync checksum handed to GekkoNet; both peers must use the same one
+enum class Mode {
+    Fletcher32,
+    Hash64
+};
+
+enum class Kernel {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+uint32_t Fletcher32(const void* data, size_t len);
+
+// Run a specific kernel (unsupported kernels fall back to scalar)
+uint32_t Fletcher32With(Kernel kernel, const void* data, size_t len);
+
+uint64_t Hash64(const void* data, size_t len, uint64_t seed = 0);
+
+// 64-bit hash folded to fit 32-bit checksum slots (GekkoNet save events)
+inline uint32_t Fold32(uint64_t hash) {
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+// `mode`'s checksum of the data in 32 bits. Hash64 is folded, and a fold of
+// 0 is reported as 0xFFFFFFFF, so neither mode ever returns 0.
+uint32_t StateChecksum(Mode mode, const void* data, size_t len);
+
+// "fletcher32" or "hash64", any case; false leaves `mode` untouched
+bool ParseMode(const char* text, Mode* mode);
+const char* ModeName(Mode mode);
+
+bool KernelSupported(Kernel kernel);
+Kernel ActiveKernel();
+const char* KernelName(Kernel kernel);
+
+} // namespace Checksum
+} // namespace FM2K
@@ -1,5 +1,6 @@
 #include "FM2K_GameInstance.h"
 #include "FM2K_Integration.h"
+#include "FM2K_SharedControl.h"
 // DLL injection approach - no direct hooks needed
 #include <SDL3/SDL.h>
 #include <algorithm>
@@ -8,22 +9,6 @@
 #include <codecvt>
 #include <windows.h>
 
-// Shared memory structure matching the DLL
-struct SharedInputData {
-    uint32_t frame_number;
-    uint16_t p1_input;
-    uint16_t p2_input;
-    bool valid;
-    
-    // Network configuration
-    bool is_online_mode;
-    bool is_host;
-    char remote_address[64];
-    uint16_t port;
-    uint8_t input_delay;
-    bool config_updated;
-};
-
 namespace {
 
 // Constants
@@ -54,7 +39,7 @@ FM2KGameInstance::FM2KGameInstance()
     : process_handle_(nullptr)
     , process_id_(0)
     , shared_memory_handle_(nullptr)
-    , shared_memory_data_(nullptr)
+    , shared_control_(nullptr)
     , last_processed_frame_(0)
 {
     process_info_ = {};
@@ -348,24 +333,24 @@ void FM2KGameInstance::SetNetworkConfig(bool is_online, bool is_host, const std:
                 is_online ? "YES" : "NO", is_host ? "YES" : "NO", remote_addr.c_str(), port, input_delay);
     
     // If shared memory is not initialized, initialize it first
-    if (!shared_memory_data_) {
+    if (!shared_control_) {
         InitializeSharedMemory();
     }
     
-    // Write configuration to shared memory
-    if (shared_memory_data_) {
-        SharedInputData* shared_data = static_cast<SharedInputData*>(shared_memory_data_);
-        shared_data->is_online_mode = is_online;
-        shared_data->is_host = is_host;
-        shared_data->port = port;
-        shared_data->input_delay = input_delay;
-        shared_data->config_updated = true;
+    // Publish configuration to shared memory; the hook picks it up next frame
+    if (shared_control_) {
+        FM2K::NetworkConfig config = {};
+        config.is_online_mode = is_online;
+        config.is_host = is_host;
+        config.port = port;
+        config.input_delay = input_delay;
         
         // Copy remote address safely
-        strncpy_s(shared_data->remote_address, sizeof(shared_data->remote_address), 
+        strncpy_s(config.remote_address, sizeof(config.remote_address), 
                   remote_addr.c_str(), _TRUNCATE);
         
-        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Network configuration written to shared memory");
+        uint32_t generation = shared_control_->WriteConfig(config);
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Network configuration written to shared memory (generation %u)", generation);
     } else {
         SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Cannot set network config - shared memory not available");
     }
@@ -457,23 +442,33 @@ void FM2KGameInstance::InitializeSharedMemory() {
     shared_memory_handle_ = OpenFileMappingA(
         FILE_MAP_ALL_ACCESS,
         FALSE,
-        "FM2K_InputSharedMemory"
+        FM2K::SHARED_CONTROL_NAME
     );
     
     if (shared_memory_handle_ != nullptr) {
-        shared_memory_data_ = MapViewOfFile(
+        void* view = MapViewOfFile(
             shared_memory_handle_,
             FILE_MAP_ALL_ACCESS,
             0,
             0,
-            sizeof(SharedInputData)
+            sizeof(FM2K::SharedControlBlock)
         );
         
-        if (shared_memory_data_) {
-            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Shared memory opened successfully");
+        // A block the DLL has not formatted yet, or one from a DLL built
+        // against another layout, is left alone and retried later
+        shared_control_ = view ? FM2K::SharedControlBlock::Attach(view) : nullptr;
+        if (shared_control_) {
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Shared memory opened successfully (layout %u)", FM2K::SHARED_CONTROL_LAYOUT);
             last_processed_frame_ = 0;
         } else {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to map shared memory view");
+            if (view) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Shared memory is not a layout %u control block", FM2K::SHARED_CONTROL_LAYOUT);
+                UnmapViewOfFile(view);
+            } else {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to map shared memory view");
+            }
+            CloseHandle(shared_memory_handle_);
+            shared_memory_handle_ = nullptr;
         }
     } else {
         SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to open shared memory (DLL might not be ready yet)");
@@ -481,9 +476,9 @@ void FM2KGameInstance::InitializeSharedMemory() {
 }
 
 void FM2KGameInstance::CleanupSharedMemory() {
-    if (shared_memory_data_) {
-        UnmapViewOfFile(shared_memory_data_);
-        shared_memory_data_ = nullptr;
+    if (shared_control_) {
+        UnmapViewOfFile(shared_control_);
+        shared_control_ = nullptr;
     }
     if (shared_memory_handle_) {
         CloseHandle(shared_memory_handle_);
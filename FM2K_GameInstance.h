@@ -6,7 +6,9 @@
 #include <filesystem>
 #include <windows.h>
 
-
+namespace FM2K {
+struct SharedControlBlock;
+}
 
 class FM2KGameInstance {
 public:
@@ -79,6 +81,6 @@ private:
     
     // Shared memory for input communication with injected DLL
     HANDLE shared_memory_handle_;
-    void* shared_memory_data_;
+    FM2K::SharedControlBlock* shared_control_;
     uint32_t last_processed_frame_;
 };
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "vendored/GekkoNet/GekkoLib/include/gekkonet.h"
 #include "MinHook.h"
 #include "ISession.h"
+#include "FM2K_Checksum.h"
 
 #include <string>
 #include <vector>
@@ -28,35 +29,8 @@ namespace FM2K {
     // Forward declarations for FM2K namespace classes
     class GekkoNetBridge;
     
-    // Memory addresses for critical game state
-    constexpr uintptr_t INPUT_BUFFER_INDEX_ADDR = 0x470000;
-    constexpr uintptr_t RANDOM_SEED_ADDR = 0x41FB1C;
-    
-    // Player state addresses (working addresses for this game version)
-    constexpr uintptr_t P1_INPUT_ADDR = 0x470100;          // Current input state (working)
-    constexpr uintptr_t P1_STAGE_X_ADDR = 0x470104;
-    constexpr uintptr_t P1_STAGE_Y_ADDR = 0x470108;
-    constexpr uintptr_t P1_HP_ADDR = 0x47010C;
-    constexpr uintptr_t P1_MAX_HP_ADDR = 0x470110;
-    constexpr uintptr_t P1_INPUT_HISTORY_ADDR = 0x470200;  // Input history buffer
-    
-    constexpr uintptr_t P2_INPUT_ADDR = 0x470300;          // Current input state (working)
-    constexpr uintptr_t P2_HP_ADDR = 0x47030C;
-    constexpr uintptr_t P2_MAX_HP_ADDR = 0x470310;
-    constexpr uintptr_t P2_INPUT_HISTORY_ADDR = 0x470400;
-    
-    // Global state addresses
-    constexpr uintptr_t ROUND_TIMER_ADDR = 0x470060;
-    constexpr uintptr_t GAME_TIMER_ADDR = 0x470064;
-
-    // Sprite effect system addresses
-    constexpr uintptr_t EFFECT_ACTIVE_FLAGS = 0x40CC30;  // Bitfield of active effects
-    constexpr uintptr_t EFFECT_TIMERS_BASE = 0x40CC34;   // Array of 8 effect timers
-    constexpr uintptr_t EFFECT_COLORS_BASE = 0x40CC54;   // Array of 8 RGB color sets
-    constexpr uintptr_t EFFECT_TARGETS_BASE = 0x40CCD4;  // Array of 8 target IDs
-    
-    // Game State
-    constexpr DWORD OBJECT_POOL_ADDR = 0x4701E0;
+    // Game variable addresses live in one place, the hook's state schema
+    // (FM2KHook/src/state_schema.h)
     
     // Hook Points
     constexpr DWORD FRAME_HOOK_ADDR = 0x4146D0;
@@ -98,8 +72,6 @@ namespace FM2K {
 
     // Utility functions
     bool FileExists(const std::string& path);
-    uint32_t Fletcher32(const uint16_t* data, size_t len);
-    float GetFM2KFrameTime(float frames_ahead);
     std::chrono::milliseconds GetFrameDuration();
 
     struct GameState {
@@ -146,7 +118,7 @@ namespace FM2K {
 
         // Calculate state checksum for rollback verification
         uint32_t CalculateChecksum() const {
-            return Fletcher32(reinterpret_cast<const uint16_t*>(this), sizeof(GameState));
+            return Checksum::Fletcher32(this, sizeof(GameState));
         }
     };
 
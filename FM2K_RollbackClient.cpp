@@ -125,36 +125,6 @@ namespace Utils {
         return "Unknown";
     }
     
-    uint32_t Fletcher32(const uint16_t* data, size_t len) {
-        uint32_t c0, c1;
-        len = (len + 1) & ~1;
-        
-        for (c0 = c1 = 0; len > 0; ) {
-            size_t blocklen = len;
-            if (blocklen > 360 * 2) {
-                blocklen = 360 * 2;
-            }
-            len -= blocklen;
-            do {
-                c0 = c0 + *data++;
-                c1 = c1 + c0;
-            } while ((blocklen -= 2));
-            c0 = c0 % 65535;
-            c1 = c1 % 65535;
-        }
-        return (c1 << 16 | c0);
-    }
-    
-    float GetFM2KFrameTime(float frames_ahead) {
-        const float base_frame_time = 1.0f / 100.0f;  // 10ms per frame
-        
-        if (frames_ahead >= 0.75f) {
-            return base_frame_time * 1.02f;  // Slow down if too far ahead
-        } else {
-            return base_frame_time;
-        }
-    }
-    
     std::chrono::milliseconds GetFrameDuration() {
         return std::chrono::milliseconds(10);  // 100 FPS = 10ms per frame
     }
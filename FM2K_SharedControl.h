@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+// Control block shared by the launcher and the hook DLL through a named
+// file mapping. The hook creates and formats it; the launcher attaches only
+// once the magic, layout version and size all match its own build, so a
+// stale DLL or launcher is refused instead of misreading fields.
+//
+// The launcher is the only writer of the network config, which is published
+// under a seqlock: the sequence is odd while a write is in progress and even
+// otherwise, and each finished write advances it by two. That even value is
+// the config's generation, so the hook checks for a new config each frame
+// with one relaxed load and only copies it when the generation moved. The
+// copy goes through relaxed atomic words and is kept only if the sequence
+// did not move under it, so it can never be torn.
+//
+// Launcher-written and hook-written fields sit on separate cache lines.
+// Everything is a lock-free 32-bit atomic, which is address-free and so
+// valid across the two processes' views of the mapping.
+namespace FM2K {
+
+constexpr char SHARED_CONTROL_NAME[] = "FM2K_InputSharedMemory";
+constexpr uint32_t SHARED_CONTROL_MAGIC = 0x43324D46;     // "FM2C"
+constexpr uint32_t SHARED_CONTROL_LAYOUT = 1;             // Bump on any change below
+
+struct NetworkConfig {
+    bool is_online_mode;
+    bool is_host;
+    uint8_t input_delay;
+    uint8_t reserved;
+    uint16_t port;
+    uint16_t reserved2;
+    char remote_address[64];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Shared control words must be lock-free");
+static_assert(sizeof(NetworkConfig) % sizeof(uint32_t) == 0, "NetworkConfig must be whole words");
+
+struct SharedControlBlock {
+    static constexpr size_t CACHE_LINE = 64;
+    static constexpr size_t CONFIG_WORDS = sizeof(NetworkConfig) / sizeof(uint32_t);
+
+    // Header, written once by the hook; magic last, so a launcher never
+    // sees a valid magic ahead of the rest
+    std::atomic<uint32_t> magic;
+    uint32_t layout_version;
+    uint32_t size;
+
+    // Launcher section
+    alignas(CACHE_LINE) std::atomic<uint32_t> config_sequence;
+    std::atomic<uint32_t> config_words[CONFIG_WORDS];
+
+    // Hook section
+    alignas(CACHE_LINE) std::atomic<uint32_t> applied_generation;     // Last config the hook took
+    std::atomic<uint32_t> hook_frame;                                 // Hook's frame counter
+
+    // Hook: format freshly mapped memory, zero config at generation 0
+    static SharedControlBlock* Create(void* memory) {
+        SharedControlBlock* block = new (memory) SharedControlBlock();
+        block->layout_version = SHARED_CONTROL_LAYOUT;
+        block->size = sizeof(SharedControlBlock);
+        block->magic.store(SHARED_CONTROL_MAGIC, std::memory_order_release);
+        return block;
+    }
+
+    // Launcher: the block in a mapped view, or nullptr if the hook has not
+    // formatted it yet or was built with another layout
+    static SharedControlBlock* Attach(void* memory) {
+        SharedControlBlock* block = static_cast<SharedControlBlock*>(memory);
+        if (block->magic.load(std::memory_order_acquire) != SHARED_CONTROL_MAGIC ||
+            block->layout_version != SHARED_CONTROL_LAYOUT || block->size != sizeof(SharedControlBlock)) {
+            return nullptr;
+        }
+        return block;
+    }
+
+    // Launcher. Returns the new generation.
+    uint32_t WriteConfig(const NetworkConfig& config) {
+        uint32_t words[CONFIG_WORDS];
+        std::memcpy(words, &config, sizeof(words));
+
+        uint32_t sequence = config_sequence.load(std::memory_order_relaxed);
+        config_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < CONFIG_WORDS; i++) {
+            config_words[i].store(words[i], std::memory_order_relaxed);
+        }
+        config_sequence.store(sequence + 2, std::memory_order_release);
+        return sequence + 2;
+    }
+
+    // Hook fast path: has a config newer than `generation` been started?
+    bool ConfigChanged(uint32_t generation) const {
+        return config_sequence.load(std::memory_order_relaxed) != generation;
+    }
+
+    // Hook. False while the launcher is mid-write (try again next frame);
+    // never waits on it.
+    bool ReadConfig(NetworkConfig* config, uint32_t* generation) const {
+        constexpr int MAX_ATTEMPTS = 4;
+        for (int attempt = 0; attempt < MAX_ATTEMPTS; attempt++) {
+            uint32_t before = config_sequence.load(std::memory_order_acquire);
+            if (before & 1) continue;
+
+            uint32_t words[CONFIG_WORDS];
+            for (size_t i = 0; i < CONFIG_WORDS; i++) {
+                words[i] = config_words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (config_sequence.load(std::memory_order_relaxed) != before) continue;
+
+            std::memcpy(config, words, sizeof(words));
+            *generation = before;
+            return true;
+        }
+        return false;
+    }
+
+    // Hook section
+    void AcknowledgeConfig(uint32_t generation) { applied_generation.store(generation, std::memory_order_release); }
+    void PublishFrame(uint32_t frame) { hook_frame.store(frame, std::memory_order_relaxed); }
+
+    // Launcher: whether the hook has taken the config of `generation` (or a later one)
+    bool ConfigApplied(uint32_t generation) const {
+        return static_cast<int32_t>(applied_generation.load(std::memory_order_acquire) - generation) >= 0;
+    }
+};
+
+static_assert(offsetof(SharedControlBlock, applied_generation) - offsetof(SharedControlBlock, config_sequence) >=
+              SharedControlBlock::CACHE_LINE, "Launcher and hook sections must not share a cache line");
+
+} // namespace FM2K
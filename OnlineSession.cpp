@@ -25,8 +25,8 @@ OnlineSession::OnlineSession()
     SDL_SetAtomicInt(&last_confirmed_frame_, 0);
     SDL_SetAtomicInt(&prediction_window_, 2); // Start with 2 frame prediction (20ms at 100 FPS)
     
-    // Pre-allocate state buffer (128 frames ? 1.28 seconds at 100fps)
-    state_buffer_.resize(STATE_BUFFER_SIZE);
+    // Pre-allocate state history (128 frames = 1.28 seconds at 100fps)
+    saved_states_.Init(STATE_BUFFER_SIZE, sizeof(FM2K::GameState));
 }
 
 OnlineSession::~OnlineSession() {
@@ -75,18 +75,16 @@ SessionMode OnlineSession::GetSessionMode() const {
 bool OnlineSession::SaveGameState(int frame) {
     if (!game_instance_) return false;
 
-    // Allocate buffer for state
-    std::vector<uint8_t> state_buffer(sizeof(FM2K::GameState));
-    
-    // Save state to buffer
+    // Save state into the recycled spare buffer
+    std::vector<uint8_t>& state_buffer = saved_states_.Spare();
     if (!game_instance_->SaveState(state_buffer.data(), state_buffer.size())) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
             "Failed to save game state");
         return false;
     }
 
-    // Store state in history
-    saved_states_[frame] = std::move(state_buffer);
+    // Move it into the history; the evicted buffer becomes the next spare
+    saved_states_.Store(frame);
     return true;
 }
 
@@ -94,15 +92,15 @@ bool OnlineSession::LoadGameState(int frame) {
     if (!game_instance_) return false;
 
     // Find state in history
-    auto it = saved_states_.find(frame);
-    if (it == saved_states_.end()) {
+    const std::vector<uint8_t>* state_buffer = saved_states_.Find(frame);
+    if (!state_buffer) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
             "No saved state found for frame %d", frame);
         return false;
     }
 
     // Load state from buffer
-    if (!game_instance_->LoadState(it->second.data(), it->second.size())) {
+    if (!game_instance_->LoadState(state_buffer->data(), state_buffer->size())) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
             "Failed to load game state");
         return false;
@@ -209,31 +207,23 @@ void OnlineSession::ProcessRollback(int target_frame) {
         return;
     }
     
-    // Re-simulate up to current frame
-    int current_frame = SDL_GetAtomicInt(&frame_counter_);
-    
-    SDL_LockRWLockForWriting(input_buffer_lock_);
-    for (int frame = target_frame + 1; frame <= current_frame; frame++) {
-        // TODO: Re-apply inputs and update game state
-        // This will need to use the FM2KGameInstance to:
-        // 1. Apply confirmed remote inputs
-        // 2. Re-simulate frame
-        // 3. Save new state
-    }
-    SDL_UnlockRWLock(input_buffer_lock_);
+    // Re-simulation happens in-process: the hook DLL queues the frames after
+    // GekkoNet's LoadEvent and replays them through the game's own
+    // trampolines within a per-frame budget (see SimulateFrame and RunCatchUp
+    // in FM2KHook/src/dllmain.cpp)
 }
 
 bool OnlineSession::ShouldRollback(uint32_t remote_input, int frame_number) {
-    // DLL handles rollback logic directly
-    return false; // DLL handles rollback decisions automatically
+    // The hook DLL decides in-process: it compares the inputs each frame
+    // consumed against the confirmed ones and elides rollbacks that would
+    // change nothing (see InputLedger in FM2KHook/src/input_ledger.h)
+    return false;
 }
 
 void OnlineSession::UpdatePredictionWindow() {
-    // TODO: Implement dynamic prediction window adjustment based on:
-    // 1. Network latency (ping)
-    // 2. Jitter
-    // 3. Rollback frequency
-    // This helps balance input delay vs rollback frequency
+    // The hook DLL tunes input delay in-process from ping, jitter and rollback
+    // depth (see InputDelayController in FM2KHook/src/delay_controller.h);
+    // NetworkConfig::input_delay is only its starting point
 }
 
 void OnlineSession::ProcessEvents(FM2KGameInstance* game) {
@@ -1,8 +1,8 @@
 #pragma once
 
 #include "ISession.h"
+#include "StateSlab.h"
 #include <memory>
-#include <unordered_map>
 #include <vector>
 #include <SDL3/SDL.h>
 
@@ -50,10 +50,9 @@ private:
     SDL_AtomicInt prediction_window_;
     NetworkStats cached_stats_;
     
-    // State buffer for rollbacks
+    // State history for rollbacks (128 frames = 1.28 seconds at 100fps)
     static constexpr size_t STATE_BUFFER_SIZE = 128;
-    std::vector<uint8_t> state_buffer_;
-    std::unordered_map<int, std::vector<uint8_t>> saved_states_;  // Frame number -> State data
+    StateSlab saved_states_;  // Frame number % STATE_BUFFER_SIZE -> State data
     
     // Thread functions
     static int RollbackThreadFunction(void* data);
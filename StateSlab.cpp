@@ -0,0 +1,70 @@
+#include "StateSlab.h"
+#include <utility>
+
+void StateSlab::Init(size_t capacity, size_t state_size) {
+    state_size_ = state_size;
+    slots_.clear();
+    slots_.resize(capacity);
+    for (Slot& slot : slots_) {
+        slot.frame = -1;
+        slot.generation = 0;
+        slot.valid = false;
+        slot.data.resize(state_size);
+    }
+    spare_.resize(state_size);
+    stats_ = {};
+}
+
+void StateSlab::Clear() {
+    for (Slot& slot : slots_) {
+        slot.valid = false;
+    }
+}
+
+std::vector<uint8_t>& StateSlab::Spare() {
+    if (spare_.capacity() < state_size_) {
+        stats_.allocations++;
+    }
+    spare_.resize(state_size_);
+    return spare_;
+}
+
+StateSlab::Slot* StateSlab::SlotFor(int frame) {
+    if (slots_.empty() || frame < 0) return nullptr;
+    return &slots_[static_cast<size_t>(frame) % slots_.size()];
+}
+
+const StateSlab::Slot* StateSlab::SlotFor(int frame) const {
+    if (slots_.empty() || frame < 0) return nullptr;
+    return &slots_[static_cast<size_t>(frame) % slots_.size()];
+}
+
+uint32_t StateSlab::Store(int frame) {
+    Slot* slot = SlotFor(frame);
+    if (!slot) return 0;
+
+    if (slot->valid && slot->frame != frame) {
+        stats_.evictions++;
+    }
+    std::swap(slot->data, spare_);
+    slot->frame = frame;
+    slot->generation++;
+    slot->valid = true;
+    stats_.stores++;
+    return slot->generation;
+}
+
+const std::vector<uint8_t>* StateSlab::Find(int frame) {
+    Slot* slot = SlotFor(frame);
+    if (!slot || !slot->valid || slot->frame != frame) {
+        stats_.stale_lookups++;
+        return nullptr;
+    }
+    stats_.loads++;
+    return &slot->data;
+}
+
+bool StateSlab::IsCurrent(int frame, uint32_t generation) const {
+    const Slot* slot = SlotFor(frame);
+    return slot && slot->valid && slot->frame == frame && slot->generation == generation;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed-capacity history of saved game states. Frame N lives in slot
+// N % capacity; each slot carries the frame it holds and a generation that
+// bumps every time the slot is reused, so lookups are one compare and a
+// caller holding (frame, generation) can tell whether its state survived.
+//
+// Buffers are recycled, never freed: a save fills Spare() and Store() swaps it
+// into the slot, handing the evicted buffer back as the next spare. After
+// Init, allocations only happen if the state size grows.
+class StateSlab {
+public:
+    struct Stats {
+        uint64_t stores;
+        uint64_t loads;
+        uint64_t evictions;      // Stores that replaced another valid frame
+        uint64_t stale_lookups;  // Lookups whose slot was empty or held another frame
+        uint64_t allocations;    // Buffer allocations since Init (0 in steady state)
+    };
+
+    StateSlab() = default;
+
+    void Init(size_t capacity, size_t state_size);
+    void Clear();
+
+    // Buffer to fill for the next Store, sized to the state size
+    std::vector<uint8_t>& Spare();
+
+    // Move the spare into the slot for `frame`. Returns the slot's new generation.
+    uint32_t Store(int frame);
+
+    // State saved for `frame`, or nullptr if its slot is empty or reused
+    const std::vector<uint8_t>* Find(int frame);
+    bool IsCurrent(int frame, uint32_t generation) const;
+
+    size_t Capacity() const { return slots_.size(); }
+    Stats GetStats() const { return stats_; }
+
+private:
+    struct Slot {
+        int frame;
+        uint32_t generation;
+        bool valid;
+        std::vector<uint8_t> data;
+    };
+
+    Slot* SlotFor(int frame);
+    const Slot* SlotFor(int frame) const;
+
+    std::vector<Slot> slots_;
+    std::vector<uint8_t> spare_;
+    size_t state_size_ = 0;
+    Stats stats_ = {};
+};